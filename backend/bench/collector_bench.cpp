@@ -0,0 +1,590 @@
+// Collector benchmark over recorded or synthetic procfs/sysfs trees.
+//
+// The collector reads everything through MetricsCollector's configurable proc and sys roots, so it can
+// be pointed at a fixture directory instead of the live kernel. For every requested process count the
+// benchmark writes a synthetic tree (per-process stat, status, io, cmdline, smaps_rollup, cgroup and fd
+// entries, socket tables, meminfo, loadavg, ...), runs --iterations collections after one warm-up and
+// reports per-stage latency and heap allocations as seen through a stage listener and a counting
+// operator new:
+//
+//   collector_bench --processes 1000,10000,100000 --sockets 4000 --iterations 10
+//
+// --threads N runs independent stages on the collector's stage pool, as the server does; the total then
+// approaches the slowest stage rather than the sum. Allocations are attributed to stages only with one
+// thread, since concurrent stages share the counter. --backend sync|io_uring|both picks how the process
+// walk reads /proc; `both` runs every tree with each backend for a side-by-side comparison:
+//
+//   collector_bench --processes 10000,50000 --backend both
+//
+// --detail-budget US sets the per-walk time budget of the PSS/cgroup/fd detail probes (0 disables them),
+// to see what the budget costs on top of the walk.
+//
+// --record DIR copies the live /proc and /sys files the collector reads into DIR/proc and DIR/sys, so a
+// busy production host can be captured once and replayed anywhere:
+//
+//   collector_bench --record /tmp/host-fixture
+//   collector_bench --proc-root /tmp/host-fixture/proc --sys-root /tmp/host-fixture/sys
+//
+// Docker is never collected and disk usage still comes from statvfs("/"); both sit outside procfs.
+#include "system_metrics.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    std::atomic<unsigned long long> g_allocations(0);
+
+    void *counted_allocation(std::size_t size, std::size_t alignment)
+    {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        void *memory = nullptr;
+        if (alignment <= alignof(std::max_align_t))
+        {
+            memory = std::malloc(size == 0 ? 1 : size);
+        }
+        else if (posix_memalign(&memory, alignment, size == 0 ? alignment : size) != 0)
+        {
+            memory = nullptr;
+        }
+        if (memory == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return memory;
+    }
+} // namespace
+
+// Array and nothrow forms forward to these by default, so every heap allocation is counted once.
+void *operator new(std::size_t size)
+{
+    return counted_allocation(size, alignof(std::max_align_t));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return counted_allocation(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+    constexpr std::size_t STAGE_COUNT = static_cast<std::size_t>(CollectorStage::Count);
+    constexpr unsigned int BENCH_SECTIONS = SECTION_ALL & ~SECTION_DOCKER;
+    // The collector serves a cached snapshot to refreshes closer together than this.
+    constexpr auto COLLECTION_SPACING = std::chrono::milliseconds(450);
+
+    struct Options
+    {
+        std::vector<std::size_t> processes{1000, 10000, 100000};
+        std::size_t sockets = 2000;
+        std::size_t iterations = 10;
+        std::size_t threads = 1;
+        std::vector<bool> backends{false}; // io_uring off / on
+        std::size_t detail_budget_us = 2000;
+        std::string proc_root;
+        std::string sys_root;
+        std::string record;
+        std::string fixture_dir;
+    };
+
+    void usage()
+    {
+        std::cerr << "usage: collector_bench [--processes N[,N...]] [--sockets N] [--iterations N] [--threads N] [--backend B] [--detail-budget US] [--fixture-dir DIR]\n"
+                     "       collector_bench --proc-root DIR [--sys-root DIR] [--iterations N] [--threads N] [--backend B] [--detail-budget US]\n"
+                     "       collector_bench --record DIR\n";
+    }
+
+    std::vector<std::size_t> parse_list(const std::string &value)
+    {
+        std::vector<std::size_t> values;
+        std::istringstream stream(value);
+        std::string item;
+        while (std::getline(stream, item, ','))
+        {
+            const std::size_t count = std::strtoul(item.c_str(), nullptr, 10);
+            if (count > 0)
+            {
+                values.push_back(count);
+            }
+        }
+        return values;
+    }
+
+    bool parse_options(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string flag = argv[i];
+            if (i + 1 >= argc)
+            {
+                return false;
+            }
+            const char *value = argv[++i];
+            if (flag == "--processes")
+            {
+                options.processes = parse_list(value);
+            }
+            else if (flag == "--sockets")
+            {
+                options.sockets = std::strtoul(value, nullptr, 10);
+            }
+            else if (flag == "--iterations")
+            {
+                options.iterations = std::max<std::size_t>(1, std::strtoul(value, nullptr, 10));
+            }
+            else if (flag == "--threads")
+            {
+                options.threads = std::max<std::size_t>(1, std::strtoul(value, nullptr, 10));
+            }
+            else if (flag == "--backend")
+            {
+                const std::string backend = value;
+                if (backend == "sync")
+                {
+                    options.backends = {false};
+                }
+                else if (backend == "io_uring")
+                {
+                    options.backends = {true};
+                }
+                else if (backend == "both")
+                {
+                    options.backends = {false, true};
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            else if (flag == "--detail-budget")
+            {
+                options.detail_budget_us = std::strtoul(value, nullptr, 10);
+            }
+            else if (flag == "--proc-root")
+            {
+                options.proc_root = value;
+            }
+            else if (flag == "--sys-root")
+            {
+                options.sys_root = value;
+            }
+            else if (flag == "--record")
+            {
+                options.record = value;
+            }
+            else if (flag == "--fixture-dir")
+            {
+                options.fixture_dir = value;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return !options.processes.empty() || !options.proc_root.empty();
+    }
+
+    // Plain write(2): the generator creates hundreds of thousands of files and streams would dominate.
+    void write_file(const std::string &path, const std::string &contents)
+    {
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            throw std::runtime_error("cannot create " + path);
+        }
+        const ssize_t written = ::write(fd, contents.data(), contents.size());
+        ::close(fd);
+        if (written != static_cast<ssize_t>(contents.size()))
+        {
+            throw std::runtime_error("short write to " + path);
+        }
+    }
+
+    bool read_file(const std::string &path, std::string &contents)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        contents = buffer.str();
+        return static_cast<bool>(file) || file.eof();
+    }
+
+    std::string socket_table(std::size_t rows, bool ipv6, bool tcp)
+    {
+        const std::string loopback = ipv6 ? "00000000000000000000000001000000" : "0100007F";
+        const std::string any = ipv6 ? "00000000000000000000000000000000" : "00000000";
+        std::string table = "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n";
+        char line[256];
+        for (std::size_t i = 0; i < rows; ++i)
+        {
+            // One in eight sockets listens; the rest are established connections to loopback so that
+            // domain attribution runs without waiting on a resolver.
+            const bool listening = i % 8 == 0;
+            const char *state = listening ? (tcp ? "0A" : "07") : "01";
+            std::snprintf(line, sizeof(line), "%4zu: %s:%04zX %s:%04zX %s 00000000:00000000 00:00000000 00000000  1000        0 %zu 1\n",
+                          i, loopback.c_str(), 1024 + i % 60000, listening ? any.c_str() : loopback.c_str(),
+                          listening ? std::size_t{0} : 30000 + i % 30000, state, 100000 + i);
+            table += line;
+        }
+        return table;
+    }
+
+    void write_global_files(const fs::path &proc, const fs::path &sys, std::size_t processes, std::size_t sockets)
+    {
+        fs::create_directories(proc / "net");
+        fs::create_directories(proc / "sys" / "fs");
+        fs::create_directories(sys / "devices" / "system" / "cpu");
+
+        std::string stat = "cpu  4705 356 584 3699176 23060 0 277 0 0 0\n";
+        for (int cpu = 0; cpu < 8; ++cpu)
+        {
+            stat += "cpu" + std::to_string(cpu) + " 588 44 73 462397 2882 0 34 0 0 0\n";
+        }
+        stat += "intr 1462898 0 9 0\nctxt 2560420\nbtime 1700000000\nprocesses " + std::to_string(processes) +
+                "\nprocs_running 2\nprocs_blocked 0\n";
+        write_file((proc / "stat").string(), stat);
+        write_file((proc / "meminfo").string(),
+                   "MemTotal:       32768000 kB\nMemFree:         8192000 kB\nMemAvailable:   16384000 kB\n"
+                   "Buffers:          512000 kB\nCached:          6144000 kB\nSwapCached:            0 kB\n"
+                   "SwapTotal:       8388604 kB\nSwapFree:        8000000 kB\n");
+        write_file((proc / "loadavg").string(), "1.25 0.98 0.75 3/" + std::to_string(processes) + " 424242\n");
+        write_file((proc / "sys" / "fs" / "file-nr").string(), "12640\t0\t9223372036854775807\n");
+        write_file((proc / "net" / "dev").string(),
+                   "Inter-|   Receive                                                |  Transmit\n"
+                   " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n"
+                   "    lo: 9012345   81234    0    0    0     0          0         0  9012345   81234    0    0    0     0       0          0\n"
+                   "  eth0: 987654321 765432    0    0    0     0          0         0 123456789 345678    0    0    0     0       0          0\n");
+        write_file((proc / "net" / "tcp").string(), socket_table(sockets / 2, false, true));
+        write_file((proc / "net" / "tcp6").string(), socket_table(sockets / 4, true, true));
+        write_file((proc / "net" / "udp").string(), socket_table(sockets / 8, false, false));
+        write_file((proc / "net" / "udp6").string(), socket_table(sockets / 8, true, false));
+        write_file((sys / "devices" / "system" / "cpu" / "online").string(), "0-7\n");
+    }
+
+    // A status file with the fields and length of a real one; the collector scans it for four keys.
+    std::string status_file(std::size_t pid, const std::string &name, std::size_t threads)
+    {
+        std::ostringstream status;
+        status << "Name:\t" << name << "\nUmask:\t0022\nState:\tS (sleeping)\nTgid:\t" << pid << "\nNgid:\t0\nPid:\t" << pid
+               << "\nPPid:\t1\nTracerPid:\t0\nUid:\t1000\t1000\t1000\t1000\nGid:\t1000\t1000\t1000\t1000\nFDSize:\t64\n"
+                  "Groups:\t1000\nNStgid:\t" << pid << "\nNSpid:\t" << pid << "\nNSpgid:\t" << pid << "\nNSsid:\t" << pid
+               << "\nVmPeak:\t  812344 kB\nVmSize:\t  745132 kB\nVmLck:\t       0 kB\nVmPin:\t       0 kB\nVmHWM:\t   "
+               << 20000 + pid % 50000 << " kB\nVmRSS:\t   " << 18000 + pid % 50000
+               << " kB\nRssAnon:\t   12000 kB\nRssFile:\t    6000 kB\nRssShmem:\t       0 kB\nVmData:\t  120000 kB\n"
+                  "VmStk:\t     132 kB\nVmExe:\t    2048 kB\nVmLib:\t   14000 kB\nVmPTE:\t     220 kB\nVmSwap:\t       0 kB\n"
+                  "HugetlbPages:\t       0 kB\nCoreDumping:\t0\nTHP_enabled:\t1\nThreads:\t" << threads
+               << "\nSigQ:\t0/127431\nSigPnd:\t0000000000000000\nShdPnd:\t0000000000000000\nSigBlk:\t0000000000000000\n"
+                  "SigIgn:\t0000000000001000\nSigCgt:\t0000000180004a02\nCapInh:\t0000000000000000\nCapPrm:\t0000000000000000\n"
+                  "CapEff:\t0000000000000000\nCapBnd:\t000001ffffffffff\nCapAmb:\t0000000000000000\nNoNewPrivs:\t0\nSeccomp:\t0\n"
+                  "Seccomp_filters:\t0\nSpeculation_Store_Bypass:\tthread vulnerable\nCpus_allowed:\tff\nCpus_allowed_list:\t0-7\n"
+                  "Mems_allowed:\t00000001\nMems_allowed_list:\t0\nvoluntary_ctxt_switches:\t" << pid * 3
+               << "\nnonvoluntary_ctxt_switches:\t" << pid % 97 << "\n";
+        return status.str();
+    }
+
+    void write_process(const fs::path &proc, std::size_t pid)
+    {
+        // Pools of identically named workers, as on real hosts, so interning sees repeats.
+        static const std::array<const char *, 8> NAMES = {"nginx", "postgres", "java", "python3", "node", "sshd", "kworker/0:1", "systemd"};
+        const std::string name = NAMES[pid % NAMES.size()];
+        const std::size_t threads = 1 + pid % 16;
+        const fs::path directory = proc / std::to_string(pid);
+        fs::create_directories(directory / "fd");
+
+        char stat[512];
+        std::snprintf(stat, sizeof(stat),
+                      "%zu (%s) S 1 %zu %zu 0 -1 4194560 1520 0 0 0 %zu %zu 0 0 20 0 %zu 0 %zu 745132032 %zu "
+                      "18446744073709551615 1 1 0 0 0 0 0 4096 16384 0 0 0 17 %zu 0 0 0 0 0 0 0 0 0 0 0 0 0\n",
+                      pid, name.c_str(), pid, pid, pid * 7 % 100000, pid * 3 % 50000, threads, 1000 + pid, 4500 + pid % 12500, pid % 8);
+        write_file((directory / "stat").string(), stat);
+        write_file((directory / "status").string(), status_file(pid, name, threads));
+        write_file((directory / "io").string(), "rchar: " + std::to_string(pid * 4096) + "\nwchar: " + std::to_string(pid * 1024) +
+                                                    "\nsyscr: 100\nsyscw: 50\nread_bytes: " + std::to_string(pid * 512) +
+                                                    "\nwrite_bytes: " + std::to_string(pid * 256) + "\ncancelled_write_bytes: 0\n");
+        std::string cmdline = "/usr/bin/" + name;
+        cmdline.push_back('\0');
+        cmdline += "--config=/etc/" + name + "/" + name + ".conf";
+        cmdline.push_back('\0');
+        cmdline += "--worker=" + std::to_string(pid % 32);
+        cmdline.push_back('\0');
+        write_file((directory / "cmdline").string(), cmdline);
+        const std::size_t rss = 1000 + pid % 50000;
+        write_file((directory / "smaps_rollup").string(),
+                   "55d4c0a00000-7ffd5a3fe000 ---p 00000000 00:00 0                          [rollup]\nRss:             " +
+                       std::to_string(rss) + " kB\nPss:             " + std::to_string(rss * 2 / 3) +
+                       " kB\nPss_Anon:        " + std::to_string(rss / 2) + " kB\nPss_File:        " + std::to_string(rss / 6) +
+                       " kB\nPss_Shmem:           0 kB\nShared_Clean:    " + std::to_string(rss / 3) +
+                       " kB\nShared_Dirty:          0 kB\nPrivate_Clean:       0 kB\nPrivate_Dirty:   " + std::to_string(rss / 2) +
+                       " kB\nReferenced:      " + std::to_string(rss) + " kB\nAnonymous:       " + std::to_string(rss / 2) +
+                       " kB\nSwap:                  0 kB\nSwapPss:               0 kB\nLocked:                0 kB\n");
+        write_file((directory / "cgroup").string(), "0::/system.slice/" + name + ".service\n");
+        for (int fd = 0; fd < 3; ++fd)
+        {
+            fs::create_symlink("/dev/null", directory / "fd" / std::to_string(fd));
+        }
+    }
+
+    void generate_tree(const fs::path &root, std::size_t processes, std::size_t sockets)
+    {
+        fs::remove_all(root);
+        write_global_files(root / "proc", root / "sys", processes, sockets);
+        for (std::size_t pid = 1; pid <= processes; ++pid)
+        {
+            write_process(root / "proc", pid);
+        }
+    }
+
+    // Copies what the collector reads from the live kernel. fd directories become symlinks to
+    // /dev/null, one per open descriptor; unreadable per-process files are left out.
+    void record_tree(const fs::path &root)
+    {
+        std::string contents;
+        const auto copy = [&contents](const fs::path &from, const fs::path &to)
+        {
+            if (read_file(from.string(), contents))
+            {
+                fs::create_directories(to.parent_path());
+                write_file(to.string(), contents);
+            }
+        };
+
+        const fs::path proc = root / "proc";
+        for (const char *file : {"stat", "meminfo", "loadavg", "net/dev", "net/tcp", "net/tcp6", "net/udp", "net/udp6", "sys/fs/file-nr"})
+        {
+            copy(fs::path("/proc") / file, proc / file);
+        }
+        copy("/sys/devices/system/cpu/online", root / "sys" / "devices" / "system" / "cpu" / "online");
+
+        std::size_t recorded = 0;
+        std::error_code ignored;
+        for (const auto &entry : fs::directory_iterator("/proc", ignored))
+        {
+            const std::string pid = entry.path().filename().string();
+            if (pid.empty() || !std::isdigit(static_cast<unsigned char>(pid[0])))
+            {
+                continue;
+            }
+            for (const char *file : {"stat", "status", "io", "cmdline", "smaps_rollup", "cgroup"})
+            {
+                copy(entry.path() / file, proc / pid / file);
+            }
+            fs::create_directories(proc / pid / "fd");
+            std::size_t descriptors = 0;
+            for (auto fd = fs::directory_iterator(entry.path() / "fd", ignored); !ignored && fd != fs::directory_iterator(); fd.increment(ignored))
+            {
+                fs::create_symlink("/dev/null", proc / pid / "fd" / std::to_string(descriptors++), ignored);
+            }
+            ignored.clear();
+            ++recorded;
+        }
+        std::cout << "recorded " << recorded << " processes into " << root.string() << "\n";
+    }
+
+    double percentile(std::vector<double> values, double p)
+    {
+        if (values.empty())
+        {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        const auto index = static_cast<std::size_t>(p * static_cast<double>(values.size() - 1) + 0.5);
+        return values[std::min(index, values.size() - 1)];
+    }
+
+    struct StageSamples
+    {
+        std::vector<double> micros;
+        unsigned long long allocations = 0;
+    };
+
+    void run(const std::string &label, const std::string &procRoot, const std::string &sysRoot, std::size_t iterations,
+             std::size_t threads, bool ioUring, std::size_t detailBudgetUs)
+    {
+        CollectorConfig config{};
+        config.proc_root = procRoot;
+        config.sys_root = sysRoot;
+        config.threads = threads;
+        config.io_uring = ioUring;
+        config.detail_budget = std::chrono::microseconds(detailBudgetUs);
+        MetricsCollector collector(config);
+
+        std::array<StageSamples, STAGE_COUNT> stages{};
+        std::mutex stages_mutex;
+        bool recording = false;
+        unsigned long long mark = 0;
+        collector.add_stage_listener([&](CollectorStage stage, Clock::time_point start, Clock::time_point end)
+                                     {
+            std::lock_guard<std::mutex> lock(stages_mutex);
+            if (!recording)
+            {
+                return;
+            }
+            StageSamples &samples = stages[static_cast<std::size_t>(stage)];
+            samples.micros.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+            // Reverse lookups run inside the connections stage, whose allocations they stay part of.
+            if (stage != CollectorStage::ReverseDns)
+            {
+                const unsigned long long now = g_allocations.load(std::memory_order_relaxed);
+                samples.allocations += now - mark;
+                mark = g_allocations.load(std::memory_order_relaxed);
+            } });
+
+        // The first collection primes the per-process counters and the reverse DNS cache.
+        collector.refresh(BENCH_SECTIONS);
+        std::this_thread::sleep_for(COLLECTION_SPACING);
+
+        std::vector<double> totals;
+        unsigned long long allocations = 0;
+        std::size_t processes = 0;
+        for (std::size_t i = 0; i < iterations; ++i)
+        {
+            recording = true;
+            const unsigned long long before = g_allocations.load(std::memory_order_relaxed);
+            mark = before;
+            const auto started = Clock::now();
+            const auto snapshot = collector.snapshot(BENCH_SECTIONS);
+            totals.push_back(std::chrono::duration<double, std::micro>(Clock::now() - started).count());
+            allocations += g_allocations.load(std::memory_order_relaxed) - before;
+            recording = false;
+            processes = snapshot->processCount;
+            std::this_thread::sleep_for(COLLECTION_SPACING);
+        }
+
+        const double runs = static_cast<double>(iterations);
+        std::cout << "\n" << label << ": " << processes << " processes, " << iterations << " collections, " << threads
+                  << (threads == 1 ? " thread, " : " threads, ") << (ioUring ? "io_uring" : "sync") << " reads, "
+                  << detailBudgetUs << " us detail budget\n"
+                  << std::left << std::setw(18) << "stage" << std::right << std::setw(12) << "p50 (us)" << std::setw(12)
+                  << "p99 (us)" << std::setw(16) << "allocs/collect" << "\n";
+        std::cout << std::fixed << std::setprecision(0);
+        for (std::size_t i = 0; i < STAGE_COUNT; ++i)
+        {
+            const StageSamples &samples = stages[i];
+            if (samples.micros.empty())
+            {
+                continue;
+            }
+            std::cout << std::left << std::setw(18) << collector_stage_name(static_cast<CollectorStage>(i)) << std::right
+                      << std::setw(12) << percentile(samples.micros, 0.50) << std::setw(12) << percentile(samples.micros, 0.99)
+                      << std::setw(16);
+            if (threads == 1)
+            {
+                std::cout << static_cast<double>(samples.allocations) / runs << "\n";
+            }
+            else
+            {
+                std::cout << "-" << "\n";
+            }
+        }
+        std::cout << std::left << std::setw(18) << "total" << std::right << std::setw(12) << percentile(totals, 0.50)
+                  << std::setw(12) << percentile(totals, 0.99) << std::setw(16) << static_cast<double>(allocations) / runs << "\n";
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        usage();
+        return 2;
+    }
+
+    try
+    {
+        if (!options.record.empty())
+        {
+            record_tree(options.record);
+            return 0;
+        }
+
+        if (!options.proc_root.empty())
+        {
+            for (const bool ioUring : options.backends)
+            {
+                run(options.proc_root, options.proc_root, options.sys_root.empty() ? "/sys" : options.sys_root, options.iterations,
+                    options.threads, ioUring, options.detail_budget_us);
+            }
+            return 0;
+        }
+
+        const bool keep = !options.fixture_dir.empty();
+        const fs::path base = keep ? fs::path(options.fixture_dir)
+                                   : fs::temp_directory_path() / ("collector_bench." + std::to_string(::getpid()));
+        for (const std::size_t processes : options.processes)
+        {
+            const fs::path root = base / std::to_string(processes);
+            const auto started = Clock::now();
+            generate_tree(root, processes, options.sockets);
+            std::cout << "generated " << processes << " processes and " << options.sockets << " sockets in "
+                      << std::chrono::duration<double>(Clock::now() - started).count() << " s\n";
+            for (const bool ioUring : options.backends)
+            {
+                run("synthetic", (root / "proc").string(), (root / "sys").string(), options.iterations, options.threads, ioUring,
+                    options.detail_budget_us);
+            }
+            if (!keep)
+            {
+                fs::remove_all(root);
+            }
+        }
+        if (!keep)
+        {
+            fs::remove_all(base);
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << "collector_bench: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
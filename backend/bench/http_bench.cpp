@@ -0,0 +1,251 @@
+// Closed-loop HTTP/1.1 load generator for the metrics endpoint.
+//
+// Each connection keeps `--pipeline` requests in flight over one keep-alive socket and records the
+// latency of every response. Run it against two builds (or two listeners) with the same flags to
+// compare throughput and tail latency:
+//
+//   http_bench --port 8080 --path /metrics --connections 16 --duration 10
+//   http_bench --port 8080 --path /metrics/openmetrics --pipeline 8 --token secret
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    struct Options
+    {
+        std::string host = "127.0.0.1";
+        std::string port = "8080";
+        std::string path = "/metrics";
+        std::string token;
+        std::string etag;
+        std::size_t connections = 8;
+        std::size_t pipeline = 1;
+        double duration = 10.0;
+        double warmup = 1.0;
+    };
+
+    struct Result
+    {
+        std::vector<double> latencies_us;
+        std::size_t bytes = 0;
+        std::size_t errors = 0;
+        std::size_t non_ok = 0;
+    };
+
+    void usage()
+    {
+        std::cerr << "usage: http_bench [--host H] [--port P] [--path /metrics] [--connections N]\n"
+                     "                  [--pipeline DEPTH] [--duration SECONDS] [--warmup SECONDS]\n"
+                     "                  [--token TOKEN] [--if-none-match ETAG]\n";
+    }
+
+    bool parse_options(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string flag = argv[i];
+            if (i + 1 >= argc)
+            {
+                return false;
+            }
+            const char *value = argv[++i];
+            if (flag == "--host")
+            {
+                options.host = value;
+            }
+            else if (flag == "--port")
+            {
+                options.port = value;
+            }
+            else if (flag == "--path")
+            {
+                options.path = value;
+            }
+            else if (flag == "--token")
+            {
+                options.token = value;
+            }
+            else if (flag == "--if-none-match")
+            {
+                options.etag = value;
+            }
+            else if (flag == "--connections")
+            {
+                options.connections = std::max<std::size_t>(1, std::strtoul(value, nullptr, 10));
+            }
+            else if (flag == "--pipeline")
+            {
+                options.pipeline = std::max<std::size_t>(1, std::strtoul(value, nullptr, 10));
+            }
+            else if (flag == "--duration")
+            {
+                options.duration = std::max(0.1, std::atof(value));
+            }
+            else if (flag == "--warmup")
+            {
+                options.warmup = std::max(0.0, std::atof(value));
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string build_request(const Options &options)
+    {
+        http::request<http::empty_body> req{http::verb::get, options.path, 11};
+        req.set(http::field::host, options.host);
+        req.set(http::field::user_agent, "http_bench");
+        req.keep_alive(true);
+        if (!options.token.empty())
+        {
+            req.set(http::field::authorization, "Bearer " + options.token);
+        }
+        if (!options.etag.empty())
+        {
+            req.set(http::field::if_none_match, options.etag);
+        }
+
+        std::ostringstream out;
+        out << req;
+        return out.str();
+    }
+
+    void run_connection(const Options &options, const std::string &request, Clock::time_point measureFrom,
+                        Clock::time_point deadline, Result &result)
+    {
+        net::io_context ioc;
+        tcp::resolver resolver(ioc);
+        beast::tcp_stream stream(ioc);
+        beast::flat_buffer buffer;
+
+        std::string batch;
+        for (std::size_t i = 0; i < options.pipeline; ++i)
+        {
+            batch += request;
+        }
+
+        try
+        {
+            stream.connect(resolver.resolve(options.host, options.port));
+            stream.socket().set_option(tcp::no_delay(true));
+
+            while (Clock::now() < deadline)
+            {
+                const auto sent = Clock::now();
+                net::write(stream, net::buffer(batch));
+                for (std::size_t i = 0; i < options.pipeline; ++i)
+                {
+                    http::response<http::string_body> res;
+                    http::read(stream, buffer, res);
+                    const auto received = Clock::now();
+                    if (sent < measureFrom)
+                    {
+                        continue;
+                    }
+                    result.latencies_us.push_back(std::chrono::duration<double, std::micro>(received - sent).count());
+                    result.bytes += res.body().size();
+                    if (res.result() != http::status::ok && res.result() != http::status::not_modified)
+                    {
+                        ++result.non_ok;
+                    }
+                    if (!res.keep_alive())
+                    {
+                        throw std::runtime_error("server closed the connection");
+                    }
+                }
+            }
+
+            beast::error_code ec;
+            stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+        }
+        catch (const std::exception &ex)
+        {
+            ++result.errors;
+            std::cerr << "connection error: " << ex.what() << std::endl;
+        }
+    }
+
+    double percentile(const std::vector<double> &sorted, double p)
+    {
+        if (sorted.empty())
+        {
+            return 0.0;
+        }
+        const auto index = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        usage();
+        return 2;
+    }
+
+    const std::string request = build_request(options);
+    const auto start = Clock::now();
+    const auto measureFrom = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.warmup));
+    const auto deadline = measureFrom + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration));
+
+    std::vector<Result> results(options.connections);
+    std::vector<std::thread> threads;
+    threads.reserve(options.connections);
+    for (std::size_t i = 0; i < options.connections; ++i)
+    {
+        threads.emplace_back(run_connection, std::cref(options), std::cref(request), measureFrom, deadline, std::ref(results[i]));
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    std::vector<double> latencies;
+    std::size_t bytes = 0;
+    std::size_t errors = 0;
+    std::size_t nonOk = 0;
+    for (auto &result : results)
+    {
+        latencies.insert(latencies.end(), result.latencies_us.begin(), result.latencies_us.end());
+        bytes += result.bytes;
+        errors += result.errors;
+        nonOk += result.non_ok;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    const double seconds = options.duration;
+    std::cout << std::fixed << std::setprecision(1)
+              << "target        http://" << options.host << ':' << options.port << options.path << '\n'
+              << "connections   " << options.connections << " x pipeline " << options.pipeline << '\n'
+              << "requests      " << latencies.size() << " in " << seconds << " s (" << nonOk << " non-2xx/304, "
+              << errors << " connection errors)\n"
+              << "throughput    " << static_cast<double>(latencies.size()) / seconds << " req/s, "
+              << static_cast<double>(bytes) / seconds / (1024.0 * 1024.0) << " MiB/s body\n"
+              << "latency (us)  p50 " << percentile(latencies, 0.50) << "  p90 " << percentile(latencies, 0.90)
+              << "  p99 " << percentile(latencies, 0.99) << "  p99.9 " << percentile(latencies, 0.999)
+              << "  max " << (latencies.empty() ? 0.0 : latencies.back()) << std::endl;
+
+    return errors == 0 ? 0 : 1;
+}
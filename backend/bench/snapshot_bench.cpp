@@ -0,0 +1,300 @@
+// Reader contention benchmark for snapshot publication.
+//
+// Dozens of reader threads fetch the current snapshot in a tight loop while one writer publishes a
+// new version every --publish-us microseconds. Each strategy is run for --duration seconds:
+//
+//   mutex-copy   the previous scheme: lock, copy the whole SystemMetrics, unlock
+//   atomic-sp    std::atomic_load/atomic_store on a shared_ptr (libstdc++ guards these with a lock pool)
+//   publisher    SnapshotPublisher: hazard-slot protected pointer swap, zero-copy handle
+//   collector    MetricsCollector::snapshot() against the live collector (publisher plus freshness check)
+//
+//   snapshot_bench --readers 48 --duration 3 --publish-us 500 --apps 300
+#include "snapshot_publisher.h"
+#include "system_metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    // Keeps the readers' loads observable so the compiler cannot drop them.
+    std::atomic<unsigned long long> g_sink(0);
+
+    struct Options
+    {
+        std::size_t readers = 32;
+        double duration = 3.0;
+        long publish_us = 1000;
+        std::size_t apps = 200;
+    };
+
+    struct Outcome
+    {
+        unsigned long long reads = 0;
+        std::vector<double> latencies_ns;
+    };
+
+    void usage()
+    {
+        std::cerr << "usage: snapshot_bench [--readers N] [--duration SECONDS] [--publish-us MICROS] [--apps N]\n";
+    }
+
+    bool parse_options(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string flag = argv[i];
+            if (i + 1 >= argc)
+            {
+                return false;
+            }
+            const char *value = argv[++i];
+            if (flag == "--readers")
+            {
+                options.readers = std::max<std::size_t>(1, std::strtoul(value, nullptr, 10));
+            }
+            else if (flag == "--duration")
+            {
+                options.duration = std::max(0.1, std::atof(value));
+            }
+            else if (flag == "--publish-us")
+            {
+                options.publish_us = std::max(10L, std::strtol(value, nullptr, 10));
+            }
+            else if (flag == "--apps")
+            {
+                options.apps = std::strtoul(value, nullptr, 10);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // A snapshot shaped like a busy host: many processes, domains and containers with string fields in an arena.
+    SystemMetrics make_snapshot(std::size_t apps)
+    {
+        auto arena = std::make_shared<SnapshotArena>();
+        SystemMetrics m{};
+        m.arena = arena;
+        m.timestamp = std::chrono::system_clock::now();
+        m.cpuUsage = 42.0;
+        m.cpuCount = 16;
+        m.sections = SECTION_ALL;
+        m.collectedSections = SECTION_ALL;
+        for (std::size_t i = 0; i < apps; ++i)
+        {
+            ApplicationUsage app{};
+            app.pid = static_cast<int>(1000 + i);
+            app.name = arena->intern("worker-" + std::to_string(i % 40));
+            app.cpuPercent = 1.5;
+            app.memoryMb = 120.0;
+            app.commandLine = arena->intern("/usr/bin/worker --config /etc/worker/worker-" + std::to_string(i) + ".yaml --verbose");
+            app.threads = 4;
+            app.openFds = 32;
+            app.pssAgeMs = -1.0;
+            app.openFdsAgeMs = 0.0;
+            app.cgroupAgeMs = -1.0;
+            m.topApplications.push_back(app);
+        }
+        for (std::size_t i = 0; i < apps / 4; ++i)
+        {
+            m.domainUsage.push_back({arena->intern("host-" + std::to_string(i) + ".internal.example.com"), 12.0, 3.0, 4});
+        }
+        for (std::size_t i = 0; i < apps / 10; ++i)
+        {
+            DockerContainerSummary container{};
+            container.id = arena->intern("c0ffee" + std::to_string(i));
+            container.name = arena->intern("service-" + std::to_string(i));
+            container.image = arena->intern("registry.example.com/service:1.2." + std::to_string(i));
+            container.status = arena->intern("Up 3 hours");
+            container.cpuPercent = 2.0;
+            container.memoryUsageMb = 256.0;
+            container.memoryLimitMb = 1024.0;
+            container.memoryPercent = 25.0;
+            container.networkRxKb = 10.0;
+            container.networkTxKb = 5.0;
+            container.blockReadKb = 1.0;
+            container.blockWriteKb = 1.0;
+            container.pids = 12;
+            container.cpuPressure = 0.5;
+            container.memoryPressure = 0.0;
+            container.ioPressure = 0.2;
+            m.dockerContainers.push_back(container);
+        }
+        return m;
+    }
+
+    double percentile(const std::vector<double> &sorted, double p)
+    {
+        if (sorted.empty())
+        {
+            return 0.0;
+        }
+        const auto index = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+
+    // Runs `read` on every reader thread and `publish` on a writer thread, then prints one result line.
+    template <typename Read, typename Publish>
+    void run(const char *name, const Options &options, Read read, Publish publish)
+    {
+        std::atomic<bool> stop(false);
+        std::atomic<std::size_t> ready(0);
+        std::vector<Outcome> outcomes(options.readers);
+        std::vector<std::thread> threads;
+
+        for (std::size_t r = 0; r < options.readers; ++r)
+        {
+            threads.emplace_back([&, r]()
+                                 {
+                Outcome &outcome = outcomes[r];
+                outcome.latencies_ns.reserve(1 << 16);
+                double sink = 0.0;
+                ready.fetch_add(1);
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    // Time every 16th read so clock overhead does not dominate.
+                    if ((outcome.reads & 15) == 0)
+                    {
+                        const auto started = Clock::now();
+                        sink += read();
+                        outcome.latencies_ns.push_back(std::chrono::duration<double, std::nano>(Clock::now() - started).count());
+                    }
+                    else
+                    {
+                        sink += read();
+                    }
+                    ++outcome.reads;
+                }
+                g_sink.fetch_add(static_cast<unsigned long long>(sink), std::memory_order_relaxed); });
+        }
+
+        std::thread writer([&]()
+                           {
+            while (ready.load() < options.readers)
+            {
+                std::this_thread::yield();
+            }
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                publish();
+                std::this_thread::sleep_for(std::chrono::microseconds(options.publish_us));
+            } });
+
+        while (ready.load() < options.readers)
+        {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.duration));
+        stop = true;
+        writer.join();
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        unsigned long long reads = 0;
+        std::vector<double> latencies;
+        for (auto &outcome : outcomes)
+        {
+            reads += outcome.reads;
+            latencies.insert(latencies.end(), outcome.latencies_ns.begin(), outcome.latencies_ns.end());
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(10) << static_cast<double>(reads) / options.duration / 1e6 << " M reads/s"
+                  << std::setprecision(0)
+                  << "   latency (ns) p50 " << std::setw(9) << percentile(latencies, 0.50)
+                  << "  p99 " << std::setw(10) << percentile(latencies, 0.99)
+                  << "  p99.9 " << std::setw(10) << percentile(latencies, 0.999) << std::endl;
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        usage();
+        return 2;
+    }
+
+    const SystemMetrics prototype = make_snapshot(options.apps);
+    std::cout << options.readers << " readers, 1 writer every " << options.publish_us << " us, "
+              << prototype.topApplications.size() << " processes per snapshot, " << options.duration << " s per strategy, "
+              << std::thread::hardware_concurrency() << " hardware threads\n";
+
+    {
+        std::mutex mutex;
+        SystemMetrics cached = prototype;
+        unsigned long long sequence = 0;
+        run("mutex-copy", options, [&]()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                const SystemMetrics copy = cached;
+                return copy.cpuUsage + static_cast<double>(copy.topApplications.size()); },
+            [&]()
+            {
+                SystemMetrics next = prototype;
+                next.sequence = ++sequence;
+                std::lock_guard<std::mutex> lock(mutex);
+                cached = std::move(next); });
+    }
+
+    {
+        std::shared_ptr<const SystemMetrics> current = std::make_shared<const SystemMetrics>(prototype);
+        unsigned long long sequence = 0;
+        run("atomic-sp", options, [&]()
+            {
+                const auto handle = std::atomic_load(&current);
+                return handle->cpuUsage + static_cast<double>(handle->topApplications.size()); },
+            [&]()
+            {
+                auto next = std::make_shared<SystemMetrics>(prototype);
+                next->sequence = ++sequence;
+                std::atomic_store(&current, std::shared_ptr<const SystemMetrics>(std::move(next))); });
+    }
+
+    {
+        SnapshotPublisher<SystemMetrics> publisher;
+        publisher.publish(std::make_shared<const SystemMetrics>(prototype));
+        unsigned long long sequence = 0;
+        run("publisher", options, [&]()
+            {
+                const auto handle = publisher.load();
+                return handle->cpuUsage + static_cast<double>(handle->topApplications.size()); },
+            [&]()
+            {
+                auto next = std::make_shared<SystemMetrics>(prototype);
+                next->sequence = ++sequence;
+                publisher.publish(std::move(next)); });
+    }
+
+    {
+        // The live collector re-reads /proc whenever its snapshot is older than the minimum interval.
+        MetricsCollector collector;
+        collector.refresh(SECTION_PROCESS_COUNTS);
+        run("collector", options, [&]()
+            {
+                const auto handle = collector.snapshot(SECTION_PROCESS_COUNTS);
+                return handle->cpuUsage + static_cast<double>(handle->processCount); },
+            []() {});
+    }
+
+    return 0;
+}
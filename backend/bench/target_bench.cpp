@@ -0,0 +1,206 @@
+// Scoped-target benchmark: what one ?target= query costs on snapshots with many long command lines.
+//
+// For every requested process count it builds a snapshot whose processes carry --cmdline-bytes long
+// command lines (plus one 120 KB command line, the case that used to exhaust the matcher's stack), then
+// times each target over a fresh index, as the first query after a tick does, and reports the index
+// build separately. Regular expressions run under the per-query step budget; a target that runs out is
+// reported as rejected, which is what the server answers with a 400:
+//
+//   target_bench --processes 500,2100,10000 --cmdline-bytes 1100 --iterations 5
+//   target_bench --target 're:(ab|ba|b)*x' --target worker-1
+#include "system_metrics.h"
+#include "target_index.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    struct Options
+    {
+        std::vector<std::size_t> processes{500, 2100, 10000};
+        std::size_t cmdline_bytes = 1100;
+        std::size_t iterations = 5;
+        std::vector<std::string> targets;
+    };
+
+    const std::vector<std::string> DEFAULT_TARGETS = {
+        "worker-17",
+        "prefix:worker-1",
+        "re:zzz",
+        "re:^worker-[0-9]+$",
+        "re:--config /etc/worker/worker-[0-9]+\\.yaml",
+        "re:(ab|ba|b)*x",
+        "re:(a|b|c|d|e|f|g|h)+z",
+    };
+
+    void usage()
+    {
+        std::cerr << "usage: target_bench [--processes N[,N...]] [--cmdline-bytes N] [--iterations N] [--target T]...\n";
+    }
+
+    bool parse_options(int argc, char **argv, Options &options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string flag = argv[i];
+            if (i + 1 >= argc)
+            {
+                return false;
+            }
+            const char *value = argv[++i];
+            if (flag == "--processes")
+            {
+                options.processes.clear();
+                std::stringstream list(value);
+                std::string item;
+                while (std::getline(list, item, ','))
+                {
+                    options.processes.push_back(std::strtoul(item.c_str(), nullptr, 10));
+                }
+            }
+            else if (flag == "--cmdline-bytes")
+            {
+                options.cmdline_bytes = std::strtoul(value, nullptr, 10);
+            }
+            else if (flag == "--iterations")
+            {
+                options.iterations = std::max<std::size_t>(1, std::strtoul(value, nullptr, 10));
+            }
+            else if (flag == "--target")
+            {
+                options.targets.push_back(value);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        if (options.targets.empty())
+        {
+            options.targets = DEFAULT_TARGETS;
+        }
+        return !options.processes.empty();
+    }
+
+    // Processes named like a worker pool, with command lines padded by "ab" runs to the requested length.
+    SystemMetrics make_snapshot(std::size_t processes, std::size_t cmdlineBytes)
+    {
+        auto arena = std::make_shared<SnapshotArena>();
+        SystemMetrics m{};
+        m.arena = arena;
+        m.sections = SECTION_ALL;
+        m.collectedSections = SECTION_ALL;
+        for (std::size_t i = 0; i < processes; ++i)
+        {
+            std::string commandLine = "/usr/bin/worker --config /etc/worker/worker-" + std::to_string(i) + ".yaml --payload ";
+            while (commandLine.size() < cmdlineBytes)
+            {
+                commandLine += "ab";
+            }
+            if (i == 0)
+            {
+                commandLine.resize(120 * 1024, 'b');
+            }
+
+            ApplicationUsage app{};
+            app.pid = static_cast<int>(1000 + i);
+            app.name = arena->intern("worker-" + std::to_string(i));
+            app.commandLine = arena->intern(commandLine);
+            app.pssAgeMs = -1.0;
+            app.cgroupAgeMs = -1.0;
+            m.topApplications.push_back(app);
+        }
+        return m;
+    }
+
+    double milliseconds(Clock::duration elapsed)
+    {
+        return std::chrono::duration<double, std::milli>(elapsed).count();
+    }
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        usage();
+        return 2;
+    }
+
+    for (const std::size_t processes : options.processes)
+    {
+        const SystemMetrics snapshot = make_snapshot(processes, options.cmdline_bytes);
+        std::size_t bytes = 0;
+        for (const auto &app : snapshot.topApplications)
+        {
+            bytes += app.name.size() + app.commandLine.size();
+        }
+        std::cout << processes << " processes, " << bytes / 1024 << " KB of names and command lines\n";
+
+        // An empty substring list still builds the index, which every first query pays for.
+        {
+            std::vector<TargetQuery> queries;
+            std::string error;
+            TargetQuery::parse_list("no-such-process", queries, error);
+            double total = 0.0;
+            for (std::size_t i = 0; i < options.iterations; ++i)
+            {
+                const TargetIndex index;
+                const auto started = Clock::now();
+                index.match(snapshot, queries);
+                total += milliseconds(Clock::now() - started);
+            }
+            std::cout << "  " << std::left << std::setw(48) << "(index build)" << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(10) << total / static_cast<double>(options.iterations) << " ms\n";
+        }
+
+        for (const auto &target : options.targets)
+        {
+            std::vector<TargetQuery> queries;
+            std::string error;
+            if (!TargetQuery::parse_list(target, queries, error))
+            {
+                std::cout << "  " << std::left << std::setw(48) << target << " invalid: " << error << '\n';
+                continue;
+            }
+
+            // The index is built outside the timed region so only matching is measured.
+            double total = 0.0;
+            TargetIndex::Matches matches;
+            for (std::size_t i = 0; i < options.iterations; ++i)
+            {
+                const TargetIndex index;
+                std::vector<TargetQuery> warmup;
+                TargetQuery::parse_list("no-such-process", warmup, error);
+                index.match(snapshot, warmup);
+
+                const auto started = Clock::now();
+                matches = index.match(snapshot, queries);
+                total += milliseconds(Clock::now() - started);
+            }
+
+            std::cout << "  " << std::left << std::setw(48) << target << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(10) << total / static_cast<double>(options.iterations) << " ms  ";
+            if (matches.budget_exhausted)
+            {
+                std::cout << "rejected: step budget exhausted\n";
+            }
+            else
+            {
+                std::cout << matches.applications.size() << " matches\n";
+            }
+        }
+    }
+    return 0;
+}
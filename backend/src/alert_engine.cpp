@@ -0,0 +1,846 @@
+#include "alert_engine.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string_view>
+
+namespace
+{
+    constexpr std::size_t RECENT_EVENTS = 100;
+    constexpr auto DEFAULT_RATE_WINDOW = std::chrono::seconds(60);
+    constexpr double MAX_DURATION_MS = 24.0 * 3600.0 * 1000.0; // longest "for" or rate window a rule may ask for
+
+    struct ScalarSource
+    {
+        const char *name;
+        unsigned int sections;
+        double (*read)(const SystemMetrics &);
+    };
+
+    struct ContainerSource
+    {
+        const char *name;
+        double (*read)(const DockerContainerSummary &);
+    };
+
+    // Metric names follow the JSON payload keys.
+    const ScalarSource SCALAR_SOURCES[] = {
+        {"cpu", 0, [](const SystemMetrics &m)
+         { return m.cpuUsage; }},
+        {"cpuAvg", 0, [](const SystemMetrics &m)
+         { return m.cpuUsageAverage; }},
+        {"memory", 0, [](const SystemMetrics &m)
+         { return m.memoryUsage; }},
+        {"swap", 0, [](const SystemMetrics &m)
+         { return m.swapUsage; }},
+        {"disk", 0, [](const SystemMetrics &m)
+         { return m.diskUsage; }},
+        {"connections", SECTION_CONNECTIONS, [](const SystemMetrics &m)
+         { return static_cast<double>(m.activeConnections); }},
+        {"load1", 0, [](const SystemMetrics &m)
+         { return m.loadAverage1; }},
+        {"load5", 0, [](const SystemMetrics &m)
+         { return m.loadAverage5; }},
+        {"load15", 0, [](const SystemMetrics &m)
+         { return m.loadAverage15; }},
+        {"loadPerCore", 0, [](const SystemMetrics &m)
+         { return m.loadAverage1 / std::max(1u, m.cpuCount); }},
+        {"procsRunning", 0, [](const SystemMetrics &m)
+         { return static_cast<double>(m.procsRunning); }},
+        {"procsBlocked", 0, [](const SystemMetrics &m)
+         { return static_cast<double>(m.procsBlocked); }},
+        // PSI 10 s averages; "some" unless named full.
+        {"pressure.cpu", 0, [](const SystemMetrics &m)
+         { return m.pressure.cpu.someAvg10; }},
+        {"pressure.memory", 0, [](const SystemMetrics &m)
+         { return m.pressure.memory.someAvg10; }},
+        {"pressure.memoryFull", 0, [](const SystemMetrics &m)
+         { return m.pressure.memory.fullAvg10; }},
+        {"pressure.io", 0, [](const SystemMetrics &m)
+         { return m.pressure.io.someAvg10; }},
+        {"pressure.ioFull", 0, [](const SystemMetrics &m)
+         { return m.pressure.io.fullAvg10; }},
+        {"netRx", 0, [](const SystemMetrics &m)
+         { return m.networkReceiveRate; }},
+        {"netTx", 0, [](const SystemMetrics &m)
+         { return m.networkTransmitRate; }},
+        {"netRxAvg", 0, [](const SystemMetrics &m)
+         { return m.networkReceiveRateAverage; }},
+        {"netTxAvg", 0, [](const SystemMetrics &m)
+         { return m.networkTransmitRateAverage; }},
+        {"processes", SECTION_PROCESS_COUNTS, [](const SystemMetrics &m)
+         { return static_cast<double>(m.processCount); }},
+        {"threads", SECTION_PROCESS_COUNTS, [](const SystemMetrics &m)
+         { return static_cast<double>(m.threadCount); }},
+        {"listeningTcp", SECTION_LISTENING_PORTS, [](const SystemMetrics &m)
+         { return static_cast<double>(m.listeningTcp); }},
+        {"listeningUdp", SECTION_LISTENING_PORTS, [](const SystemMetrics &m)
+         { return static_cast<double>(m.listeningUdp); }},
+        {"openFds", 0, [](const SystemMetrics &m)
+         { return static_cast<double>(m.openFileDescriptors); }},
+        {"uniqueDomains", SECTION_CONNECTIONS, [](const SystemMetrics &m)
+         { return static_cast<double>(m.uniqueDomains); }},
+    };
+
+    const ContainerSource CONTAINER_SOURCES[] = {
+        {"container.cpu", [](const DockerContainerSummary &c)
+         { return c.cpuPercent; }},
+        {"container.memory", [](const DockerContainerSummary &c)
+         { return c.memoryPercent; }},
+        {"container.memoryMb", [](const DockerContainerSummary &c)
+         { return c.memoryUsageMb; }},
+        {"container.netRx", [](const DockerContainerSummary &c)
+         { return c.networkRxKb; }},
+        {"container.netTx", [](const DockerContainerSummary &c)
+         { return c.networkTxKb; }},
+        {"container.blockRead", [](const DockerContainerSummary &c)
+         { return c.blockReadKb; }},
+        {"container.blockWrite", [](const DockerContainerSummary &c)
+         { return c.blockWriteKb; }},
+        {"container.pids", [](const DockerContainerSummary &c)
+         { return static_cast<double>(c.pids); }},
+        {"container.cpuPressure", [](const DockerContainerSummary &c)
+         { return c.cpuPressure; }},
+        {"container.memoryPressure", [](const DockerContainerSummary &c)
+         { return c.memoryPressure; }},
+        {"container.ioPressure", [](const DockerContainerSummary &c)
+         { return c.ioPressure; }},
+    };
+
+    constexpr std::size_t SCALAR_COUNT = sizeof(SCALAR_SOURCES) / sizeof(SCALAR_SOURCES[0]);
+
+    std::string fold(std::string_view value)
+    {
+        std::string result(value.size(), '\0');
+        std::transform(value.begin(), value.end(), result.begin(), [](unsigned char ch)
+                       { return static_cast<char>(std::tolower(ch)); });
+        return result;
+    }
+
+    // Rejects NaN, infinities, negatives and anything past MAX_DURATION_MS before the conversion.
+    bool to_duration(double milliseconds, std::chrono::milliseconds &out)
+    {
+        if (!std::isfinite(milliseconds) || milliseconds < 0 || milliseconds > MAX_DURATION_MS)
+        {
+            return false;
+        }
+        out = std::chrono::milliseconds(static_cast<long long>(milliseconds));
+        return true;
+    }
+
+    // Accepts a number of seconds or a string such as "500ms", "30s", "5m", "1h", up to 24 hours.
+    bool parse_duration(const nlohmann::json &value, std::chrono::milliseconds &out)
+    {
+        if (value.is_number())
+        {
+            return to_duration(value.get<double>() * 1000.0, out);
+        }
+        if (!value.is_string())
+        {
+            return false;
+        }
+
+        const std::string text = value.get<std::string>();
+        std::size_t consumed = 0;
+        double amount = 0.0;
+        try
+        {
+            amount = std::stod(text, &consumed);
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+        const std::string unit = text.substr(consumed);
+        double scale = 0.0;
+        if (unit == "ms")
+        {
+            scale = 1.0;
+        }
+        else if (unit == "s" || unit.empty())
+        {
+            scale = 1000.0;
+        }
+        else if (unit == "m")
+        {
+            scale = 60000.0;
+        }
+        else if (unit == "h")
+        {
+            scale = 3600000.0;
+        }
+        if (scale == 0.0)
+        {
+            return false;
+        }
+        return to_duration(amount * scale, out);
+    }
+
+    const char *state_name(AlertState state)
+    {
+        switch (state)
+        {
+        case AlertState::Pending:
+            return "pending";
+        case AlertState::Firing:
+            return "firing";
+        default:
+            return "resolved";
+        }
+    }
+
+    // Reads an optional string field; false when it is present with another type.
+    bool string_field(const nlohmann::json &entry, const char *key, const char *fallback, std::string &value)
+    {
+        const auto iter = entry.find(key);
+        if (iter == entry.end())
+        {
+            value = fallback;
+            return true;
+        }
+        if (!iter->is_string())
+        {
+            return false;
+        }
+        value = iter->get<std::string>();
+        return true;
+    }
+
+    bool file_signature(const std::string &path, long long &mtime, long long &size)
+    {
+        struct stat info
+        {
+        };
+        if (::stat(path.c_str(), &info) != 0)
+        {
+            return false;
+        }
+        mtime = static_cast<long long>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+        size = static_cast<long long>(info.st_size);
+        return true;
+    }
+
+} // namespace
+
+nlohmann::json alert_event_to_json(const AlertEvent &event)
+{
+    return {
+        {"type", "alert"},
+        {"state", state_name(event.state)},
+        {"rule", event.rule},
+        {"instance", event.instance},
+        {"severity", event.severity},
+        {"metric", event.metric},
+        {"op", event.op},
+        {"value", event.value},
+        {"threshold", event.threshold},
+        {"since", MetricsCollector::to_iso8601(event.since)},
+        {"timestamp", MetricsCollector::to_iso8601(event.timestamp)}};
+}
+
+AlertEngine::AlertEngine(MetricsCollector &collector, std::string rulesPath, std::chrono::milliseconds interval)
+    : collector_(collector),
+      rules_path_(std::move(rulesPath)),
+      interval_(interval),
+      required_sections_(0),
+      rules_mtime_(-1),
+      rules_size_(-1),
+      wake_requested_(false),
+      running_(false)
+{
+    std::vector<AlertEvent> ignored;
+    std::lock_guard<std::mutex> lock(mutex_);
+    install_rules_locked(default_rules(), ignored);
+    if (!rules_path_.empty())
+    {
+        load_error_ = "not loaded yet";
+    }
+}
+
+AlertEngine::~AlertEngine()
+{
+    stop();
+}
+
+void AlertEngine::add_listener(EventListener listener)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    listeners_.push_back(std::move(listener));
+}
+
+void AlertEngine::start()
+{
+    if (running_.exchange(true))
+    {
+        return;
+    }
+
+    reload_if_changed();
+    collector_.add_listener([this](const SystemMetrics &metrics)
+                            { on_snapshot(metrics); });
+    worker_ = std::thread(&AlertEngine::run, this);
+}
+
+void AlertEngine::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_requested_ = true;
+    }
+    wake_.notify_all();
+}
+
+void AlertEngine::stop()
+{
+    {
+        // Under the wake lock, so the worker cannot check the flag and then miss the notification.
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        if (!running_.exchange(false))
+        {
+            return;
+        }
+    }
+    wake_.notify_all();
+    if (worker_.joinable())
+    {
+        worker_.join();
+    }
+}
+
+std::vector<AlertEngine::Rule> AlertEngine::default_rules()
+{
+    // Mirrors determineHealth() in frontend/src/utils/health.js.
+    static const char *DEFAULTS = R"([
+        {"name": "cpu-warning", "metric": "cpu", "op": ">=", "threshold": 75, "for": "15s", "severity": "warning"},
+        {"name": "cpu-critical", "metric": "cpu", "op": ">=", "threshold": 90, "for": "15s", "severity": "critical"},
+        {"name": "memory-warning", "metric": "memory", "op": ">=", "threshold": 82, "severity": "warning"},
+        {"name": "memory-critical", "metric": "memory", "op": ">=", "threshold": 92, "severity": "critical"},
+        {"name": "disk-warning", "metric": "disk", "op": ">=", "threshold": 85, "severity": "warning"},
+        {"name": "disk-critical", "metric": "disk", "op": ">=", "threshold": 93, "severity": "critical"},
+        {"name": "load-warning", "metric": "loadPerCore", "op": ">=", "threshold": 1.2, "for": "15s", "severity": "warning"},
+        {"name": "load-critical", "metric": "loadPerCore", "op": ">=", "threshold": 2, "for": "15s", "severity": "critical"},
+        {"name": "connections-warning", "metric": "connections", "op": ">=", "threshold": 1200, "severity": "warning"},
+        {"name": "connections-critical", "metric": "connections", "op": ">=", "threshold": 2000, "severity": "critical"}
+    ])";
+
+    std::vector<Rule> rules;
+    std::string error;
+    parse_rules(nlohmann::json::parse(DEFAULTS), rules, error);
+    return rules;
+}
+
+bool AlertEngine::parse_rules(const nlohmann::json &document, std::vector<Rule> &rules, std::string &error)
+{
+    const nlohmann::json *list = &document;
+    if (document.is_object())
+    {
+        const auto iter = document.find("rules");
+        if (iter == document.end())
+        {
+            error = "expected a \"rules\" array";
+            return false;
+        }
+        list = &*iter;
+    }
+    if (!list->is_array())
+    {
+        error = "rules must be an array";
+        return false;
+    }
+
+    for (const auto &entry : *list)
+    {
+        if (!entry.is_object())
+        {
+            error = "every rule must be an object";
+            return false;
+        }
+
+        Rule rule{};
+        std::string match;
+        std::string kind;
+        if (!string_field(entry, "name", "", rule.name))
+        {
+            error = "rule names must be strings";
+            return false;
+        }
+        const std::string where = "rule '" + rule.name + "': ";
+        if (rule.name.empty())
+        {
+            error = "every rule needs a name";
+            return false;
+        }
+        const auto read = [&entry, &where, &error](const char *key, const char *fallback, std::string &value)
+        {
+            if (string_field(entry, key, fallback, value))
+            {
+                return true;
+            }
+            error = where + "\"" + key + "\" must be a string";
+            return false;
+        };
+        if (!read("metric", "", rule.metric) || !read("severity", "warning", rule.severity) || !read("op", ">=", rule.op) ||
+            !read("match", "", match) || !read("kind", "threshold", kind))
+        {
+            return false;
+        }
+        if (std::any_of(rules.begin(), rules.end(), [&rule](const Rule &other)
+                        { return other.name == rule.name; }))
+        {
+            error = where + "duplicate name";
+            return false;
+        }
+
+        const auto scalar = std::find_if(std::begin(SCALAR_SOURCES), std::end(SCALAR_SOURCES), [&rule](const ScalarSource &source)
+                                         { return rule.metric == source.name; });
+        const auto container = std::find_if(std::begin(CONTAINER_SOURCES), std::end(CONTAINER_SOURCES), [&rule](const ContainerSource &source)
+                                            { return rule.metric == source.name; });
+        if (scalar != std::end(SCALAR_SOURCES))
+        {
+            rule.source = static_cast<std::size_t>(scalar - std::begin(SCALAR_SOURCES));
+            rule.container = false;
+        }
+        else if (container != std::end(CONTAINER_SOURCES))
+        {
+            rule.source = static_cast<std::size_t>(container - std::begin(CONTAINER_SOURCES));
+            rule.container = true;
+            rule.match = fold(match);
+        }
+        else
+        {
+            error = where + "unknown metric '" + rule.metric + "'";
+            return false;
+        }
+
+        if (rule.op == ">")
+        {
+            rule.comparison = Comparison::Greater;
+        }
+        else if (rule.op == ">=")
+        {
+            rule.comparison = Comparison::GreaterEqual;
+        }
+        else if (rule.op == "<")
+        {
+            rule.comparison = Comparison::Less;
+        }
+        else if (rule.op == "<=")
+        {
+            rule.comparison = Comparison::LessEqual;
+        }
+        else
+        {
+            error = where + "op must be one of >, >=, <, <=";
+            return false;
+        }
+
+        const auto threshold = entry.find("threshold");
+        if (threshold == entry.end() || !threshold->is_number())
+        {
+            error = where + "numeric threshold required";
+            return false;
+        }
+        rule.threshold = threshold->get<double>();
+
+        if (kind == "threshold")
+        {
+            rule.kind = Kind::Threshold;
+        }
+        else if (kind == "rate")
+        {
+            // Rate rules compare the change per second across the window against the threshold.
+            rule.kind = Kind::Rate;
+        }
+        else
+        {
+            error = where + "kind must be \"threshold\" or \"rate\"";
+            return false;
+        }
+
+        rule.hold = std::chrono::milliseconds(0);
+        rule.window = DEFAULT_RATE_WINDOW;
+        if (entry.contains("for") && !parse_duration(entry["for"], rule.hold))
+        {
+            error = where + "invalid \"for\" duration";
+            return false;
+        }
+        if (entry.contains("window") && (!parse_duration(entry["window"], rule.window) || rule.window.count() == 0))
+        {
+            error = where + "invalid \"window\" duration";
+            return false;
+        }
+
+        rule.definition = entry.dump();
+        rules.push_back(std::move(rule));
+    }
+    return true;
+}
+
+void AlertEngine::install_rules_locked(std::vector<Rule> rules, std::vector<AlertEvent> &events)
+{
+    const auto now = std::chrono::system_clock::now();
+
+    // Unchanged rules keep their instances; firing alerts of removed or edited rules resolve.
+    for (auto &previous : rules_)
+    {
+        const auto kept = std::find_if(rules.begin(), rules.end(), [&previous](const Rule &rule)
+                                       { return rule.name == previous.name && rule.definition == previous.definition; });
+        if (kept != rules.end())
+        {
+            kept->instances = std::move(previous.instances);
+            continue;
+        }
+        for (const auto &instance : previous.instances)
+        {
+            if (instance.second.state == AlertState::Firing)
+            {
+                events.push_back({previous.name, instance.first, previous.severity, previous.metric, previous.op,
+                                  AlertState::Inactive, instance.second.value, previous.threshold, instance.second.since, now});
+            }
+        }
+    }
+
+    rules_ = std::move(rules);
+    rules_by_source_.assign(SCALAR_COUNT, {});
+    last_values_.assign(SCALAR_COUNT, 0.0);
+    has_last_value_.assign(SCALAR_COUNT, false);
+    container_rules_.clear();
+    required_sections_ = 0;
+    for (std::size_t i = 0; i < rules_.size(); ++i)
+    {
+        if (rules_[i].container)
+        {
+            container_rules_.push_back(i);
+            required_sections_ |= SECTION_DOCKER;
+        }
+        else
+        {
+            rules_by_source_[rules_[i].source].push_back(i);
+            required_sections_ |= SCALAR_SOURCES[rules_[i].source].sections;
+        }
+    }
+    loaded_at_ = now;
+}
+
+bool AlertEngine::reload_if_changed()
+{
+    if (rules_path_.empty())
+    {
+        return false;
+    }
+
+    long long mtime = 0;
+    long long size = 0;
+    if (!file_signature(rules_path_, mtime, size))
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rules_mtime_ != 0)
+        {
+            std::cerr << "Alert rules file " << rules_path_ << " is not readable; keeping the current rules" << std::endl;
+            load_error_ = "file not readable";
+            rules_mtime_ = 0;
+        }
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (mtime == rules_mtime_ && size == rules_size_)
+        {
+            return false;
+        }
+        rules_mtime_ = mtime;
+        rules_size_ = size;
+    }
+
+    std::ifstream input(rules_path_);
+    std::stringstream contents;
+    contents << input.rdbuf();
+
+    std::vector<Rule> rules;
+    std::string error;
+    const nlohmann::json document = nlohmann::json::parse(contents.str(), nullptr, false);
+    if (document.is_discarded())
+    {
+        error = "invalid JSON";
+    }
+    if (!error.empty() || !parse_rules(document, rules, error))
+    {
+        std::cerr << "Failed to load alert rules from " << rules_path_ << ": " << error << "; keeping the current rules" << std::endl;
+        std::lock_guard<std::mutex> lock(mutex_);
+        load_error_ = error;
+        return false;
+    }
+
+    const std::size_t count = rules.size();
+    std::vector<AlertEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        install_rules_locked(std::move(rules), events);
+        load_error_.clear();
+    }
+    std::cout << "Loaded " << count << " alert rules from " << rules_path_ << std::endl;
+    publish(events);
+    return true;
+}
+
+void AlertEngine::evaluate(Rule &rule, InstanceState &state, const std::string &instance, double value,
+                           std::chrono::system_clock::time_point now, std::vector<AlertEvent> &events)
+{
+    double observed = value;
+    if (rule.kind == Kind::Rate)
+    {
+        state.history.emplace_back(now, value);
+        while (state.history.size() > 2 && now - state.history[1].first >= rule.window)
+        {
+            state.history.pop_front();
+        }
+        const auto &oldest = state.history.front();
+        const double seconds = std::chrono::duration<double>(now - oldest.first).count();
+        observed = seconds > 0.0 ? (value - oldest.second) / seconds : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    bool condition = false;
+    if (!std::isnan(observed))
+    {
+        switch (rule.comparison)
+        {
+        case Comparison::Greater:
+            condition = observed > rule.threshold;
+            break;
+        case Comparison::GreaterEqual:
+            condition = observed >= rule.threshold;
+            break;
+        case Comparison::Less:
+            condition = observed < rule.threshold;
+            break;
+        case Comparison::LessEqual:
+            condition = observed <= rule.threshold;
+            break;
+        }
+    }
+    state.value = observed;
+
+    auto emit = [&](AlertState next)
+    {
+        events.push_back({rule.name, instance, rule.severity, rule.metric, rule.op, next, observed, rule.threshold, state.since, now});
+    };
+
+    switch (state.state)
+    {
+    case AlertState::Inactive:
+        if (condition)
+        {
+            state.since = now;
+            state.state = rule.hold.count() == 0 ? AlertState::Firing : AlertState::Pending;
+            if (state.state == AlertState::Firing)
+            {
+                emit(AlertState::Firing);
+            }
+        }
+        break;
+    case AlertState::Pending:
+        if (!condition)
+        {
+            state.state = AlertState::Inactive;
+        }
+        else if (now - state.since >= rule.hold)
+        {
+            state.state = AlertState::Firing;
+            emit(AlertState::Firing);
+        }
+        break;
+    case AlertState::Firing:
+        if (!condition)
+        {
+            state.state = AlertState::Inactive;
+            emit(AlertState::Inactive);
+        }
+        break;
+    }
+}
+
+void AlertEngine::on_snapshot(const SystemMetrics &metrics)
+{
+    std::vector<AlertEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto now = metrics.timestamp;
+
+        for (std::size_t source = 0; source < SCALAR_COUNT; ++source)
+        {
+            auto &indices = rules_by_source_[source];
+            if (indices.empty() || (metrics.sections & SCALAR_SOURCES[source].sections) != SCALAR_SOURCES[source].sections)
+            {
+                continue;
+            }
+
+            const double value = SCALAR_SOURCES[source].read(metrics);
+            const bool changed = !has_last_value_[source] || value != last_values_[source];
+            last_values_[source] = value;
+            has_last_value_[source] = true;
+
+            for (const std::size_t index : indices)
+            {
+                Rule &rule = rules_[index];
+                InstanceState &state = rule.instances[std::string()];
+                // An unchanged input only matters to rules that are timing something.
+                if (changed || rule.kind == Kind::Rate || state.state == AlertState::Pending)
+                {
+                    evaluate(rule, state, std::string(), value, now, events);
+                }
+            }
+        }
+
+        if (!container_rules_.empty() && (metrics.sections & SECTION_DOCKER) != 0)
+        {
+            for (const std::size_t index : container_rules_)
+            {
+                Rule &rule = rules_[index];
+                const ContainerSource &source = CONTAINER_SOURCES[rule.source];
+                std::vector<std::string_view> seen;
+                for (const auto &container : metrics.dockerContainers)
+                {
+                    if (!rule.match.empty() && fold(container.name).find(rule.match) == std::string::npos)
+                    {
+                        continue;
+                    }
+                    const std::string name(container.name);
+                    evaluate(rule, rule.instances[name], name, source.read(container), now, events);
+                    seen.push_back(container.name);
+                }
+
+                // Containers that went away resolve instead of firing forever.
+                for (auto iter = rule.instances.begin(); iter != rule.instances.end();)
+                {
+                    const bool present = std::any_of(seen.begin(), seen.end(), [&iter](std::string_view name)
+                                                     { return name == iter->first; });
+                    if (present)
+                    {
+                        ++iter;
+                        continue;
+                    }
+                    if (iter->second.state == AlertState::Firing)
+                    {
+                        events.push_back({rule.name, iter->first, rule.severity, rule.metric, rule.op, AlertState::Inactive,
+                                          iter->second.value, rule.threshold, iter->second.since, now});
+                    }
+                    iter = rule.instances.erase(iter);
+                }
+            }
+        }
+    }
+
+    publish(events);
+}
+
+void AlertEngine::publish(const std::vector<AlertEvent> &events)
+{
+    if (events.empty())
+    {
+        return;
+    }
+
+    std::vector<EventListener> listeners;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &event : events)
+        {
+            recent_.push_back(event);
+            if (recent_.size() > RECENT_EVENTS)
+            {
+                recent_.pop_front();
+            }
+        }
+        listeners = listeners_;
+    }
+
+    for (const auto &event : events)
+    {
+        std::cerr << "Alert " << state_name(event.state) << ": " << event.rule
+                  << (event.instance.empty() ? std::string() : " [" + event.instance + "]")
+                  << " " << event.metric << "=" << event.value << " (" << event.op << " " << event.threshold << ")" << std::endl;
+        for (const auto &listener : listeners)
+        {
+            listener(event);
+        }
+    }
+}
+
+void AlertEngine::handle_alerts(const HttpRequest &, HttpResponse &response)
+{
+    nlohmann::json rules = nlohmann::json::array();
+    nlohmann::json active = nlohmann::json::array();
+    nlohmann::json recent = nlohmann::json::array();
+    nlohmann::json body;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &rule : rules_)
+        {
+            rules.push_back(nlohmann::json::parse(rule.definition));
+            for (const auto &instance : rule.instances)
+            {
+                if (instance.second.state == AlertState::Inactive)
+                {
+                    continue;
+                }
+                active.push_back({{"rule", rule.name},
+                                  {"instance", instance.first},
+                                  {"severity", rule.severity},
+                                  {"state", state_name(instance.second.state)},
+                                  {"metric", rule.metric},
+                                  {"value", instance.second.value},
+                                  {"threshold", rule.threshold},
+                                  {"since", MetricsCollector::to_iso8601(instance.second.since)}});
+            }
+        }
+        for (auto iter = recent_.rbegin(); iter != recent_.rend(); ++iter)
+        {
+            recent.push_back(alert_event_to_json(*iter));
+        }
+
+        body["rulesFile"] = rules_path_.empty() ? nlohmann::json(nullptr) : nlohmann::json(rules_path_);
+        body["loadedAt"] = MetricsCollector::to_iso8601(loaded_at_);
+        if (!load_error_.empty())
+        {
+            body["loadError"] = load_error_;
+        }
+    }
+
+    body["rules"] = std::move(rules);
+    body["active"] = std::move(active);
+    body["recent"] = std::move(recent);
+    response.set_body(body.dump(), "application/json");
+}
+
+void AlertEngine::run()
+{
+    while (running_.load())
+    {
+        reload_if_changed();
+
+        unsigned int sections = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sections = required_sections_;
+        }
+        if (interval_.count() > 0)
+        {
+            // Keeps the rules' sections in demand, so the collecting thread samples them; snapshots reach
+            // on_snapshot() through the collector listener. Nothing is collected here.
+            collector_.latest(sections);
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait_for(lock, interval_.count() > 0 ? interval_ : std::chrono::milliseconds(1000), [this]()
+                       { return !running_.load() || wake_requested_; });
+        wake_requested_ = false;
+    }
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "http_server.h"
+#include "system_metrics.h"
+
+enum class AlertState
+{
+    Inactive,
+    Pending,
+    Firing
+};
+
+// A state change of one rule instance (a scalar rule has one instance; container rules have one per container).
+struct AlertEvent
+{
+    std::string rule;
+    std::string instance;
+    std::string severity;
+    std::string metric;
+    std::string op;
+    AlertState state; // Firing, or Inactive when the alert resolved
+    double value;
+    double threshold;
+    std::chrono::system_clock::time_point since;
+    std::chrono::system_clock::time_point timestamp;
+};
+
+nlohmann::json alert_event_to_json(const AlertEvent &event);
+
+// Evaluates threshold, rate-of-change and duration rules against every collector snapshot.
+//
+// Rules come from a JSON file (MONITORING_ALERT_RULES) that is re-read when it changes on disk;
+// without a file the engine uses the same thresholds as the dashboard's health badge. Scalar rules
+// are indexed by metric, so a tick only evaluates rules whose input changed or that are waiting on
+// a duration or rate window. The worker thread keeps snapshots coming when no client is connected.
+class AlertEngine
+{
+public:
+    using EventListener = std::function<void(const AlertEvent &)>;
+
+    AlertEngine(MetricsCollector &collector, std::string rulesPath, std::chrono::milliseconds interval);
+    ~AlertEngine();
+
+    void start();
+    void stop();
+    // Refreshes and evaluates now instead of at the next interval, e.g. when a pressure trigger fires.
+    void wake();
+    // Listeners run on the collecting thread after each transition batch and must not call collect().
+    void add_listener(EventListener listener);
+    // JSON report of the loaded rules, active (pending/firing) alerts and recent transitions.
+    void handle_alerts(const HttpRequest &request, HttpResponse &response);
+
+private:
+    enum class Kind
+    {
+        Threshold,
+        Rate
+    };
+
+    enum class Comparison
+    {
+        Greater,
+        GreaterEqual,
+        Less,
+        LessEqual
+    };
+
+    struct InstanceState
+    {
+        AlertState state = AlertState::Inactive;
+        std::chrono::system_clock::time_point since{};
+        double value = 0.0;
+        std::deque<std::pair<std::chrono::system_clock::time_point, double>> history; // rate rules only
+    };
+
+    struct Rule
+    {
+        std::string name;
+        std::string metric;
+        std::string severity;
+        std::string op;
+        std::string match;      // case-folded container-name filter (container rules only)
+        std::string definition; // canonical JSON, compared on reload to keep state of unchanged rules
+        Kind kind;
+        Comparison comparison;
+        double threshold;
+        std::chrono::milliseconds hold;
+        std::chrono::milliseconds window;
+        std::size_t source;
+        bool container;
+        std::unordered_map<std::string, InstanceState> instances;
+    };
+
+    static bool parse_rules(const nlohmann::json &document, std::vector<Rule> &rules, std::string &error);
+    static std::vector<Rule> default_rules();
+
+    void install_rules_locked(std::vector<Rule> rules, std::vector<AlertEvent> &events);
+    bool reload_if_changed();
+    void on_snapshot(const SystemMetrics &metrics);
+    void evaluate(Rule &rule, InstanceState &state, const std::string &instance, double value,
+                  std::chrono::system_clock::time_point now, std::vector<AlertEvent> &events);
+    void publish(const std::vector<AlertEvent> &events);
+    void run();
+
+    MetricsCollector &collector_;
+    std::string rules_path_;
+    std::chrono::milliseconds interval_;
+
+    std::mutex mutex_;
+    std::vector<Rule> rules_;
+    std::vector<std::vector<std::size_t>> rules_by_source_; // scalar rule indices per metric source
+    std::vector<double> last_values_;
+    std::vector<bool> has_last_value_;
+    std::vector<std::size_t> container_rules_;
+    unsigned int required_sections_;
+    std::deque<AlertEvent> recent_;
+    std::chrono::system_clock::time_point loaded_at_;
+    std::string load_error_;
+    long long rules_mtime_;
+    long long rules_size_;
+    std::vector<EventListener> listeners_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool wake_requested_; // guarded by wake_mutex_
+    std::atomic<bool> running_;
+    std::thread worker_;
+};
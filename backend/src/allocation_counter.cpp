@@ -0,0 +1,61 @@
+// Replacement global allocation functions that count heap allocations for self_stats. Linked into the
+// server binary only, so the benchmarks keep their own counting operator new. The array, nothrow and
+// sized forms forward to these by default.
+#include "self_stats.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    void *allocate(std::size_t size, std::size_t alignment)
+    {
+        self_stats::count_allocation();
+        void *memory = nullptr;
+        if (alignment <= alignof(std::max_align_t))
+        {
+            memory = std::malloc(size == 0 ? 1 : size);
+        }
+        else if (posix_memalign(&memory, alignment, size == 0 ? alignment : size) != 0)
+        {
+            memory = nullptr;
+        }
+        if (memory == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return memory;
+    }
+
+    [[maybe_unused]] const bool TRACKING_ENABLED = (self_stats::enable_allocation_tracking(), true);
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
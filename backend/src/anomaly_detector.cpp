@@ -0,0 +1,364 @@
+#include "anomaly_detector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+    constexpr double HOLT_ALPHA = 0.3;     // level smoothing
+    constexpr double HOLT_BETA = 0.05;     // trend smoothing
+    constexpr double RESIDUAL_GAMMA = 0.05; // weight of the newest squared residual
+    constexpr double MEDIAN_ETA = 0.05;     // streaming median/MAD step, relative to the current spread
+    constexpr double MAD_SCALE = 1.4826;    // MAD -> standard deviation for normal data
+
+    constexpr double HOLT_LIMIT = 3.0;
+    constexpr double Z_LIMIT = 3.0;
+    constexpr double ROBUST_LIMIT = 3.5;
+    constexpr unsigned int REQUIRED_VOTES = 2;
+
+    constexpr std::size_t RECENT_EVENTS = 100;
+
+    struct ScalarSeries
+    {
+        const char *name;
+        double minSpread; // smallest deviation treated as meaningful, in the series' unit
+        double (*read)(const SystemMetrics &);
+    };
+
+    struct ContainerSeries
+    {
+        const char *name;
+        double minSpread;
+        double (*read)(const DockerContainerSummary &);
+    };
+
+    const ScalarSeries SCALAR_SERIES[] = {
+        {"cpu", 2.0, [](const SystemMetrics &m)
+         { return m.cpuUsage; }},
+        {"memory", 1.0, [](const SystemMetrics &m)
+         { return m.memoryUsage; }},
+        {"netRx", 8.0, [](const SystemMetrics &m)
+         { return m.networkReceiveRate; }},
+        {"netTx", 8.0, [](const SystemMetrics &m)
+         { return m.networkTransmitRate; }},
+    };
+
+    const ContainerSeries CONTAINER_SERIES[] = {
+        {"container.cpu", 2.0, [](const DockerContainerSummary &c)
+         { return c.cpuPercent; }},
+        {"container.memory", 1.0, [](const DockerContainerSummary &c)
+         { return c.memoryPercent; }},
+    };
+
+    double finite_or_zero(double value)
+    {
+        return std::isfinite(value) ? value : 0.0;
+    }
+
+} // namespace
+
+nlohmann::json anomaly_event_to_json(const AnomalyEvent &event)
+{
+    return {
+        {"type", "anomaly"},
+        {"state", event.anomalous ? "anomalous" : "normal"},
+        {"gone", event.gone},
+        {"series", event.series},
+        {"instance", event.instance},
+        {"value", event.value},
+        {"expected", event.expected},
+        {"lower", event.lower},
+        {"upper", event.upper},
+        {"scores", {{"holt", event.holtScore}, {"zscore", event.zScore}, {"mad", event.robustScore}}},
+        {"timestamp", MetricsCollector::to_iso8601(event.timestamp)}};
+}
+
+SeriesDetector::SeriesDetector(double minSpread)
+    : min_spread_(minSpread), samples_(0), level_(0.0), trend_(0.0), residual_var_(0.0), ring_(), head_(0), sum_(0.0),
+      sum_sq_(0.0), median_(0.0), mad_(0.0)
+{
+}
+
+SeriesDetector::Reading SeriesDetector::update(double value)
+{
+    Reading reading{};
+
+    // Score against the state built from earlier samples, then fold the new sample in.
+    if (samples_ >= WINDOW)
+    {
+        const double forecast = level_ + trend_;
+        const double holtSpread = std::max(std::sqrt(residual_var_), min_spread_);
+        reading.expected = forecast;
+        reading.lower = forecast - HOLT_LIMIT * holtSpread;
+        reading.upper = forecast + HOLT_LIMIT * holtSpread;
+        reading.holtScore = std::fabs(value - forecast) / holtSpread;
+
+        const double mean = sum_ / static_cast<double>(WINDOW);
+        const double variance = std::max(0.0, sum_sq_ / static_cast<double>(WINDOW) - mean * mean);
+        reading.zScore = std::fabs(value - mean) / std::max(std::sqrt(variance), min_spread_);
+
+        reading.robustScore = std::fabs(value - median_) / std::max(MAD_SCALE * mad_, min_spread_);
+
+        reading.votes = (reading.holtScore > HOLT_LIMIT ? 1U : 0U) + (reading.zScore > Z_LIMIT ? 1U : 0U) +
+                        (reading.robustScore > ROBUST_LIMIT ? 1U : 0U);
+        reading.anomalous = reading.votes >= REQUIRED_VOTES;
+        reading.ready = true;
+    }
+
+    if (samples_ == 0)
+    {
+        level_ = value;
+    }
+    else
+    {
+        const double forecast = level_ + trend_;
+        const double residual = value - forecast;
+        residual_var_ = (1.0 - RESIDUAL_GAMMA) * residual_var_ + RESIDUAL_GAMMA * residual * residual;
+        const double previousLevel = level_;
+        level_ = HOLT_ALPHA * value + (1.0 - HOLT_ALPHA) * forecast;
+        trend_ = HOLT_BETA * (level_ - previousLevel) + (1.0 - HOLT_BETA) * trend_;
+    }
+
+    if (samples_ >= WINDOW)
+    {
+        const double oldest = ring_[head_];
+        sum_ -= oldest;
+        sum_sq_ -= oldest * oldest;
+
+        // Sign-driven steps keep the median/MAD estimates robust to the outliers they are scoring.
+        const double step = MEDIAN_ETA * std::max(MAD_SCALE * mad_, min_spread_);
+        median_ += value > median_ ? step : (value < median_ ? -step : 0.0);
+        const double deviation = std::fabs(value - median_);
+        mad_ = std::max(0.0, mad_ + (deviation > mad_ ? step : -step) / MAD_SCALE);
+    }
+    ring_[head_] = value;
+    sum_ += value;
+    sum_sq_ += value * value;
+    head_ = (head_ + 1) % WINDOW;
+    ++samples_;
+
+    if (head_ == 0)
+    {
+        // Once per window, rebuild the running sums to shed accumulated rounding error (amortised O(1)).
+        sum_ = 0.0;
+        sum_sq_ = 0.0;
+        for (const double sample : ring_)
+        {
+            sum_ += sample;
+            sum_sq_ += sample * sample;
+        }
+        if (samples_ == WINDOW)
+        {
+            seed_robust();
+        }
+    }
+
+    return reading;
+}
+
+void SeriesDetector::seed_robust()
+{
+    std::array<double, WINDOW> sorted = ring_;
+    std::nth_element(sorted.begin(), sorted.begin() + WINDOW / 2, sorted.end());
+    median_ = sorted[WINDOW / 2];
+    for (double &sample : sorted)
+    {
+        sample = std::fabs(sample - median_);
+    }
+    std::nth_element(sorted.begin(), sorted.begin() + WINDOW / 2, sorted.end());
+    mad_ = sorted[WINDOW / 2];
+}
+
+AnomalyMonitor::AnomalyMonitor(MetricsCollector &collector)
+    : collector_(collector), running_(false)
+{
+}
+
+void AnomalyMonitor::start()
+{
+    if (running_.exchange(true))
+    {
+        return;
+    }
+    collector_.add_listener([this](const SystemMetrics &metrics)
+                            { on_snapshot(metrics); });
+}
+
+void AnomalyMonitor::stop()
+{
+    // The collector keeps the registered listener, so the flag is what detaches the monitor.
+    std::lock_guard<std::mutex> lock(delivery_mutex_);
+    running_ = false;
+}
+
+void AnomalyMonitor::add_listener(EventListener listener)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    listeners_.push_back(std::move(listener));
+}
+
+void AnomalyMonitor::observe(Series &series, const std::string &name, const std::string &instance, double value,
+                             std::chrono::system_clock::time_point now, std::vector<AnomalyEvent> &events)
+{
+    const SeriesDetector::Reading reading = series.detector.update(value);
+    series.last = reading;
+    series.value = value;
+    if (!reading.ready)
+    {
+        return;
+    }
+
+    // Enter on a majority vote, leave only once no detector objects, so a series hovering at the edge does not flap.
+    const bool enter = !series.anomalous && reading.anomalous;
+    const bool leave = series.anomalous && reading.votes == 0;
+    if (!enter && !leave)
+    {
+        return;
+    }
+    series.anomalous = enter;
+    events.push_back({name, instance, enter, false, value, reading.expected, reading.lower, reading.upper, reading.holtScore,
+                      reading.zScore, reading.robustScore, now});
+}
+
+void AnomalyMonitor::on_snapshot(const SystemMetrics &metrics)
+{
+    std::vector<AnomalyEvent> events;
+    std::vector<EventListener> listeners;
+    if (!running_)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto now = metrics.timestamp;
+        for (const auto &source : SCALAR_SERIES)
+        {
+            auto iter = series_.try_emplace(source.name, source.minSpread).first;
+            observe(iter->second, source.name, std::string(), finite_or_zero(source.read(metrics)), now, events);
+        }
+
+        // Containers carried over from an earlier snapshot were observed then already.
+        if ((metrics.collectedSections & SECTION_DOCKER) != 0)
+        {
+            for (const auto &container : metrics.dockerContainers)
+            {
+                const std::string name(container.name);
+                auto &tracked = containers_[name];
+                for (const auto &source : CONTAINER_SERIES)
+                {
+                    auto iter = tracked.try_emplace(source.name, source.minSpread).first;
+                    observe(iter->second, source.name, name, finite_or_zero(source.read(container)), now, events);
+                }
+            }
+
+            for (auto iter = containers_.begin(); iter != containers_.end();)
+            {
+                const bool present = std::any_of(metrics.dockerContainers.begin(), metrics.dockerContainers.end(),
+                                                 [&iter](const DockerContainerSummary &container)
+                                                 { return container.name == iter->first; });
+                if (present)
+                {
+                    ++iter;
+                    continue;
+                }
+                // Close anomalies still open on a vanished container, or clients would keep them forever.
+                for (const auto &entry : iter->second)
+                {
+                    const Series &series = entry.second;
+                    if (series.anomalous)
+                    {
+                        const SeriesDetector::Reading &last = series.last;
+                        events.push_back({entry.first, iter->first, false, true, series.value, last.expected, last.lower, last.upper,
+                                          last.holtScore, last.zScore, last.robustScore, now});
+                    }
+                }
+                iter = containers_.erase(iter);
+            }
+        }
+
+        for (const auto &event : events)
+        {
+            recent_.push_back(event);
+            if (recent_.size() > RECENT_EVENTS)
+            {
+                recent_.pop_front();
+            }
+        }
+        if (!events.empty())
+        {
+            listeners = listeners_;
+        }
+    }
+
+    std::lock_guard<std::mutex> delivering(delivery_mutex_);
+    if (!running_)
+    {
+        return;
+    }
+    for (const auto &event : events)
+    {
+        if (event.anomalous)
+        {
+            std::cerr << "Anomaly on " << event.series << (event.instance.empty() ? std::string() : " [" + event.instance + "]")
+                      << ": " << event.value << " outside " << event.lower << " .. " << event.upper << std::endl;
+        }
+        for (const auto &listener : listeners)
+        {
+            listener(event);
+        }
+    }
+}
+
+void AnomalyMonitor::handle_anomalies(const HttpRequest &, HttpResponse &response)
+{
+    auto describe = [](const std::string &name, const std::string &instance, const Series &series)
+    {
+        const SeriesDetector::Reading &reading = series.last;
+        nlohmann::json entry = {
+            {"series", name},
+            {"instance", instance},
+            {"samples", series.detector.samples()},
+            {"value", series.value},
+            {"anomalous", series.anomalous}};
+        if (reading.ready)
+        {
+            entry["expected"] = reading.expected;
+            entry["lower"] = reading.lower;
+            entry["upper"] = reading.upper;
+            entry["scores"] = {{"holt", reading.holtScore}, {"zscore", reading.zScore}, {"mad", reading.robustScore}};
+        }
+        return entry;
+    };
+
+    nlohmann::json series = nlohmann::json::array();
+    nlohmann::json recent = nlohmann::json::array();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &source : SCALAR_SERIES)
+        {
+            const auto iter = series_.find(source.name);
+            if (iter != series_.end())
+            {
+                series.push_back(describe(source.name, std::string(), iter->second));
+            }
+        }
+        for (const auto &container : containers_)
+        {
+            for (const auto &entry : container.second)
+            {
+                series.push_back(describe(entry.first, container.first, entry.second));
+            }
+        }
+        for (auto iter = recent_.rbegin(); iter != recent_.rend(); ++iter)
+        {
+            recent.push_back(anomaly_event_to_json(*iter));
+        }
+    }
+
+    const nlohmann::json body = {
+        {"warmupSamples", SeriesDetector::WINDOW},
+        {"series", std::move(series)},
+        {"recent", std::move(recent)}};
+    response.set_body(body.dump(), "application/json");
+}
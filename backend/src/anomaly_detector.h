@@ -0,0 +1,124 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "http_server.h"
+#include "system_metrics.h"
+
+// Start or end of an anomalous stretch on one series (a container name in `instance` for per-container series).
+struct AnomalyEvent
+{
+    std::string series;
+    std::string instance;
+    bool anomalous; // false when the series returned to its expected band
+    bool gone;      // the series' container disappeared; closes an anomaly that can no longer return to normal
+    double value;
+    double expected;
+    double lower;
+    double upper;
+    double holtScore;   // |residual| / band width of the Holt forecast
+    double zScore;      // distance from the rolling mean in standard deviations
+    double robustScore; // distance from the running median in scaled MADs
+    std::chrono::system_clock::time_point timestamp;
+};
+
+nlohmann::json anomaly_event_to_json(const AnomalyEvent &event);
+
+// Online detectors for one series. Every update costs O(1) time and a fixed amount of memory:
+//   - Holt (level + trend) exponential smoothing with an exponentially weighted residual variance band;
+//   - a rolling z-score over the last WINDOW samples (running sum and sum of squares);
+//   - a robust score against a streaming median/MAD estimate, seeded once from the first window.
+// A sample is anomalous when at least two of the three detectors agree.
+class SeriesDetector
+{
+public:
+    static constexpr std::size_t WINDOW = 60;
+
+    struct Reading
+    {
+        bool ready;         // false while warming up
+        unsigned int votes; // detectors that flagged the sample
+        bool anomalous;
+        double expected;
+        double lower;
+        double upper;
+        double holtScore;
+        double zScore;
+        double robustScore;
+    };
+
+    explicit SeriesDetector(double minSpread);
+
+    Reading update(double value);
+    std::size_t samples() const { return samples_; }
+
+private:
+    void seed_robust();
+
+    double min_spread_;
+    std::size_t samples_;
+
+    double level_;
+    double trend_;
+    double residual_var_;
+
+    std::array<double, WINDOW> ring_;
+    std::size_t head_;
+    double sum_;
+    double sum_sq_;
+
+    double median_;
+    double mad_;
+};
+
+// Feeds CPU, memory, network and per-container series through SeriesDetector as snapshots arrive and
+// reports anomalies as events (to listeners, e.g. the WebSocket broadcast) and through /anomalies.
+class AnomalyMonitor
+{
+public:
+    using EventListener = std::function<void(const AnomalyEvent &)>;
+
+    explicit AnomalyMonitor(MetricsCollector &collector);
+
+    void start();
+    // No event reaches the listeners once stop() returns, so their owners may go away; later snapshots are ignored.
+    void stop();
+    // Listeners run on the collecting thread and must not call collect().
+    void add_listener(EventListener listener);
+    // JSON report of every tracked series (current band and scores) and recent events.
+    void handle_anomalies(const HttpRequest &request, HttpResponse &response);
+
+private:
+    struct Series
+    {
+        explicit Series(double minSpread) : detector(minSpread) {}
+
+        SeriesDetector detector;
+        SeriesDetector::Reading last{};
+        double value = 0.0;
+        bool anomalous = false;
+    };
+
+    void on_snapshot(const SystemMetrics &metrics);
+    void observe(Series &series, const std::string &name, const std::string &instance, double value,
+                 std::chrono::system_clock::time_point now, std::vector<AnomalyEvent> &events);
+
+    MetricsCollector &collector_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, Series> series_;                                        // host-wide, by series name
+    std::unordered_map<std::string, std::unordered_map<std::string, Series>> containers_; // container name -> series
+    std::deque<AnomalyEvent> recent_;
+    std::vector<EventListener> listeners_;
+    std::mutex delivery_mutex_; // held while listeners run, so stop() can wait for a delivery in progress
+    std::atomic<bool> running_;
+};
@@ -0,0 +1,584 @@
+#include "burst_capture.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <ctime>
+#include <fcntl.h>
+#include <string_view>
+#include <unistd.h>
+#include <utility>
+
+#include "system_metrics.h"
+
+namespace
+{
+    constexpr auto DEFAULT_INTERVAL = std::chrono::milliseconds(20);
+    constexpr auto DEFAULT_DURATION = std::chrono::seconds(10);
+    constexpr auto STREAM_EVERY = std::chrono::milliseconds(250);
+    constexpr auto CPU_CHECK_AFTER = std::chrono::seconds(1);
+    constexpr std::size_t READ_BUFFER_BYTES = 64 * 1024;
+
+    struct HostCounters
+    {
+        unsigned long long total;
+        unsigned long long idle;
+        unsigned long long iowait;
+        unsigned int running;
+        unsigned int blocked;
+        unsigned long long rxBytes;
+        unsigned long long txBytes;
+    };
+
+    struct ProcessCounters
+    {
+        unsigned long long cpuTicks;  // utime + stime, clock ticks
+        unsigned long long runtimeNs; // schedstat CPU time
+        bool hasRuntime;
+        unsigned long long rssPages;
+        unsigned long long waitNs;
+    };
+
+    long long monotonic_ns(clockid_t clock)
+    {
+        timespec now{};
+        ::clock_gettime(clock, &now);
+        return static_cast<long long>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+    }
+
+    // Re-reads an open procfs file from the start; the buffer only grows on the first read of a large file.
+    bool reread(int fd, std::vector<char> &buffer, std::string_view &text)
+    {
+        std::size_t length = 0;
+        for (;;)
+        {
+            if (length == buffer.size())
+            {
+                buffer.resize(buffer.size() * 2);
+            }
+            const ssize_t count = ::pread(fd, buffer.data() + length, buffer.size() - length, static_cast<off_t>(length));
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count < 0)
+            {
+                return false;
+            }
+            if (count == 0)
+            {
+                break;
+            }
+            length += static_cast<std::size_t>(count);
+        }
+        text = std::string_view(buffer.data(), length);
+        return true;
+    }
+
+    // Skips `count` space-separated fields and parses the next one.
+    bool field(std::string_view &text, int skip, unsigned long long &value)
+    {
+        for (int i = 0; i < skip; ++i)
+        {
+            text.remove_prefix(std::min(text.size(), text.find_first_not_of(' ')));
+            text.remove_prefix(std::min(text.size(), text.find(' ')));
+        }
+        text.remove_prefix(std::min(text.size(), text.find_first_not_of(' ')));
+        const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (result.ec != std::errc())
+        {
+            return false;
+        }
+        text.remove_prefix(static_cast<std::size_t>(result.ptr - text.data()));
+        return true;
+    }
+
+    bool labelled(std::string_view text, std::string_view label, unsigned int &value)
+    {
+        const std::size_t position = text.find(label);
+        unsigned long long parsed = 0;
+        if (position == std::string_view::npos)
+        {
+            return false;
+        }
+        text.remove_prefix(position + label.size());
+        if (!field(text, 0, parsed))
+        {
+            return false;
+        }
+        value = static_cast<unsigned int>(parsed);
+        return true;
+    }
+
+    // "cpu  user nice system idle iowait irq softirq steal ..." plus procs_running / procs_blocked.
+    bool parse_stat(std::string_view text, HostCounters &counters)
+    {
+        if (text.substr(0, 4) != "cpu ")
+        {
+            return false;
+        }
+        std::string_view line = text.substr(4);
+        unsigned long long values[8] = {};
+        for (auto &value : values)
+        {
+            if (!field(line, 0, value))
+            {
+                return false;
+            }
+        }
+        counters.total = 0;
+        for (const unsigned long long value : values)
+        {
+            counters.total += value;
+        }
+        counters.idle = values[3];
+        counters.iowait = values[4];
+        return labelled(text, "\nprocs_running", counters.running) && labelled(text, "\nprocs_blocked", counters.blocked);
+    }
+
+    // Receive and transmit bytes summed over every interface but loopback.
+    bool parse_net_dev(std::string_view text, HostCounters &counters)
+    {
+        counters.rxBytes = 0;
+        counters.txBytes = 0;
+        for (int header = 0; header < 2; ++header)
+        {
+            text.remove_prefix(std::min(text.size(), text.find('\n') + 1));
+        }
+        while (!text.empty())
+        {
+            const std::size_t end = text.find('\n');
+            std::string_view line = text.substr(0, end);
+            text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+            const std::size_t colon = line.find(':');
+            if (colon == std::string_view::npos)
+            {
+                continue;
+            }
+            std::string_view name = line.substr(0, colon);
+            name.remove_prefix(std::min(name.size(), name.find_first_not_of(' ')));
+            if (name == "lo")
+            {
+                continue;
+            }
+            line.remove_prefix(colon + 1);
+            unsigned long long rx = 0;
+            unsigned long long tx = 0;
+            if (field(line, 0, rx) && field(line, 7, tx))
+            {
+                counters.rxBytes += rx;
+                counters.txBytes += tx;
+            }
+        }
+        return true;
+    }
+
+    // utime, stime (fields 14 and 15) and rss (24) of /proc/<pid>/stat; the name may contain spaces.
+    bool parse_process_stat(std::string_view text, ProcessCounters &counters)
+    {
+        const std::size_t close = text.rfind(')');
+        if (close == std::string_view::npos || close + 2 > text.size())
+        {
+            return false;
+        }
+        text.remove_prefix(close + 2);
+        unsigned long long utime = 0;
+        unsigned long long stime = 0;
+        if (!field(text, 11, utime) || !field(text, 0, stime) || !field(text, 8, counters.rssPages))
+        {
+            return false;
+        }
+        counters.cpuTicks = utime + stime;
+        return true;
+    }
+
+    int open_proc(const std::string &path)
+    {
+        return ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+
+    const char *state_name(int state)
+    {
+        constexpr const char *NAMES[] = {"idle", "running", "finished", "stopped", "cpuLimit", "failed"};
+        return NAMES[state];
+    }
+} // namespace
+
+BurstCapture::BurstCapture(std::string procRoot)
+    : proc_root_(std::move(procRoot)),
+      mutex_(),
+      samples_(),
+      count_(0),
+      stopping_(false),
+      state_(State::Idle),
+      missed_ticks_(0),
+      sampler_(),
+      capture_id_(0),
+      started_at_(),
+      interval_(DEFAULT_INTERVAL),
+      duration_(DEFAULT_DURATION),
+      pid_(0),
+      listeners_mutex_(),
+      listeners_()
+{
+}
+
+BurstCapture::~BurstCapture()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop();
+}
+
+void BurstCapture::add_listener(BatchListener listener)
+{
+    std::lock_guard<std::mutex> lock(listeners_mutex_);
+    listeners_.push_back(std::move(listener));
+}
+
+void BurstCapture::handle_burst(const HttpRequest &request, HttpResponse &response)
+{
+    const auto fail = [&response](unsigned int status, const std::string &message)
+    {
+        response.status = status;
+        response.set_body(nlohmann::json{{"error", message}}.dump(), "application/json");
+    };
+    const auto number = [&request](const char *name, long long fallback, long long &value)
+    {
+        const std::string raw = request.query_value(name);
+        if (raw.empty())
+        {
+            value = fallback;
+            return true;
+        }
+        const auto result = std::from_chars(raw.data(), raw.data() + raw.size(), value);
+        return result.ec == std::errc() && result.ptr == raw.data() + raw.size();
+    };
+
+    // Starting and stopping change server state, so they need POST; status and the download stay on GET.
+    const std::string action = request.query_value("action");
+    const bool changes = action == "start" || action == "stop";
+    if (changes != (request.method == "POST"))
+    {
+        response.headers.emplace_back("Allow", changes ? "POST" : "GET, HEAD");
+        fail(405, changes ? "action=" + action + " needs POST" : "Only action=start and action=stop take POST");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (action == "start")
+    {
+        long long interval = 0;
+        long long duration = 0;
+        long long pid = 0;
+        if (!number("interval", DEFAULT_INTERVAL.count(), interval) || !number("duration", DEFAULT_DURATION.count(), duration) ||
+            !number("pid", 0, pid) || pid < 0)
+        {
+            fail(400, "interval (ms), duration (s) and pid must be whole numbers");
+            return;
+        }
+        if (interval < MIN_INTERVAL.count() || interval > MAX_INTERVAL.count() || duration < 1 || duration > MAX_DURATION.count())
+        {
+            fail(400, "interval must be " + std::to_string(MIN_INTERVAL.count()) + "-" + std::to_string(MAX_INTERVAL.count()) +
+                          " ms and duration 1-" + std::to_string(MAX_DURATION.count()) + " s");
+            return;
+        }
+        std::string error;
+        if (!start(std::chrono::milliseconds(interval), std::chrono::seconds(duration), static_cast<int>(pid),
+                   request.query_value("stream") == "1", error))
+        {
+            fail(state_.load() == State::Running ? 409 : 400, error);
+            return;
+        }
+        response.set_body(describe_locked().dump(), "application/json");
+        return;
+    }
+    if (action == "stop" || action == "status")
+    {
+        if (action == "stop")
+        {
+            stop();
+        }
+        response.set_body(describe_locked().dump(), "application/json");
+        return;
+    }
+    if (!action.empty() && action != "dump")
+    {
+        fail(400, "Unknown action '" + action + "'");
+        return;
+    }
+    nlohmann::json body = describe_locked();
+    body["samples"] = samples_json(0, count_.load(std::memory_order_acquire));
+    response.headers.emplace_back("Content-Disposition", "attachment; filename=\"monitor-burst.json\"");
+    response.set_body(body.dump(), "application/json");
+}
+
+bool BurstCapture::start(std::chrono::milliseconds interval, std::chrono::milliseconds duration, int pid, bool stream, std::string &error)
+{
+    if (state_.load() == State::Running)
+    {
+        error = "A burst capture is already running";
+        return false;
+    }
+    if (sampler_.joinable())
+    {
+        sampler_.join();
+    }
+
+    Files files;
+    files.stat = open_proc(proc_root_ + "/stat");
+    files.netDev = open_proc(proc_root_ + "/net/dev");
+    if (pid != 0)
+    {
+        const std::string directory = proc_root_ + "/" + std::to_string(pid);
+        files.processStat = open_proc(directory + "/stat");
+        files.processSchedstat = open_proc(directory + "/schedstat");
+    }
+    if (files.stat < 0 || files.netDev < 0 || (pid != 0 && files.processStat < 0))
+    {
+        error = files.stat < 0 || files.netDev < 0 ? "Cannot open " + proc_root_ + "/stat or /net/dev" : "No process " + std::to_string(pid);
+        close_files(files);
+        return false;
+    }
+
+    // One sample per interval plus the priming read; the buffer is never resized while sampling.
+    const std::size_t capacity = std::min<std::size_t>(MAX_SAMPLES, static_cast<std::size_t>(duration / interval));
+    samples_.assign(capacity, BurstSample{});
+    count_.store(0, std::memory_order_relaxed);
+    missed_ticks_.store(0, std::memory_order_relaxed);
+    stopping_.store(false);
+    ++capture_id_;
+    started_at_ = std::chrono::system_clock::now();
+    interval_ = interval;
+    duration_ = interval * static_cast<long long>(capacity);
+    pid_ = pid;
+    state_.store(State::Running);
+    sampler_ = std::thread([this, files, interval, capacity, stream]
+                           { run(files, interval, capacity, stream); });
+    return true;
+}
+
+void BurstCapture::stop()
+{
+    stopping_.store(true);
+    if (sampler_.joinable())
+    {
+        sampler_.join();
+    }
+}
+
+void BurstCapture::close_files(Files &files)
+{
+    for (int *fd : {&files.stat, &files.netDev, &files.processStat, &files.processSchedstat})
+    {
+        if (*fd >= 0)
+        {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void BurstCapture::run(Files files, std::chrono::milliseconds interval, std::size_t capacity, bool stream)
+{
+    std::vector<char> buffer(READ_BUFFER_BYTES);
+    std::string_view text;
+    const double ticks_per_second = static_cast<double>(::sysconf(_SC_CLK_TCK));
+    const double page_mb = static_cast<double>(::sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+    const long long interval_ns = std::chrono::nanoseconds(interval).count();
+
+    // Reads every source; false when a host source fails. A process that exits simply stops reporting.
+    const auto read = [&](HostCounters &host, ProcessCounters &process, bool &processAlive)
+    {
+        if (!reread(files.stat, buffer, text) || !parse_stat(text, host) || !reread(files.netDev, buffer, text) ||
+            !parse_net_dev(text, host))
+        {
+            return false;
+        }
+        processAlive = files.processStat >= 0 && reread(files.processStat, buffer, text) && parse_process_stat(text, process);
+        std::string_view schedstat;
+        process.hasRuntime = processAlive && files.processSchedstat >= 0 && reread(files.processSchedstat, buffer, schedstat) &&
+                             field(schedstat, 0, process.runtimeNs) && field(schedstat, 0, process.waitNs);
+        return true;
+    };
+
+    HostCounters previous{};
+    ProcessCounters previous_process{};
+    bool process_alive = false;
+    State outcome = State::Finished;
+    const long long started_ns = monotonic_ns(CLOCK_MONOTONIC);
+    const long long started_cpu_ns = monotonic_ns(CLOCK_THREAD_CPUTIME_ID);
+    long long previous_ns = started_ns;
+    long long next_ns = started_ns;
+    long long streamed_ns = started_ns;
+    std::size_t streamed = 0;
+    if (!read(previous, previous_process, process_alive))
+    {
+        outcome = State::Failed;
+        capacity = 0;
+    }
+
+    const auto publish = [&](std::size_t last, const char *state)
+    {
+        std::vector<BatchListener> listeners;
+        {
+            std::lock_guard<std::mutex> lock(listeners_mutex_);
+            listeners = listeners_;
+        }
+        nlohmann::json batch{{"type", "burst"}, {"id", capture_id_}, {"first", streamed}, {"samples", samples_json(streamed, last)}};
+        if (state != nullptr)
+        {
+            batch["state"] = state;
+        }
+        for (const auto &listener : listeners)
+        {
+            listener(batch);
+        }
+        streamed = last;
+    };
+
+    for (std::size_t index = 0; index < capacity; ++index)
+    {
+        // Absolute deadlines keep the spacing even; ticks that already passed are skipped, not bunched.
+        next_ns += interval_ns;
+        long long now_ns = monotonic_ns(CLOCK_MONOTONIC);
+        if (now_ns > next_ns)
+        {
+            const long long behind = (now_ns - next_ns) / interval_ns + 1;
+            missed_ticks_.fetch_add(static_cast<unsigned long long>(behind), std::memory_order_relaxed);
+            next_ns += behind * interval_ns;
+        }
+        const timespec deadline{static_cast<time_t>(next_ns / 1000000000LL), static_cast<long>(next_ns % 1000000000LL)};
+        while (::clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+        {
+        }
+        if (stopping_.load(std::memory_order_relaxed))
+        {
+            outcome = State::Stopped;
+            break;
+        }
+
+        HostCounters host{};
+        ProcessCounters process{};
+        bool alive = false;
+        if (!read(host, process, alive))
+        {
+            outcome = State::Failed;
+            break;
+        }
+        now_ns = monotonic_ns(CLOCK_MONOTONIC);
+        const double elapsed = static_cast<double>(now_ns - previous_ns) / 1e9;
+        const unsigned long long total = host.total - std::min(host.total, previous.total);
+        const auto share = [total](unsigned long long part)
+        {
+            return total == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(total);
+        };
+
+        BurstSample &sample = samples_[index];
+        sample.offsetMs = static_cast<double>(now_ns - started_ns) / 1e6;
+        sample.cpuPercent = 100.0 - share((host.idle - std::min(host.idle, previous.idle)) + (host.iowait - std::min(host.iowait, previous.iowait)));
+        sample.iowaitPercent = share(host.iowait - std::min(host.iowait, previous.iowait));
+        sample.running = host.running;
+        sample.blocked = host.blocked;
+        sample.receiveKbps = elapsed > 0.0 ? static_cast<double>(host.rxBytes - std::min(host.rxBytes, previous.rxBytes)) / 1024.0 / elapsed : 0.0;
+        sample.transmitKbps = elapsed > 0.0 ? static_cast<double>(host.txBytes - std::min(host.txBytes, previous.txBytes)) / 1024.0 / elapsed : 0.0;
+        if (alive && process_alive && elapsed > 0.0)
+        {
+            // At 100 Hz a 20 ms tick sees 0 or 2 ticks; the ticks only stand in when schedstat is missing.
+            sample.processCpuPercent =
+                process.hasRuntime && previous_process.hasRuntime
+                    ? 100.0 * static_cast<double>(process.runtimeNs - std::min(process.runtimeNs, previous_process.runtimeNs)) / 1e9 / elapsed
+                    : 100.0 * static_cast<double>(process.cpuTicks - std::min(process.cpuTicks, previous_process.cpuTicks)) / ticks_per_second / elapsed;
+            sample.processRssMb = static_cast<double>(process.rssPages) * page_mb;
+            sample.processRunDelayMs = static_cast<double>(process.waitNs - std::min(process.waitNs, previous_process.waitNs)) / 1e6;
+        }
+        previous = host;
+        previous_process = process;
+        process_alive = alive;
+        previous_ns = now_ns;
+        count_.store(index + 1, std::memory_order_release);
+
+        if (now_ns - started_ns >= std::chrono::nanoseconds(CPU_CHECK_AFTER).count())
+        {
+            const double cpu_percent = 100.0 * static_cast<double>(monotonic_ns(CLOCK_THREAD_CPUTIME_ID) - started_cpu_ns) /
+                                       static_cast<double>(now_ns - started_ns);
+            if (cpu_percent > MAX_CPU_PERCENT)
+            {
+                outcome = State::CpuLimit;
+                break;
+            }
+        }
+        if (stream && now_ns - streamed_ns >= std::chrono::nanoseconds(STREAM_EVERY).count())
+        {
+            publish(index + 1, nullptr);
+            streamed_ns = now_ns;
+        }
+    }
+
+    close_files(files);
+    state_.store(outcome);
+    if (stream)
+    {
+        publish(count_.load(std::memory_order_acquire), state_name(static_cast<int>(outcome)));
+    }
+}
+
+nlohmann::json BurstCapture::describe_locked() const
+{
+    const State state = state_.load();
+    nlohmann::json body{{"id", capture_id_},
+                        {"state", state_name(static_cast<int>(state))},
+                        {"intervalMs", interval_.count()},
+                        {"durationMs", duration_.count()},
+                        {"samples", count_.load(std::memory_order_acquire)},
+                        {"capacity", samples_.size()},
+                        {"missedTicks", missed_ticks_.load(std::memory_order_relaxed)}};
+    if (capture_id_ != 0)
+    {
+        body["startedAt"] = MetricsCollector::to_iso8601(started_at_);
+    }
+    body["pid"] = pid_ == 0 ? nlohmann::json() : nlohmann::json(pid_);
+    return body;
+}
+
+nlohmann::json BurstCapture::samples_json(std::size_t first, std::size_t last) const
+{
+    // Column arrays: a few kilobytes per second of capture rather than one object per sample.
+    nlohmann::json offset = nlohmann::json::array();
+    nlohmann::json cpu = nlohmann::json::array();
+    nlohmann::json iowait = nlohmann::json::array();
+    nlohmann::json running = nlohmann::json::array();
+    nlohmann::json blocked = nlohmann::json::array();
+    nlohmann::json rx = nlohmann::json::array();
+    nlohmann::json tx = nlohmann::json::array();
+    nlohmann::json processCpu = nlohmann::json::array();
+    nlohmann::json processRss = nlohmann::json::array();
+    nlohmann::json processDelay = nlohmann::json::array();
+    for (std::size_t i = first; i < last; ++i)
+    {
+        const BurstSample &sample = samples_[i];
+        offset.push_back(sample.offsetMs);
+        cpu.push_back(sample.cpuPercent);
+        iowait.push_back(sample.iowaitPercent);
+        running.push_back(sample.running);
+        blocked.push_back(sample.blocked);
+        rx.push_back(sample.receiveKbps);
+        tx.push_back(sample.transmitKbps);
+        if (pid_ != 0)
+        {
+            processCpu.push_back(sample.processCpuPercent);
+            processRss.push_back(sample.processRssMb);
+            processDelay.push_back(sample.processRunDelayMs);
+        }
+    }
+    nlohmann::json columns{{"offsetMs", std::move(offset)}, {"cpu", std::move(cpu)},     {"iowait", std::move(iowait)},
+                           {"running", std::move(running)}, {"blocked", std::move(blocked)}, {"rxKbps", std::move(rx)},
+                           {"txKbps", std::move(tx)}};
+    if (pid_ != 0)
+    {
+        columns["processCpu"] = std::move(processCpu);
+        columns["processRssMb"] = std::move(processRss);
+        columns["processRunDelayMs"] = std::move(processDelay);
+    }
+    return columns;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "http_server.h"
+
+// One burst sample; rates and deltas cover the time since the previous sample.
+struct BurstSample
+{
+    double offsetMs;          // since the capture started
+    double cpuPercent;        // host CPU busy time
+    double iowaitPercent;
+    unsigned int running;     // runnable tasks (procs_running in /proc/stat)
+    unsigned int blocked;     // tasks in uninterruptible sleep (procs_blocked)
+    double receiveKbps;       // all interfaces but loopback
+    double transmitKbps;
+    double processCpuPercent; // followed process, % of one core
+    double processRssMb;
+    double processRunDelayMs; // time the process spent runnable but waiting for a CPU (schedstat)
+};
+
+// Time-boxed, high-frequency sampling of a few cheap sources for incident investigation, far below
+// the collector's interval: host CPU and run queue from /proc/stat, network totals from /proc/net/dev,
+// and optionally one process's stat and schedstat.
+//
+// A dedicated thread keeps the files open and re-reads them with pread() on an absolute-time schedule,
+// so a sample costs a handful of system calls and no allocation: samples go into a buffer sized for the
+// whole capture when it starts. Ticks missed under load are skipped and counted rather than bunched.
+// Interval, duration and sample count are capped, only one capture runs at a time, and the sampler stops
+// itself if its own CPU use exceeds MAX_CPU_PERCENT of a core. A capture started with stream=1 hands new
+// samples to listeners in batches while it runs (WebSocket sessions that asked for bursts); the whole
+// capture can be downloaded afterwards.
+class BurstCapture
+{
+public:
+    using BatchListener = std::function<void(const nlohmann::json &batch)>;
+
+    static constexpr auto MIN_INTERVAL = std::chrono::milliseconds(10);
+    static constexpr auto MAX_INTERVAL = std::chrono::milliseconds(1000);
+    static constexpr auto MAX_DURATION = std::chrono::seconds(60);
+    static constexpr std::size_t MAX_SAMPLES = 6000;
+    static constexpr double MAX_CPU_PERCENT = 5.0;
+
+    explicit BurstCapture(std::string procRoot);
+    ~BurstCapture();
+
+    BurstCapture(const BurstCapture &) = delete;
+    BurstCapture &operator=(const BurstCapture &) = delete;
+
+    // Listeners run on the sampling thread and must return quickly.
+    void add_listener(BatchListener listener);
+
+    // /burst: POST ?action=start&interval=20&duration=10[&pid=N][&stream=1] and POST ?action=stop;
+    // GET ?action=status, and the latest capture (running or finished) by default.
+    void handle_burst(const HttpRequest &request, HttpResponse &response);
+
+private:
+    enum class State
+    {
+        Idle,
+        Running,
+        Finished, // ran its full duration
+        Stopped,  // stopped through the API
+        CpuLimit, // stopped itself at MAX_CPU_PERCENT
+        Failed    // a source could not be read
+    };
+
+    struct Files
+    {
+        int stat = -1;
+        int netDev = -1;
+        int processStat = -1;
+        int processSchedstat = -1;
+    };
+
+    bool start(std::chrono::milliseconds interval, std::chrono::milliseconds duration, int pid, bool stream, std::string &error);
+    void stop();
+    void run(Files files, std::chrono::milliseconds interval, std::size_t capacity, bool stream);
+    nlohmann::json describe_locked() const;
+    nlohmann::json samples_json(std::size_t first, std::size_t last) const;
+    void close_files(Files &files);
+
+    const std::string proc_root_;
+    std::mutex mutex_; // start, stop and readers of the buffer
+    std::vector<BurstSample> samples_;
+    std::atomic<std::size_t> count_; // samples written; the sampler publishes each with a release store
+    std::atomic<bool> stopping_;
+    std::atomic<State> state_;
+    std::atomic<unsigned long long> missed_ticks_;
+    std::thread sampler_;
+    unsigned long long capture_id_;
+    std::chrono::system_clock::time_point started_at_;
+    std::chrono::milliseconds interval_;
+    std::chrono::milliseconds duration_;
+    int pid_; // 0 when no process is followed
+    std::mutex listeners_mutex_;
+    std::vector<BatchListener> listeners_;
+};
@@ -0,0 +1,130 @@
+#include "collector_governor.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    constexpr auto MAX_INTERVAL = std::chrono::milliseconds(10000);
+    constexpr auto MAX_DETAIL_INTERVAL = std::chrono::milliseconds(60000);
+    constexpr double STEP = 1.5;
+    constexpr double COST_SMOOTHING = 0.2; // weight of the newest collection in the moving averages
+    // Between these shares of the budget the settings stay put, so they do not oscillate.
+    constexpr double SPEED_UP_BELOW = 0.5;
+
+    std::chrono::milliseconds scaled(std::chrono::milliseconds interval, double factor)
+    {
+        return std::chrono::milliseconds(static_cast<long long>(static_cast<double>(interval.count()) * factor));
+    }
+} // namespace
+
+CollectorGovernor::CollectorGovernor(double cpuPercent, std::chrono::milliseconds minInterval)
+    : budget_percent_(cpuPercent),
+      min_interval_(minInterval),
+      interval_(minInterval),
+      detail_interval_(minInterval),
+      depth_halvings_(0),
+      base_cost_ms_(0.0),
+      detail_cost_ms_(0.0),
+      top_up_ms_(0.0),
+      base_measured_(false),
+      detail_measured_(false)
+{
+}
+
+bool CollectorGovernor::enabled() const
+{
+    return budget_percent_ > 0.0;
+}
+
+void CollectorGovernor::record(std::chrono::nanoseconds cpu, bool detail)
+{
+    const double ms = std::chrono::duration<double, std::milli>(cpu).count();
+    const double topUpMs = std::exchange(top_up_ms_, 0.0);
+    const auto smooth = [](double &average, bool &measured, double sample)
+    {
+        average = measured ? average + COST_SMOOTHING * (sample - average) : sample;
+        measured = true;
+    };
+    if (detail)
+    {
+        // Until a base-only collection has been seen, the whole cost is attributed to the detail tier.
+        smooth(detail_cost_ms_, detail_measured_, std::max(0.0, ms - base_cost_ms_) + topUpMs);
+    }
+    else
+    {
+        smooth(base_cost_ms_, base_measured_, ms);
+        if (topUpMs > 0.0)
+        {
+            // Top-ups replace part of a detail collection; they stretch the detail tier, not the base one.
+            smooth(detail_cost_ms_, detail_measured_, topUpMs);
+        }
+    }
+    if (enabled())
+    {
+        adjust();
+    }
+}
+
+void CollectorGovernor::record_top_up(std::chrono::nanoseconds cpu)
+{
+    top_up_ms_ += std::chrono::duration<double, std::milli>(cpu).count();
+}
+
+double CollectorGovernor::projected_percent() const
+{
+    // Detail collections replace a base one, so they add only their extra cost.
+    return 100.0 * (base_cost_ms_ / static_cast<double>(interval_.count()) +
+                    detail_cost_ms_ / static_cast<double>(detail_interval_.count()));
+}
+
+void CollectorGovernor::adjust()
+{
+    const double load = projected_percent() / budget_percent_;
+    if (load > 1.0)
+    {
+        if (detail_interval_ < MAX_DETAIL_INTERVAL)
+        {
+            detail_interval_ = std::min(MAX_DETAIL_INTERVAL, scaled(detail_interval_, STEP));
+        }
+        else if (depth_halvings_ < MAX_DEPTH_HALVINGS)
+        {
+            ++depth_halvings_;
+        }
+        else
+        {
+            interval_ = std::min(MAX_INTERVAL, scaled(interval_, STEP));
+        }
+    }
+    else if (load < SPEED_UP_BELOW)
+    {
+        if (interval_ > min_interval_)
+        {
+            interval_ = std::max(min_interval_, scaled(interval_, 1.0 / STEP));
+        }
+        else if (depth_halvings_ > 0)
+        {
+            --depth_halvings_;
+        }
+        else
+        {
+            detail_interval_ = std::max(min_interval_, scaled(detail_interval_, 1.0 / STEP));
+        }
+    }
+    detail_interval_ = std::max(detail_interval_, interval_);
+}
+
+std::chrono::milliseconds CollectorGovernor::interval() const
+{
+    return interval_;
+}
+
+std::chrono::milliseconds CollectorGovernor::detail_interval() const
+{
+    return detail_interval_;
+}
+
+unsigned int CollectorGovernor::depth_halvings() const
+{
+    return depth_halvings_;
+}
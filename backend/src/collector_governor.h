@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+
+// Keeps the collector's own CPU use under a share of one core by stretching its sampling intervals.
+//
+// Collections come in two tiers: the base gauges (CPU, memory, disk, network, load) and the detail
+// sections (process walk, socket tables, Docker). Each collection reports the CPU time its stages used;
+// the governor keeps a moving average of both tiers' cost and projects the CPU share the current
+// intervals lead to. Over budget it backs off in order of cost per value lost: first the detail
+// interval, then the depth of the per-process detail probes, and only then the base interval. Well under
+// budget (a quiet host makes collections cheap again) it steps back in the reverse order, down to the
+// fastest settings.
+class CollectorGovernor
+{
+public:
+    static constexpr unsigned int MAX_DEPTH_HALVINGS = 3;
+
+    // `cpuPercent` of one core; 0 disables the governor and keeps every interval at `minInterval`.
+    CollectorGovernor(double cpuPercent, std::chrono::milliseconds minInterval);
+
+    bool enabled() const;
+
+    // Accounts one collection: `cpu` is the thread CPU time of its stages, `detail` whether the detail
+    // tier was collected or carried over from the previous snapshot.
+    void record(std::chrono::nanoseconds cpu, bool detail);
+
+    // Accounts sections collected between collections for a consumer that asked for them; the cost is
+    // charged to the detail tier with the next record().
+    void record_top_up(std::chrono::nanoseconds cpu);
+
+    std::chrono::milliseconds interval() const;        // between collections
+    std::chrono::milliseconds detail_interval() const; // between detail collections, never below interval()
+    unsigned int depth_halvings() const;               // how often the detail probe budget is halved
+    double projected_percent() const;                  // CPU share at the current intervals, % of one core
+
+private:
+    void adjust();
+
+    const double budget_percent_;
+    const std::chrono::milliseconds min_interval_;
+    std::chrono::milliseconds interval_;
+    std::chrono::milliseconds detail_interval_;
+    unsigned int depth_halvings_;
+    double base_cost_ms_;   // moving average of a base-only collection
+    double detail_cost_ms_; // moving average of what the detail tier adds
+    double top_up_ms_;      // top-up CPU time since the last record()
+    bool base_measured_;
+    bool detail_measured_;
+};
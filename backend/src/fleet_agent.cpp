@@ -0,0 +1,237 @@
+#include "fleet_agent.h"
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/version.hpp>
+#include <boost/beast/websocket.hpp>
+#include <algorithm>
+#include <iostream>
+
+#include "fleet_codec.h"
+
+namespace beast = boost::beast;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace
+{
+    constexpr unsigned int PUSH_SECTIONS = SECTION_PROCESS_COUNTS | SECTION_CONNECTIONS | SECTION_LISTENING_PORTS | SECTION_DOCKER;
+    constexpr auto IO_TIMEOUT = std::chrono::seconds(5);
+    constexpr auto MIN_RETRY_BACKOFF = std::chrono::milliseconds(500);
+    constexpr auto MAX_RETRY_BACKOFF = std::chrono::seconds(30);
+
+    // Accepts ws://host[:port][/path] (http:// is treated the same); the path defaults to /ingest.
+    bool parse_ws_url(const std::string &url, std::string &host, std::string &port, std::string &path)
+    {
+        std::string rest;
+        for (const char *scheme : {"ws://", "http://"})
+        {
+            if (url.rfind(scheme, 0) == 0)
+            {
+                rest = url.substr(std::char_traits<char>::length(scheme));
+                break;
+            }
+        }
+        if (rest.empty())
+        {
+            return false;
+        }
+
+        const auto slash = rest.find('/');
+        const std::string authority = rest.substr(0, slash);
+        path = slash == std::string::npos ? "/ingest" : rest.substr(slash);
+        const auto colon = authority.rfind(':');
+        host = authority.substr(0, colon);
+        port = colon == std::string::npos ? "80" : authority.substr(colon + 1);
+        return !host.empty() && !port.empty();
+    }
+
+} // namespace
+
+struct FleetAgent::Connection
+{
+    net::io_context ioc;
+    tcp::resolver resolver{ioc};
+    std::unique_ptr<websocket::stream<beast::tcp_stream>> ws;
+    std::string host;
+    std::string port;
+    std::string path;
+
+    // Runs one asynchronous operation to completion on this thread; tcp_stream's timer bounds it.
+    template <typename Initiate>
+    beast::error_code complete(Initiate initiate)
+    {
+        beast::error_code result;
+        auto &stream = beast::get_lowest_layer(*ws);
+        stream.expires_after(IO_TIMEOUT);
+        initiate([&result](beast::error_code ec, auto &&...)
+                 { result = ec; });
+        ioc.restart();
+        ioc.run();
+        stream.expires_never();
+        return result;
+    }
+
+    void close()
+    {
+        if (!ws)
+        {
+            return;
+        }
+        beast::error_code ignored;
+        beast::get_lowest_layer(*ws).socket().shutdown(tcp::socket::shutdown_both, ignored);
+        beast::get_lowest_layer(*ws).close();
+        ws.reset();
+    }
+};
+
+FleetAgent::FleetAgent(MetricsCollector &collector, FleetAgentConfig config)
+    : collector_(collector),
+      config_(std::move(config)),
+      connection_(std::make_unique<Connection>()),
+      running_(false)
+{
+}
+
+FleetAgent::~FleetAgent()
+{
+    stop();
+}
+
+void FleetAgent::start()
+{
+    if (!parse_ws_url(config_.url, connection_->host, connection_->port, connection_->path))
+    {
+        std::cerr << "Fleet push disabled: unsupported URL '" << config_.url << "' (expected ws://host[:port][/path])" << std::endl;
+        return;
+    }
+
+    collector_.add_listener([this](const SystemMetrics &metrics)
+                            { on_snapshot(metrics); });
+
+    running_ = true;
+    worker_ = std::thread([this]()
+                          { run(); });
+    std::cout << "Pushing snapshots as '" << config_.host << "' to " << config_.url << std::endl;
+}
+
+void FleetAgent::stop()
+{
+    if (!running_.exchange(false))
+    {
+        return;
+    }
+
+    wake_.notify_all();
+    if (worker_.joinable())
+    {
+        worker_.join();
+    }
+
+    Connection &conn = *connection_;
+    if (conn.ws)
+    {
+        conn.complete([&conn](auto handler)
+                      { conn.ws->async_close(websocket::close_code::going_away, handler); });
+        conn.close();
+    }
+}
+
+void FleetAgent::on_snapshot(const SystemMetrics &metrics)
+{
+    std::string frame = encode_fleet_sample(metrics, config_.host);
+    std::lock_guard<std::mutex> lock(mutex_);
+    latest_frame_ = std::move(frame);
+}
+
+bool FleetAgent::connect()
+{
+    Connection &conn = *connection_;
+    beast::error_code ec;
+    const auto endpoints = conn.resolver.resolve(conn.host, conn.port, ec);
+    if (!ec)
+    {
+        conn.ws = std::make_unique<websocket::stream<beast::tcp_stream>>(conn.ioc);
+        ec = conn.complete([&conn, &endpoints](auto handler)
+                           { beast::get_lowest_layer(*conn.ws).async_connect(endpoints, handler); });
+    }
+    if (!ec)
+    {
+        beast::get_lowest_layer(*conn.ws).socket().set_option(tcp::no_delay(true));
+        const std::string token = config_.token;
+        conn.ws->set_option(websocket::stream_base::decorator([token](websocket::request_type &req)
+                                                              {
+            req.set(beast::http::field::user_agent, BOOST_BEAST_VERSION_STRING " monitoring-agent");
+            if (!token.empty())
+            {
+                req.set(beast::http::field::authorization, "Bearer " + token);
+            } }));
+        const std::string hostHeader = conn.host + ':' + conn.port;
+        ec = conn.complete([&conn, &hostHeader](auto handler)
+                           { conn.ws->async_handshake(hostHeader, conn.path, handler); });
+    }
+    if (ec)
+    {
+        std::cerr << "Fleet push cannot connect to " << config_.url << ": " << ec.message() << std::endl;
+        conn.close();
+        return false;
+    }
+
+    conn.ws->binary(true);
+    std::cout << "Fleet push connected to " << config_.url << std::endl;
+    return true;
+}
+
+bool FleetAgent::push(const std::string &frame)
+{
+    Connection &conn = *connection_;
+    const beast::error_code ec = conn.complete([&conn, &frame](auto handler)
+                                               { conn.ws->async_write(net::buffer(frame), handler); });
+    if (ec)
+    {
+        std::cerr << "Fleet push failed: " << ec.message() << std::endl;
+        conn.close();
+        return false;
+    }
+    return true;
+}
+
+void FleetAgent::run()
+{
+    auto backoff = std::chrono::steady_clock::duration(MIN_RETRY_BACKOFF);
+    auto retry_at = std::chrono::steady_clock::now();
+    std::string frame;
+
+    while (running_)
+    {
+        const auto started = std::chrono::steady_clock::now();
+
+        // Keeps the pushed sections in demand, so the collecting thread samples them and hands each snapshot
+        // to on_snapshot(); nothing is collected here. Repeated sequences double as heartbeats.
+        collector_.latest(PUSH_SECTIONS);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            frame = latest_frame_;
+        }
+
+        if (!frame.empty() && started >= retry_at)
+        {
+            const bool delivered = (connection_->ws || connect()) && push(frame);
+            if (delivered)
+            {
+                backoff = MIN_RETRY_BACKOFF;
+            }
+            else
+            {
+                retry_at = std::chrono::steady_clock::now() + backoff;
+                backoff = std::min<std::chrono::steady_clock::duration>(backoff * 2, MAX_RETRY_BACKOFF);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait_until(lock, started + config_.interval, [this]()
+                         { return !running_.load(); });
+    }
+}
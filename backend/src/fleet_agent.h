@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "system_metrics.h"
+
+struct FleetAgentConfig
+{
+    std::string url;                    // Aggregator ingest endpoint, e.g. ws://aggregator:8080/ingest
+    std::string token;                  // Sent as "Authorization: Bearer ..." on the handshake
+    std::string host;                   // Name this agent reports under
+    std::chrono::milliseconds interval; // Push period
+};
+
+// Pushes binary FleetSample frames (fleet_codec.h) to an aggregator over one persistent WebSocket,
+// reconnecting with exponential backoff. Frames are encoded from collector snapshots, so the push
+// itself never copies or re-reads a snapshot.
+class FleetAgent
+{
+public:
+    FleetAgent(MetricsCollector &collector, FleetAgentConfig config);
+    ~FleetAgent();
+
+    void start();
+    void stop();
+
+private:
+    struct Connection;
+
+    void on_snapshot(const SystemMetrics &metrics);
+    void run();
+    bool connect();
+    bool push(const std::string &frame);
+
+    MetricsCollector &collector_;
+    FleetAgentConfig config_;
+    std::unique_ptr<Connection> connection_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::string latest_frame_;
+    std::atomic<bool> running_;
+    std::thread worker_;
+};
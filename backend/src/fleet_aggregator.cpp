@@ -0,0 +1,669 @@
+#include "fleet_aggregator.h"
+
+#include "http_transport.h"
+#include "system_metrics.h"
+#include "token_utils.h"
+
+// Include Boost beast/asio only in .cpp (limits macro/template exposure)
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <boost/beast/version.hpp>
+#include <boost/beast/websocket.hpp>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace beast = boost::beast;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace
+{
+    constexpr std::size_t DEFAULT_TOP = 10;
+    constexpr std::size_t MAX_TOP = 100;
+    constexpr std::size_t MAX_FRAME_BYTES = 4096;
+    constexpr auto STREAM_INTERVAL = std::chrono::seconds(1);
+    constexpr auto EVICTION_INTERVAL = std::chrono::seconds(1);
+
+    bool is_disconnect(beast::error_code ec)
+    {
+        return ec == websocket::error::closed || ec == net::error::operation_aborted ||
+               ec == net::error::broken_pipe || ec == net::error::connection_reset || ec == net::error::eof;
+    }
+
+    std::string_view target_path(const beast::http::request<beast::http::string_body> &request)
+    {
+        const std::string_view target(request.target().data(), request.target().size());
+        return target.substr(0, target.find('?'));
+    }
+
+    std::string remote_address(const beast::tcp_stream &stream)
+    {
+        beast::error_code ec;
+        const auto endpoint = stream.socket().remote_endpoint(ec);
+        return ec ? std::string() : endpoint.address().to_string() + ':' + std::to_string(endpoint.port());
+    }
+
+    // Whether the agent's snapshot held `section`, i.e. its counters for that section are real zeros rather than absent.
+    bool reports(const FleetSample &sample, unsigned int section)
+    {
+        return (sample.sections & section) != 0;
+    }
+
+    nlohmann::json counter(const FleetSample &sample, unsigned int section, unsigned long long value)
+    {
+        return reports(sample, section) ? nlohmann::json(value) : nlohmann::json(nullptr);
+    }
+
+    std::string handshake_token(const beast::http::request<beast::http::string_body> &request)
+    {
+        const auto field = request[beast::http::field::authorization];
+        const std::string_view authorization(field.data(), field.size());
+        constexpr std::string_view BEARER = "Bearer ";
+        if (authorization.size() > BEARER.size() && authorization.substr(0, BEARER.size()) == BEARER)
+        {
+            return std::string(authorization.substr(BEARER.size()));
+        }
+        const auto params = parse_query(std::string_view(request.target().data(), request.target().size()));
+        const auto iter = params.find("token");
+        return iter != params.end() ? iter->second : std::string();
+    }
+
+    void reject_upgrade(HttpUpgrade &&upgrade, beast::http::status status)
+    {
+        struct Rejection
+        {
+            HttpUpgrade upgrade;
+            beast::http::response<beast::http::string_body> response;
+        };
+        const unsigned version = upgrade.request.version();
+        auto rejection = std::make_shared<Rejection>(Rejection{std::move(upgrade), {status, version}});
+        rejection->response.set(beast::http::field::server, BOOST_BEAST_VERSION_STRING " monitoring-service");
+        rejection->response.keep_alive(false);
+        rejection->response.prepare_payload();
+        beast::http::async_write(rejection->upgrade.stream, rejection->response, [rejection](beast::error_code, std::size_t)
+                                 {
+            beast::error_code ignored;
+            rejection->upgrade.stream.socket().shutdown(tcp::socket::shutdown_both, ignored); });
+    }
+
+    void set_error(HttpResponse &response, unsigned int status, const std::string &message)
+    {
+        response.status = status;
+        response.set_body(nlohmann::json{{"error", message}}.dump(), "application/json");
+    }
+
+    // Nearest-rank percentiles over an ascending sequence.
+    nlohmann::json distribution(std::vector<double> values)
+    {
+        if (values.empty())
+        {
+            return nullptr;
+        }
+        std::sort(values.begin(), values.end());
+        auto at = [&values](double p)
+        {
+            const auto rank = static_cast<std::size_t>(p * static_cast<double>(values.size() - 1) + 0.5);
+            return values[std::min(rank, values.size() - 1)];
+        };
+        double sum = 0.0;
+        for (const double value : values)
+        {
+            sum += value;
+        }
+        return {
+            {"avg", sum / static_cast<double>(values.size())},
+            {"min", values.front()},
+            {"p50", at(0.50)},
+            {"p90", at(0.90)},
+            {"p99", at(0.99)},
+            {"max", values.back()}};
+    }
+
+    double load_per_core(const FleetSample &sample)
+    {
+        return sample.load1 / std::max(1u, sample.cpuCount);
+    }
+
+} // namespace
+
+// One agent connection: binary FleetSample frames in, nothing out.
+class FleetAggregator::IngestSession : public std::enable_shared_from_this<FleetAggregator::IngestSession>
+{
+public:
+    IngestSession(FleetAggregator &aggregator, HttpUpgrade &&upgrade)
+        : aggregator_(aggregator), ws_(std::move(upgrade.stream)), request_(std::move(upgrade.request))
+    {
+        remote_ = remote_address(beast::get_lowest_layer(ws_));
+    }
+
+    ~IngestSession()
+    {
+        if (!host_.empty())
+        {
+            aggregator_.agent_detached(host_);
+        }
+        aggregator_.active_agents_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void run()
+    {
+        ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+        ws_.read_message_max(MAX_FRAME_BYTES);
+        ws_.async_accept(request_, [self = shared_from_this()](beast::error_code ec)
+                         {
+            if (ec)
+            {
+                std::cerr << "Fleet agent handshake error: " << ec.message() << std::endl;
+                return;
+            }
+            self->do_read(); });
+    }
+
+private:
+    void do_read()
+    {
+        ws_.async_read(buffer_, [self = shared_from_this()](beast::error_code ec, std::size_t bytes)
+                       { self->on_read(ec, bytes); });
+    }
+
+    void on_read(beast::error_code ec, std::size_t bytes)
+    {
+        if (ec)
+        {
+            if (!is_disconnect(ec))
+            {
+                std::cerr << "Fleet agent " << (host_.empty() ? remote_ : host_) << " disconnected: " << ec.message() << std::endl;
+            }
+            return;
+        }
+
+        FleetSample sample{};
+        std::string error;
+        const auto data = buffer_.cdata();
+        if (!ws_.got_binary() ||
+            !decode_fleet_sample(static_cast<const char *>(data.data()), data.size(), sample, error))
+        {
+            aggregator_.frames_rejected_.fetch_add(1, std::memory_order_relaxed);
+            buffer_.consume(bytes);
+            do_read();
+            return;
+        }
+        buffer_.consume(bytes);
+
+        if (host_.empty())
+        {
+            host_ = sample.host;
+            aggregator_.agent_attached(host_);
+        }
+        else if (sample.host != host_)
+        {
+            // The first frame pins the session's host; renaming would leave a host entry behind per name.
+            aggregator_.frames_rejected_.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "Closing fleet agent " << remote_ << ": host changed from '" << host_ << "' to '" << sample.host << "'" << std::endl;
+            ws_.async_close(websocket::close_code::policy_error, [self = shared_from_this()](beast::error_code) {});
+            return;
+        }
+        aggregator_.ingest(sample, remote_);
+        do_read();
+    }
+
+    FleetAggregator &aggregator_;
+    websocket::stream<beast::tcp_stream> ws_;
+    beast::http::request<beast::http::string_body> request_;
+    beast::flat_buffer buffer_;
+    std::string remote_;
+    std::string host_;
+};
+
+// A dashboard connection on /fleet: the default rollup every STREAM_INTERVAL, skipping ticks while a write is pending.
+class FleetAggregator::StreamSession : public std::enable_shared_from_this<FleetAggregator::StreamSession>
+{
+public:
+    StreamSession(FleetAggregator &aggregator, HttpUpgrade &&upgrade)
+        : aggregator_(aggregator), ws_(std::move(upgrade.stream)), request_(std::move(upgrade.request)),
+          timer_(ws_.get_executor()), writing_(false), closed_(false)
+    {
+    }
+
+    ~StreamSession()
+    {
+        aggregator_.active_streams_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void run()
+    {
+        ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+        ws_.read_message_max(MAX_FRAME_BYTES);
+        ws_.async_accept(request_, [self = shared_from_this()](beast::error_code ec)
+                         {
+            if (ec)
+            {
+                std::cerr << "Fleet stream handshake error: " << ec.message() << std::endl;
+                return;
+            }
+            self->ws_.text(true);
+            self->do_read();
+            self->tick(); });
+    }
+
+private:
+    // Incoming messages are ignored; reading keeps close and ping frames flowing.
+    void do_read()
+    {
+        ws_.async_read(buffer_, [self = shared_from_this()](beast::error_code ec, std::size_t bytes)
+                       {
+            if (ec)
+            {
+                self->closed_ = true;
+                self->timer_.cancel();
+                return;
+            }
+            self->buffer_.consume(bytes);
+            self->do_read(); });
+    }
+
+    void tick()
+    {
+        if (closed_)
+        {
+            return;
+        }
+        if (!writing_)
+        {
+            writing_ = true;
+            current_ = aggregator_.stream_payload();
+            ws_.async_write(net::buffer(*current_), [self = shared_from_this()](beast::error_code ec, std::size_t)
+                            {
+                self->writing_ = false;
+                self->current_.reset();
+                if (ec)
+                {
+                    self->closed_ = true;
+                    self->timer_.cancel();
+                } });
+        }
+
+        timer_.expires_after(STREAM_INTERVAL);
+        timer_.async_wait([self = shared_from_this()](beast::error_code ec)
+                          {
+            if (!ec)
+            {
+                self->tick();
+            } });
+    }
+
+    FleetAggregator &aggregator_;
+    websocket::stream<beast::tcp_stream> ws_;
+    beast::http::request<beast::http::string_body> request_;
+    beast::flat_buffer buffer_;
+    net::steady_timer timer_;
+    std::shared_ptr<const std::string> current_;
+    bool writing_;
+    bool closed_;
+};
+
+FleetAggregator::FleetAggregator(std::string apiToken, std::size_t historyLength, std::chrono::milliseconds staleAfter,
+                                 std::chrono::milliseconds retainOffline, std::size_t maxAgents, std::size_t maxStreams)
+    : api_token_(std::move(apiToken)), history_length_(std::max<std::size_t>(1, historyLength)), stale_after_(staleAfter),
+      retain_offline_(retainOffline), max_agents_(std::max<std::size_t>(1, maxAgents)), max_streams_(std::max<std::size_t>(1, maxStreams)),
+      active_agents_(0), active_streams_(0), frames_received_(0), frames_rejected_(0), last_eviction_(), version_(0), payload_version_(0)
+{
+}
+
+HttpServer::UpgradeHandler FleetAggregator::upgrade_handler(HttpServer::UpgradeHandler fallback)
+{
+    return [this, fallback = std::move(fallback)](HttpUpgrade &&upgrade)
+    {
+        const std::string_view path = target_path(upgrade.request);
+        if (path != "/ingest" && path != "/fleet")
+        {
+            fallback(std::move(upgrade));
+            return;
+        }
+
+        if (!is_token_valid(handshake_token(upgrade.request)))
+        {
+            std::cerr << "Rejected fleet connection on " << path << " due to invalid token" << std::endl;
+            reject_upgrade(std::move(upgrade), beast::http::status::unauthorized);
+            return;
+        }
+        if (path == "/fleet")
+        {
+            // Stream sessions count against their own cap, like agents; the session releases its slot.
+            if (active_streams_.fetch_add(1, std::memory_order_relaxed) >= max_streams_)
+            {
+                active_streams_.fetch_sub(1, std::memory_order_relaxed);
+                std::cerr << "Rejecting fleet stream: too many sessions" << std::endl;
+                reject_upgrade(std::move(upgrade), beast::http::status::service_unavailable);
+                return;
+            }
+            std::make_shared<StreamSession>(*this, std::move(upgrade))->run();
+            return;
+        }
+
+        // The session releases its slot when it is destroyed.
+        if (active_agents_.fetch_add(1, std::memory_order_relaxed) >= max_agents_)
+        {
+            active_agents_.fetch_sub(1, std::memory_order_relaxed);
+            std::cerr << "Rejecting fleet agent: too many agents" << std::endl;
+            reject_upgrade(std::move(upgrade), beast::http::status::service_unavailable);
+            return;
+        }
+        std::make_shared<IngestSession>(*this, std::move(upgrade))->run();
+    };
+}
+
+void FleetAggregator::ingest(const FleetSample &sample, const std::string &remote)
+{
+    frames_received_.fetch_add(1, std::memory_order_relaxed);
+
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    evict_locked(now);
+    HostState &state = hosts_[sample.host];
+    state.lastSeen = now;
+    state.remote = remote;
+    ++state.samples;
+    ++version_;
+
+    // Heartbeats repeat the previous snapshot; only new sequences extend the history.
+    const bool fresh = state.history.empty() || sample.sequence != state.latest.sequence;
+    state.latest = sample;
+    if (!fresh)
+    {
+        return;
+    }
+    state.history.push_back({sample.timestamp, static_cast<float>(sample.cpu), static_cast<float>(sample.memory),
+                             static_cast<float>(load_per_core(sample)), static_cast<float>(sample.netRx),
+                             static_cast<float>(sample.netTx), sample.connections});
+    if (state.history.size() > history_length_)
+    {
+        state.history.pop_front();
+    }
+}
+
+void FleetAggregator::agent_attached(const std::string &host)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::size_t sessions = ++hosts_[host].sessions;
+    if (sessions == 1)
+    {
+        std::cout << "Fleet agent '" << host << "' connected" << std::endl;
+    }
+}
+
+void FleetAggregator::agent_detached(const std::string &host)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto iter = hosts_.find(host);
+    if (iter != hosts_.end() && iter->second.sessions > 0 && --iter->second.sessions == 0)
+    {
+        std::cout << "Fleet agent '" << host << "' disconnected" << std::endl;
+        ++version_;
+    }
+}
+
+bool FleetAggregator::is_online(const HostState &state, std::chrono::steady_clock::time_point now) const
+{
+    return state.sessions > 0 && now - state.lastSeen <= stale_after_;
+}
+
+void FleetAggregator::evict_locked(std::chrono::steady_clock::time_point now)
+{
+    if (now - last_eviction_ < EVICTION_INTERVAL)
+    {
+        return;
+    }
+    last_eviction_ = now;
+    for (auto iter = hosts_.begin(); iter != hosts_.end();)
+    {
+        if (iter->second.sessions == 0 && now - iter->second.lastSeen > retain_offline_)
+        {
+            iter = hosts_.erase(iter);
+            ++version_;
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+}
+
+nlohmann::json FleetAggregator::rollup_locked(std::size_t top, std::chrono::steady_clock::time_point now) const
+{
+    std::vector<const HostState *> online;
+    online.reserve(hosts_.size());
+    for (const auto &entry : hosts_)
+    {
+        if (is_online(entry.second, now))
+        {
+            online.push_back(&entry.second);
+        }
+    }
+
+    std::vector<double> cpu;
+    std::vector<double> memory;
+    std::vector<double> disk;
+    std::vector<double> load;
+    cpu.reserve(online.size());
+    memory.reserve(online.size());
+    disk.reserve(online.size());
+    load.reserve(online.size());
+    unsigned long long connections = 0;
+    unsigned long long processes = 0;
+    unsigned long long threads = 0;
+    unsigned long long containers = 0;
+    unsigned long long cores = 0;
+    double netRx = 0.0;
+    double netTx = 0.0;
+    for (const HostState *state : online)
+    {
+        const FleetSample &sample = state->latest;
+        cpu.push_back(sample.cpu);
+        memory.push_back(sample.memory);
+        disk.push_back(sample.disk);
+        load.push_back(load_per_core(sample));
+        // Hosts whose snapshot lacked a section add nothing to its totals.
+        if (reports(sample, SECTION_CONNECTIONS))
+        {
+            connections += sample.connections;
+        }
+        if (reports(sample, SECTION_PROCESS_COUNTS | SECTION_APPLICATIONS))
+        {
+            processes += sample.processes;
+            threads += sample.threads;
+        }
+        if (reports(sample, SECTION_DOCKER))
+        {
+            containers += sample.containers;
+        }
+        cores += sample.cpuCount;
+        netRx += sample.netRx;
+        netTx += sample.netTx;
+    }
+
+    // Top-K by partial sort: O(n log k) per ranking.
+    auto ranking = [&online, top](double (*key)(const FleetSample &))
+    {
+        std::vector<const HostState *> ranked(online);
+        const std::size_t count = std::min(top, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(count), ranked.end(),
+                          [key](const HostState *lhs, const HostState *rhs)
+                          { return key(lhs->latest) > key(rhs->latest); });
+        nlohmann::json list = nlohmann::json::array();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            list.push_back({{"host", ranked[i]->latest.host}, {"value", key(ranked[i]->latest)}});
+        }
+        return list;
+    };
+
+    return {
+        {"hosts", hosts_.size()},
+        {"online", online.size()},
+        {"totals",
+         {{"cpuCores", cores},
+          {"connections", connections},
+          {"processes", processes},
+          {"threads", threads},
+          {"containers", containers},
+          {"netRx", netRx},
+          {"netTx", netTx}}},
+        {"cpu", distribution(std::move(cpu))},
+        {"memory", distribution(std::move(memory))},
+        {"disk", distribution(std::move(disk))},
+        {"loadPerCore", distribution(std::move(load))},
+        {"top",
+         {{"cpu", ranking([](const FleetSample &s)
+                          { return s.cpu; })},
+          {"memory", ranking([](const FleetSample &s)
+                             { return s.memory; })},
+          {"loadPerCore", ranking([](const FleetSample &s)
+                                  { return load_per_core(s); })},
+          {"connections", ranking([](const FleetSample &s)
+                                  { return static_cast<double>(s.connections); })}}},
+        {"agents", active_agents_.load(std::memory_order_relaxed)},
+        {"framesReceived", frames_received_.load(std::memory_order_relaxed)},
+        {"framesRejected", frames_rejected_.load(std::memory_order_relaxed)},
+        {"timestamp", MetricsCollector::to_iso8601(std::chrono::system_clock::now())}};
+}
+
+std::shared_ptr<const std::string> FleetAggregator::stream_payload()
+{
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    evict_locked(now);
+    // Offline detection depends on the clock, so even an idle fleet is re-rendered once per interval.
+    if (!payload_ || payload_version_ != version_ || now - payload_rendered_ >= STREAM_INTERVAL)
+    {
+        nlohmann::json body = rollup_locked(DEFAULT_TOP, now);
+        body["type"] = "fleet";
+        payload_ = std::make_shared<const std::string>(body.dump());
+        payload_version_ = version_;
+        payload_rendered_ = now;
+    }
+    return payload_;
+}
+
+void FleetAggregator::handle_fleet(const HttpRequest &request, HttpResponse &response)
+{
+    std::size_t top = DEFAULT_TOP;
+    const std::string raw = request.query_value("top");
+    if (!raw.empty())
+    {
+        if (raw.find_first_not_of("0123456789") != std::string::npos || raw.size() > 4)
+        {
+            set_error(response, 400, "top must be a number");
+            return;
+        }
+        top = std::clamp<std::size_t>(std::stoul(raw), 1, MAX_TOP);
+    }
+
+    nlohmann::json body;
+    {
+        const auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        evict_locked(now);
+        body = rollup_locked(top, now);
+    }
+    response.set_body(body.dump(), "application/json");
+}
+
+void FleetAggregator::handle_hosts(const HttpRequest &, HttpResponse &response)
+{
+    const auto now = std::chrono::steady_clock::now();
+    nlohmann::json hosts = nlohmann::json::array();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        evict_locked(now);
+        for (const auto &entry : hosts_)
+        {
+            const HostState &state = entry.second;
+            const FleetSample &sample = state.latest;
+            hosts.push_back({{"host", entry.first},
+                             {"online", is_online(state, now)},
+                             {"remote", state.remote},
+                             {"lastSeenMs", std::chrono::duration_cast<std::chrono::milliseconds>(now - state.lastSeen).count()},
+                             {"samples", state.samples},
+                             {"cpu", sample.cpu},
+                             {"memory", sample.memory},
+                             {"disk", sample.disk},
+                             {"loadPerCore", load_per_core(sample)},
+                             {"connections", sample.connections},
+                             {"timestamp", MetricsCollector::to_iso8601(sample.timestamp)}});
+        }
+    }
+    std::sort(hosts.begin(), hosts.end(), [](const nlohmann::json &lhs, const nlohmann::json &rhs)
+              { return lhs["host"].get_ref<const std::string &>() < rhs["host"].get_ref<const std::string &>(); });
+    response.set_body(nlohmann::json({{"hosts", std::move(hosts)}}).dump(), "application/json");
+}
+
+void FleetAggregator::handle_host(const HttpRequest &request, HttpResponse &response)
+{
+    const std::string name = request.query_value("name");
+    const auto now = std::chrono::steady_clock::now();
+    nlohmann::json body;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto iter = hosts_.find(name);
+        if (iter == hosts_.end())
+        {
+            set_error(response, 404, "Unknown host '" + name + "'");
+            return;
+        }
+
+        const HostState &state = iter->second;
+        const FleetSample &s = state.latest;
+        nlohmann::json history = nlohmann::json::array();
+        for (const auto &point : state.history)
+        {
+            history.push_back({{"timestamp", MetricsCollector::to_iso8601(point.timestamp)},
+                               {"cpu", point.cpu},
+                               {"memory", point.memory},
+                               {"loadPerCore", point.loadPerCore},
+                               {"netRx", point.netRx},
+                               {"netTx", point.netTx},
+                               {"connections", point.connections}});
+        }
+        body = {
+            {"host", name},
+            {"online", is_online(state, now)},
+            {"remote", state.remote},
+            {"latest",
+             {{"sequence", s.sequence},
+              {"timestamp", MetricsCollector::to_iso8601(s.timestamp)},
+              {"cpuCount", s.cpuCount},
+              {"cpu", s.cpu},
+              {"cpuAvg", s.cpuAvg},
+              {"memory", s.memory},
+              {"swap", s.swap},
+              {"disk", s.disk},
+              {"load", {{"oneMinute", s.load1}, {"fiveMinutes", s.load5}, {"fifteenMinutes", s.load15}}},
+              {"network", {{"rx", s.netRx}, {"tx", s.netTx}, {"rxAvg", s.netRxAvg}, {"txAvg", s.netTxAvg}}},
+              {"connections", counter(s, SECTION_CONNECTIONS, s.connections)},
+              {"processes", counter(s, SECTION_PROCESS_COUNTS | SECTION_APPLICATIONS, s.processes)},
+              {"threads", counter(s, SECTION_PROCESS_COUNTS | SECTION_APPLICATIONS, s.threads)},
+              {"listeningTcp", counter(s, SECTION_LISTENING_PORTS, s.listeningTcp)},
+              {"listeningUdp", counter(s, SECTION_LISTENING_PORTS, s.listeningUdp)},
+              {"openFds", s.openFds},
+              {"uniqueDomains", counter(s, SECTION_CONNECTIONS, s.uniqueDomains)},
+              {"containers", counter(s, SECTION_DOCKER, s.containers)}}},
+            {"history", std::move(history)}};
+    }
+    response.set_body(body.dump(), "application/json");
+}
+
+bool FleetAggregator::is_token_valid(const std::string &provided) const
+{
+    if (api_token_.empty())
+    {
+        return true;
+    }
+    if (provided.empty())
+    {
+        return false;
+    }
+    return security::tokens_equal(provided, api_token_);
+}
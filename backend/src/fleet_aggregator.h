@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+
+#include "fleet_codec.h"
+#include "http_server.h"
+
+// Aggregator side of multi-host monitoring.
+//
+// Agents (FleetAgent) keep a WebSocket open to /ingest and push binary FleetSample frames. For each
+// host the aggregator keeps the latest sample plus a bounded history, and serves fleet-wide rollups:
+// GET /fleet (totals, percentiles, top hosts), /fleet/hosts and /fleet/host?name=..., and a WebSocket
+// stream of the rollup on /fleet. Hosts that stop pushing are reported offline after `staleAfter`,
+// left out of the rollup, and forgotten once they have been offline for `retainOffline`.
+//
+// A session reports under the host name of its first frame; a frame naming another host closes it.
+// `maxAgents` caps ingest sessions and `maxStreams` /fleet stream sessions.
+class FleetAggregator
+{
+public:
+    FleetAggregator(std::string apiToken, std::size_t historyLength, std::chrono::milliseconds staleAfter,
+                    std::chrono::milliseconds retainOffline, std::size_t maxAgents, std::size_t maxStreams);
+
+    // Routes /ingest and /fleet upgrades here and hands every other upgrade to `fallback`.
+    HttpServer::UpgradeHandler upgrade_handler(HttpServer::UpgradeHandler fallback);
+
+    void handle_fleet(const HttpRequest &request, HttpResponse &response);
+    void handle_hosts(const HttpRequest &request, HttpResponse &response);
+    void handle_host(const HttpRequest &request, HttpResponse &response);
+
+private:
+    class IngestSession;
+    class StreamSession;
+
+    struct HistoryPoint
+    {
+        std::chrono::system_clock::time_point timestamp;
+        float cpu;
+        float memory;
+        float loadPerCore;
+        float netRx;
+        float netTx;
+        unsigned long long connections;
+    };
+
+    struct HostState
+    {
+        FleetSample latest;
+        std::deque<HistoryPoint> history;
+        std::chrono::steady_clock::time_point lastSeen;
+        std::string remote;
+        std::size_t sessions = 0;
+        unsigned long long samples = 0;
+    };
+
+    void ingest(const FleetSample &sample, const std::string &remote);
+    void agent_attached(const std::string &host);
+    void agent_detached(const std::string &host);
+    bool is_online(const HostState &state, std::chrono::steady_clock::time_point now) const;
+    // Drops hosts offline for longer than the retention; runs at most once per second.
+    void evict_locked(std::chrono::steady_clock::time_point now);
+    nlohmann::json rollup_locked(std::size_t top, std::chrono::steady_clock::time_point now) const;
+    // Default rollup shared by every /fleet stream tick; re-rendered at most once per ingest batch and second.
+    std::shared_ptr<const std::string> stream_payload();
+    bool is_token_valid(const std::string &provided) const;
+
+    std::string api_token_;
+    std::size_t history_length_;
+    std::chrono::milliseconds stale_after_;
+    std::chrono::milliseconds retain_offline_;
+    std::size_t max_agents_;
+    std::size_t max_streams_;
+    std::atomic<std::size_t> active_agents_;
+    std::atomic<std::size_t> active_streams_;
+    std::atomic<unsigned long long> frames_received_;
+    std::atomic<unsigned long long> frames_rejected_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, HostState> hosts_;
+    std::chrono::steady_clock::time_point last_eviction_;
+    unsigned long long version_;
+    unsigned long long payload_version_;
+    std::chrono::steady_clock::time_point payload_rendered_;
+    std::shared_ptr<const std::string> payload_;
+};
@@ -0,0 +1,192 @@
+#include "fleet_codec.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    constexpr unsigned char MAGIC_0 = 'F';
+    constexpr unsigned char MAGIC_1 = 'S';
+    constexpr unsigned char VERSION = 1;
+    constexpr std::size_t MAX_HOST_LENGTH = 255;
+
+    void put_varint(std::string &out, unsigned long long value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    void put_float(std::string &out, double value)
+    {
+        const float narrowed = static_cast<float>(value);
+        std::uint32_t bits = 0;
+        std::memcpy(&bits, &narrowed, sizeof(bits));
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            out.push_back(static_cast<char>((bits >> shift) & 0xFF));
+        }
+    }
+
+    class Reader
+    {
+    public:
+        Reader(const char *data, std::size_t size) : data_(reinterpret_cast<const unsigned char *>(data)), size_(size), offset_(0) {}
+
+        bool byte(unsigned char &value)
+        {
+            if (offset_ >= size_)
+            {
+                return false;
+            }
+            value = data_[offset_++];
+            return true;
+        }
+
+        bool varint(unsigned long long &value)
+        {
+            value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                unsigned char part = 0;
+                if (!byte(part))
+                {
+                    return false;
+                }
+                value |= static_cast<unsigned long long>(part & 0x7F) << shift;
+                if ((part & 0x80) == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool real(double &value)
+        {
+            if (size_ - offset_ < 4)
+            {
+                return false;
+            }
+            std::uint32_t bits = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                bits |= static_cast<std::uint32_t>(data_[offset_++]) << (8 * i);
+            }
+            float narrowed = 0.0F;
+            std::memcpy(&narrowed, &bits, sizeof(narrowed));
+            value = narrowed;
+            return true;
+        }
+
+        bool text(std::string &value, std::size_t maxLength)
+        {
+            unsigned long long length = 0;
+            if (!varint(length) || length > maxLength || size_ - offset_ < length)
+            {
+                return false;
+            }
+            value.assign(reinterpret_cast<const char *>(data_ + offset_), static_cast<std::size_t>(length));
+            offset_ += static_cast<std::size_t>(length);
+            return true;
+        }
+
+    private:
+        const unsigned char *data_;
+        std::size_t size_;
+        std::size_t offset_;
+    };
+
+} // namespace
+
+std::string encode_fleet_sample(const SystemMetrics &metrics, const std::string &host)
+{
+    std::string out;
+    out.reserve(96 + host.size());
+    out.push_back(static_cast<char>(MAGIC_0));
+    out.push_back(static_cast<char>(MAGIC_1));
+    out.push_back(static_cast<char>(VERSION));
+
+    const std::string name = host.substr(0, MAX_HOST_LENGTH);
+    put_varint(out, name.size());
+    out += name;
+    put_varint(out, metrics.sequence);
+    put_varint(out, static_cast<unsigned long long>(
+                        std::chrono::duration_cast<std::chrono::milliseconds>(metrics.timestamp.time_since_epoch()).count()));
+    put_varint(out, metrics.sections);
+    put_varint(out, metrics.cpuCount);
+
+    for (const double gauge : {metrics.cpuUsage, metrics.cpuUsageAverage, metrics.memoryUsage, metrics.swapUsage,
+                               metrics.diskUsage, metrics.loadAverage1, metrics.loadAverage5, metrics.loadAverage15,
+                               metrics.networkReceiveRate, metrics.networkTransmitRate, metrics.networkReceiveRateAverage,
+                               metrics.networkTransmitRateAverage})
+    {
+        put_float(out, gauge);
+    }
+
+    for (const unsigned long long counter :
+         {static_cast<unsigned long long>(metrics.activeConnections > 0 ? metrics.activeConnections : 0),
+          static_cast<unsigned long long>(metrics.processCount), static_cast<unsigned long long>(metrics.threadCount),
+          static_cast<unsigned long long>(metrics.listeningTcp), static_cast<unsigned long long>(metrics.listeningUdp),
+          static_cast<unsigned long long>(metrics.openFileDescriptors), static_cast<unsigned long long>(metrics.uniqueDomains),
+          static_cast<unsigned long long>(metrics.dockerContainers.size())})
+    {
+        put_varint(out, counter);
+    }
+    return out;
+}
+
+bool decode_fleet_sample(const char *data, std::size_t size, FleetSample &sample, std::string &error)
+{
+    Reader reader(data, size);
+    unsigned char magic0 = 0;
+    unsigned char magic1 = 0;
+    unsigned char version = 0;
+    if (!reader.byte(magic0) || !reader.byte(magic1) || magic0 != MAGIC_0 || magic1 != MAGIC_1)
+    {
+        error = "not a fleet sample";
+        return false;
+    }
+    if (!reader.byte(version) || version != VERSION)
+    {
+        error = "unsupported fleet sample version";
+        return false;
+    }
+
+    unsigned long long timestampMs = 0;
+    unsigned long long sections = 0;
+    unsigned long long cpuCount = 0;
+    if (!reader.text(sample.host, MAX_HOST_LENGTH) || sample.host.empty() || !reader.varint(sample.sequence) ||
+        !reader.varint(timestampMs) || !reader.varint(sections) || !reader.varint(cpuCount))
+    {
+        error = "truncated fleet sample header";
+        return false;
+    }
+    sample.timestamp = std::chrono::system_clock::time_point(std::chrono::milliseconds(timestampMs));
+    sample.sections = static_cast<unsigned int>(sections & SECTION_ALL);
+    sample.cpuCount = static_cast<unsigned int>(cpuCount);
+
+    for (double *gauge : {&sample.cpu, &sample.cpuAvg, &sample.memory, &sample.swap, &sample.disk, &sample.load1,
+                          &sample.load5, &sample.load15, &sample.netRx, &sample.netTx, &sample.netRxAvg, &sample.netTxAvg})
+    {
+        if (!reader.real(*gauge))
+        {
+            error = "truncated fleet sample gauges";
+            return false;
+        }
+    }
+
+    for (unsigned long long *counter : {&sample.connections, &sample.processes, &sample.threads, &sample.listeningTcp,
+                                        &sample.listeningUdp, &sample.openFds, &sample.uniqueDomains, &sample.containers})
+    {
+        if (!reader.varint(*counter))
+        {
+            error = "truncated fleet sample counters";
+            return false;
+        }
+    }
+    return true;
+}
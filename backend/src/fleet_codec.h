@@ -0,0 +1,43 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "system_metrics.h"
+
+// Host-level summary an agent pushes to the aggregator (see encode_fleet_sample for the wire format).
+struct FleetSample
+{
+    std::string host;
+    unsigned long long sequence;
+    std::chrono::system_clock::time_point timestamp;
+    unsigned int sections; // CollectorSection bits in the agent's snapshot; counters of the others are not meaningful
+    unsigned int cpuCount;
+    double cpu;
+    double cpuAvg;
+    double memory;
+    double swap;
+    double disk;
+    double load1;
+    double load5;
+    double load15;
+    double netRx;
+    double netTx;
+    double netRxAvg;
+    double netTxAvg;
+    unsigned long long connections;
+    unsigned long long processes;
+    unsigned long long threads;
+    unsigned long long listeningTcp;
+    unsigned long long listeningUdp;
+    unsigned long long openFds;
+    unsigned long long uniqueDomains;
+    unsigned long long containers;
+};
+
+// Encodes a snapshot as a compact binary frame (about 80 bytes, against several KB of JSON):
+//   "FS" magic, version byte, varint-prefixed host name, varint sequence, timestamp (ms) and sections,
+//   varint CPU count, twelve little-endian float32 gauges, then eight varint counters.
+// Decoders ignore trailing bytes, so later versions can append fields.
+std::string encode_fleet_sample(const SystemMetrics &metrics, const std::string &host);
+bool decode_fleet_sample(const char *data, std::size_t size, FleetSample &sample, std::string &error);
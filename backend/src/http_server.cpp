@@ -0,0 +1,435 @@
+#include "http_server.h"
+
+#include "http_transport.h"
+#include "self_stats.h"
+#include "trace_recorder.h"
+
+#include <boost/asio/thread_pool.hpp>
+#include <boost/beast/version.hpp>
+#include <boost/beast/websocket.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <optional>
+#include <thread>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace
+{
+    constexpr auto IDLE_TIMEOUT = std::chrono::seconds(30);
+    constexpr std::size_t HEADER_LIMIT = 16 * 1024;
+    constexpr std::size_t BODY_LIMIT = 64 * 1024;
+    constexpr std::size_t BLOCKING_THREADS = 2;
+
+    bool iequals(std::string_view lhs, std::string_view rhs)
+    {
+        return lhs.size() == rhs.size() &&
+               std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char a, char b)
+                          { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); });
+    }
+
+    int hex_value(char ch)
+    {
+        if (ch >= '0' && ch <= '9')
+        {
+            return ch - '0';
+        }
+        if (ch >= 'a' && ch <= 'f')
+        {
+            return ch - 'a' + 10;
+        }
+        if (ch >= 'A' && ch <= 'F')
+        {
+            return ch - 'A' + 10;
+        }
+        return -1;
+    }
+
+    std::string url_decode(std::string_view value)
+    {
+        std::string result;
+        result.reserve(value.size());
+        for (std::size_t i = 0; i < value.size(); ++i)
+        {
+            if (value[i] == '%' && i + 2 < value.size())
+            {
+                const int high = hex_value(value[i + 1]);
+                const int low = hex_value(value[i + 2]);
+                if (high >= 0 && low >= 0)
+                {
+                    result.push_back(static_cast<char>(high * 16 + low));
+                    i += 2;
+                    continue;
+                }
+            }
+            result.push_back(value[i] == '+' ? ' ' : value[i]);
+        }
+        return result;
+    }
+
+    void log_error(const char *what, beast::error_code ec)
+    {
+        if (ec == net::error::operation_aborted || ec == beast::error::timeout ||
+            ec == net::error::connection_reset || ec == net::error::eof)
+        {
+            return;
+        }
+        std::cerr << "HTTP " << what << " error: " << ec.message() << std::endl;
+    }
+
+    class HttpSession : public std::enable_shared_from_this<HttpSession>
+    {
+    public:
+        HttpSession(tcp::socket &&socket, net::thread_pool &blocking, const HttpServer::RequestHandler &onRequest,
+                    const HttpServer::UpgradeHandler &onUpgrade)
+            : stream_(std::move(socket)), blocking_(blocking), on_request_(onRequest), on_upgrade_(onUpgrade)
+        {
+        }
+
+        void run()
+        {
+            net::dispatch(stream_.get_executor(), [self = shared_from_this()]()
+                          { self->do_read(); });
+        }
+
+    private:
+        void do_read()
+        {
+            parser_.emplace();
+            parser_->header_limit(HEADER_LIMIT);
+            parser_->body_limit(BODY_LIMIT);
+            stream_.expires_after(IDLE_TIMEOUT);
+            http::async_read(stream_, buffer_, *parser_, [self = shared_from_this()](beast::error_code ec, std::size_t)
+                             { self->on_read(ec); });
+        }
+
+        void on_read(beast::error_code ec)
+        {
+            if (ec == http::error::end_of_stream)
+            {
+                stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+                return;
+            }
+            if (ec)
+            {
+                log_error("read", ec);
+                return;
+            }
+
+            if (websocket::is_upgrade(parser_->get()))
+            {
+                stream_.expires_never();
+                on_upgrade_(HttpUpgrade{std::move(stream_), std::move(buffer_), parser_->release()});
+                return;
+            }
+
+            const auto &req = parser_->get();
+            HttpResponse response;
+            // POST is passed on for the few routes that change state; the handler rejects it everywhere else.
+            if (req.method() != http::verb::get && req.method() != http::verb::head && req.method() != http::verb::post)
+            {
+                response.status = 405;
+                response.headers.emplace_back("Allow", "GET, HEAD, POST");
+                response.set_body(std::string("{\"error\":\"Method not allowed\"}"), "application/json");
+            }
+            else
+            {
+                HttpRequest request;
+                request.method = std::string_view(req.method_string().data(), req.method_string().size());
+                request.target = std::string_view(req.target().data(), req.target().size());
+                request.path = request.target.substr(0, request.target.find('?'));
+                request.query = parse_query(request.target);
+                for (const auto &field : req)
+                {
+                    request.headers.emplace_back(std::string_view(field.name_string().data(), field.name_string().size()),
+                                                 std::string_view(field.value().data(), field.value().size()));
+                }
+
+                try
+                {
+                    self_stats::ScopedTimer timer(self_stats::Timer::HttpRequest);
+                    trace::Span span(trace::enabled() ? trace::intern(request.path, "request") : "request", "http");
+                    on_request_(request, response);
+                }
+                catch (const std::exception &ex)
+                {
+                    fail_response(response, ex);
+                }
+            }
+
+            if (response.deferred)
+            {
+                // The parsed request stays in parser_ until the response is written, so it can be used then.
+                net::post(blocking_, [self = shared_from_this(), response = std::move(response)]() mutable
+                          {
+                    try
+                    {
+                        trace::Span span("request.deferred", "http");
+                        const auto work = std::move(response.deferred);
+                        response.deferred = nullptr;
+                        work(response);
+                    }
+                    catch (const std::exception &ex)
+                    {
+                        fail_response(response, ex);
+                    }
+                    net::post(self->stream_.get_executor(), [self, response = std::move(response)]() mutable
+                              { self->write_response(self->parser_->get(), std::move(response)); }); });
+                return;
+            }
+
+            write_response(req, std::move(response));
+        }
+
+        static void fail_response(HttpResponse &response, const std::exception &ex)
+        {
+            std::cerr << "HTTP handler error: " << ex.what() << std::endl;
+            response = HttpResponse{};
+            response.status = 500;
+            response.set_body(std::string("{\"error\":\"Internal server error\"}"), "application/json");
+        }
+
+        void write_response(const http::request<http::string_body> &req, HttpResponse &&response)
+        {
+            body_ = std::move(response.body);
+            response_ = {};
+            response_.result(static_cast<http::status>(response.status));
+            response_.version(req.version());
+            response_.keep_alive(req.keep_alive());
+            response_.set(http::field::server, BOOST_BEAST_VERSION_STRING " monitoring-service");
+            if (!response.content_type.empty())
+            {
+                response_.set(http::field::content_type, response.content_type);
+            }
+            for (const auto &header : response.headers)
+            {
+                response_.set(header.first, header.second);
+            }
+
+            const bool hasBody = body_ && response.status != 204 && response.status != 304;
+            if (hasBody)
+            {
+                response_.body() = http::span_body<const char>::value_type(body_->data(), body_->size());
+            }
+            response_.prepare_payload();
+            if (req.method() == http::verb::head)
+            {
+                // Keep the Content-Length of the GET representation but send no body.
+                response_.body() = {};
+            }
+
+            http::async_write(stream_, response_, [self = shared_from_this()](beast::error_code ec, std::size_t bytes)
+                              { self->on_write(ec, bytes); });
+        }
+
+        void on_write(beast::error_code ec, std::size_t bytes)
+        {
+            body_.reset();
+            self_stats::add(self_stats::Counter::HttpRequests);
+            self_stats::add(self_stats::Counter::HttpBytesSent, bytes);
+            if (ec)
+            {
+                log_error("write", ec);
+                return;
+            }
+            if (!response_.keep_alive())
+            {
+                stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+                return;
+            }
+            // Pipelined requests are already waiting in buffer_ and are answered in order.
+            do_read();
+        }
+
+        beast::tcp_stream stream_;
+        net::thread_pool &blocking_;
+        beast::flat_buffer buffer_;
+        std::optional<http::request_parser<http::string_body>> parser_;
+        http::response<http::span_body<const char>> response_;
+        std::shared_ptr<const std::string> body_;
+        const HttpServer::RequestHandler &on_request_;
+        const HttpServer::UpgradeHandler &on_upgrade_;
+    };
+
+    class Listener : public std::enable_shared_from_this<Listener>
+    {
+    public:
+        Listener(net::io_context &ioc, net::thread_pool &blocking, tcp::endpoint endpoint,
+                 const HttpServer::RequestHandler &onRequest, const HttpServer::UpgradeHandler &onUpgrade)
+            : ioc_(ioc), blocking_(blocking), acceptor_(net::make_strand(ioc)), on_request_(onRequest), on_upgrade_(onUpgrade)
+        {
+            acceptor_.open(endpoint.protocol());
+            acceptor_.set_option(net::socket_base::reuse_address(true));
+            acceptor_.bind(endpoint);
+            acceptor_.listen(net::socket_base::max_listen_connections);
+        }
+
+        void run()
+        {
+            do_accept();
+        }
+
+    private:
+        void do_accept()
+        {
+            acceptor_.async_accept(net::make_strand(ioc_), [self = shared_from_this()](beast::error_code ec, tcp::socket socket)
+                                   { self->on_accept(ec, std::move(socket)); });
+        }
+
+        void on_accept(beast::error_code ec, tcp::socket socket)
+        {
+            if (ec == net::error::operation_aborted)
+            {
+                return;
+            }
+            if (ec)
+            {
+                log_error("accept", ec);
+            }
+            else
+            {
+                socket.set_option(tcp::no_delay(true), ec);
+                std::make_shared<HttpSession>(std::move(socket), blocking_, on_request_, on_upgrade_)->run();
+            }
+            do_accept();
+        }
+
+        net::io_context &ioc_;
+        net::thread_pool &blocking_;
+        tcp::acceptor acceptor_;
+        const HttpServer::RequestHandler &on_request_;
+        const HttpServer::UpgradeHandler &on_upgrade_;
+    };
+
+} // namespace
+
+std::string_view HttpRequest::header(std::string_view name) const
+{
+    for (const auto &header : headers)
+    {
+        if (iequals(header.first, name))
+        {
+            return header.second;
+        }
+    }
+    return {};
+}
+
+std::string HttpRequest::query_value(const std::string &name) const
+{
+    const auto iter = query.find(name);
+    return iter != query.end() ? iter->second : std::string();
+}
+
+void HttpResponse::set_body(std::string payload, std::string contentType)
+{
+    body = std::make_shared<const std::string>(std::move(payload));
+    content_type = std::move(contentType);
+}
+
+void HttpResponse::set_body(std::shared_ptr<const std::string> payload, std::string contentType)
+{
+    body = std::move(payload);
+    content_type = std::move(contentType);
+}
+
+std::unordered_map<std::string, std::string> parse_query(std::string_view target)
+{
+    std::unordered_map<std::string, std::string> params;
+    const auto pos = target.find('?');
+    if (pos == std::string_view::npos)
+    {
+        return params;
+    }
+
+    std::string_view query = target.substr(pos + 1);
+    while (!query.empty())
+    {
+        const auto end = query.find('&');
+        const std::string_view pair = query.substr(0, end);
+        query = end == std::string_view::npos ? std::string_view() : query.substr(end + 1);
+
+        const auto equal = pair.find('=');
+        if (pair.empty() || equal == std::string_view::npos)
+        {
+            continue;
+        }
+        params[url_decode(pair.substr(0, equal))] = url_decode(pair.substr(equal + 1));
+    }
+    return params;
+}
+
+struct HttpServer::Impl
+{
+    Impl(RequestHandler request, UpgradeHandler upgrade, std::size_t threadCount)
+        : ioc(static_cast<int>(threadCount)), signals(ioc, SIGINT, SIGTERM), onRequest(std::move(request)),
+          onUpgrade(std::move(upgrade)), threads(threadCount), blocking(BLOCKING_THREADS)
+    {
+    }
+
+    net::io_context ioc;
+    net::signal_set signals;
+    RequestHandler onRequest;
+    UpgradeHandler onUpgrade;
+    std::size_t threads;
+    net::thread_pool blocking;
+};
+
+HttpServer::HttpServer(RequestHandler onRequest, UpgradeHandler onUpgrade, std::size_t threads)
+    : impl_(std::make_unique<Impl>(std::move(onRequest), std::move(onUpgrade), threads == 0 ? 1 : threads))
+{
+}
+
+HttpServer::~HttpServer() = default;
+
+void HttpServer::listen(const std::string &address, unsigned short port)
+{
+    try
+    {
+        tcp::resolver resolver(impl_->ioc);
+        const std::string host = address.empty() || address == "*" || address == "+" ? std::string("0.0.0.0") : address;
+        const auto results = resolver.resolve(host, std::to_string(port), tcp::resolver::passive);
+        std::make_shared<Listener>(impl_->ioc, impl_->blocking, results.begin()->endpoint(), impl_->onRequest, impl_->onUpgrade)->run();
+        std::cout << "HTTP server listening on " << host << ':' << port << std::endl;
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << "Failed to listen on " << address << ':' << port << ": " << ex.what() << std::endl;
+        throw;
+    }
+}
+
+void HttpServer::run()
+{
+    impl_->signals.async_wait([this](beast::error_code ec, int)
+                              {
+        if (!ec)
+        {
+            stop();
+        } });
+
+    std::vector<std::thread> workers;
+    workers.reserve(impl_->threads - 1);
+    for (std::size_t i = 1; i < impl_->threads; ++i)
+    {
+        workers.emplace_back([this]()
+                             { impl_->ioc.run(); });
+    }
+    impl_->ioc.run();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void HttpServer::stop()
+{
+    impl_->ioc.stop();
+}
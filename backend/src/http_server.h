@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A parsed HTTP/1.1 request. The views point into the connection's parser and stay valid for the
+// duration of the handler call only.
+struct HttpRequest
+{
+    std::string_view method;
+    std::string_view target;
+    std::string_view path;
+    std::unordered_map<std::string, std::string> query;
+    std::vector<std::pair<std::string_view, std::string_view>> headers;
+
+    // Case-insensitive header lookup; empty when the header is absent.
+    std::string_view header(std::string_view name) const;
+    // Decoded query parameter; empty when absent.
+    std::string query_value(const std::string &name) const;
+};
+
+struct HttpResponse
+{
+    unsigned int status = 200;
+    std::string content_type;
+    std::vector<std::pair<std::string, std::string>> headers;
+    // Shared so encoded snapshot payloads can be written without copying them per response.
+    std::shared_ptr<const std::string> body;
+    // Set by a handler whose remaining work may run long: the server finishes it on a small blocking pool
+    // instead of the I/O thread and writes the response afterwards. It must not refer to the request, whose
+    // views are gone by then.
+    std::function<void(HttpResponse &)> deferred;
+
+    void set_body(std::string payload, std::string contentType);
+    void set_body(std::shared_ptr<const std::string> payload, std::string contentType);
+};
+
+// Splits the query component of a request target into percent-decoded key/value pairs.
+std::unordered_map<std::string, std::string> parse_query(std::string_view target);
+
+// The connection and handshake request of a WebSocket upgrade; defined in http_transport.h.
+struct HttpUpgrade;
+
+// Asio-based HTTP/1.1 server. Every listening port serves plain requests (with keep-alive and
+// in-order pipelining) and hands WebSocket upgrades to the upgrade handler; all connections run on
+// one io_context driven by a small thread pool. Deferred handler work runs on a separate pool so it
+// never holds an I/O thread.
+class HttpServer
+{
+public:
+    using RequestHandler = std::function<void(const HttpRequest &, HttpResponse &)>;
+    using UpgradeHandler = std::function<void(HttpUpgrade &&)>;
+
+    HttpServer(RequestHandler onRequest, UpgradeHandler onUpgrade, std::size_t threads = 2);
+    ~HttpServer();
+
+    void listen(const std::string &address, unsigned short port);
+    // Serves until stop() is called or the process receives SIGINT/SIGTERM.
+    void run();
+    void stop();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
@@ -0,0 +1,14 @@
+#pragma once
+// Beast types shared by http_server.cpp and websocket_server.cpp. Include only from .cpp files.
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include "http_server.h"
+
+struct HttpUpgrade
+{
+    boost::beast::tcp_stream stream;
+    boost::beast::flat_buffer buffer;
+    boost::beast::http::request<boost::beast::http::string_body> request;
+};
@@ -0,0 +1,843 @@
+#include "influx_exporter.h"
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/version.hpp>
+#include <zlib.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace
+{
+    constexpr std::size_t APPLICATION_SERIES_LIMIT = 25;
+    constexpr auto SAMPLE_INTERVAL = std::chrono::seconds(1);
+    // The open batch keeps growing only until a send in flight finishes; beyond this many times the batch
+    // size new snapshots are dropped instead.
+    constexpr std::size_t OPEN_BATCH_LIMIT = 2;
+    constexpr auto MIN_RETRY_BACKOFF = std::chrono::milliseconds(500);
+    constexpr auto MAX_RETRY_BACKOFF = std::chrono::seconds(30);
+    constexpr const char *SPOOL_PREFIX = "influx-";
+    constexpr const char *SPOOL_SUFFIX = ".lp.gz";
+
+    // Escapes tag keys/values and measurement names (commas, equals signs and spaces).
+    void append_escaped(std::string &out, std::string_view value)
+    {
+        for (const char ch : value)
+        {
+            if (ch == ',' || ch == '=' || ch == ' ')
+            {
+                out.push_back('\\');
+                out.push_back(ch);
+            }
+            else if (ch == '\n' || ch == '\r' || ch == '\t')
+            {
+                out.push_back(' ');
+            }
+            else
+            {
+                out.push_back(ch);
+            }
+        }
+    }
+
+    class PointWriter
+    {
+    public:
+        PointWriter(std::string &out, const char *measurement, std::string_view escapedHost)
+            : out_(out), first_field_(true)
+        {
+            out_.append(measurement);
+            out_.append(",host=");
+            out_.append(escapedHost);
+        }
+
+        void tag(const char *key, std::string_view value)
+        {
+            // InfluxDB rejects empty tag values, so those tags are omitted.
+            if (value.empty())
+            {
+                return;
+            }
+            out_.push_back(',');
+            out_.append(key);
+            out_.push_back('=');
+            append_escaped(out_, value);
+        }
+
+        void number(const char *key, double value)
+        {
+            begin_field(key);
+            char buffer[32];
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), std::isfinite(value) ? value : 0.0);
+            out_.append(buffer, result.ptr);
+        }
+
+        void integer(const char *key, long long value)
+        {
+            begin_field(key);
+            char buffer[24];
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out_.append(buffer, result.ptr);
+            out_.push_back('i');
+        }
+
+        void boolean(const char *key, bool value)
+        {
+            begin_field(key);
+            out_.append(value ? "true" : "false");
+        }
+
+        void finish(long long timestampMs)
+        {
+            out_.push_back(' ');
+            char buffer[24];
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), timestampMs);
+            out_.append(buffer, result.ptr);
+            out_.push_back('\n');
+        }
+
+    private:
+        void begin_field(const char *key)
+        {
+            out_.push_back(first_field_ ? ' ' : ',');
+            first_field_ = false;
+            out_.append(key);
+            out_.push_back('=');
+        }
+
+        std::string &out_;
+        bool first_field_;
+    };
+
+    bool gzip_compress(const std::string &input, std::string &output)
+    {
+        z_stream stream{};
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            return false;
+        }
+
+        output.resize(deflateBound(&stream, static_cast<uLong>(input.size())));
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+        stream.avail_in = static_cast<uInt>(input.size());
+        stream.next_out = reinterpret_cast<Bytef *>(&output[0]);
+        stream.avail_out = static_cast<uInt>(output.size());
+
+        const int result = deflate(&stream, Z_FINISH);
+        output.resize(stream.total_out);
+        deflateEnd(&stream);
+        return result == Z_STREAM_END;
+    }
+
+    std::string url_encode(const std::string &value)
+    {
+        static constexpr char hex[] = "0123456789ABCDEF";
+        std::string result;
+        result.reserve(value.size());
+        for (const char ch : value)
+        {
+            const auto byte = static_cast<unsigned char>(ch);
+            if (std::isalnum(byte) || ch == '-' || ch == '_' || ch == '.' || ch == '~')
+            {
+                result.push_back(ch);
+            }
+            else
+            {
+                result.push_back('%');
+                result.push_back(hex[byte >> 4]);
+                result.push_back(hex[byte & 0x0F]);
+            }
+        }
+        return result;
+    }
+
+    struct ParsedUrl
+    {
+        std::string host;
+        std::string port;
+        std::string path;
+    };
+
+    bool parse_http_url(const std::string &url, ParsedUrl &parsed)
+    {
+        constexpr std::string_view scheme = "http://";
+        if (url.compare(0, scheme.size(), scheme) != 0)
+        {
+            return false;
+        }
+
+        const std::string rest = url.substr(scheme.size());
+        const std::size_t slash = rest.find('/');
+        const std::string authority = rest.substr(0, slash);
+        parsed.path = slash == std::string::npos ? std::string() : rest.substr(slash);
+        while (!parsed.path.empty() && parsed.path.back() == '/')
+        {
+            parsed.path.pop_back();
+        }
+
+        const std::size_t colon = authority.rfind(':');
+        if (colon == std::string::npos)
+        {
+            parsed.host = authority;
+            parsed.port = "80";
+        }
+        else
+        {
+            parsed.host = authority.substr(0, colon);
+            parsed.port = authority.substr(colon + 1);
+        }
+        return !parsed.host.empty() && !parsed.port.empty();
+    }
+
+    bool read_file(const std::string &path, std::string &content)
+    {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+} // namespace
+
+LineProtocolEncoder::LineProtocolEncoder(std::string hostTag)
+{
+    append_escaped(escaped_host_, hostTag.empty() ? std::string_view("unknown") : std::string_view(hostTag));
+}
+
+void LineProtocolEncoder::encode(const SystemMetrics &metrics, std::string &out) const
+{
+    const long long timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(metrics.timestamp.time_since_epoch()).count();
+
+    // Field names mirror SystemMetrics so the provisioned Grafana dashboard can query them directly.
+    // Detail sections are written only by the collection that sampled them, not again while carried over.
+    const auto fresh = [&metrics](unsigned int section)
+    { return (metrics.collectedSections & section) != 0; };
+    PointWriter system(out, "system_metrics", escaped_host_);
+    system.number("cpuUsage", metrics.cpuUsage);
+    system.number("cpuUsageAverage", metrics.cpuUsageAverage);
+    system.number("memoryUsage", metrics.memoryUsage);
+    system.number("swapUsage", metrics.swapUsage);
+    system.number("diskUsage", metrics.diskUsage);
+    system.number("loadAverage1", metrics.loadAverage1);
+    system.number("loadAverage5", metrics.loadAverage5);
+    system.number("loadAverage15", metrics.loadAverage15);
+    system.integer("procsRunning", metrics.procsRunning);
+    system.integer("procsBlocked", metrics.procsBlocked);
+    if (metrics.pressure.available)
+    {
+        system.number("cpuPressureSome", metrics.pressure.cpu.someAvg10);
+        system.number("memoryPressureSome", metrics.pressure.memory.someAvg10);
+        system.number("memoryPressureFull", metrics.pressure.memory.fullAvg10);
+        system.number("ioPressureSome", metrics.pressure.io.someAvg10);
+        system.number("ioPressureFull", metrics.pressure.io.fullAvg10);
+    }
+    system.number("networkReceiveRate", metrics.networkReceiveRate);
+    system.number("networkTransmitRate", metrics.networkTransmitRate);
+    system.number("networkReceiveRateAverage", metrics.networkReceiveRateAverage);
+    system.number("networkTransmitRateAverage", metrics.networkTransmitRateAverage);
+    system.integer("cpuCount", metrics.cpuCount);
+    system.integer("openFileDescriptors", static_cast<long long>(metrics.openFileDescriptors));
+    if (fresh(SECTION_PROCESS_COUNTS))
+    {
+        system.integer("processCount", metrics.processCount);
+        system.integer("threadCount", metrics.threadCount);
+    }
+    if (fresh(SECTION_LISTENING_PORTS))
+    {
+        system.integer("listeningTcp", metrics.listeningTcp);
+        system.integer("listeningUdp", metrics.listeningUdp);
+    }
+    if (fresh(SECTION_CONNECTIONS))
+    {
+        system.integer("activeConnections", metrics.activeConnections);
+        system.integer("uniqueDomains", static_cast<long long>(metrics.uniqueDomains));
+    }
+    if (fresh(SECTION_DOCKER))
+    {
+        system.boolean("dockerAvailable", metrics.dockerAvailable);
+    }
+    system.finish(timestamp);
+
+    // Series are keyed by process name only: a pid tag would add a series per process ever seen. Processes
+    // sharing a name would then overwrite each other's point, so they are summed into one, which keeps the
+    // pid of the highest-ranked one and the number of processes as fields.
+    struct ApplicationPoint
+    {
+        std::string_view name;
+        long long pid;
+        long long processes;
+        double cpuPercent;
+        double memoryMb;
+        double ioReadKbps;
+        double ioWriteKbps;
+        double voluntarySwitches;
+        double involuntarySwitches;
+        long long threads;
+        long long openFds;
+        double pssMb;
+        bool hasPss;
+    };
+    const std::size_t applicationCount = fresh(SECTION_APPLICATIONS) ? std::min(metrics.topApplications.size(), APPLICATION_SERIES_LIMIT) : 0;
+    std::vector<ApplicationPoint> applications;
+    applications.reserve(applicationCount);
+    for (std::size_t i = 0; i < applicationCount; ++i)
+    {
+        const auto &app = metrics.topApplications[i];
+        auto group = std::find_if(applications.begin(), applications.end(), [&app](const ApplicationPoint &point)
+                                  { return point.name == app.name; });
+        if (group == applications.end())
+        {
+            applications.push_back(ApplicationPoint{app.name, app.pid, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0, 0.0, false});
+            group = std::prev(applications.end());
+        }
+        ++group->processes;
+        group->cpuPercent += app.cpuPercent;
+        group->memoryMb += app.memoryMb;
+        group->ioReadKbps += app.ioReadKbps;
+        group->ioWriteKbps += app.ioWriteKbps;
+        group->voluntarySwitches += app.voluntarySwitches;
+        group->involuntarySwitches += app.involuntarySwitches;
+        group->threads += app.threads;
+        group->openFds += app.openFds;
+        if (app.pssAgeMs >= 0.0)
+        {
+            group->pssMb += app.pssMb;
+            group->hasPss = true;
+        }
+    }
+    for (const auto &app : applications)
+    {
+        PointWriter point(out, "application_usage", escaped_host_);
+        point.tag("name", app.name);
+        point.integer("pid", app.pid);
+        point.integer("processes", app.processes);
+        point.number("cpuPercent", app.cpuPercent);
+        point.number("memoryMb", app.memoryMb);
+        point.number("ioReadKbps", app.ioReadKbps);
+        point.number("ioWriteKbps", app.ioWriteKbps);
+        point.number("ctxSwitchesVoluntary", app.voluntarySwitches);
+        point.number("ctxSwitchesInvoluntary", app.involuntarySwitches);
+        point.integer("threads", app.threads);
+        point.integer("openFds", app.openFds);
+        if (app.hasPss)
+        {
+            point.number("pssMb", app.pssMb);
+        }
+        point.finish(timestamp);
+    }
+
+    if (fresh(SECTION_CONNECTIONS))
+    {
+        for (const auto &domain : metrics.domainUsage)
+        {
+            PointWriter point(out, "domain_usage", escaped_host_);
+            point.tag("domain", domain.domain);
+            point.number("receiveRate", domain.receiveRate);
+            point.number("transmitRate", domain.transmitRate);
+            point.integer("connections", domain.connections);
+            point.finish(timestamp);
+        }
+    }
+
+    if (fresh(SECTION_DOCKER))
+    {
+        for (const auto &container : metrics.dockerContainers)
+        {
+            PointWriter point(out, "docker_container", escaped_host_);
+            point.tag("id", container.id);
+            point.tag("name", container.name);
+            point.tag("image", container.image);
+            point.number("cpuPercent", container.cpuPercent);
+            point.number("memoryUsageMb", container.memoryUsageMb);
+            point.number("memoryLimitMb", container.memoryLimitMb);
+            point.number("memoryPercent", container.memoryPercent);
+            point.number("networkRxKb", container.networkRxKb);
+            point.number("networkTxKb", container.networkTxKb);
+            point.number("blockReadKb", container.blockReadKb);
+            point.number("blockWriteKb", container.blockWriteKb);
+            point.integer("pids", container.pids);
+            if (container.cpuPressure >= 0.0)
+            {
+                point.number("cpuPressure", container.cpuPressure);
+                point.number("memoryPressure", container.memoryPressure);
+                point.number("ioPressure", container.ioPressure);
+            }
+            point.finish(timestamp);
+        }
+    }
+}
+
+struct InfluxExporter::Connection
+{
+    net::io_context ioc;
+    tcp::resolver resolver{ioc};
+    beast::tcp_stream stream{ioc};
+    beast::flat_buffer buffer;
+    std::string host;
+    std::string port;
+    bool connected = false;
+
+    // Runs one asynchronous operation on this thread until it completes. The stream's expiry only bounds
+    // asynchronous operations, so connect, write and read all go through here rather than the blocking calls.
+    template <typename Initiate>
+    beast::error_code complete(Initiate initiate, std::chrono::milliseconds timeout)
+    {
+        beast::error_code result;
+        stream.expires_after(timeout);
+        initiate([&result](beast::error_code ec, auto &&...)
+                 { result = ec; });
+        ioc.restart();
+        ioc.run();
+        stream.expires_never();
+        return result;
+    }
+
+    void close()
+    {
+        beast::error_code ignored;
+        stream.socket().shutdown(tcp::socket::shutdown_both, ignored);
+        stream.close();
+        buffer.clear();
+        connected = false;
+    }
+};
+
+InfluxExporter::InfluxExporter(MetricsCollector &collector, InfluxExporterConfig config)
+    : collector_(collector),
+      config_(std::move(config)),
+      encoder_(config_.host_tag),
+      target_(),
+      connection_(std::make_unique<Connection>()),
+      open_batch_(),
+      open_batch_started_(),
+      pending_(),
+      spool_files_(),
+      spool_bytes_(0),
+      spool_sequence_(0),
+      dropped_batches_(0),
+      dropped_snapshots_(0),
+      running_(false),
+      worker_()
+{
+    open_batch_.reserve(config_.batch_max_bytes + config_.batch_max_bytes / 4);
+}
+
+InfluxExporter::~InfluxExporter()
+{
+    stop();
+}
+
+void InfluxExporter::start()
+{
+    ParsedUrl url;
+    if (!parse_http_url(config_.url, url))
+    {
+        std::cerr << "InfluxDB exporter disabled: unsupported URL '" << config_.url << "' (expected http://host[:port])" << std::endl;
+        return;
+    }
+
+    connection_->host = url.host;
+    connection_->port = url.port;
+    target_ = url.path + "/api/v2/write?org=" + url_encode(config_.org) + "&bucket=" + url_encode(config_.bucket) + "&precision=ms";
+
+    load_spool();
+    collector_.add_listener([this](const SystemMetrics &metrics)
+                            { on_snapshot(metrics); });
+
+    running_ = true;
+    worker_ = std::thread([this]()
+                          { run(); });
+    std::cout << "InfluxDB exporter writing to " << config_.url << " (bucket " << config_.bucket << ")" << std::endl;
+}
+
+void InfluxExporter::stop()
+{
+    if (!running_.exchange(false))
+    {
+        return;
+    }
+
+    wake_.notify_all();
+    // A write or read in flight is cancelled rather than left to run into the request timeout; posted to the
+    // connection's io_context, the cancellation runs on the worker inside Connection::complete().
+    Connection &conn = *connection_;
+    net::post(conn.ioc, [&conn]()
+              { conn.stream.cancel(); });
+    if (worker_.joinable())
+    {
+        worker_.join();
+    }
+
+    // Persist whatever is still queued so a restart can deliver it.
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string compressed;
+    if (!open_batch_.empty() && gzip_compress(open_batch_, compressed))
+    {
+        pending_.push_back(std::move(compressed));
+    }
+    open_batch_.clear();
+    while (!pending_.empty())
+    {
+        spill_locked(std::move(pending_.front()));
+        pending_.pop_front();
+    }
+}
+
+void InfluxExporter::on_snapshot(const SystemMetrics &metrics)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (open_batch_.empty())
+    {
+        open_batch_started_ = std::chrono::steady_clock::now();
+    }
+    else if (open_batch_.size() >= OPEN_BATCH_LIMIT * config_.batch_max_bytes)
+    {
+        // Nothing seals the open batch while a send waits on the server.
+        if (dropped_snapshots_++ % 60 == 0)
+        {
+            std::cerr << "InfluxDB exporter busy sending; dropped snapshot (" << dropped_snapshots_ << " dropped so far)" << std::endl;
+        }
+        return;
+    }
+
+    encoder_.encode(metrics, open_batch_);
+    if (open_batch_.size() >= config_.batch_max_bytes)
+    {
+        wake_.notify_one();
+    }
+}
+
+void InfluxExporter::run()
+{
+    std::string sealing;
+    std::string compressed;
+    std::string batch;
+    std::string spool_path;
+    sealing.reserve(open_batch_.capacity());
+
+    auto backoff = std::chrono::steady_clock::duration(MIN_RETRY_BACKOFF);
+    auto next_sample = std::chrono::steady_clock::now();
+    auto retry_at = next_sample;
+
+    while (running_)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_sample)
+        {
+            // Keeps the encoded sections in demand, so the collecting thread samples them and hands each
+            // snapshot to on_snapshot() even when no client is polling. Nothing is collected here.
+            collector_.latest(LineProtocolEncoder::SECTIONS);
+            now = std::chrono::steady_clock::now();
+            next_sample = now + SAMPLE_INTERVAL;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!open_batch_.empty() &&
+                (open_batch_.size() >= config_.batch_max_bytes || now - open_batch_started_ >= config_.flush_interval))
+            {
+                // Swap buffers so both keep their capacity across batches.
+                sealing.swap(open_batch_);
+                open_batch_.clear();
+            }
+        }
+
+        if (!sealing.empty())
+        {
+            const bool ok = gzip_compress(sealing, compressed);
+            sealing.clear();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!ok)
+            {
+                ++dropped_batches_;
+                std::cerr << "InfluxDB exporter failed to compress batch; dropped" << std::endl;
+            }
+            else
+            {
+                if (pending_.size() >= config_.retry_queue_max_batches)
+                {
+                    spill_locked(std::move(pending_.front()));
+                    pending_.pop_front();
+                }
+                pending_.push_back(std::move(compressed));
+                compressed = std::string();
+            }
+        }
+
+        bool has_batch = false;
+        if (now >= retry_at)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            has_batch = next_batch_locked(batch, spool_path);
+        }
+
+        if (has_batch && !spool_path.empty() && !read_file(spool_path, batch))
+        {
+            std::cerr << "InfluxDB exporter could not read spooled batch " << spool_path << std::endl;
+            std::lock_guard<std::mutex> lock(mutex_);
+            drop_spool_front_locked();
+            continue;
+        }
+
+        if (has_batch)
+        {
+            const bool delivered = send(batch);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!spool_path.empty())
+            {
+                if (delivered)
+                {
+                    drop_spool_front_locked();
+                }
+            }
+            else if (!delivered)
+            {
+                // Requeue at the front; if the queue filled up meanwhile the oldest batch spills to disk.
+                pending_.push_front(std::move(batch));
+                if (pending_.size() > config_.retry_queue_max_batches)
+                {
+                    spill_locked(std::move(pending_.front()));
+                    pending_.pop_front();
+                }
+            }
+
+            batch.clear();
+            if (delivered)
+            {
+                backoff = MIN_RETRY_BACKOFF;
+                continue;
+            }
+
+            retry_at = std::chrono::steady_clock::now() + backoff;
+            backoff = std::min<std::chrono::steady_clock::duration>(backoff * 2, MAX_RETRY_BACKOFF);
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto deadline = next_sample;
+        if (!open_batch_.empty())
+        {
+            deadline = std::min(deadline, open_batch_started_ + config_.flush_interval);
+        }
+        if (!pending_.empty() || !spool_files_.empty())
+        {
+            deadline = std::min(deadline, std::max(retry_at, std::chrono::steady_clock::now()));
+        }
+        wake_.wait_until(lock, deadline, [this]()
+                         { return !running_ || open_batch_.size() >= config_.batch_max_bytes; });
+    }
+}
+
+bool InfluxExporter::next_batch_locked(std::string &batch, std::string &spoolPath)
+{
+    // Spooled batches are always older than the in-memory ones, so they go first.
+    if (!spool_files_.empty())
+    {
+        spoolPath = spool_files_.front().first;
+        return true;
+    }
+
+    spoolPath.clear();
+    if (pending_.empty())
+    {
+        return false;
+    }
+
+    batch = std::move(pending_.front());
+    pending_.pop_front();
+    return true;
+}
+
+void InfluxExporter::drop_spool_front_locked()
+{
+    std::error_code ignored;
+    std::filesystem::remove(spool_files_.front().first, ignored);
+    spool_bytes_ -= std::min(spool_bytes_, spool_files_.front().second);
+    spool_files_.pop_front();
+}
+
+void InfluxExporter::spill_locked(std::string batch)
+{
+    if (config_.spool_directory.empty())
+    {
+        ++dropped_batches_;
+        std::cerr << "InfluxDB exporter retry queue full; dropped oldest batch (" << dropped_batches_ << " dropped so far)" << std::endl;
+        return;
+    }
+
+    while (!spool_files_.empty() && spool_bytes_ + batch.size() > config_.spool_max_bytes)
+    {
+        drop_spool_front_locked();
+        ++dropped_batches_;
+    }
+
+    if (batch.size() > config_.spool_max_bytes)
+    {
+        ++dropped_batches_;
+        return;
+    }
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%020llu%s", SPOOL_PREFIX, ++spool_sequence_, SPOOL_SUFFIX);
+    const std::string path = (std::filesystem::path(config_.spool_directory) / name).string();
+
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+    if (!file)
+    {
+        ++dropped_batches_;
+        std::cerr << "InfluxDB exporter could not spool batch to " << path << std::endl;
+        return;
+    }
+
+    spool_bytes_ += batch.size();
+    spool_files_.emplace_back(path, batch.size());
+}
+
+void InfluxExporter::load_spool()
+{
+    if (config_.spool_directory.empty())
+    {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(config_.spool_directory, ec);
+    if (ec)
+    {
+        std::cerr << "InfluxDB exporter cannot use spool directory " << config_.spool_directory << ": " << ec.message() << std::endl;
+        config_.spool_directory.clear();
+        return;
+    }
+
+    std::vector<std::pair<std::string, std::size_t>> files;
+    for (const auto &entry : std::filesystem::directory_iterator(config_.spool_directory, ec))
+    {
+        const std::string name = entry.path().filename().string();
+        if (!entry.is_regular_file() || name.rfind(SPOOL_PREFIX, 0) != 0 || name.size() <= std::char_traits<char>::length(SPOOL_SUFFIX))
+        {
+            continue;
+        }
+
+        const std::string sequence = name.substr(std::char_traits<char>::length(SPOOL_PREFIX), 20);
+        spool_sequence_ = std::max(spool_sequence_, std::strtoull(sequence.c_str(), nullptr, 10));
+        const auto size = static_cast<std::size_t>(entry.file_size(ec));
+        spool_bytes_ += size;
+        files.emplace_back(entry.path().string(), size);
+    }
+
+    std::sort(files.begin(), files.end());
+    spool_files_.assign(files.begin(), files.end());
+    if (!spool_files_.empty())
+    {
+        std::cout << "InfluxDB exporter resuming " << spool_files_.size() << " spooled batches" << std::endl;
+    }
+}
+
+bool InfluxExporter::send(std::string &compressed)
+{
+    Connection &conn = *connection_;
+
+    // A keep-alive connection may have been closed by the server while idle; retry once on a fresh one.
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        beast::error_code ec;
+        if (!conn.connected)
+        {
+            const auto endpoints = conn.resolver.resolve(conn.host, conn.port, ec);
+            if (!ec)
+            {
+                ec = conn.complete([&conn, &endpoints](auto handler)
+                                   { conn.stream.async_connect(endpoints, handler); },
+                                   config_.request_timeout);
+            }
+            if (ec)
+            {
+                std::cerr << "InfluxDB exporter cannot connect to " << conn.host << ":" << conn.port << ": " << ec.message() << std::endl;
+                conn.close();
+                return false;
+            }
+            conn.connected = true;
+        }
+
+        http::request<http::string_body> req{http::verb::post, target_, 11};
+        req.set(http::field::host, conn.host);
+        req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING " monitoring-service");
+        req.set(http::field::content_type, "text/plain; charset=utf-8");
+        req.set(http::field::content_encoding, "gzip");
+        if (!config_.token.empty())
+        {
+            req.set(http::field::authorization, "Token " + config_.token);
+        }
+        req.keep_alive(true);
+        req.body() = std::move(compressed);
+        req.prepare_payload();
+
+        http::response<http::string_body> res;
+        ec = conn.complete([&conn, &req](auto handler)
+                           { http::async_write(conn.stream, req, handler); },
+                           config_.request_timeout);
+        if (!ec)
+        {
+            ec = conn.complete([&conn, &res](auto handler)
+                               { http::async_read(conn.stream, conn.buffer, res, handler); },
+                               config_.request_timeout);
+        }
+        compressed = std::move(req.body());
+
+        if (ec)
+        {
+            conn.close();
+            const bool stale = ec == http::error::end_of_stream || ec == net::error::connection_reset || ec == net::error::broken_pipe;
+            if (attempt == 0 && stale)
+            {
+                continue;
+            }
+            std::cerr << "InfluxDB write failed: " << ec.message() << std::endl;
+            return false;
+        }
+
+        if (!res.keep_alive())
+        {
+            conn.close();
+        }
+
+        const unsigned status = res.result_int();
+        if (status >= 200 && status < 300)
+        {
+            return true;
+        }
+
+        std::cerr << "InfluxDB write rejected with HTTP " << status << ": " << res.body() << std::endl;
+        if (status == 400 || status == 413 || status == 422)
+        {
+            // The payload itself is unacceptable; retrying would only block the queue.
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++dropped_batches_;
+            return true;
+        }
+        return false;
+    }
+
+    return false;
+}
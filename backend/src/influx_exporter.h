@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "system_metrics.h"
+
+struct InfluxExporterConfig
+{
+    std::string url;                           // Base URL of the InfluxDB 2.x API, e.g. http://influxdb:8086
+    std::string org;                           // Organisation passed to /api/v2/write
+    std::string bucket;                        // Destination bucket
+    std::string token;                         // API token (sent as "Authorization: Token ...")
+    std::string host_tag;                      // Value of the "host" tag on every point
+    std::size_t batch_max_bytes;               // Seal the open batch once it reaches this size
+    std::chrono::milliseconds flush_interval;  // Seal the open batch at least this often
+    std::size_t retry_queue_max_batches;       // Sealed batches kept in memory while the server is unreachable
+    std::string spool_directory;               // Overflow location for batches that do not fit in memory
+    std::size_t spool_max_bytes;               // Upper bound for the on-disk spool
+    std::chrono::milliseconds request_timeout; // Bound on connecting, writing a batch and reading the answer
+};
+
+// Appends SystemMetrics snapshots to a caller-owned buffer in InfluxDB line protocol.
+class LineProtocolEncoder
+{
+public:
+    // Collector sections encode() writes points or fields for.
+    static constexpr unsigned int SECTIONS =
+        SECTION_APPLICATIONS | SECTION_PROCESS_COUNTS | SECTION_CONNECTIONS | SECTION_LISTENING_PORTS | SECTION_DOCKER;
+
+    explicit LineProtocolEncoder(std::string hostTag);
+    void encode(const SystemMetrics &metrics, std::string &out) const;
+
+private:
+    std::string escaped_host_;
+};
+
+class InfluxExporter
+{
+public:
+    InfluxExporter(MetricsCollector &collector, InfluxExporterConfig config);
+    ~InfluxExporter();
+
+    void start();
+    void stop();
+
+private:
+    struct Connection;
+
+    void on_snapshot(const SystemMetrics &metrics);
+    void run();
+    void spill_locked(std::string batch);
+    bool next_batch_locked(std::string &batch, std::string &spoolPath);
+    void drop_spool_front_locked();
+    bool send(std::string &compressed);
+    void load_spool();
+
+    MetricsCollector &collector_;
+    InfluxExporterConfig config_;
+    LineProtocolEncoder encoder_;
+    std::string target_;
+    std::unique_ptr<Connection> connection_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::string open_batch_;
+    std::chrono::steady_clock::time_point open_batch_started_;
+    std::deque<std::string> pending_;
+    std::deque<std::pair<std::string, std::size_t>> spool_files_;
+    std::size_t spool_bytes_;
+    unsigned long long spool_sequence_;
+    unsigned long long dropped_batches_;
+    unsigned long long dropped_snapshots_; // guarded by mutex_
+    std::atomic<bool> running_;
+    std::thread worker_;
+};
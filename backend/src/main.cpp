@@ -1,22 +1,239 @@
+#include "alert_engine.h"
+#include "anomaly_detector.h"
+#include "burst_capture.h"
+#include "fleet_agent.h"
+#include "fleet_aggregator.h"
+#include "http_server.h"
+#include "influx_exporter.h"
+#include "payload_cache.h"
+#include "pressure.h"
 #include "rest_server.h"
+#include "self_stats.h"
 #include "server_config.h"
+#include "trace_recorder.h"
 #include "websocket_server.h"
 
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
-#include <thread>
+#include <memory>
+#include <string>
+#include <utility>
 
 int main()
 {
     const ServerConfig config = load_server_config();
 
-    RestServer restServer(config.metrics_endpoint, config.api_token);
-    std::thread rest_thread([&restServer]()
-                            { restServer.start(); });
-    rest_thread.detach();
+    // A single collector feeds every consumer so /proc is walked once per interval.
+    CollectorConfig collectorConfig{};
+    collectorConfig.proc_root = config.proc_root;
+    collectorConfig.sys_root = config.sys_root;
+    collectorConfig.threads = config.collector_threads;
+    collectorConfig.io_uring = config.proc_io_uring;
+    collectorConfig.process_events = config.process_events;
+    collectorConfig.rescan_interval = std::chrono::seconds(config.process_rescan_seconds);
+    collectorConfig.detail_budget = std::chrono::microseconds(config.detail_budget_us);
+    collectorConfig.detail_syscalls = config.detail_syscalls;
+    collectorConfig.detail_top_k = config.detail_top_k;
+    collectorConfig.cpu_budget_percent = static_cast<double>(config.collector_cpu_percent);
+    MetricsCollector collector(std::move(collectorConfig));
 
-    WebSocketServer wsServer(config.websocket_port, config.api_token, config.max_sessions);
-    std::cout << "WebSocket server running on ws://0.0.0.0:" << config.websocket_port << std::endl;
-    wsServer.run();
+    std::unique_ptr<InfluxExporter> exporter;
+    if (!config.influx_url.empty())
+    {
+        InfluxExporterConfig exporterConfig{};
+        exporterConfig.url = config.influx_url;
+        exporterConfig.org = config.influx_org;
+        exporterConfig.bucket = config.influx_bucket;
+        exporterConfig.token = config.influx_token;
+        exporterConfig.host_tag = config.host_name;
+        exporterConfig.batch_max_bytes = config.influx_batch_bytes;
+        exporterConfig.flush_interval = std::chrono::milliseconds(config.influx_flush_interval_ms);
+        exporterConfig.retry_queue_max_batches = config.influx_retry_batches;
+        exporterConfig.spool_directory = config.influx_spool_dir;
+        exporterConfig.spool_max_bytes = config.influx_spool_max_bytes;
+        exporterConfig.request_timeout = std::chrono::milliseconds(config.influx_timeout_ms);
+        exporter = std::make_unique<InfluxExporter>(collector, std::move(exporterConfig));
+    }
+
+    // REST and WebSocket traffic share one HTTP server, one io_context and one payload cache.
+    PayloadCache payloads;
+    RestServer restServer(config.metrics_endpoint, collector, payloads, config.api_token);
+    WebSocketServer wsServer(collector, payloads, config.api_token, config.max_sessions,
+                             std::chrono::milliseconds(config.ws_slow_consumer_ms));
+    restServer.add_route("/websocket/sessions", [&wsServer](const HttpRequest &request, HttpResponse &response)
+                         { wsServer.handle_sessions(request, response); });
+    restServer.add_route("/debug/stats", [&wsServer](const HttpRequest &, HttpResponse &response)
+                         {
+        nlohmann::json stats = self_stats::report();
+        stats["webSocket"] = wsServer.sessions_report();
+        response.set_body(stats.dump(), "application/json"); });
+    // Chrome trace capture: POST ?action=start (optionally &events=N per thread) and ?action=stop, GET for the capture.
+    if (config.trace_on_start)
+    {
+        trace::start(config.trace_events);
+    }
+    restServer.add_route("/debug/trace", [&config](const HttpRequest &request, HttpResponse &response)
+                         {
+        const std::string action = request.query_value("action");
+        const bool changes = action == "start" || action == "stop";
+        if (changes != (request.method == "POST"))
+        {
+            response.status = 405;
+            response.headers.emplace_back("Allow", changes ? "POST" : "GET, HEAD");
+            response.set_body(nlohmann::json{{"error", changes ? "action=" + action + " needs POST" : "Only action=start and action=stop take POST"}}.dump(),
+                              "application/json");
+            return;
+        }
+        if (changes)
+        {
+            if (action == "start")
+            {
+                // Sizes the rings of threads that first trace after this call; existing rings keep theirs.
+                const std::string events = request.query_value("events");
+                std::size_t eventsPerThread = config.trace_events;
+                if (!events.empty())
+                {
+                    const auto result = std::from_chars(events.data(), events.data() + events.size(), eventsPerThread);
+                    if (result.ec != std::errc() || result.ptr != events.data() + events.size())
+                    {
+                        response.status = 400;
+                        response.set_body(nlohmann::json{{"error", "events must be a number of events per thread"}}.dump(), "application/json");
+                        return;
+                    }
+                }
+                trace::start(eventsPerThread);
+            }
+            else
+            {
+                trace::stop();
+            }
+            response.set_body(nlohmann::json{{"tracing", trace::enabled()}}.dump(), "application/json");
+            return;
+        }
+        if (!action.empty() && action != "dump")
+        {
+            response.status = 400;
+            response.set_body(nlohmann::json{{"error", "Unknown action '" + action + "'"}}.dump(), "application/json");
+            return;
+        }
+        response.headers.emplace_back("Content-Disposition", "attachment; filename=\"monitor-trace.json\"");
+        response.set_body(trace::dump_chrome_json(), "application/json"); }, true);
+
+    // High-frequency burst capture: POST ?action=start&interval=20&duration=10[&pid=N][&stream=1] and ?action=stop,
+    // GET ?action=status and the capture by default.
+    BurstCapture burst(config.proc_root);
+    burst.add_listener([&wsServer](const nlohmann::json &batch)
+                       { wsServer.broadcast_burst(batch.dump()); });
+    restServer.add_route("/burst", [&burst](const HttpRequest &request, HttpResponse &response)
+                         { burst.handle_burst(request, response); }, true);
+
+    AlertEngine alerts(collector, config.alert_rules_path, std::chrono::milliseconds(config.alert_interval_ms));
+    alerts.add_listener([&wsServer](const AlertEvent &event)
+                        { wsServer.broadcast(alert_event_to_json(event).dump()); });
+    restServer.add_route("/alerts", [&alerts](const HttpRequest &request, HttpResponse &response)
+                         { alerts.handle_alerts(request, response); });
+
+    AnomalyMonitor anomalies(collector);
+    anomalies.add_listener([&wsServer](const AnomalyEvent &event)
+                           { wsServer.broadcast(anomaly_event_to_json(event).dump()); });
+    restServer.add_route("/anomalies", [&anomalies](const HttpRequest &request, HttpResponse &response)
+                         { anomalies.handle_anomalies(request, response); });
+
+    // PSI triggers: a pressure spike makes the alert engine collect and evaluate right away.
+    std::unique_ptr<PressureTriggers> pressure;
+    if (config.pressure_trigger_ms > 0)
+    {
+        pressure = std::make_unique<PressureTriggers>(config.proc_root, std::chrono::milliseconds(config.pressure_trigger_ms),
+                                                      std::chrono::milliseconds(config.pressure_window_ms));
+        pressure->add_listener([&collector, &alerts](PressureResource resource)
+                               {
+            collector.on_pressure_trigger(resource);
+            alerts.wake(); });
+        std::string error;
+        if (!pressure->start(error))
+        {
+            std::cerr << "PSI triggers unavailable (" << error << "), pressure is sampled at the collection interval" << std::endl;
+            pressure.reset();
+        }
+        else if (!error.empty())
+        {
+            std::cerr << "Some PSI triggers unavailable (" << error << ")" << std::endl;
+        }
+    }
+
+    // Aggregator mode: agents push to /ingest; fleet rollups are served next to the local metrics.
+    std::unique_ptr<FleetAggregator> fleet;
+    HttpServer::UpgradeHandler upgrades = wsServer.upgrade_handler();
+    if (config.aggregator)
+    {
+        fleet = std::make_unique<FleetAggregator>(config.api_token, config.fleet_history, std::chrono::milliseconds(config.fleet_stale_ms),
+                                                  std::chrono::milliseconds(config.fleet_retention_ms), config.fleet_max_agents,
+                                                  config.max_sessions);
+        upgrades = fleet->upgrade_handler(std::move(upgrades));
+        FleetAggregator &aggregator = *fleet;
+        restServer.add_route("/fleet", [&aggregator](const HttpRequest &request, HttpResponse &response)
+                             { aggregator.handle_fleet(request, response); });
+        restServer.add_route("/fleet/hosts", [&aggregator](const HttpRequest &request, HttpResponse &response)
+                             { aggregator.handle_hosts(request, response); });
+        restServer.add_route("/fleet/host", [&aggregator](const HttpRequest &request, HttpResponse &response)
+                             { aggregator.handle_host(request, response); });
+    }
+
+    std::unique_ptr<FleetAgent> agent;
+    if (!config.push_url.empty())
+    {
+        FleetAgentConfig agentConfig{};
+        agentConfig.url = config.push_url;
+        agentConfig.token = config.push_token;
+        agentConfig.host = config.host_name;
+        agentConfig.interval = std::chrono::milliseconds(config.push_interval_ms);
+        agent = std::make_unique<FleetAgent>(collector, std::move(agentConfig));
+    }
+
+    HttpServer server([&restServer](const HttpRequest &request, HttpResponse &response)
+                      { restServer.handle(request, response); },
+                      std::move(upgrades),
+                      config.http_threads);
+    try
+    {
+        server.listen(restServer.address(), restServer.port());
+        if (config.websocket_port != restServer.port())
+        {
+            server.listen(restServer.address(), config.websocket_port);
+        }
+    }
+    catch (const std::exception &)
+    {
+        return 1;
+    }
+    // The exporter's worker and the collecting thread start only once the listeners are bound, so a failed
+    // bind returns without threads to stop; the collecting thread stops before the listeners' owners go.
+    if (exporter)
+    {
+        exporter->start();
+    }
+    collector.start();
+    anomalies.start();
+    alerts.start();
+    if (agent)
+    {
+        agent->start();
+    }
+    server.run();
+
+    collector.stop();
+    if (agent)
+    {
+        agent->stop();
+    }
+    anomalies.stop();
+    alerts.stop();
+    if (exporter)
+    {
+        exporter->stop();
+    }
 
     return 0;
 }
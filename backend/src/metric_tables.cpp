@@ -0,0 +1,44 @@
+#include "metric_tables.h"
+
+double sum_column(const double *values, std::size_t count)
+{
+    double a = 0.0;
+    double b = 0.0;
+    double c = 0.0;
+    double d = 0.0;
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        a += values[i];
+        b += values[i + 1];
+        c += values[i + 2];
+        d += values[i + 3];
+    }
+    for (; i < count; ++i)
+    {
+        a += values[i];
+    }
+    return (a + b) + (c + d);
+}
+
+double sum_rows(const double *values, const std::vector<std::size_t> &rows)
+{
+    double a = 0.0;
+    double b = 0.0;
+    double c = 0.0;
+    double d = 0.0;
+    const std::size_t count = rows.size();
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        a += values[rows[i]];
+        b += values[rows[i + 1]];
+        c += values[rows[i + 2]];
+        d += values[rows[i + 3]];
+    }
+    for (; i < count; ++i)
+    {
+        a += values[rows[i]];
+    }
+    return (a + b) + (c + d);
+}
@@ -0,0 +1,361 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Row views of the process and container tables. String fields view memory owned by the snapshot's
+// SnapshotArena.
+struct ApplicationUsage
+{
+    int pid;
+    std::string_view name;
+    double cpuPercent;
+    double memoryMb;
+    std::string_view commandLine;
+    double ioReadKbps;             // storage reads (read_bytes in /proc/<pid>/io) in KB/s
+    double ioWriteKbps;            // storage writes (write_bytes) in KB/s
+    double voluntarySwitches;      // voluntary context switches per second (blocking, I/O waits)
+    double involuntarySwitches;    // involuntary context switches per second (preempted by the scheduler)
+    unsigned int threads;
+    unsigned int openFds;
+    // Details probed a few processes per walk (see process_details.h). Ages are in milliseconds at
+    // collection time, -1 while no value has been read; openFdsAgeMs is 0 when this walk counted them.
+    double pssMb;                  // proportional set size: shared pages split among their users
+    std::string_view cgroup;       // cgroup path, unified hierarchy when mounted
+    double pssAgeMs;
+    double openFdsAgeMs;
+    double cgroupAgeMs;
+};
+
+struct DockerContainerSummary
+{
+    std::string_view id;
+    std::string_view name;
+    std::string_view image;
+    std::string_view status;
+    double cpuPercent;
+    double memoryUsageMb;
+    double memoryLimitMb;
+    double memoryPercent;
+    double networkRxKb;
+    double networkTxKb;
+    double blockReadKb;
+    double blockWriteKb;
+    unsigned int pids;
+    // "some" avg10 stall of the container's cgroup in %; -1 when its pressure files cannot be read.
+    double cpuPressure;
+    double memoryPressure;
+    double ioPressure;
+};
+
+// Sum of `count` contiguous values. Four independent accumulators let the compiler keep several
+// vector lanes busy without -ffast-math, since the additions are not reassociated behind its back.
+double sum_column(const double *values, std::size_t count);
+// Sum of values[rows[i]] for every row index, with the same accumulator split.
+double sum_rows(const double *values, const std::vector<std::size_t> &rows);
+
+// Column-oriented table: one contiguous vector per numeric column and one vector of dictionary ids per
+// string column, so sorting, filtering and aggregation touch only the columns they need. Traits
+// supplies the column enums and converts between rows and columns; rows are materialised on demand
+// (operator[], iteration), which keeps serializers written against the row structs working unchanged.
+//
+// The string dictionary is shared by copies of a table, so carrying a table into a top-up snapshot copies
+// the id and number columns but no hash map; a copy clones the dictionary only if it adds a row.
+template <typename Traits>
+class ColumnTable
+{
+public:
+    using Row = typename Traits::Row;
+    using Column = typename Traits::Column;
+    using StringColumn = typename Traits::StringColumn;
+    static constexpr std::size_t NUMBER_COUNT = static_cast<std::size_t>(Column::Count);
+    static constexpr std::size_t STRING_COUNT = static_cast<std::size_t>(StringColumn::Count);
+
+    // Rows are materialised per dereference, so the iterator is multi-pass but offers no random access.
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Row;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Row;
+
+        const_iterator(const ColumnTable *table, std::size_t index) : table_(table), index_(index) {}
+        Row operator*() const { return (*table_)[index_]; }
+        const_iterator &operator++()
+        {
+            ++index_;
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            const_iterator previous = *this;
+            ++index_;
+            return previous;
+        }
+        bool operator==(const const_iterator &other) const { return index_ == other.index_; }
+        bool operator!=(const const_iterator &other) const { return index_ != other.index_; }
+
+    private:
+        const ColumnTable *table_;
+        std::size_t index_;
+    };
+
+    std::size_t size() const { return numbers_[0].size(); }
+    bool empty() const { return size() == 0; }
+
+    void reserve(std::size_t rows)
+    {
+        for (auto &column : numbers_)
+        {
+            column.reserve(rows);
+        }
+        for (auto &column : strings_)
+        {
+            column.reserve(rows);
+        }
+    }
+
+    void push_back(const Row &row)
+    {
+        std::array<double, NUMBER_COUNT> numbers{};
+        std::array<std::string_view, STRING_COUNT> strings{};
+        Traits::split(row, numbers.data(), strings.data());
+        for (std::size_t i = 0; i < NUMBER_COUNT; ++i)
+        {
+            numbers_[i].push_back(numbers[i]);
+        }
+        for (std::size_t i = 0; i < STRING_COUNT; ++i)
+        {
+            strings_[i].push_back(string_id(strings[i]));
+        }
+    }
+
+    Row operator[](std::size_t index) const
+    {
+        std::array<double, NUMBER_COUNT> numbers{};
+        std::array<std::string_view, STRING_COUNT> strings{};
+        for (std::size_t i = 0; i < NUMBER_COUNT; ++i)
+        {
+            numbers[i] = numbers_[i][index];
+        }
+        for (std::size_t i = 0; i < STRING_COUNT; ++i)
+        {
+            strings[i] = dictionary_->strings[strings_[i][index]];
+        }
+        return Traits::join(numbers.data(), strings.data());
+    }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    const std::vector<double> &column(Column column) const { return numbers_[static_cast<std::size_t>(column)]; }
+    // Dictionary ids of a string column; equal strings share an id within one table.
+    const std::vector<std::uint32_t> &ids(StringColumn column) const { return strings_[static_cast<std::size_t>(column)]; }
+    std::string_view string(std::uint32_t id) const { return dictionary_->strings[id]; }
+    std::string_view string(StringColumn column, std::size_t index) const { return dictionary_->strings[ids(column)[index]]; }
+
+    double sum(Column column) const { return sum_column(this->column(column).data(), size()); }
+    double sum(Column column, const std::vector<std::size_t> &rows) const { return sum_rows(this->column(column).data(), rows); }
+
+    // Indices of the `k` rows with the largest (or smallest) values of `column`, best first; ties keep row order.
+    std::vector<std::size_t> top_k(Column column, std::size_t k, bool descending = true) const
+    {
+        const std::vector<double> &values = this->column(column);
+        std::vector<std::size_t> order(size());
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        k = std::min(k, order.size());
+        const auto better = [&values, descending](std::size_t lhs, std::size_t rhs)
+        {
+            if (values[lhs] != values[rhs])
+            {
+                return descending ? values[lhs] > values[rhs] : values[lhs] < values[rhs];
+            }
+            return lhs < rhs;
+        };
+        std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(k), order.end(), better);
+        order.resize(k);
+        return order;
+    }
+
+    // Rearranges every column so that row i becomes the former row order[i]; `order` must be a permutation.
+    void reorder(const std::vector<std::size_t> &order)
+    {
+        std::vector<double> numbers(order.size());
+        for (auto &column : numbers_)
+        {
+            for (std::size_t i = 0; i < order.size(); ++i)
+            {
+                numbers[i] = column[order[i]];
+            }
+            column.swap(numbers);
+        }
+        std::vector<std::uint32_t> ids(order.size());
+        for (auto &column : strings_)
+        {
+            for (std::size_t i = 0; i < order.size(); ++i)
+            {
+                ids[i] = column[order[i]];
+            }
+            column.swap(ids);
+        }
+    }
+
+private:
+    struct Dictionary
+    {
+        std::vector<std::string_view> strings;
+        std::unordered_map<std::string_view, std::uint32_t> lookup;
+    };
+
+    std::uint32_t string_id(std::string_view value)
+    {
+        // Tables are not shared across threads while they are built, so a use count of one means no other
+        // copy can be reading the dictionary.
+        if (!dictionary_)
+        {
+            dictionary_ = std::make_shared<Dictionary>();
+        }
+        else if (dictionary_.use_count() > 1)
+        {
+            dictionary_ = std::make_shared<Dictionary>(*dictionary_);
+        }
+        const auto inserted = dictionary_->lookup.emplace(value, static_cast<std::uint32_t>(dictionary_->strings.size()));
+        if (inserted.second)
+        {
+            dictionary_->strings.push_back(value);
+        }
+        return inserted.first->second;
+    }
+
+    std::array<std::vector<double>, NUMBER_COUNT> numbers_;
+    std::array<std::vector<std::uint32_t>, STRING_COUNT> strings_;
+    std::shared_ptr<Dictionary> dictionary_;
+};
+
+struct ProcessColumns
+{
+    using Row = ApplicationUsage;
+
+    enum class Column : std::size_t
+    {
+        Pid,
+        CpuPercent,
+        MemoryMb,
+        IoReadKbps,
+        IoWriteKbps,
+        VoluntarySwitches,
+        InvoluntarySwitches,
+        Threads,
+        OpenFds,
+        PssMb,
+        PssAgeMs,
+        OpenFdsAgeMs,
+        CgroupAgeMs,
+        Count
+    };
+
+    enum class StringColumn : std::size_t
+    {
+        Name,
+        CommandLine,
+        Cgroup,
+        Count
+    };
+
+    static void split(const Row &row, double *numbers, std::string_view *strings)
+    {
+        numbers[0] = row.pid;
+        numbers[1] = row.cpuPercent;
+        numbers[2] = row.memoryMb;
+        numbers[3] = row.ioReadKbps;
+        numbers[4] = row.ioWriteKbps;
+        numbers[5] = row.voluntarySwitches;
+        numbers[6] = row.involuntarySwitches;
+        numbers[7] = row.threads;
+        numbers[8] = row.openFds;
+        numbers[9] = row.pssMb;
+        numbers[10] = row.pssAgeMs;
+        numbers[11] = row.openFdsAgeMs;
+        numbers[12] = row.cgroupAgeMs;
+        strings[0] = row.name;
+        strings[1] = row.commandLine;
+        strings[2] = row.cgroup;
+    }
+
+    static Row join(const double *numbers, const std::string_view *strings)
+    {
+        return {static_cast<int>(numbers[0]), strings[0], numbers[1], numbers[2], strings[1], numbers[3], numbers[4],
+                numbers[5], numbers[6], static_cast<unsigned int>(numbers[7]), static_cast<unsigned int>(numbers[8]),
+                numbers[9], strings[2], numbers[10], numbers[11], numbers[12]};
+    }
+};
+
+struct ContainerColumns
+{
+    using Row = DockerContainerSummary;
+
+    enum class Column : std::size_t
+    {
+        CpuPercent,
+        MemoryUsageMb,
+        MemoryLimitMb,
+        MemoryPercent,
+        NetworkRxKb,
+        NetworkTxKb,
+        BlockReadKb,
+        BlockWriteKb,
+        Pids,
+        CpuPressure,
+        MemoryPressure,
+        IoPressure,
+        Count
+    };
+
+    enum class StringColumn : std::size_t
+    {
+        Id,
+        Name,
+        Image,
+        Status,
+        Count
+    };
+
+    static void split(const Row &row, double *numbers, std::string_view *strings)
+    {
+        numbers[0] = row.cpuPercent;
+        numbers[1] = row.memoryUsageMb;
+        numbers[2] = row.memoryLimitMb;
+        numbers[3] = row.memoryPercent;
+        numbers[4] = row.networkRxKb;
+        numbers[5] = row.networkTxKb;
+        numbers[6] = row.blockReadKb;
+        numbers[7] = row.blockWriteKb;
+        numbers[8] = row.pids;
+        numbers[9] = row.cpuPressure;
+        numbers[10] = row.memoryPressure;
+        numbers[11] = row.ioPressure;
+        strings[0] = row.id;
+        strings[1] = row.name;
+        strings[2] = row.image;
+        strings[3] = row.status;
+    }
+
+    static Row join(const double *numbers, const std::string_view *strings)
+    {
+        return {strings[0], strings[1], strings[2], strings[3], numbers[0], numbers[1], numbers[2], numbers[3],
+                numbers[4], numbers[5], numbers[6], numbers[7], static_cast<unsigned int>(numbers[8]), numbers[9],
+                numbers[10], numbers[11]};
+    }
+};
+
+using ProcessTable = ColumnTable<ProcessColumns>;
+using ContainerTable = ColumnTable<ContainerColumns>;
@@ -0,0 +1,191 @@
+#include "metrics_json.h"
+
+namespace
+{
+    // Ages of probed details; null until the first value has been read.
+    nlohmann::json known(double ageMs)
+    {
+        return ageMs < 0.0 ? nlohmann::json() : nlohmann::json(ageMs);
+    }
+
+    // Container pressure; null when the container's cgroup could not be read.
+    nlohmann::json percent_or_null(double percent)
+    {
+        return percent < 0.0 ? nlohmann::json() : nlohmann::json(percent);
+    }
+
+    nlohmann::json stall_to_json(const PressureStall &stall)
+    {
+        return {{"some", {{"avg10", stall.someAvg10}, {"avg60", stall.someAvg60}, {"totalUs", stall.someTotalUs}}},
+                {"full", {{"avg10", stall.fullAvg10}, {"avg60", stall.fullAvg60}, {"totalUs", stall.fullTotalUs}}}};
+    }
+} // namespace
+
+nlohmann::json application_to_json(const ApplicationUsage &app)
+{
+    return {
+        {"pid", app.pid},
+        {"name", app.name},
+        {"cpu", app.cpuPercent},
+        {"memoryMb", app.memoryMb},
+        {"commandLine", app.commandLine},
+        {"ioReadKbps", app.ioReadKbps},
+        {"ioWriteKbps", app.ioWriteKbps},
+        {"ctxSwitchesVoluntary", app.voluntarySwitches},
+        {"ctxSwitchesInvoluntary", app.involuntarySwitches},
+        {"threads", app.threads},
+        {"openFds", app.openFds},
+        {"openFdsAgeMs", known(app.openFdsAgeMs)},
+        {"pssMb", app.pssAgeMs < 0.0 ? nlohmann::json() : nlohmann::json(app.pssMb)},
+        {"pssAgeMs", known(app.pssAgeMs)},
+        {"cgroup", app.cgroupAgeMs < 0.0 ? nlohmann::json() : nlohmann::json(app.cgroup)},
+        {"cgroupAgeMs", known(app.cgroupAgeMs)}};
+}
+
+nlohmann::json container_to_json(const DockerContainerSummary &container)
+{
+    return {
+        {"id", container.id},
+        {"name", container.name},
+        {"image", container.image},
+        {"status", container.status},
+        {"cpu", container.cpuPercent},
+        {"memoryMb", container.memoryUsageMb},
+        {"memoryLimitMb", container.memoryLimitMb},
+        {"memoryPercent", container.memoryPercent},
+        {"netRxKb", container.networkRxKb},
+        {"netTxKb", container.networkTxKb},
+        {"blockReadKb", container.blockReadKb},
+        {"blockWriteKb", container.blockWriteKb},
+        {"pids", container.pids},
+        {"cpuPressure", percent_or_null(container.cpuPressure)},
+        {"memoryPressure", percent_or_null(container.memoryPressure)},
+        {"ioPressure", percent_or_null(container.ioPressure)}};
+}
+
+nlohmann::json metrics_to_json(const SystemMetrics &m, const MetricsSelection &selection)
+{
+    nlohmann::json j = nlohmann::json::object();
+    auto put = [&j, &selection](MetricField field, const char *key, auto value)
+    {
+        if (selection.includes(field))
+        {
+            j[key] = value;
+        }
+    };
+
+    put(MetricField::Cpu, "cpu", m.cpuUsage);
+    put(MetricField::CpuAverage, "cpuAvg", m.cpuUsageAverage);
+    put(MetricField::Memory, "memory", m.memoryUsage);
+    put(MetricField::Swap, "swap", m.swapUsage);
+    put(MetricField::Connections, "connections", m.activeConnections);
+    put(MetricField::Disk, "disk", m.diskUsage);
+    put(MetricField::Load1, "load1", m.loadAverage1);
+    put(MetricField::Load5, "load5", m.loadAverage5);
+    put(MetricField::Load15, "load15", m.loadAverage15);
+    put(MetricField::ProcsRunning, "procsRunning", m.procsRunning);
+    put(MetricField::ProcsBlocked, "procsBlocked", m.procsBlocked);
+    put(MetricField::NetRx, "netRx", m.networkReceiveRate);
+    put(MetricField::NetTx, "netTx", m.networkTransmitRate);
+    put(MetricField::NetRxAverage, "netRxAvg", m.networkReceiveRateAverage);
+    put(MetricField::NetTxAverage, "netTxAvg", m.networkTransmitRateAverage);
+    put(MetricField::CpuCores, "cpuCores", m.cpuCount);
+    put(MetricField::Processes, "processes", m.processCount);
+    put(MetricField::Threads, "threads", m.threadCount);
+    put(MetricField::ListeningTcp, "listeningTcp", m.listeningTcp);
+    put(MetricField::ListeningUdp, "listeningUdp", m.listeningUdp);
+    put(MetricField::OpenFds, "openFds", m.openFileDescriptors);
+    put(MetricField::UniqueDomains, "uniqueDomains", m.uniqueDomains);
+    put(MetricField::DockerAvailable, "dockerAvailable", m.dockerAvailable);
+    j["timestamp"] = MetricsCollector::to_iso8601(m.timestamp);
+
+    if (selection.includes(MetricField::Agent))
+    {
+        j["agent"] = {{"collectionMs", m.agent.collectionMs},
+                      {"collectionP99Ms", m.agent.collectionP99Ms},
+                      {"requestP99Ms", m.agent.requestP99Ms},
+                      {"allocations", m.agent.allocations},
+                      {"readSyscalls", m.agent.readSyscalls},
+                      {"writeSyscalls", m.agent.writeSyscalls},
+                      {"bytesSent", m.agent.bytesSent},
+                      {"collectionCpuMs", m.agent.collectionCpuMs},
+                      {"cpuPercent", m.agent.cpuPercent},
+                      {"intervalMs", m.agent.intervalMs},
+                      {"detailIntervalMs", m.agent.detailIntervalMs}};
+    }
+
+    if (selection.includes(MetricField::Pressure))
+    {
+        j["pressure"] = {{"available", m.pressure.available},
+                         {"cpu", stall_to_json(m.pressure.cpu)},
+                         {"memory", stall_to_json(m.pressure.memory)},
+                         {"io", stall_to_json(m.pressure.io)},
+                         {"triggers", m.pressure.triggers}};
+    }
+
+    if (selection.includes(MetricField::ProcessChurn))
+    {
+        nlohmann::json shortLived = nlohmann::json::array();
+        for (const auto &process : m.processChurn.shortLived)
+        {
+            shortLived.push_back({{"pid", process.pid},
+                                  {"name", process.name},
+                                  {"lifetimeMs", process.lifetimeMs},
+                                  {"exitCode", process.exitCode}});
+        }
+        j["processChurn"] = {{"eventDriven", m.processChurn.eventDriven},
+                             {"forks", m.processChurn.forks},
+                             {"execs", m.processChurn.execs},
+                             {"exits", m.processChurn.exits},
+                             {"shortLived", std::move(shortLived)},
+                             {"shortLivedDropped", m.processChurn.shortLivedDropped}};
+    }
+
+    if (selection.includes(MetricField::Applications))
+    {
+        nlohmann::json applications = nlohmann::json::array();
+        for (const std::size_t row : selection.application_rows(m.topApplications))
+        {
+            applications.push_back(application_to_json(m.topApplications[row]));
+        }
+        j["applications"] = std::move(applications);
+    }
+
+    if (selection.includes(MetricField::Domains))
+    {
+        nlohmann::json domains = nlohmann::json::array();
+        for (const auto &domain : m.domainUsage)
+        {
+            domains.push_back({{"domain", domain.domain},
+                               {"receiveRate", domain.receiveRate},
+                               {"transmitRate", domain.transmitRate},
+                               {"connections", domain.connections}});
+        }
+        j["domains"] = std::move(domains);
+    }
+
+    if (selection.includes(MetricField::DockerContainers))
+    {
+        nlohmann::json containers = nlohmann::json::array();
+        for (const auto &container : m.dockerContainers)
+        {
+            containers.push_back(container_to_json(container));
+        }
+        j["dockerContainers"] = std::move(containers);
+    }
+
+    if (selection.includes(MetricField::DockerImages))
+    {
+        nlohmann::json images = nlohmann::json::array();
+        for (const auto &image : m.dockerImages)
+        {
+            images.push_back({{"repository", image.repository},
+                              {"tag", image.tag},
+                              {"id", image.id},
+                              {"size", image.size}});
+        }
+        j["dockerImages"] = std::move(images);
+    }
+
+    return j;
+}
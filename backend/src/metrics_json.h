@@ -0,0 +1,10 @@
+#pragma once
+#include <nlohmann/json.hpp>
+
+#include "metrics_selection.h"
+#include "system_metrics.h"
+
+// Shared JSON encoding for the REST and WebSocket payloads.
+nlohmann::json metrics_to_json(const SystemMetrics &metrics, const MetricsSelection &selection);
+nlohmann::json application_to_json(const ApplicationUsage &app);
+nlohmann::json container_to_json(const DockerContainerSummary &container);
@@ -0,0 +1,253 @@
+#include "metrics_selection.h"
+
+#include "system_metrics.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <numeric>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t FIELD_COUNT = static_cast<std::size_t>(MetricField::Count);
+
+    struct FieldInfo
+    {
+        const char *name;
+        unsigned int sections;
+    };
+
+    // Indexed by MetricField; names match the JSON payload keys.
+    constexpr std::array<FieldInfo, FIELD_COUNT> FIELDS{{
+        {"cpu", 0},
+        {"cpuAvg", 0},
+        {"memory", 0},
+        {"swap", 0},
+        {"connections", SECTION_CONNECTIONS},
+        {"disk", 0},
+        {"load1", 0},
+        {"load5", 0},
+        {"load15", 0},
+        {"procsRunning", 0},
+        {"procsBlocked", 0},
+        {"pressure", 0},
+        {"netRx", 0},
+        {"netTx", 0},
+        {"netRxAvg", 0},
+        {"netTxAvg", 0},
+        {"cpuCores", 0},
+        {"processes", SECTION_PROCESS_COUNTS},
+        {"threads", SECTION_PROCESS_COUNTS},
+        {"listeningTcp", SECTION_LISTENING_PORTS},
+        {"listeningUdp", SECTION_LISTENING_PORTS},
+        {"openFds", 0},
+        {"uniqueDomains", SECTION_CONNECTIONS},
+        {"dockerAvailable", SECTION_DOCKER},
+        {"agent", 0},
+        {"processChurn", SECTION_APPLICATIONS},
+        {"applications", SECTION_APPLICATIONS},
+        {"domains", SECTION_CONNECTIONS},
+        {"dockerContainers", SECTION_DOCKER},
+        {"dockerImages", SECTION_DOCKER},
+    }};
+
+    struct SortKey
+    {
+        const char *name;
+        ProcessTable::Column column;
+    };
+
+    // Entry 0 is the collector order (CPU, then memory); the others sort by one column, largest first.
+    constexpr SortKey SORT_KEYS[] = {
+        {"", ProcessTable::Column::CpuPercent},
+        {"cpu", ProcessTable::Column::CpuPercent},
+        {"memoryMb", ProcessTable::Column::MemoryMb},
+        {"ioReadKbps", ProcessTable::Column::IoReadKbps},
+        {"ioWriteKbps", ProcessTable::Column::IoWriteKbps},
+        {"ctxSwitchesVoluntary", ProcessTable::Column::VoluntarySwitches},
+        {"ctxSwitchesInvoluntary", ProcessTable::Column::InvoluntarySwitches},
+        {"threads", ProcessTable::Column::Threads},
+        {"openFds", ProcessTable::Column::OpenFds},
+        {"pssMb", ProcessTable::Column::PssMb},
+    };
+    constexpr std::size_t SORT_KEY_COUNT = sizeof(SORT_KEYS) / sizeof(SORT_KEYS[0]);
+    constexpr std::size_t MAX_LIMIT = 100000;
+
+    bool iequals(const std::string &lhs, const char *rhs)
+    {
+        std::size_t i = 0;
+        for (; i < lhs.size() && rhs[i] != '\0'; ++i)
+        {
+            if (std::tolower(static_cast<unsigned char>(lhs[i])) != std::tolower(static_cast<unsigned char>(rhs[i])))
+            {
+                return false;
+            }
+        }
+        return i == lhs.size() && rhs[i] == '\0';
+    }
+
+    template <typename Bits>
+    bool apply_list(const std::string &list, Bits &bits, std::string &error)
+    {
+        static const std::pair<const char *, std::vector<MetricField>> GROUPS[] = {
+            {"network", {MetricField::NetRx, MetricField::NetTx, MetricField::NetRxAverage, MetricField::NetTxAverage}},
+            {"load", {MetricField::Load1, MetricField::Load5, MetricField::Load15, MetricField::ProcsRunning, MetricField::ProcsBlocked}},
+            {"docker", {MetricField::DockerAvailable, MetricField::DockerContainers, MetricField::DockerImages}},
+        };
+
+        std::stringstream ss(list);
+        std::string name;
+        while (std::getline(ss, name, ','))
+        {
+            const auto begin = name.find_first_not_of(" \t");
+            if (begin == std::string::npos)
+            {
+                continue;
+            }
+            name = name.substr(begin, name.find_last_not_of(" \t") - begin + 1);
+
+            bool matched = false;
+            for (std::size_t i = 0; i < FIELD_COUNT && !matched; ++i)
+            {
+                if (iequals(name, FIELDS[i].name))
+                {
+                    bits.set(i);
+                    matched = true;
+                }
+            }
+            for (const auto &group : GROUPS)
+            {
+                if (!matched && iequals(name, group.first))
+                {
+                    for (const MetricField field : group.second)
+                    {
+                        bits.set(static_cast<std::size_t>(field));
+                    }
+                    matched = true;
+                }
+            }
+
+            if (!matched)
+            {
+                error = "Unknown metrics field '" + name + "'";
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace
+
+MetricsSelection MetricsSelection::all()
+{
+    MetricsSelection selection;
+    selection.fields_.set();
+    return selection;
+}
+
+bool MetricsSelection::parse(const std::string &fields, const std::string &exclude, MetricsSelection &selection, std::string &error)
+{
+    std::bitset<FIELD_COUNT> included;
+    std::bitset<FIELD_COUNT> excluded;
+    if (!apply_list(fields, included, error) || !apply_list(exclude, excluded, error))
+    {
+        return false;
+    }
+
+    if (included.none())
+    {
+        included.set();
+    }
+
+    selection.fields_ = included & ~excluded;
+    return true;
+}
+
+bool MetricsSelection::parse_order(const std::string &sort, const std::string &limit, std::string &error)
+{
+    std::size_t sortIndex = 0;
+    if (!sort.empty())
+    {
+        for (std::size_t i = 1; i < SORT_KEY_COUNT && sortIndex == 0; ++i)
+        {
+            if (iequals(sort, SORT_KEYS[i].name))
+            {
+                sortIndex = i;
+            }
+        }
+        if (sortIndex == 0)
+        {
+            error = "Unknown sort key '" + sort + "'";
+            return false;
+        }
+    }
+
+    std::size_t limitValue = 0;
+    if (!limit.empty())
+    {
+        if (limit.size() > 6 || limit.find_first_not_of("0123456789") != std::string::npos || std::stoul(limit) == 0 ||
+            std::stoul(limit) > MAX_LIMIT)
+        {
+            error = "limit must be between 1 and " + std::to_string(MAX_LIMIT);
+            return false;
+        }
+        limitValue = std::stoul(limit);
+    }
+
+    sort_ = sortIndex;
+    limit_ = limitValue;
+    return true;
+}
+
+std::vector<std::size_t> MetricsSelection::application_rows(const ProcessTable &processes) const
+{
+    const std::size_t count = limit_ == 0 ? processes.size() : std::min(limit_, processes.size());
+    if (sort_ != 0)
+    {
+        return processes.top_k(SORT_KEYS[sort_].column, count);
+    }
+    std::vector<std::size_t> rows(count);
+    std::iota(rows.begin(), rows.end(), std::size_t{0});
+    return rows;
+}
+
+std::string MetricsSelection::sort_key() const
+{
+    return SORT_KEYS[sort_].name;
+}
+
+bool MetricsSelection::includes(MetricField field) const
+{
+    return fields_.test(static_cast<std::size_t>(field));
+}
+
+bool MetricsSelection::is_all() const
+{
+    return fields_.all();
+}
+
+unsigned int MetricsSelection::sections() const
+{
+    unsigned int sections = 0;
+    for (std::size_t i = 0; i < FIELD_COUNT; ++i)
+    {
+        if (fields_.test(i))
+        {
+            sections |= FIELDS[i].sections;
+        }
+    }
+    return sections;
+}
+
+std::string MetricsSelection::key() const
+{
+    std::string key = fields_.to_string();
+    if (sort_ != 0 || limit_ != 0)
+    {
+        key += '/' + std::to_string(sort_) + '/' + std::to_string(limit_);
+    }
+    return key;
+}
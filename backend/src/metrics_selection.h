@@ -0,0 +1,80 @@
+#pragma once
+#include <bitset>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "metric_tables.h"
+
+// Top-level payload fields a consumer can select with ?fields= / ?exclude=. The timestamp is always sent.
+enum class MetricField : std::size_t
+{
+    Cpu,
+    CpuAverage,
+    Memory,
+    Swap,
+    Connections,
+    Disk,
+    Load1,
+    Load5,
+    Load15,
+    ProcsRunning,
+    ProcsBlocked,
+    Pressure,
+    NetRx,
+    NetTx,
+    NetRxAverage,
+    NetTxAverage,
+    CpuCores,
+    Processes,
+    Threads,
+    ListeningTcp,
+    ListeningUdp,
+    OpenFds,
+    UniqueDomains,
+    DockerAvailable,
+    Agent,
+    ProcessChurn,
+    Applications,
+    Domains,
+    DockerContainers,
+    DockerImages,
+    Count
+};
+
+class MetricsSelection
+{
+public:
+    static MetricsSelection all();
+
+    // Parses comma-separated field lists (JSON key names or the groups "network", "load", "docker").
+    // An empty include list means every field. Returns false and describes the problem on unknown names.
+    static bool parse(const std::string &fields, const std::string &exclude, MetricsSelection &selection, std::string &error);
+
+    // Orders the applications list by a process column, largest first, and/or keeps only the first `limit`
+    // rows (?sort=ioWriteKbps&limit=10). Sort keys are the application JSON keys of numeric columns; an
+    // empty sort keeps the collector's CPU/memory order and an empty limit keeps every row.
+    bool parse_order(const std::string &sort, const std::string &limit, std::string &error);
+
+    bool includes(MetricField field) const;
+    bool is_all() const;
+    // CollectorSection bits the selected fields depend on.
+    unsigned int sections() const;
+    // Stable identifier for grouping consumers with identical selections.
+    std::string key() const;
+    // Rows of `processes` to serialise, in order.
+    std::vector<std::size_t> application_rows(const ProcessTable &processes) const;
+    std::string sort_key() const;
+    std::size_t limit() const { return limit_; }
+
+    bool operator==(const MetricsSelection &other) const
+    {
+        return fields_ == other.fields_ && sort_ == other.sort_ && limit_ == other.limit_;
+    }
+    bool operator!=(const MetricsSelection &other) const { return !(*this == other); }
+
+private:
+    std::bitset<static_cast<std::size_t>(MetricField::Count)> fields_;
+    std::size_t sort_ = 0;  // index into the sort key table; 0 keeps the collector order
+    std::size_t limit_ = 0; // 0 = every row
+};
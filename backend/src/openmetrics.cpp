@@ -0,0 +1,387 @@
+#include "openmetrics.h"
+
+#include "self_stats.h"
+#include "trace_recorder.h"
+
+#include <charconv>
+#include <cmath>
+#include <string_view>
+
+namespace
+{
+    constexpr unsigned long long LABEL_SET_TTL = 16; // renders a label set survives without being referenced
+
+    void append_label_value(std::string &out, std::string_view value)
+    {
+        for (const char ch : value)
+        {
+            switch (ch)
+            {
+            case '\\':
+                out.append("\\\\");
+                break;
+            case '"':
+                out.append("\\\"");
+                break;
+            case '\n':
+                out.append("\\n");
+                break;
+            default:
+                out.push_back(ch);
+                break;
+            }
+        }
+    }
+
+    void append_label(std::string &out, const char *name, std::string_view value)
+    {
+        out.push_back(out.empty() ? '{' : ',');
+        out.append(name);
+        out.append("=\"");
+        append_label_value(out, value);
+        out.push_back('"');
+    }
+
+    void append_value(std::string &out, double value)
+    {
+        if (std::isnan(value))
+        {
+            out.append("NaN");
+            return;
+        }
+        if (std::isinf(value))
+        {
+            out.append(value > 0 ? "+Inf" : "-Inf");
+            return;
+        }
+
+        char buffer[32];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    // Counter samples carry a "_total" suffix and info samples an "_info" suffix on the family name.
+    void append_family(std::string &out, const char *name, const char *help, const char *type = "gauge")
+    {
+        out.append("# TYPE ");
+        out.append(name);
+        out.push_back(' ');
+        out.append(type);
+        out.append("\n# HELP ");
+        out.append(name);
+        out.push_back(' ');
+        out.append(help);
+        out.push_back('\n');
+    }
+
+    void append_sample(std::string &out, const char *name, std::string_view labels, double value)
+    {
+        out.append(name);
+        out.append(labels);
+        out.push_back(' ');
+        append_value(out, value);
+        out.push_back('\n');
+    }
+
+    void append_gauge(std::string &out, const char *name, const char *help, double value)
+    {
+        append_family(out, name, help);
+        append_sample(out, name, std::string_view(), value);
+    }
+
+    void append_counter(std::string &out, const char *name, const char *sample, const char *help, double value)
+    {
+        append_family(out, name, help, "counter");
+        append_sample(out, sample, std::string_view(), value);
+    }
+
+    template <typename Map, typename Key>
+    const std::string &intern(Map &cache, const Key &key, std::string_view identity, unsigned long long generation,
+                              void (*build)(std::string &, const void *), const void *source)
+    {
+        auto iter = cache.find(key);
+        if (iter == cache.end() || iter->second.key != identity)
+        {
+            std::string labels;
+            build(labels, source);
+            labels.push_back('}');
+            auto &entry = cache[key];
+            entry.key = std::string(identity);
+            entry.labels = std::move(labels);
+            iter = cache.find(key);
+        }
+        iter->second.generation = generation;
+        return iter->second.labels;
+    }
+
+} // namespace
+
+OpenMetricsRenderer::OpenMetricsRenderer()
+    : mutex_(),
+      buffer_(),
+      has_render_(false),
+      rendered_sequence_(0),
+      generation_(0),
+      application_labels_(),
+      domain_labels_(),
+      container_labels_(),
+      image_labels_()
+{
+}
+
+const std::string &OpenMetricsRenderer::application_labels(const ApplicationUsage &app)
+{
+    return intern(application_labels_, app.pid, app.name, generation_, [](std::string &out, const void *source)
+                  {
+        const auto &entry = *static_cast<const ApplicationUsage *>(source);
+        char pid[16];
+        const auto result = std::to_chars(pid, pid + sizeof(pid), entry.pid);
+        append_label(out, "pid", std::string_view(pid, static_cast<std::size_t>(result.ptr - pid)));
+        append_label(out, "name", entry.name); },
+                  &app);
+}
+
+const std::string &OpenMetricsRenderer::domain_labels(const DomainUsage &domain)
+{
+    return intern(domain_labels_, std::string(domain.domain), domain.domain, generation_, [](std::string &out, const void *source)
+                  { append_label(out, "domain", static_cast<const DomainUsage *>(source)->domain); },
+                  &domain);
+}
+
+const std::string &OpenMetricsRenderer::container_labels(const DockerContainerSummary &container)
+{
+    // Names and images rarely change for a given id, so the identity check is a cheap comparison.
+    std::string identity(container.name);
+    identity.push_back('\0');
+    identity.append(container.image);
+    return intern(container_labels_, std::string(container.id), identity, generation_, [](std::string &out, const void *source)
+                  {
+        const auto &entry = *static_cast<const DockerContainerSummary *>(source);
+        append_label(out, "id", entry.id);
+        append_label(out, "name", entry.name);
+        append_label(out, "image", entry.image); },
+                  &container);
+}
+
+const std::string &OpenMetricsRenderer::image_labels(const DockerImageSummary &image)
+{
+    std::string identity(image.repository);
+    identity.push_back('\0');
+    identity.append(image.tag);
+    identity.push_back('\0');
+    identity.append(image.size);
+    return intern(image_labels_, std::string(image.id), identity, generation_, [](std::string &out, const void *source)
+                  {
+        const auto &entry = *static_cast<const DockerImageSummary *>(source);
+        append_label(out, "repository", entry.repository);
+        append_label(out, "tag", entry.tag);
+        append_label(out, "id", entry.id);
+        append_label(out, "size", entry.size); },
+                  &image);
+}
+
+void OpenMetricsRenderer::evict_stale()
+{
+    auto sweep = [this](auto &cache)
+    {
+        for (auto iter = cache.begin(); iter != cache.end();)
+        {
+            if (generation_ - iter->second.generation > LABEL_SET_TTL)
+            {
+                iter = cache.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+    };
+
+    sweep(application_labels_);
+    sweep(domain_labels_);
+    sweep(container_labels_);
+    sweep(image_labels_);
+}
+
+std::string OpenMetricsRenderer::render(const SystemMetrics &m)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (has_render_ && rendered_sequence_ == m.sequence)
+    {
+        return buffer_;
+    }
+
+    self_stats::ScopedTimer timer(self_stats::Timer::OpenMetricsEncode);
+    trace::Span span("encode.openmetrics", "serialize");
+    ++generation_;
+    buffer_.clear();
+    std::string &out = buffer_;
+
+    append_gauge(out, "monitoring_cpu_usage_percent", "CPU usage in percent.", m.cpuUsage);
+    append_gauge(out, "monitoring_cpu_usage_average_percent", "Rolling average CPU usage in percent.", m.cpuUsageAverage);
+    append_gauge(out, "monitoring_memory_usage_percent", "Memory usage in percent.", m.memoryUsage);
+    append_gauge(out, "monitoring_swap_usage_percent", "Swap usage in percent.", m.swapUsage);
+    append_gauge(out, "monitoring_disk_usage_percent", "Root filesystem usage in percent.", m.diskUsage);
+    append_gauge(out, "monitoring_active_connections", "Active TCP connections.", m.activeConnections);
+
+    append_family(out, "monitoring_load_average", "Kernel load average.");
+    append_sample(out, "monitoring_load_average", "{window=\"1m\"}", m.loadAverage1);
+    append_sample(out, "monitoring_load_average", "{window=\"5m\"}", m.loadAverage5);
+    append_sample(out, "monitoring_load_average", "{window=\"15m\"}", m.loadAverage15);
+    append_gauge(out, "monitoring_procs_running", "Runnable tasks (procs_running in /proc/stat).", m.procsRunning);
+    append_gauge(out, "monitoring_procs_blocked", "Tasks blocked on I/O (procs_blocked in /proc/stat).", m.procsBlocked);
+
+    if (m.pressure.available)
+    {
+        const std::pair<const char *, const PressureStall *> resources[] = {
+            {"cpu", &m.pressure.cpu}, {"memory", &m.pressure.memory}, {"io", &m.pressure.io}};
+        std::string labels;
+        append_family(out, "monitoring_pressure_stall_percent", "Share of time tasks stalled on a resource, 10 s average (PSI).");
+        for (const auto &[resource, stall] : resources)
+        {
+            labels.assign("{resource=\"").append(resource).append("\",kind=\"some\"}");
+            append_sample(out, "monitoring_pressure_stall_percent", labels, stall->someAvg10);
+            labels.assign("{resource=\"").append(resource).append("\",kind=\"full\"}");
+            append_sample(out, "monitoring_pressure_stall_percent", labels, stall->fullAvg10);
+        }
+        append_family(out, "monitoring_pressure_stall_seconds", "Cumulative time tasks stalled on a resource since boot (PSI).", "counter");
+        for (const auto &[resource, stall] : resources)
+        {
+            labels.assign("{resource=\"").append(resource).append("\",kind=\"some\"}");
+            append_sample(out, "monitoring_pressure_stall_seconds_total", labels, static_cast<double>(stall->someTotalUs) / 1e6);
+            labels.assign("{resource=\"").append(resource).append("\",kind=\"full\"}");
+            append_sample(out, "monitoring_pressure_stall_seconds_total", labels, static_cast<double>(stall->fullTotalUs) / 1e6);
+        }
+        append_counter(out, "monitoring_pressure_triggers", "monitoring_pressure_triggers_total", "PSI trigger events since start.",
+                       static_cast<double>(m.pressure.triggers));
+    }
+
+    append_gauge(out, "monitoring_network_receive_kib_per_second", "Inbound network throughput in KiB/s.", m.networkReceiveRate);
+    append_gauge(out, "monitoring_network_transmit_kib_per_second", "Outbound network throughput in KiB/s.", m.networkTransmitRate);
+    append_gauge(out, "monitoring_network_receive_average_kib_per_second", "Rolling average inbound throughput in KiB/s.", m.networkReceiveRateAverage);
+    append_gauge(out, "monitoring_network_transmit_average_kib_per_second", "Rolling average outbound throughput in KiB/s.", m.networkTransmitRateAverage);
+    append_gauge(out, "monitoring_cpu_cores", "Logical CPU cores.", m.cpuCount);
+    append_gauge(out, "monitoring_processes", "Running processes.", m.processCount);
+    append_gauge(out, "monitoring_threads", "Threads across all processes.", m.threadCount);
+
+    append_family(out, "monitoring_listening_sockets", "Listening sockets by protocol.");
+    append_sample(out, "monitoring_listening_sockets", "{protocol=\"tcp\"}", m.listeningTcp);
+    append_sample(out, "monitoring_listening_sockets", "{protocol=\"udp\"}", m.listeningUdp);
+
+    append_gauge(out, "monitoring_open_file_descriptors", "Open file descriptors reported by the kernel.", static_cast<double>(m.openFileDescriptors));
+    append_gauge(out, "monitoring_unique_domains", "Unique remote domains observed.", static_cast<double>(m.uniqueDomains));
+    append_gauge(out, "monitoring_docker_available", "Whether the Docker CLI is accessible.", m.dockerAvailable ? 1.0 : 0.0);
+
+    append_gauge(out, "monitoring_agent_collection_milliseconds", "Duration of the collection behind this scrape.", m.agent.collectionMs);
+    append_gauge(out, "monitoring_agent_collection_p99_milliseconds", "99th percentile collection duration since start.", m.agent.collectionP99Ms);
+    append_gauge(out, "monitoring_agent_request_p99_milliseconds", "99th percentile REST handler time since start.", m.agent.requestP99Ms);
+    append_counter(out, "monitoring_agent_allocations", "monitoring_agent_allocations_total", "Heap allocations by the agent since start.",
+                   static_cast<double>(m.agent.allocations));
+    append_family(out, "monitoring_agent_syscalls", "read and write system calls by the agent since start.", "counter");
+    append_sample(out, "monitoring_agent_syscalls_total", "{kind=\"read\"}", static_cast<double>(m.agent.readSyscalls));
+    append_sample(out, "monitoring_agent_syscalls_total", "{kind=\"write\"}", static_cast<double>(m.agent.writeSyscalls));
+    append_counter(out, "monitoring_agent_bytes_sent", "monitoring_agent_bytes_sent_total", "HTTP and WebSocket bytes written by the agent since start.",
+                   static_cast<double>(m.agent.bytesSent));
+    append_gauge(out, "monitoring_agent_collector_cpu_percent", "Collector CPU share projected at the current intervals, % of one core.", m.agent.cpuPercent);
+    append_family(out, "monitoring_agent_interval_milliseconds", "Effective time between collections, per tier.");
+    append_sample(out, "monitoring_agent_interval_milliseconds", "{tier=\"base\"}", m.agent.intervalMs);
+    append_sample(out, "monitoring_agent_interval_milliseconds", "{tier=\"detail\"}", m.agent.detailIntervalMs);
+
+    if (m.processChurn.eventDriven)
+    {
+        append_family(out, "monitoring_process_events", "Process lifecycle events from the proc connector since start.", "counter");
+        append_sample(out, "monitoring_process_events_total", "{kind=\"fork\"}", static_cast<double>(m.processChurn.forks));
+        append_sample(out, "monitoring_process_events_total", "{kind=\"exec\"}", static_cast<double>(m.processChurn.execs));
+        append_sample(out, "monitoring_process_events_total", "{kind=\"exit\"}", static_cast<double>(m.processChurn.exits));
+        append_gauge(out, "monitoring_short_lived_processes", "Processes that started and exited between the last two process walks.",
+                     static_cast<double>(m.processChurn.shortLived.size() + m.processChurn.shortLivedDropped));
+    }
+
+    append_family(out, "monitoring_process_cpu_percent", "Per-process CPU usage in percent.");
+    for (const auto &app : m.topApplications)
+    {
+        append_sample(out, "monitoring_process_cpu_percent", application_labels(app), app.cpuPercent);
+    }
+    append_family(out, "monitoring_process_memory_mib", "Per-process resident memory in MiB.");
+    for (const auto &app : m.topApplications)
+    {
+        append_sample(out, "monitoring_process_memory_mib", application_labels(app), app.memoryMb);
+    }
+
+    append_family(out, "monitoring_domain_receive_kib_per_second", "Estimated inbound throughput per remote domain in KiB/s.");
+    for (const auto &domain : m.domainUsage)
+    {
+        append_sample(out, "monitoring_domain_receive_kib_per_second", domain_labels(domain), domain.receiveRate);
+    }
+    append_family(out, "monitoring_domain_transmit_kib_per_second", "Estimated outbound throughput per remote domain in KiB/s.");
+    for (const auto &domain : m.domainUsage)
+    {
+        append_sample(out, "monitoring_domain_transmit_kib_per_second", domain_labels(domain), domain.transmitRate);
+    }
+    append_family(out, "monitoring_domain_connections", "Active connections per remote domain.");
+    for (const auto &domain : m.domainUsage)
+    {
+        append_sample(out, "monitoring_domain_connections", domain_labels(domain), domain.connections);
+    }
+
+    struct ContainerFamily
+    {
+        const char *name;
+        const char *sample;
+        const char *type;
+        const char *help;
+        double (*value)(const DockerContainerSummary &);
+    };
+    static const ContainerFamily containerFamilies[] = {
+        {"monitoring_container_cpu_percent", "monitoring_container_cpu_percent", "gauge", "Container CPU usage in percent.", [](const DockerContainerSummary &c)
+         { return c.cpuPercent; }},
+        {"monitoring_container_memory_usage_mib", "monitoring_container_memory_usage_mib", "gauge", "Container memory usage in MiB.", [](const DockerContainerSummary &c)
+         { return c.memoryUsageMb; }},
+        {"monitoring_container_memory_limit_mib", "monitoring_container_memory_limit_mib", "gauge", "Container memory limit in MiB.", [](const DockerContainerSummary &c)
+         { return c.memoryLimitMb; }},
+        {"monitoring_container_memory_percent", "monitoring_container_memory_percent", "gauge", "Container memory usage relative to its limit.", [](const DockerContainerSummary &c)
+         { return c.memoryPercent; }},
+        {"monitoring_container_network_receive_kib", "monitoring_container_network_receive_kib_total", "counter", "Container network bytes received in KiB.", [](const DockerContainerSummary &c)
+         { return c.networkRxKb; }},
+        {"monitoring_container_network_transmit_kib", "monitoring_container_network_transmit_kib_total", "counter", "Container network bytes sent in KiB.", [](const DockerContainerSummary &c)
+         { return c.networkTxKb; }},
+        {"monitoring_container_block_read_kib", "monitoring_container_block_read_kib_total", "counter", "Container block device reads in KiB.", [](const DockerContainerSummary &c)
+         { return c.blockReadKb; }},
+        {"monitoring_container_block_write_kib", "monitoring_container_block_write_kib_total", "counter", "Container block device writes in KiB.", [](const DockerContainerSummary &c)
+         { return c.blockWriteKb; }},
+        {"monitoring_container_pids", "monitoring_container_pids", "gauge", "Processes running inside the container.", [](const DockerContainerSummary &c)
+         { return static_cast<double>(c.pids); }},
+        {"monitoring_container_cpu_pressure_percent", "monitoring_container_cpu_pressure_percent", "gauge", "Share of time the container's tasks waited for CPU, 10 s average.", [](const DockerContainerSummary &c)
+         { return c.cpuPressure; }},
+        {"monitoring_container_memory_pressure_percent", "monitoring_container_memory_pressure_percent", "gauge", "Share of time the container's tasks stalled on memory, 10 s average.", [](const DockerContainerSummary &c)
+         { return c.memoryPressure; }},
+        {"monitoring_container_io_pressure_percent", "monitoring_container_io_pressure_percent", "gauge", "Share of time the container's tasks stalled on I/O, 10 s average.", [](const DockerContainerSummary &c)
+         { return c.ioPressure; }},
+    };
+    for (const auto &family : containerFamilies)
+    {
+        append_family(out, family.name, family.help, family.type);
+        for (const auto &container : m.dockerContainers)
+        {
+            // Pressure of a container whose cgroup could not be read is -1 and left out.
+            const double value = family.value(container);
+            if (value >= 0.0)
+            {
+                append_sample(out, family.sample, container_labels(container), value);
+            }
+        }
+    }
+
+    append_family(out, "monitoring_docker_image", "Docker images available on the host.", "info");
+    for (const auto &image : m.dockerImages)
+    {
+        append_sample(out, "monitoring_docker_image_info", image_labels(image), 1.0);
+    }
+
+    out.append("# EOF\n");
+
+    evict_stale();
+    rendered_sequence_ = m.sequence;
+    has_render_ = true;
+    return buffer_;
+}
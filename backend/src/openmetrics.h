@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "system_metrics.h"
+
+// Renders SystemMetrics in the OpenMetrics text exposition format.
+//
+// Label sets for processes, domains and containers are rendered once and interned; each render
+// only appends family names, the cached label blocks and the formatted values into a buffer that
+// keeps its capacity. Repeated scrapes of the same snapshot return the cached exposition.
+class OpenMetricsRenderer
+{
+public:
+    OpenMetricsRenderer();
+
+    std::string render(const SystemMetrics &metrics);
+
+private:
+    struct LabelSet
+    {
+        std::string key;
+        std::string labels;
+        unsigned long long generation;
+    };
+
+    const std::string &application_labels(const ApplicationUsage &app);
+    const std::string &domain_labels(const DomainUsage &domain);
+    const std::string &container_labels(const DockerContainerSummary &container);
+    const std::string &image_labels(const DockerImageSummary &image);
+    void evict_stale();
+
+    std::mutex mutex_;
+    std::string buffer_;
+    bool has_render_;
+    unsigned long long rendered_sequence_;
+    unsigned long long generation_;
+    std::unordered_map<int, LabelSet> application_labels_;
+    std::unordered_map<std::string, LabelSet> domain_labels_;
+    std::unordered_map<std::string, LabelSet> container_labels_;
+    std::unordered_map<std::string, LabelSet> image_labels_;
+};
@@ -0,0 +1,35 @@
+#include "payload_cache.h"
+
+PayloadCache::PayloadCache(std::size_t maxEntries)
+    : mutex_(), max_entries_(maxEntries == 0 ? 1 : maxEntries), sequence_(0), payloads_()
+{
+}
+
+std::shared_ptr<const std::string> PayloadCache::find(unsigned long long sequence, const std::string &variant) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sequence != sequence_)
+    {
+        return nullptr;
+    }
+    const auto iter = payloads_.find(variant);
+    return iter != payloads_.end() ? iter->second : nullptr;
+}
+
+std::shared_ptr<const std::string> PayloadCache::store(unsigned long long sequence, const std::string &variant, std::string payload)
+{
+    auto shared = std::make_shared<const std::string>(std::move(payload));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sequence < sequence_)
+    {
+        return shared;
+    }
+    if (sequence != sequence_ || payloads_.size() >= max_entries_)
+    {
+        payloads_.clear();
+        sequence_ = sequence;
+    }
+    payloads_[variant] = shared;
+    return shared;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Encoded payloads of the newest collector snapshot, keyed by representation (format, projection,
+// target). REST responses and WebSocket frames render each representation once per snapshot and
+// write the same shared buffer to every consumer.
+class PayloadCache
+{
+public:
+    explicit PayloadCache(std::size_t maxEntries = 32);
+
+    std::shared_ptr<const std::string> find(unsigned long long sequence, const std::string &variant) const;
+    // Stores a payload rendered from the given snapshot; payloads from older snapshots are returned but not kept.
+    std::shared_ptr<const std::string> store(unsigned long long sequence, const std::string &variant, std::string payload);
+
+private:
+    mutable std::mutex mutex_;
+    std::size_t max_entries_;
+    unsigned long long sequence_;
+    std::unordered_map<std::string, std::shared_ptr<const std::string>> payloads_;
+};
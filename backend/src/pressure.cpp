@@ -0,0 +1,190 @@
+#include "pressure.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <utility>
+
+namespace
+{
+    constexpr std::size_t RESOURCE_COUNT = static_cast<std::size_t>(PressureResource::Count);
+    constexpr const char *RESOURCE_NAMES[] = {"cpu", "memory", "io"};
+    static_assert(std::size(RESOURCE_NAMES) == RESOURCE_COUNT, "one name per resource");
+
+    // Value after "<key>=" in one line of a pressure file.
+    template <typename T>
+    bool line_value(std::string_view line, std::string_view key, T &value)
+    {
+        const std::size_t position = line.find(key);
+        if (position == std::string_view::npos || position + key.size() >= line.size() || line[position + key.size()] != '=')
+        {
+            return false;
+        }
+        const char *first = line.data() + position + key.size() + 1;
+        return std::from_chars(first, line.data() + line.size(), value).ec == std::errc();
+    }
+
+    bool parse_line(std::string_view line, double &avg10, double &avg60, unsigned long long &total)
+    {
+        return line_value(line, " avg10", avg10) && line_value(line, " avg60", avg60) && line_value(line, " total", total);
+    }
+} // namespace
+
+const char *pressure_resource_name(PressureResource resource)
+{
+    return RESOURCE_NAMES[static_cast<std::size_t>(resource)];
+}
+
+bool parse_pressure(std::string_view text, PressureStall &stall)
+{
+    stall = PressureStall{};
+    bool some = false;
+    while (!text.empty())
+    {
+        const std::size_t end = text.find('\n');
+        const std::string_view line = text.substr(0, end);
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        if (line.substr(0, 5) == "some ")
+        {
+            some = parse_line(line, stall.someAvg10, stall.someAvg60, stall.someTotalUs);
+        }
+        else if (line.substr(0, 5) == "full ")
+        {
+            parse_line(line, stall.fullAvg10, stall.fullAvg60, stall.fullTotalUs);
+        }
+    }
+    return some;
+}
+
+PressureTriggers::PressureTriggers(std::string procRoot, std::chrono::microseconds stall, std::chrono::microseconds window)
+    : proc_root_(std::move(procRoot)),
+      stall_(std::min(stall, window)),
+      window_(window),
+      fds_(),
+      wake_(-1),
+      thread_(),
+      fired_(0),
+      listeners_mutex_(),
+      listeners_()
+{
+    fds_.fill(-1);
+}
+
+PressureTriggers::~PressureTriggers()
+{
+    if (thread_.joinable())
+    {
+        const unsigned long long one = 1;
+        [[maybe_unused]] const ssize_t written = ::write(wake_, &one, sizeof(one));
+        thread_.join();
+    }
+    // Closing the file descriptor destroys its trigger.
+    for (const int fd : fds_)
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+    if (wake_ >= 0)
+    {
+        ::close(wake_);
+    }
+}
+
+bool PressureTriggers::start(std::string &error)
+{
+    const std::string trigger = "some " + std::to_string(stall_.count()) + " " + std::to_string(window_.count());
+    std::size_t registered = 0;
+    for (std::size_t i = 0; i < RESOURCE_COUNT; ++i)
+    {
+        const std::string path = proc_root_ + "/pressure/" + RESOURCE_NAMES[i];
+        const int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        // The kernel expects the trigger string with its terminating NUL.
+        if (fd < 0 || ::write(fd, trigger.c_str(), trigger.size() + 1) < 0)
+        {
+            error += (error.empty() ? "" : "; ") + path + ": " + std::strerror(errno);
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            continue;
+        }
+        fds_[i] = fd;
+        ++registered;
+    }
+    if (registered == 0)
+    {
+        return false;
+    }
+    wake_ = ::eventfd(0, EFD_CLOEXEC);
+    if (wake_ < 0)
+    {
+        error = std::string("eventfd: ") + std::strerror(errno);
+        return false;
+    }
+    thread_ = std::thread([this] { poll_loop(); });
+    return true;
+}
+
+void PressureTriggers::add_listener(Listener listener)
+{
+    std::lock_guard<std::mutex> lock(listeners_mutex_);
+    listeners_.push_back(std::move(listener));
+}
+
+unsigned long long PressureTriggers::fired() const
+{
+    return fired_.load(std::memory_order_relaxed);
+}
+
+void PressureTriggers::poll_loop()
+{
+    std::array<pollfd, RESOURCE_COUNT + 1> fds{};
+    for (std::size_t i = 0; i < RESOURCE_COUNT; ++i)
+    {
+        // poll() skips negative descriptors, so resources without a trigger cost nothing.
+        fds[i] = {fds_[i], POLLPRI, 0};
+    }
+    fds[RESOURCE_COUNT] = {wake_, POLLIN, 0};
+    while (true)
+    {
+        if (::poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        if ((fds[RESOURCE_COUNT].revents & POLLIN) != 0)
+        {
+            return;
+        }
+        for (std::size_t i = 0; i < RESOURCE_COUNT; ++i)
+        {
+            if ((fds[i].revents & POLLERR) != 0)
+            {
+                // The pressure file went away; this trigger cannot fire again.
+                fds[i].fd = -1;
+                continue;
+            }
+            if ((fds[i].revents & POLLPRI) == 0)
+            {
+                continue;
+            }
+            fired_.fetch_add(1, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(listeners_mutex_);
+            for (const auto &listener : listeners_)
+            {
+                listener(static_cast<PressureResource>(i));
+            }
+        }
+    }
+}
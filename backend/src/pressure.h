@@ -0,0 +1,79 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Pressure stall information (PSI) of one resource, as <proc>/pressure/<resource> and a cgroup's
+// <resource>.pressure report it: the share of wall time in which at least one ("some") or every
+// ("full") non-idle task was stalled waiting for the resource. Unlike CPU% or the load average it
+// measures lost progress, so it separates a busy host from a contended one.
+struct PressureStall
+{
+    double someAvg10;               // % over the last 10 s
+    double someAvg60;               // % over the last 60 s
+    unsigned long long someTotalUs; // cumulative stall time
+    double fullAvg10;               // host CPU reports 0 here
+    double fullAvg60;
+    unsigned long long fullTotalUs;
+};
+
+enum class PressureResource : std::size_t
+{
+    Cpu,
+    Memory,
+    Io,
+    Count
+};
+
+const char *pressure_resource_name(PressureResource resource);
+
+// Parses the "some ..." and optional "full ..." lines of a pressure file.
+bool parse_pressure(std::string_view text, PressureStall &stall);
+
+// PSI poll triggers on the host pressure files: the kernel wakes a waiting poll() as soon as "some"
+// stall time of a resource exceeds `stall` within a `window`, at most once per window, so a pressure
+// spike can be sampled when it happens instead of at the next collection.
+//
+// The window must lie between 500 ms and 10 s. Registering needs CAP_SYS_RESOURCE, except on Linux 6.5+
+// where unprivileged processes may use windows that are multiples of 2 s.
+class PressureTriggers
+{
+public:
+    using Listener = std::function<void(PressureResource resource)>;
+
+    PressureTriggers(std::string procRoot, std::chrono::microseconds stall, std::chrono::microseconds window);
+    ~PressureTriggers();
+
+    PressureTriggers(const PressureTriggers &) = delete;
+    PressureTriggers &operator=(const PressureTriggers &) = delete;
+
+    // Registers one trigger per resource and starts the polling thread. Fails, describing why in
+    // `error`, only when no resource accepted a trigger; resources that refused are listed in `error`
+    // either way.
+    bool start(std::string &error);
+
+    // Listeners run on the polling thread and must return quickly.
+    void add_listener(Listener listener);
+
+    unsigned long long fired() const; // trigger events since start, all resources
+
+private:
+    void poll_loop();
+
+    const std::string proc_root_;
+    const std::chrono::microseconds stall_;
+    const std::chrono::microseconds window_;
+    std::array<int, static_cast<std::size_t>(PressureResource::Count)> fds_;
+    int wake_; // eventfd that stops the polling thread
+    std::thread thread_;
+    std::atomic<unsigned long long> fired_;
+    std::mutex listeners_mutex_;
+    std::vector<Listener> listeners_;
+};
@@ -0,0 +1,485 @@
+#include "proc_file_batch.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr int NOT_DONE = INT_MIN;
+
+    // The low bits of an SQE's user_data name the operation, the rest the request index.
+    constexpr unsigned int OPERATION_BITS = 2;
+    constexpr unsigned long long OPERATION_MASK = (1ULL << OPERATION_BITS) - 1;
+    constexpr unsigned long long OP_OPEN = 0;
+    constexpr unsigned long long OP_READ = 1;
+    constexpr unsigned long long OP_CLOSE = 2;
+    constexpr unsigned long long OP_STATX = 3;
+    constexpr unsigned int SQES_PER_READ = 3;
+    constexpr unsigned int PROBE_OPS = 256;
+
+    // Raw system calls: liburing is not required.
+    int uring_setup(unsigned int entries, io_uring_params *params)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int uring_enter(int fd, unsigned int toSubmit, unsigned int minComplete, unsigned int flags)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    int uring_register(int fd, unsigned int opcode, void *arg, unsigned int count)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+
+    unsigned int ring_entries(std::size_t capacity)
+    {
+        unsigned int entries = 1;
+        while (entries < capacity * SQES_PER_READ)
+        {
+            entries <<= 1;
+        }
+        return entries;
+    }
+
+    ssize_t read_retrying(int fd, char *data, std::size_t bytes)
+    {
+        ssize_t count = 0;
+        do
+        {
+            count = ::read(fd, data, bytes);
+        } while (count < 0 && errno == EINTR);
+        return count;
+    }
+} // namespace
+
+struct ProcFileBatch::Ring
+{
+    int fd = -1;
+    bool broken = false; // a submit or wait failed, or the kernel ignored direct descriptors
+    void *sq_map = MAP_FAILED;
+    std::size_t sq_map_bytes = 0;
+    void *cq_map = MAP_FAILED; // same mapping as sq_map with IORING_FEAT_SINGLE_MMAP
+    std::size_t cq_map_bytes = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    std::size_t sqes_bytes = 0;
+    unsigned int *sq_tail = nullptr;
+    unsigned int *sq_array = nullptr;
+    unsigned int sq_mask = 0;
+    unsigned int *cq_head = nullptr;
+    unsigned int *cq_tail = nullptr;
+    unsigned int cq_mask = 0;
+    io_uring_cqe *cqes = nullptr;
+    std::vector<struct statx> stats;
+
+    ~Ring()
+    {
+        if (sqes != MAP_FAILED)
+        {
+            ::munmap(sqes, sqes_bytes);
+        }
+        if (cq_map != MAP_FAILED && cq_map != sq_map)
+        {
+            ::munmap(cq_map, cq_map_bytes);
+        }
+        if (sq_map != MAP_FAILED)
+        {
+            ::munmap(sq_map, sq_map_bytes);
+        }
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+
+    // Sets up the ring, checks the opcodes the batch needs and registers `slots` empty descriptor slots.
+    bool open(unsigned int entries, std::size_t slots)
+    {
+        io_uring_params params{};
+        fd = uring_setup(entries, &params);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        sq_map_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        cq_map_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+        {
+            sq_map_bytes = cq_map_bytes = std::max(sq_map_bytes, cq_map_bytes);
+        }
+        sq_map = ::mmap(nullptr, sq_map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_map == MAP_FAILED)
+        {
+            return false;
+        }
+        cq_map = single ? sq_map : ::mmap(nullptr, cq_map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_map == MAP_FAILED)
+        {
+            return false;
+        }
+        sqes_bytes = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqe_map = ::mmap(nullptr, sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqe_map == MAP_FAILED)
+        {
+            return false;
+        }
+        sqes = static_cast<io_uring_sqe *>(sqe_map);
+
+        char *sq = static_cast<char *>(sq_map);
+        char *cq = static_cast<char *>(cq_map);
+        sq_tail = reinterpret_cast<unsigned int *>(sq + params.sq_off.tail);
+        sq_array = reinterpret_cast<unsigned int *>(sq + params.sq_off.array);
+        sq_mask = *reinterpret_cast<unsigned int *>(sq + params.sq_off.ring_mask);
+        cq_head = reinterpret_cast<unsigned int *>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned int *>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned int *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        std::vector<unsigned char> probe_memory(sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op), 0);
+        auto *probe = reinterpret_cast<io_uring_probe *>(probe_memory.data());
+        if (uring_register(fd, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0)
+        {
+            return false;
+        }
+        for (const unsigned int opcode : {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE, IORING_OP_STATX})
+        {
+            if (opcode > probe->last_op || (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) == 0)
+            {
+                return false;
+            }
+        }
+        // Direct descriptors (file_index) arrived in 5.15, together with IORING_OP_LINKAT. Older kernels
+        // ignore file_index, so the linked close would act on descriptor 0 of this process.
+        if (probe->last_op < IORING_OP_LINKAT)
+        {
+            return false;
+        }
+
+        std::vector<int> files(slots, -1);
+        if (uring_register(fd, IORING_REGISTER_FILES, files.data(), static_cast<unsigned int>(slots)) < 0)
+        {
+            return false;
+        }
+        stats.resize(slots);
+        return true;
+    }
+};
+
+ProcFileBatch::ProcFileBatch(std::size_t capacity, bool useIoUring)
+    : capacity_(std::max<std::size_t>(1, capacity)),
+      requests_(capacity_),
+      count_(0),
+      buffers_(capacity_ * FILE_BYTES),
+      ring_(),
+      in_flight_(0)
+{
+    if (!useIoUring)
+    {
+        return;
+    }
+    auto ring = std::make_unique<Ring>();
+    if (!ring->open(ring_entries(capacity_), capacity_))
+    {
+        return;
+    }
+    ring_ = std::move(ring);
+}
+
+ProcFileBatch::~ProcFileBatch()
+{
+    if (ring_ && in_flight_ > 0)
+    {
+        reap_ring();
+    }
+}
+
+bool ProcFileBatch::uses_io_uring() const
+{
+    return ring_ != nullptr;
+}
+
+std::size_t ProcFileBatch::capacity() const
+{
+    return capacity_;
+}
+
+std::size_t ProcFileBatch::size() const
+{
+    return count_;
+}
+
+void ProcFileBatch::add_read(std::string_view path)
+{
+    if (count_ == capacity_)
+    {
+        return;
+    }
+    Request &request = requests_[count_++];
+    request.kind = Kind::Read;
+    request.path.assign(path);
+    request.result = NOT_DONE;
+    request.bytes = 0;
+    request.overflow.clear();
+}
+
+void ProcFileBatch::add_size(std::string_view path)
+{
+    if (count_ == capacity_)
+    {
+        return;
+    }
+    Request &request = requests_[count_++];
+    request.kind = Kind::Size;
+    request.path.assign(path);
+    request.result = NOT_DONE;
+    request.bytes = 0;
+    request.overflow.clear();
+}
+
+void ProcFileBatch::submit()
+{
+    if (ring_)
+    {
+        submit_to_ring();
+        return;
+    }
+    for (std::size_t i = 0; i < count_; ++i)
+    {
+        complete_synchronously(i);
+    }
+}
+
+void ProcFileBatch::wait()
+{
+    if (ring_ && in_flight_ > 0)
+    {
+        reap_ring();
+    }
+    for (std::size_t i = 0; i < count_; ++i)
+    {
+        Request &request = requests_[i];
+        // Unfinished (the ring failed), interrupted, or possibly cut off at the fixed buffer: read it here.
+        const bool retry = request.result == NOT_DONE || request.result == -EAGAIN || request.result == -EINTR;
+        const bool truncated = request.kind == Kind::Read && request.result == static_cast<int>(FILE_BYTES) && request.overflow.empty();
+        if (retry || truncated)
+        {
+            complete_synchronously(i);
+        }
+    }
+    if (ring_ && ring_->broken && in_flight_ == 0)
+    {
+        ring_.reset();
+    }
+}
+
+bool ProcFileBatch::contents(std::size_t index, std::string_view &data) const
+{
+    if (index >= count_ || requests_[index].kind != Kind::Read || requests_[index].result < 0)
+    {
+        return false;
+    }
+    const Request &request = requests_[index];
+    data = request.overflow.empty() ? std::string_view(buffers_.data() + index * FILE_BYTES, static_cast<std::size_t>(request.result))
+                                    : std::string_view(request.overflow);
+    return true;
+}
+
+bool ProcFileBatch::size(std::size_t index, unsigned long long &bytes) const
+{
+    if (index >= count_ || requests_[index].kind != Kind::Size || requests_[index].result != 0)
+    {
+        return false;
+    }
+    bytes = requests_[index].bytes;
+    return true;
+}
+
+void ProcFileBatch::clear()
+{
+    count_ = 0;
+}
+
+char *ProcFileBatch::buffer(std::size_t index)
+{
+    return buffers_.data() + index * FILE_BYTES;
+}
+
+void ProcFileBatch::complete_synchronously(std::size_t index)
+{
+    Request &request = requests_[index];
+    if (request.kind == Kind::Size)
+    {
+        struct stat info{};
+        request.result = ::stat(request.path.c_str(), &info) == 0 ? 0 : -errno;
+        request.bytes = static_cast<unsigned long long>(info.st_size);
+        return;
+    }
+
+    const int fd = ::open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        request.result = -errno;
+        return;
+    }
+    char *chunk = buffer(index);
+    const ssize_t first = read_retrying(fd, chunk, FILE_BYTES);
+    request.result = first < 0 ? -errno : static_cast<int>(first);
+    request.overflow.clear();
+    if (first == static_cast<ssize_t>(FILE_BYTES))
+    {
+        request.overflow.assign(chunk, FILE_BYTES);
+        char more[FILE_BYTES];
+        ssize_t count = 0;
+        while ((count = read_retrying(fd, more, sizeof(more))) > 0)
+        {
+            request.overflow.append(more, static_cast<std::size_t>(count));
+        }
+    }
+    ::close(fd);
+}
+
+void ProcFileBatch::submit_to_ring()
+{
+    Ring &ring = *ring_;
+    unsigned int tail = *ring.sq_tail;
+    unsigned int queued = 0;
+    const auto next_sqe = [&ring, &tail, &queued](unsigned long long userData) -> io_uring_sqe &
+    {
+        const unsigned int slot = tail & ring.sq_mask;
+        io_uring_sqe &sqe = ring.sqes[slot];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.user_data = userData;
+        ring.sq_array[slot] = slot;
+        ++tail;
+        ++queued;
+        return sqe;
+    };
+
+    for (std::size_t i = 0; i < count_; ++i)
+    {
+        const Request &request = requests_[i];
+        const unsigned long long tag = static_cast<unsigned long long>(i) << OPERATION_BITS;
+        if (request.kind == Kind::Size)
+        {
+            io_uring_sqe &stat = next_sqe(tag | OP_STATX);
+            stat.opcode = IORING_OP_STATX;
+            stat.fd = AT_FDCWD;
+            stat.addr = reinterpret_cast<std::uintptr_t>(request.path.c_str());
+            stat.len = STATX_SIZE;
+            stat.addr2 = reinterpret_cast<std::uintptr_t>(&ring.stats[i]);
+            continue;
+        }
+
+        // Open into descriptor slot i, read it, and close the slot even when the read fails (hard link).
+        // A failed open cancels the rest of its chain.
+        io_uring_sqe &open = next_sqe(tag | OP_OPEN);
+        open.opcode = IORING_OP_OPENAT;
+        open.fd = AT_FDCWD;
+        open.addr = reinterpret_cast<std::uintptr_t>(request.path.c_str());
+        open.open_flags = O_RDONLY;
+        open.file_index = static_cast<unsigned int>(i + 1);
+        open.flags = IOSQE_IO_LINK;
+
+        io_uring_sqe &read = next_sqe(tag | OP_READ);
+        read.opcode = IORING_OP_READ;
+        read.fd = static_cast<int>(i);
+        read.addr = reinterpret_cast<std::uintptr_t>(buffer(i));
+        read.len = static_cast<unsigned int>(FILE_BYTES);
+        read.off = 0;
+        read.flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+
+        io_uring_sqe &close = next_sqe(tag | OP_CLOSE);
+        close.opcode = IORING_OP_CLOSE;
+        close.file_index = static_cast<unsigned int>(i + 1);
+    }
+    __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+    unsigned int submitted = 0;
+    while (submitted < queued)
+    {
+        const int result = uring_enter(ring.fd, queued - submitted, 0, 0);
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (result <= 0)
+        {
+            // What was not taken is never submitted: the ring is dropped after the rest is reaped.
+            ring.broken = true;
+            break;
+        }
+        submitted += static_cast<unsigned int>(result);
+    }
+    in_flight_ = submitted;
+}
+
+void ProcFileBatch::reap_ring()
+{
+    Ring &ring = *ring_;
+    while (in_flight_ > 0)
+    {
+        unsigned int head = *ring.cq_head;
+        const unsigned int tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail)
+        {
+            const int result = uring_enter(ring.fd, 0, static_cast<unsigned int>(in_flight_), IORING_ENTER_GETEVENTS);
+            if (result < 0 && errno != EINTR)
+            {
+                ring.broken = true;
+                in_flight_ = 0;
+                return;
+            }
+            continue;
+        }
+
+        for (; head != tail; ++head, --in_flight_)
+        {
+            const io_uring_cqe &cqe = ring.cqes[head & ring.cq_mask];
+            Request &request = requests_[static_cast<std::size_t>(cqe.user_data >> OPERATION_BITS)];
+            switch (cqe.user_data & OPERATION_MASK)
+            {
+            case OP_OPEN:
+                if (cqe.res > 0)
+                {
+                    // The kernel ignored file_index and returned an ordinary descriptor.
+                    ::close(cqe.res);
+                    ring.broken = true;
+                }
+                else if (cqe.res < 0 && (request.result == NOT_DONE || request.result == -ECANCELED))
+                {
+                    request.result = cqe.res;
+                }
+                break;
+            case OP_READ:
+                // A read cancelled by its failed open keeps the open's error.
+                if (cqe.res != -ECANCELED || request.result == NOT_DONE)
+                {
+                    request.result = cqe.res;
+                }
+                break;
+            case OP_STATX:
+                request.result = cqe.res;
+                if (cqe.res == 0)
+                {
+                    request.bytes = ring.stats[static_cast<std::size_t>(cqe.user_data >> OPERATION_BITS)].stx_size;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Reads a batch of small procfs files with as few system calls as possible.
+//
+// With io_uring every file read becomes a linked openat -> read -> close chain on a registered
+// ("direct") descriptor slot, and size requests become statx, so a whole batch is submitted with one
+// io_uring_enter() and the kernel works through it while the caller parses the previous batch. Where
+// io_uring is not requested or not usable (kernels before 5.15, seccomp filters,
+// kernel.io_uring_disabled) submit() performs the same requests synchronously, and a ring that fails
+// mid-batch drops to the synchronous path for good. Files longer than FILE_BYTES are re-read in full.
+class ProcFileBatch
+{
+public:
+    static constexpr std::size_t FILE_BYTES = 4096;
+
+    // `capacity` is the number of requests a batch holds.
+    ProcFileBatch(std::size_t capacity, bool useIoUring);
+    ~ProcFileBatch();
+
+    ProcFileBatch(const ProcFileBatch &) = delete;
+    ProcFileBatch &operator=(const ProcFileBatch &) = delete;
+
+    bool uses_io_uring() const;
+    std::size_t capacity() const;
+    std::size_t size() const;
+
+    // Queue a read of the whole file, or a stat of it for its st_size. Requests are numbered in the
+    // order they are added; the path is copied.
+    void add_read(std::string_view path);
+    void add_size(std::string_view path);
+
+    // Starts every queued request; results are ready once wait() returns.
+    void submit();
+    void wait();
+
+    // Result of request `index`; false when the file could not be opened or read. Views stay valid
+    // until clear().
+    bool contents(std::size_t index, std::string_view &data) const;
+    bool size(std::size_t index, unsigned long long &bytes) const;
+
+    // Forgets all requests so the batch can be filled again.
+    void clear();
+
+private:
+    struct Ring;
+
+    enum class Kind
+    {
+        Read,
+        Size
+    };
+
+    struct Request
+    {
+        Kind kind;
+        std::string path;
+        int result;               // bytes read or 0 for a size; -errno on failure; NOT_DONE until completed
+        unsigned long long bytes; // st_size of a size request
+        std::string overflow;     // the whole file when it does not fit the fixed buffer
+    };
+
+    char *buffer(std::size_t index);
+    void complete_synchronously(std::size_t index);
+    void submit_to_ring();
+    void reap_ring();
+
+    const std::size_t capacity_;
+    std::vector<Request> requests_;
+    std::size_t count_;
+    std::vector<char> buffers_;
+    std::unique_ptr<Ring> ring_;
+    std::size_t in_flight_; // completions still owed by the ring
+};
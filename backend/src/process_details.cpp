@@ -0,0 +1,274 @@
+#include "process_details.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <fcntl.h>
+#include <string_view>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+
+namespace
+{
+    constexpr std::size_t PROBE_COUNT = static_cast<std::size_t>(ProcessDetailScanner::Probe::Count);
+    constexpr const char *PROBE_FILES[] = {"smaps_rollup", "fd", "cgroup"};
+    static_assert(std::size(PROBE_FILES) == PROBE_COUNT, "one file per probe");
+    // How old a value may get before it is read again: the busiest processes are kept close to live,
+    // the rest are refreshed as the round-robin comes by. Cgroup membership hardly ever changes.
+    constexpr std::array<std::chrono::seconds, PROBE_COUNT> TOP_REFRESH_AGE = {std::chrono::seconds(2), std::chrono::seconds(2),
+                                                                            std::chrono::seconds(60)};
+    constexpr std::array<std::chrono::seconds, PROBE_COUNT> REFRESH_AGE = {std::chrono::seconds(10), std::chrono::seconds(10),
+                                                                        std::chrono::seconds(300)};
+    constexpr std::size_t DIRENT_BYTES = 32 * 1024;
+
+    // The layout getdents64 fills in.
+    struct LinuxDirent64
+    {
+        unsigned long long inode;
+        long long offset;
+        unsigned short length;
+        unsigned char type;
+        char name[1];
+    };
+
+    // Reads a whole file into `buffer`, counting open, every read and close.
+    bool read_counted(const char *path, std::string &buffer, std::size_t &syscalls)
+    {
+        ++syscalls;
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+        buffer.clear();
+        char chunk[4096];
+        bool ok = true;
+        for (;;)
+        {
+            ++syscalls;
+            const ssize_t count = ::read(fd, chunk, sizeof(chunk));
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                ok = count == 0;
+                break;
+            }
+            buffer.append(chunk, static_cast<std::size_t>(count));
+        }
+        ++syscalls;
+        ::close(fd);
+        return ok;
+    }
+
+    // Entries of a /proc/<pid>/fd directory, read with getdents64 so every system call is counted.
+    bool count_entries(const char *path, unsigned int &entries, std::size_t &syscalls)
+    {
+        ++syscalls;
+        const int fd = ::open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+        alignas(LinuxDirent64) char buffer[DIRENT_BYTES];
+        entries = 0;
+        bool ok = true;
+        for (;;)
+        {
+            ++syscalls;
+            const long length = ::syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+            if (length <= 0)
+            {
+                ok = length == 0;
+                break;
+            }
+            for (long offset = 0; offset < length;)
+            {
+                const auto *entry = reinterpret_cast<const LinuxDirent64 *>(buffer + offset);
+                if (entry->name[0] != '.')
+                {
+                    ++entries;
+                }
+                offset += entry->length;
+            }
+        }
+        ++syscalls;
+        ::close(fd);
+        return ok;
+    }
+
+    // The number after `key` in a "Key:   value kB" file; false when the key is missing.
+    bool kb_value(std::string_view text, std::string_view key, unsigned long long &value)
+    {
+        const std::size_t position = text.find(key);
+        if (position == std::string_view::npos)
+        {
+            return false;
+        }
+        std::size_t begin = position + key.size();
+        while (begin < text.size() && (text[begin] == ' ' || text[begin] == '\t'))
+        {
+            ++begin;
+        }
+        return std::from_chars(text.data() + begin, text.data() + text.size(), value).ec == std::errc();
+    }
+
+    // The unified hierarchy ("0::/system.slice/nginx.service") when mounted, else the first v1 controller line.
+    std::string_view cgroup_path(std::string_view text)
+    {
+        std::string_view fallback;
+        while (!text.empty())
+        {
+            const std::size_t end = text.find('\n');
+            const std::string_view line = text.substr(0, end);
+            text = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+            const std::size_t colon = line.find(':');
+            const std::size_t second = colon == std::string_view::npos ? std::string_view::npos : line.find(':', colon + 1);
+            if (second == std::string_view::npos)
+            {
+                continue;
+            }
+            if (line.substr(0, colon) == "0" && second == colon + 1)
+            {
+                return line.substr(second + 1);
+            }
+            if (fallback.empty())
+            {
+                fallback = line.substr(second + 1);
+            }
+        }
+        return fallback;
+    }
+} // namespace
+
+ProcessDetailScanner::ProcessDetailScanner(std::string procRoot, Budget budget, bool countFds)
+    : proc_root_(std::move(procRoot)),
+      budget_(budget),
+      count_fds_(countFds),
+      depth_halvings_(0),
+      details_(),
+      top_(),
+      order_(),
+      cursor_(0),
+      path_(),
+      buffer_()
+{
+}
+
+bool ProcessDetailScanner::enabled() const
+{
+    return budget_.time.count() > 0 && budget_.syscalls > 0;
+}
+
+void ProcessDetailScanner::set_depth_halvings(unsigned int halvings)
+{
+    depth_halvings_ = halvings;
+}
+
+const ProcessDetailScanner::Details *ProcessDetailScanner::find(int pid) const
+{
+    const auto found = details_.find(pid);
+    return found == details_.end() ? nullptr : &found->second;
+}
+
+ProcessDetailScanner::Pass ProcessDetailScanner::run(const std::vector<int> &pids, std::chrono::steady_clock::time_point now)
+{
+    const auto started = std::chrono::steady_clock::now();
+    Pass pass{};
+    order_.assign(pids.begin(), pids.end());
+    std::sort(order_.begin(), order_.end());
+    for (auto iter = details_.begin(); iter != details_.end();)
+    {
+        iter = std::binary_search(order_.begin(), order_.end(), iter->first) ? std::next(iter) : details_.erase(iter);
+    }
+    if (!enabled() || order_.empty())
+    {
+        return pass;
+    }
+
+    const auto deadline = started + budget_.time / (1LL << depth_halvings_);
+    const std::size_t syscalls = std::max<std::size_t>(1, budget_.syscalls >> depth_halvings_);
+    bool spent = false;
+    // Probes whatever of `pid` is older than `ages`; false once the budget is gone.
+    const auto visit = [&](int pid, const std::array<std::chrono::seconds, PROBE_COUNT> &ages)
+    {
+        Details &details = details_[pid];
+        for (std::size_t i = 0; i < PROBE_COUNT; ++i)
+        {
+            const auto probe = static_cast<Probe>(i);
+            if ((probe == Probe::OpenFds && !count_fds_) || now - details.triedAt[i] < ages[i])
+            {
+                continue;
+            }
+            if (pass.syscalls >= syscalls || std::chrono::steady_clock::now() >= deadline)
+            {
+                spent = true;
+                return false;
+            }
+            details.triedAt[i] = now;
+            if (read(probe, pid, details, pass.syscalls))
+            {
+                details.readAt[i] = now;
+            }
+            ++pass.probes;
+        }
+        return true;
+    };
+
+    for (const int pid : top_)
+    {
+        if (std::binary_search(order_.begin(), order_.end(), pid) && !visit(pid, TOP_REFRESH_AGE))
+        {
+            break;
+        }
+    }
+
+    // One lap at most; the cursor stays on the last process that was fully probed.
+    auto next = std::upper_bound(order_.begin(), order_.end(), cursor_);
+    for (std::size_t visited = 0; !spent && visited < order_.size(); ++visited, ++next)
+    {
+        if (next == order_.end())
+        {
+            next = order_.begin();
+        }
+        if (!visit(*next, REFRESH_AGE))
+        {
+            break;
+        }
+        cursor_ = *next;
+    }
+
+    pass.elapsed = std::chrono::steady_clock::now() - started;
+    return pass;
+}
+
+bool ProcessDetailScanner::read(Probe probe, int pid, Details &details, std::size_t &syscalls)
+{
+    char digits[16];
+    const auto end = std::to_chars(digits, digits + sizeof(digits), pid).ptr;
+    path_.assign(proc_root_);
+    path_ += '/';
+    path_.append(digits, end);
+    path_ += '/';
+    path_ += PROBE_FILES[static_cast<std::size_t>(probe)];
+
+    switch (probe)
+    {
+    case Probe::Pss:
+        return read_counted(path_.c_str(), buffer_, syscalls) && kb_value(buffer_, "\nPss:", details.pssKb);
+    case Probe::OpenFds:
+        return count_entries(path_.c_str(), details.openFds, syscalls);
+    case Probe::Cgroup:
+        if (!read_counted(path_.c_str(), buffer_, syscalls))
+        {
+            return false;
+        }
+        details.cgroup.assign(cgroup_path(buffer_));
+        return true;
+    default:
+        return false;
+    }
+}
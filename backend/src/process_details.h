@@ -0,0 +1,93 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Per-process details that are too expensive to read for every process on every walk: proportional set
+// size from smaps_rollup (the kernel walks the page tables), the descriptor count from listing
+// /proc/<pid>/fd (kernels before 6.2) and the cgroup path.
+//
+// Each walk spends at most a fixed time and system-call budget on probes. The busiest processes of the
+// previous walk go first, then a cursor moves round-robin through the remaining pids, so every process
+// is revisited eventually and the cost of a walk stays flat however many processes there are. Values
+// are cached with the time they were read; a value younger than its probe's refresh age is not read
+// again.
+class ProcessDetailScanner
+{
+public:
+    enum class Probe : std::size_t
+    {
+        Pss,     // smaps_rollup
+        OpenFds, // listing of fd/, only where stat() cannot count it
+        Cgroup,  // cgroup
+        Count
+    };
+
+    struct Budget
+    {
+        std::chrono::microseconds time; // per walk; 0 disables probing
+        std::size_t syscalls;           // per walk, open/read/getdents/close
+        std::size_t topK;               // processes probed ahead of the round-robin
+    };
+
+    struct Details
+    {
+        unsigned long long pssKb;
+        unsigned int openFds;
+        std::string cgroup;
+        std::array<std::chrono::steady_clock::time_point, static_cast<std::size_t>(Probe::Count)> readAt;  // epoch: no value yet
+        std::array<std::chrono::steady_clock::time_point, static_cast<std::size_t>(Probe::Count)> triedAt; // last attempt, failed ones included
+    };
+
+    // What one run() did, for self-instrumentation.
+    struct Pass
+    {
+        std::size_t probes;
+        std::size_t syscalls;
+        std::chrono::nanoseconds elapsed;
+    };
+
+    ProcessDetailScanner(std::string procRoot, Budget budget, bool countFds);
+
+    bool enabled() const;
+
+    // Divides the budget (time, system calls and top K) by 2^halvings, for the CPU governor.
+    void set_depth_halvings(unsigned int halvings);
+
+    // Probes due values of `pids` (the processes of this walk) until the budget is spent, and forgets
+    // processes that are gone.
+    Pass run(const std::vector<int> &pids, std::chrono::steady_clock::time_point now);
+
+    // Cached details of `pid`, or null when it was never probed.
+    const Details *find(int pid) const;
+
+    // The processes of this walk, busiest first; the first topK are first in line for the next run().
+    template <typename Iterator>
+    void rank(Iterator first, Iterator last)
+    {
+        top_.clear();
+        for (; first != last && top_.size() < (budget_.topK >> depth_halvings_); ++first)
+        {
+            top_.push_back(static_cast<int>(*first));
+        }
+    }
+
+private:
+    // Reads one value into `details`, adding the system calls it took to `syscalls`; false when the
+    // file is gone or not readable (smaps_rollup needs PTRACE_MODE_READ).
+    bool read(Probe probe, int pid, Details &details, std::size_t &syscalls);
+
+    const std::string proc_root_;
+    const Budget budget_;
+    const bool count_fds_;
+    unsigned int depth_halvings_;
+    std::unordered_map<int, Details> details_;
+    std::vector<int> top_;    // pids ranked by the previous walk
+    std::vector<int> order_;  // pids of the current walk, sorted, for a stable round-robin
+    int cursor_;              // last pid the round-robin probed
+    std::string path_;
+    std::string buffer_;
+};
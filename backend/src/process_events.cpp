@@ -0,0 +1,368 @@
+#include "process_events.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <utility>
+
+namespace
+{
+    constexpr int RECEIVE_BUFFER_BYTES = 4 * 1024 * 1024;
+    constexpr std::size_t MESSAGE_BYTES = 16 * 1024;
+
+    long long monotonic_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // PROC_CN_MCAST_LISTEN / _IGNORE as one netlink message.
+    bool send_subscription(int socket, proc_cn_mcast_op op)
+    {
+        alignas(NLMSG_ALIGNTO) char message[NLMSG_SPACE(sizeof(cn_msg) + sizeof(proc_cn_mcast_op))] = {};
+        auto *header = reinterpret_cast<nlmsghdr *>(message);
+        header->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+        header->nlmsg_type = NLMSG_DONE;
+        header->nlmsg_pid = static_cast<unsigned int>(::getpid());
+        auto *body = static_cast<cn_msg *>(NLMSG_DATA(header));
+        body->id.idx = CN_IDX_PROC;
+        body->id.val = CN_VAL_PROC;
+        body->len = sizeof(proc_cn_mcast_op);
+        std::memcpy(body->data, &op, sizeof(op));
+        return ::send(socket, message, header->nlmsg_len, 0) == static_cast<ssize_t>(header->nlmsg_len);
+    }
+
+    int exit_code(unsigned int status)
+    {
+        const int raw = static_cast<int>(status);
+        return WIFSIGNALED(raw) ? 128 + WTERMSIG(raw) : WEXITSTATUS(raw);
+    }
+} // namespace
+
+ProcessEventTracker::ProcessEventTracker(std::string procRoot, std::size_t maxShortLived)
+    : proc_root_(std::move(procRoot)),
+      max_short_lived_(maxShortLived),
+      socket_(-1),
+      wake_(-1),
+      thread_(),
+      forks_(0),
+      execs_(0),
+      exits_(0),
+      mutex_(),
+      live_(),
+      started_(),
+      stale_(true),
+      stopped_(false),
+      rescanning_(false),
+      rescan_log_(),
+      overflows_(0),
+      overflows_at_rescan_(0),
+      interval_start_ns_(monotonic_ns()),
+      short_lived_(),
+      short_lived_dropped_(0)
+{
+}
+
+ProcessEventTracker::~ProcessEventTracker()
+{
+    if (thread_.joinable())
+    {
+        const unsigned long long one = 1;
+        [[maybe_unused]] const ssize_t written = ::write(wake_, &one, sizeof(one));
+        thread_.join();
+    }
+    if (socket_ >= 0)
+    {
+        send_subscription(socket_, PROC_CN_MCAST_IGNORE);
+        ::close(socket_);
+    }
+    if (wake_ >= 0)
+    {
+        ::close(wake_);
+    }
+}
+
+bool ProcessEventTracker::start(std::string &error)
+{
+    socket_ = ::socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (socket_ < 0)
+    {
+        error = std::string("netlink socket: ") + std::strerror(errno);
+        return false;
+    }
+    // Bursts of process churn arrive faster than they are read; a large buffer postpones ENOBUFS.
+    if (::setsockopt(socket_, SOL_SOCKET, SO_RCVBUFFORCE, &RECEIVE_BUFFER_BYTES, sizeof(RECEIVE_BUFFER_BYTES)) != 0)
+    {
+        ::setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &RECEIVE_BUFFER_BYTES, sizeof(RECEIVE_BUFFER_BYTES));
+    }
+
+    sockaddr_nl address{};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = CN_IDX_PROC;
+    if (::bind(socket_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+    {
+        error = std::string("bind to the proc connector: ") + std::strerror(errno);
+        return false;
+    }
+    if (!send_subscription(socket_, PROC_CN_MCAST_LISTEN))
+    {
+        error = std::string("subscribe to process events: ") + std::strerror(errno);
+        return false;
+    }
+    wake_ = ::eventfd(0, EFD_CLOEXEC);
+    if (wake_ < 0)
+    {
+        error = std::string("eventfd: ") + std::strerror(errno);
+        return false;
+    }
+    thread_ = std::thread([this] { receive_loop(); });
+    return true;
+}
+
+void ProcessEventTracker::receive_loop()
+{
+    alignas(NLMSG_ALIGNTO) char buffer[MESSAGE_BYTES];
+    pollfd fds[2] = {{socket_, POLLIN, 0}, {wake_, POLLIN, 0}};
+    while (true)
+    {
+        if (::poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        if ((fds[1].revents & POLLIN) != 0)
+        {
+            return;
+        }
+
+        const ssize_t length = ::recv(socket_, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (length < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN)
+            {
+                continue;
+            }
+            if (errno == ENOBUFS)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++overflows_;
+                stale_ = true;
+                continue;
+            }
+            break;
+        }
+
+        int remaining = static_cast<int>(length);
+        for (auto *header = reinterpret_cast<nlmsghdr *>(buffer); NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining))
+        {
+            if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_NOOP)
+            {
+                continue;
+            }
+            const auto *message = static_cast<const cn_msg *>(NLMSG_DATA(header));
+            if (message->id.idx == CN_IDX_PROC && message->id.val == CN_VAL_PROC)
+            {
+                handle(message->data);
+            }
+        }
+    }
+
+    // The socket failed for good: from now on every walk lists /proc.
+    std::lock_guard<std::mutex> lock(mutex_);
+    stale_ = true;
+    stopped_ = true;
+}
+
+void ProcessEventTracker::handle(const void *data)
+{
+    const auto *event = static_cast<const proc_event *>(data);
+    const long long timestamp = static_cast<long long>(event->timestamp_ns);
+    switch (event->what)
+    {
+    case proc_event::PROC_EVENT_FORK:
+    {
+        const auto &fork = event->event_data.fork;
+        if (fork.child_pid != fork.child_tgid)
+        {
+            return; // a new thread
+        }
+        forks_.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex_);
+        live_.insert(fork.child_tgid);
+        const auto parent = started_.find(fork.parent_tgid);
+        started_[fork.child_tgid] = Started{timestamp, parent != started_.end() ? parent->second.name : std::string()};
+        if (rescanning_)
+        {
+            rescan_log_.push_back(Logged{true, fork.child_tgid});
+        }
+        return;
+    }
+    case proc_event::PROC_EVENT_EXEC:
+    {
+        const auto &exec = event->event_data.exec;
+        if (exec.process_pid != exec.process_tgid)
+        {
+            return;
+        }
+        execs_.fetch_add(1, std::memory_order_relaxed);
+        {
+            // Only processes forked since the subscription can turn out short-lived.
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (started_.count(exec.process_tgid) == 0)
+            {
+                return;
+            }
+        }
+        std::string name = read_comm(exec.process_tgid);
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto started = started_.find(exec.process_tgid);
+        if (started != started_.end() && !name.empty())
+        {
+            started->second.name = std::move(name);
+        }
+        return;
+    }
+    case proc_event::PROC_EVENT_COMM:
+    {
+        const auto &comm = event->event_data.comm;
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto started = started_.find(comm.process_tgid);
+        if (started != started_.end() && comm.process_pid == comm.process_tgid)
+        {
+            started->second.name.assign(comm.comm, strnlen(comm.comm, sizeof(comm.comm)));
+        }
+        return;
+    }
+    case proc_event::PROC_EVENT_EXIT:
+    {
+        const auto &exit = event->event_data.exit;
+        if (exit.process_pid != exit.process_tgid)
+        {
+            return;
+        }
+        exits_.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex_);
+        live_.erase(exit.process_tgid);
+        if (rescanning_)
+        {
+            rescan_log_.push_back(Logged{false, exit.process_tgid});
+        }
+        const auto started = started_.find(exit.process_tgid);
+        if (started == started_.end())
+        {
+            return;
+        }
+        if (started->second.startNs >= interval_start_ns_)
+        {
+            if (short_lived_.size() < max_short_lived_)
+            {
+                short_lived_.push_back(Exit{exit.process_tgid, std::move(started->second.name),
+                                            std::chrono::nanoseconds(timestamp - started->second.startNs),
+                                            exit_code(exit.exit_code)});
+            }
+            else
+            {
+                ++short_lived_dropped_;
+            }
+        }
+        started_.erase(started);
+        return;
+    }
+    default:
+        return;
+    }
+}
+
+std::string ProcessEventTracker::read_comm(int pid) const
+{
+    const std::string path = proc_root_ + "/" + std::to_string(pid) + "/comm";
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return std::string();
+    }
+    char comm[64];
+    const ssize_t length = ::read(fd, comm, sizeof(comm));
+    ::close(fd);
+    if (length <= 0)
+    {
+        return std::string();
+    }
+    std::string name(comm, static_cast<std::size_t>(length));
+    if (!name.empty() && name.back() == '\n')
+    {
+        name.pop_back();
+    }
+    return name;
+}
+
+void ProcessEventTracker::begin_rescan()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    rescanning_ = true;
+    rescan_log_.clear();
+    overflows_at_rescan_ = overflows_;
+}
+
+void ProcessEventTracker::finish_rescan(const std::vector<int> &pids)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    live_.clear();
+    live_.insert(pids.begin(), pids.end());
+    for (const Logged &logged : rescan_log_)
+    {
+        if (logged.fork)
+        {
+            live_.insert(logged.pid);
+        }
+        else
+        {
+            live_.erase(logged.pid);
+        }
+    }
+    rescanning_ = false;
+    rescan_log_.clear();
+    // Exits lost to an overflow leave entries behind.
+    for (auto iter = started_.begin(); iter != started_.end();)
+    {
+        iter = live_.count(iter->first) != 0 ? std::next(iter) : started_.erase(iter);
+    }
+    // Events lost while the listing ran may still be missing.
+    stale_ = stopped_ || overflows_ != overflows_at_rescan_;
+}
+
+bool ProcessEventTracker::live_pids(std::vector<int> &pids) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stale_)
+    {
+        return false;
+    }
+    pids.assign(live_.begin(), live_.end());
+    return true;
+}
+
+std::size_t ProcessEventTracker::take_short_lived(std::vector<Exit> &exits)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    exits.clear();
+    exits.swap(short_lived_);
+    interval_start_ns_ = monotonic_ns();
+    return std::exchange(short_lived_dropped_, 0);
+}
+
+ProcessEventTracker::Counts ProcessEventTracker::counts() const
+{
+    return Counts{forks_.load(std::memory_order_relaxed), execs_.load(std::memory_order_relaxed), exits_.load(std::memory_order_relaxed)};
+}
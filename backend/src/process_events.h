@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Process lifecycle from the kernel proc connector (NETLINK_CONNECTOR, CN_IDX_PROC).
+//
+// A background thread receives fork, exec and exit notifications and keeps the set of live processes
+// (thread-group leaders), so the process walk can read their files without listing /proc. Processes
+// that start and exit between two walks are kept with their name and lifetime. Event timestamps come
+// from CLOCK_MONOTONIC, the clock behind std::chrono::steady_clock.
+//
+// Subscribing needs CAP_NET_ADMIN and only sees processes of the initial PID namespace. When the socket
+// overflows (ENOBUFS) events are lost: the set is marked stale until the next full rescan.
+class ProcessEventTracker
+{
+public:
+    struct Exit
+    {
+        int pid;
+        std::string name; // comm after exec, or inherited from the parent
+        std::chrono::nanoseconds lifetime;
+        int exitCode; // exit status, or 128 + the signal number
+    };
+
+    struct Counts
+    {
+        unsigned long long forks;
+        unsigned long long execs;
+        unsigned long long exits;
+    };
+
+    // `procRoot` is where exec'd processes' comm is read; `maxShortLived` caps the exits kept per walk.
+    ProcessEventTracker(std::string procRoot, std::size_t maxShortLived);
+    ~ProcessEventTracker();
+
+    ProcessEventTracker(const ProcessEventTracker &) = delete;
+    ProcessEventTracker &operator=(const ProcessEventTracker &) = delete;
+
+    // Subscribes and starts the receiving thread; on failure describes why in `error`.
+    bool start(std::string &error);
+
+    // Reconciliation with a full /proc listing. Events received between the two calls are replayed on
+    // top of the listing, so processes created or reaped while it ran are neither lost nor resurrected.
+    void begin_rescan();
+    void finish_rescan(const std::vector<int> &pids);
+
+    // The live processes, in no particular order; false when the set is stale and a rescan is needed.
+    bool live_pids(std::vector<int> &pids) const;
+
+    // Starts a new walk interval and hands over the processes that started and exited during the last
+    // one. Returns how many more were dropped beyond `maxShortLived`.
+    std::size_t take_short_lived(std::vector<Exit> &exits);
+
+    Counts counts() const;
+
+private:
+    struct Started
+    {
+        long long startNs;
+        std::string name;
+    };
+
+    struct Logged
+    {
+        bool fork; // false: exit
+        int pid;
+    };
+
+    void receive_loop();
+    void handle(const void *event);
+    std::string read_comm(int pid) const;
+
+    const std::string proc_root_;
+    const std::size_t max_short_lived_;
+    int socket_;
+    int wake_; // eventfd that stops the receiving thread
+    std::thread thread_;
+    std::atomic<unsigned long long> forks_;
+    std::atomic<unsigned long long> execs_;
+    std::atomic<unsigned long long> exits_;
+
+    mutable std::mutex mutex_;
+    std::unordered_set<int> live_;
+    std::unordered_map<int, Started> started_; // processes forked since the subscription
+    bool stale_;                               // no rescan yet, events lost, or the thread stopped
+    bool stopped_;                             // the socket failed; every walk lists /proc from now on
+    bool rescanning_;
+    std::vector<Logged> rescan_log_;
+    unsigned long long overflows_;
+    unsigned long long overflows_at_rescan_;
+    long long interval_start_ns_;
+    std::vector<Exit> short_lived_;
+    std::size_t short_lived_dropped_;
+};
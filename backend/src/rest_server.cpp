@@ -1,22 +1,112 @@
 #include "rest_server.h"
 
+#include "metrics_json.h"
+#include "self_stats.h"
+#include "target_index.h"
 #include "token_utils.h"
+#include "trace_recorder.h"
 
-#include <cpprest/http_headers.h>
-#include <cpprest/json.h>
+#include <nlohmann/json.hpp>
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <exception>
-#include <functional>
 #include <iostream>
-#include <map>
+#include <sstream>
+#include <utility>
 #include <vector>
 
-#include <cpprest/asyncrt_utils.h>
-#include <cpprest/uri.h>
-
 namespace
 {
+    // How long a poll waits for the collecting thread to add sections nobody asked for within the demand
+    // window; covers a process walk plus the Docker CLI on a busy host.
+    constexpr std::chrono::milliseconds SECTION_WAIT{2000};
+
+    // Comma-separated names of the collector sections in `sections`, for the X-Missing-Sections header.
+    std::string section_names(unsigned int sections)
+    {
+        static const std::pair<unsigned int, const char *> NAMES[] = {
+            {SECTION_APPLICATIONS, "applications"},
+            {SECTION_PROCESS_COUNTS, "processCounts"},
+            {SECTION_CONNECTIONS, "connections"},
+            {SECTION_LISTENING_PORTS, "listeningPorts"},
+            {SECTION_DOCKER, "docker"},
+        };
+        std::string names;
+        for (const auto &entry : NAMES)
+        {
+            if ((sections & entry.first) != 0)
+            {
+                if (!names.empty())
+                {
+                    names += ',';
+                }
+                names += entry.second;
+            }
+        }
+        return names;
+    }
+
+    // Sequence numbers restart with the process, so entity tags carry a per-instance prefix.
+    std::string instance_tag()
+    {
+        const auto now = std::chrono::system_clock::now().time_since_epoch();
+        std::ostringstream out;
+        out << std::hex << std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+        return out.str();
+    }
+
+    // Splits "http://host:port/path" into its parts; the scheme is optional and the path defaults to "/metrics".
+    void parse_endpoint(const std::string &url, std::string &address, unsigned short &port, std::string &path)
+    {
+        std::string rest = url;
+        const auto scheme = rest.find("://");
+        if (scheme != std::string::npos)
+        {
+            rest = rest.substr(scheme + 3);
+        }
+
+        const auto slash = rest.find('/');
+        std::string authority = rest.substr(0, slash);
+        path = slash == std::string::npos ? std::string("/metrics") : rest.substr(slash);
+        while (path.size() > 1 && path.back() == '/')
+        {
+            path.pop_back();
+        }
+
+        const auto colon = authority.rfind(':');
+        if (colon != std::string::npos && authority.find(']', colon) == std::string::npos)
+        {
+            try
+            {
+                const unsigned long value = std::stoul(authority.substr(colon + 1));
+                if (value == 0 || value > 65535)
+                {
+                    throw std::out_of_range("port out of range");
+                }
+                port = static_cast<unsigned short>(value);
+            }
+            catch (const std::exception &ex)
+            {
+                std::cerr << "Invalid port in MONITORING_METRICS_ENDPOINT ('" << url << "'): " << ex.what()
+                          << ". Falling back to " << port << std::endl;
+            }
+            authority = authority.substr(0, colon);
+        }
+        if (authority.size() > 1 && authority.front() == '[' && authority.back() == ']')
+        {
+            authority = authority.substr(1, authority.size() - 2);
+        }
+        address = authority;
+    }
+
+    void set_error(HttpResponse &response, unsigned int status, const std::string &message)
+    {
+        response.status = status;
+        response.headers.emplace_back("Cache-Control", "no-store");
+        response.set_body(nlohmann::json{{"error", message}}.dump(), "application/json");
+    }
+
     std::string to_lower_copy(const std::string &value)
     {
         std::string result(value.size(), '\0');
@@ -25,281 +115,290 @@ namespace
         return result;
     }
 
-    bool icontains(const std::string &haystack, const std::string &needle)
+    // `scopedMatches` is null when the request named no target.
+    std::string encode_json(const SystemMetrics &m, const MetricsSelection &selection,
+                            const TargetIndex::Matches *scopedMatches, const std::string &scopedTarget)
     {
-        if (needle.empty())
+        self_stats::ScopedTimer timer(self_stats::Timer::JsonEncode);
+        trace::Span span("encode.json", "serialize");
+        nlohmann::json response = metrics_to_json(m, selection);
+
+        if (scopedMatches != nullptr)
         {
-            return false;
+            nlohmann::json scoped = {{"target", scopedTarget}};
+            const TargetIndex::Matches &matches = *scopedMatches;
+
+            // Totals are column reductions over the matched rows; entries are materialised only for the response.
+            const ProcessTable &processes = m.topApplications;
+            if (!matches.applications.empty())
+            {
+                nlohmann::json processEntries = nlohmann::json::array();
+                for (const std::size_t index : matches.applications)
+                {
+                    processEntries.push_back(application_to_json(processes[index]));
+                }
+                scoped["processes"] = {
+                    {"count", processEntries.size()},
+                    {"cpuTotal", processes.sum(ProcessTable::Column::CpuPercent, matches.applications)},
+                    {"memoryTotalMb", processes.sum(ProcessTable::Column::MemoryMb, matches.applications)},
+                    {"entries", std::move(processEntries)}};
+            }
+
+            const ContainerTable &containers = m.dockerContainers;
+            if (!matches.containers.empty())
+            {
+                nlohmann::json containerEntries = nlohmann::json::array();
+                for (const std::size_t index : matches.containers)
+                {
+                    containerEntries.push_back(container_to_json(containers[index]));
+                }
+                const auto total = [&containers, &matches](ContainerTable::Column column)
+                { return containers.sum(column, matches.containers); };
+                scoped["containers"] = {
+                    {"count", containerEntries.size()},
+                    {"cpuTotal", total(ContainerTable::Column::CpuPercent)},
+                    {"memoryTotalMb", total(ContainerTable::Column::MemoryUsageMb)},
+                    {"memoryLimitMb", total(ContainerTable::Column::MemoryLimitMb)},
+                    {"netRxTotalKb", total(ContainerTable::Column::NetworkRxKb)},
+                    {"netTxTotalKb", total(ContainerTable::Column::NetworkTxKb)},
+                    {"blockReadTotalKb", total(ContainerTable::Column::BlockReadKb)},
+                    {"blockWriteTotalKb", total(ContainerTable::Column::BlockWriteKb)},
+                    {"entries", std::move(containerEntries)}};
+            }
+
+            if (scoped.contains("processes") || scoped.contains("containers"))
+            {
+                response["scopedMetrics"] = std::move(scoped);
+            }
         }
 
-        std::string hay = to_lower_copy(haystack);
-        std::string need = to_lower_copy(needle);
-        return hay.find(need) != std::string::npos;
+        return response.dump();
+    }
+
+    std::string make_etag(const std::string &instance, unsigned long long sequence, bool openmetrics)
+    {
+        return "\"" + instance + (openmetrics ? "-om-" : "-") + std::to_string(sequence) + "\"";
+    }
+
+    // If-None-Match carries "*" or a comma-separated list of entity tags; weak tags compare equal
+    // for GET, so the W/ prefix is ignored.
+    bool etag_matches(const std::string &header, const std::string &etag)
+    {
+        std::size_t pos = 0;
+        while (pos < header.size())
+        {
+            std::size_t next = header.find(',', pos);
+            if (next == std::string::npos)
+            {
+                next = header.size();
+            }
+            std::string candidate = header.substr(pos, next - pos);
+            pos = next + 1;
+
+            const auto begin = candidate.find_first_not_of(" \t");
+            if (begin == std::string::npos)
+            {
+                continue;
+            }
+            candidate = candidate.substr(begin, candidate.find_last_not_of(" \t") - begin + 1);
+            if (candidate == "*")
+            {
+                return true;
+            }
+            if (candidate.compare(0, 2, "W/") == 0)
+            {
+                candidate.erase(0, 2);
+            }
+            if (candidate == etag)
+            {
+                return true;
+            }
+        }
+        return false;
     }
 } // namespace
 
-RestServer::RestServer(const std::string &url, std::string apiToken)
-    : listener(utility::conversions::to_string_t(url)), collector(), api_token_(std::move(apiToken))
+RestServer::RestServer(const std::string &url, MetricsCollector &collector, PayloadCache &payloads, std::string apiToken)
+    : collector(collector), payloads_(payloads), api_token_(std::move(apiToken)), address_("0.0.0.0"), port_(8080),
+      base_path_(), instance_tag_(instance_tag())
 {
-    listener.support(web::http::methods::GET, std::bind(&RestServer::handle_get, this, std::placeholders::_1));
+    parse_endpoint(url, address_, port_, base_path_);
 }
 
-void RestServer::start()
+void RestServer::handle(const HttpRequest &request, HttpResponse &response)
 {
-    try
+    const std::string_view path = request.path;
+    const bool onBase = path == base_path_ || (path.size() == base_path_.size() + 1 && path.back() == '/' &&
+                                               path.compare(0, base_path_.size(), base_path_) == 0);
+    const bool onOpenMetrics = path == base_path_ + "/openmetrics" || path == base_path_ + "/prometheus";
+    const auto route = routes_.find(std::string(path));
+    if (!onBase && !onOpenMetrics && route == routes_.end())
     {
-        listener.open()
-            .then([]
-                  { std::cout << "REST endpoint listening for metrics" << std::endl; })
-            .wait();
-    }
-    catch (const std::exception &ex)
-    {
-        std::cerr << "Failed to start REST listener: " << ex.what() << std::endl;
-        throw;
+        set_error(response, 404, "Not found");
+        return;
     }
-}
 
-void RestServer::handle_get(web::http::http_request request)
-{
     if (!authorize(request))
     {
-        web::http::http_response response(web::http::status_codes::Unauthorized);
-        response.headers().add(web::http::header_names::cache_control, utility::conversions::to_string_t("no-store"));
-        response.headers().add(web::http::header_names::content_type, utility::conversions::to_string_t("application/json"));
-        web::json::value body;
-        body[utility::conversions::to_string_t("error")] = web::json::value::string(utility::conversions::to_string_t("Unauthorized"));
-        response.set_body(body);
-        request.reply(response);
+        set_error(response, 401, "Unauthorized");
         return;
     }
 
-    SystemMetrics m = collector.collect();
+    const bool post = request.method == "POST";
+    if (post && (route == routes_.end() || !route->second.accepts_post))
+    {
+        set_error(response, 405, "Method not allowed");
+        response.headers.emplace_back("Allow", "GET, HEAD");
+        return;
+    }
 
-    std::string scopedTarget;
-    const auto query = web::uri::split_query(request.request_uri().query());
-    auto targetIter = query.find(utility::conversions::to_string_t("target"));
-    if (targetIter != query.end())
+    if (route != routes_.end())
     {
-        scopedTarget = utility::conversions::to_utf8string(targetIter->second);
+        response.headers.emplace_back("Cache-Control", "no-store");
+        route->second.handler(request, response);
+        return;
     }
-    web::json::value response;
-    response[utility::conversions::to_string_t("cpu")] = web::json::value::number(m.cpuUsage);
-    response[utility::conversions::to_string_t("cpuAvg")] = web::json::value::number(m.cpuUsageAverage);
-    response[utility::conversions::to_string_t("memory")] = web::json::value::number(m.memoryUsage);
-    response[utility::conversions::to_string_t("swap")] = web::json::value::number(m.swapUsage);
-    response[utility::conversions::to_string_t("connections")] = web::json::value::number(m.activeConnections);
-    response[utility::conversions::to_string_t("disk")] = web::json::value::number(m.diskUsage);
-    response[utility::conversions::to_string_t("load1")] = web::json::value::number(m.loadAverage1);
-    response[utility::conversions::to_string_t("load5")] = web::json::value::number(m.loadAverage5);
-    response[utility::conversions::to_string_t("load15")] = web::json::value::number(m.loadAverage15);
-    response[utility::conversions::to_string_t("netRx")] = web::json::value::number(m.networkReceiveRate);
-    response[utility::conversions::to_string_t("netTx")] = web::json::value::number(m.networkTransmitRate);
-    response[utility::conversions::to_string_t("netRxAvg")] = web::json::value::number(m.networkReceiveRateAverage);
-    response[utility::conversions::to_string_t("netTxAvg")] = web::json::value::number(m.networkTransmitRateAverage);
-    response[utility::conversions::to_string_t("cpuCores")] = web::json::value::number(m.cpuCount);
-    response[utility::conversions::to_string_t("processes")] = web::json::value::number(m.processCount);
-    response[utility::conversions::to_string_t("threads")] = web::json::value::number(m.threadCount);
-    response[utility::conversions::to_string_t("listeningTcp")] = web::json::value::number(m.listeningTcp);
-    response[utility::conversions::to_string_t("listeningUdp")] = web::json::value::number(m.listeningUdp);
-    response[utility::conversions::to_string_t("openFds")] = web::json::value::number(static_cast<double>(m.openFileDescriptors));
-    response[utility::conversions::to_string_t("uniqueDomains")] = web::json::value::number(static_cast<double>(m.uniqueDomains));
-    response[utility::conversions::to_string_t("dockerAvailable")] = web::json::value::boolean(m.dockerAvailable);
-    response[utility::conversions::to_string_t("timestamp")] = web::json::value::string(utility::conversions::to_string_t(MetricsCollector::to_iso8601(m.timestamp)));
-
-    web::json::value applications = web::json::value::array(m.topApplications.size());
-    for (std::size_t i = 0; i < m.topApplications.size(); ++i)
+
+    const bool openmetrics = onOpenMetrics || wants_openmetrics(request);
+    MetricsSelection selection = MetricsSelection::all();
+    std::string queryError;
+    if (!openmetrics && (!MetricsSelection::parse(request.query_value("fields"), request.query_value("exclude"), selection, queryError) ||
+                         !selection.parse_order(request.query_value("sort"), request.query_value("limit"), queryError)))
     {
-        const auto &app = m.topApplications[i];
-        web::json::value item;
-        item[utility::conversions::to_string_t("pid")] = web::json::value::number(app.pid);
-        item[utility::conversions::to_string_t("name")] = web::json::value::string(utility::conversions::to_string_t(app.name));
-        item[utility::conversions::to_string_t("cpu")] = web::json::value::number(app.cpuPercent);
-        item[utility::conversions::to_string_t("memoryMb")] = web::json::value::number(app.memoryMb);
-        item[utility::conversions::to_string_t("commandLine")] = web::json::value::string(utility::conversions::to_string_t(app.commandLine));
-        applications[i] = std::move(item);
+        set_error(response, 400, queryError);
+        return;
     }
-    response[utility::conversions::to_string_t("applications")] = std::move(applications);
 
-    web::json::value domains = web::json::value::array(m.domainUsage.size());
-    for (std::size_t i = 0; i < m.domainUsage.size(); ++i)
+    const std::string scopedTarget = request.query_value("target");
+    std::vector<TargetQuery> targets;
+    if (!TargetQuery::parse_list(scopedTarget, targets, queryError))
     {
-        const auto &domain = m.domainUsage[i];
-        web::json::value item;
-        item[utility::conversions::to_string_t("domain")] = web::json::value::string(utility::conversions::to_string_t(domain.domain));
-        item[utility::conversions::to_string_t("receiveRate")] = web::json::value::number(domain.receiveRate);
-        item[utility::conversions::to_string_t("transmitRate")] = web::json::value::number(domain.transmitRate);
-        item[utility::conversions::to_string_t("connections")] = web::json::value::number(domain.connections);
-        domains[i] = std::move(item);
+        set_error(response, 400, queryError);
+        return;
     }
-    response[utility::conversions::to_string_t("domains")] = std::move(domains);
 
-    web::json::value dockerContainers = web::json::value::array(m.dockerContainers.size());
-    for (std::size_t i = 0; i < m.dockerContainers.size(); ++i)
+    SnapshotQuery query;
+    query.sections = openmetrics ? SECTION_ALL : selection.sections();
+    if (!targets.empty())
     {
-        const auto &container = m.dockerContainers[i];
-        web::json::value item;
-        item[utility::conversions::to_string_t("id")] = web::json::value::string(utility::conversions::to_string_t(container.id));
-        item[utility::conversions::to_string_t("name")] = web::json::value::string(utility::conversions::to_string_t(container.name));
-        item[utility::conversions::to_string_t("image")] = web::json::value::string(utility::conversions::to_string_t(container.image));
-        item[utility::conversions::to_string_t("status")] = web::json::value::string(utility::conversions::to_string_t(container.status));
-        item[utility::conversions::to_string_t("cpu")] = web::json::value::number(container.cpuPercent);
-        item[utility::conversions::to_string_t("memoryMb")] = web::json::value::number(container.memoryUsageMb);
-        item[utility::conversions::to_string_t("memoryLimitMb")] = web::json::value::number(container.memoryLimitMb);
-        item[utility::conversions::to_string_t("memoryPercent")] = web::json::value::number(container.memoryPercent);
-        item[utility::conversions::to_string_t("netRxKb")] = web::json::value::number(container.networkRxKb);
-        item[utility::conversions::to_string_t("netTxKb")] = web::json::value::number(container.networkTxKb);
-        item[utility::conversions::to_string_t("blockReadKb")] = web::json::value::number(container.blockReadKb);
-        item[utility::conversions::to_string_t("blockWriteKb")] = web::json::value::number(container.blockWriteKb);
-        item[utility::conversions::to_string_t("pids")] = web::json::value::number(static_cast<double>(container.pids));
-        dockerContainers[i] = std::move(item);
+        query.sections |= SECTION_APPLICATIONS | SECTION_DOCKER;
     }
-    response[utility::conversions::to_string_t("dockerContainers")] = std::move(dockerContainers);
+    query.openmetrics = openmetrics;
+    query.selection = std::move(selection);
+    query.targets = std::move(targets);
+    query.scoped_target = scopedTarget;
+    query.if_none_match = std::string(request.header("if-none-match"));
 
-    web::json::value dockerImages = web::json::value::array(m.dockerImages.size());
-    for (std::size_t i = 0; i < m.dockerImages.size(); ++i)
+    // Handlers run on the shared I/O threads and never block there: when the snapshot lacks sections nobody
+    // asked for within the demand window, the wait for the collecting thread to add them moves to the
+    // blocking pool. Past that the snapshot is served as it is, with the sections it still lacks named in a header.
+    std::shared_ptr<const SystemMetrics> snapshot = collector.latest(query.sections);
+    if ((snapshot->sections & query.sections) != query.sections)
     {
-        const auto &image = m.dockerImages[i];
-        web::json::value item;
-        item[utility::conversions::to_string_t("repository")] = web::json::value::string(utility::conversions::to_string_t(image.repository));
-        item[utility::conversions::to_string_t("tag")] = web::json::value::string(utility::conversions::to_string_t(image.tag));
-        item[utility::conversions::to_string_t("id")] = web::json::value::string(utility::conversions::to_string_t(image.id));
-        item[utility::conversions::to_string_t("size")] = web::json::value::string(utility::conversions::to_string_t(image.size));
-        dockerImages[i] = std::move(item);
+        response.deferred = [this, query = std::move(query)](HttpResponse &out)
+        {
+            serve_snapshot(collector.latest(query.sections, SECTION_WAIT), query, out, false);
+        };
+        return;
     }
-    response[utility::conversions::to_string_t("dockerImages")] = std::move(dockerImages);
+    serve_snapshot(snapshot, query, response, true);
+}
 
-    if (!scopedTarget.empty())
+void RestServer::serve_snapshot(const std::shared_ptr<const SystemMetrics> &snapshot, const SnapshotQuery &query, HttpResponse &response,
+                                bool onIoThread)
+{
+    const unsigned int missing = query.sections & ~snapshot->sections;
+    if (missing != 0)
     {
-        web::json::value scoped = web::json::value::object();
-        scoped[utility::conversions::to_string_t("target")] = web::json::value::string(utility::conversions::to_string_t(scopedTarget));
+        response.headers.emplace_back("X-Missing-Sections", section_names(missing));
+    }
 
-        double processCpu = 0.0;
-        double processMemory = 0.0;
-        std::vector<web::json::value> processEntries;
-        for (const auto &app : m.topApplications)
-        {
-            if (icontains(app.name, scopedTarget) || icontains(app.commandLine, scopedTarget))
-            {
-                web::json::value entry;
-                entry[utility::conversions::to_string_t("pid")] = web::json::value::number(app.pid);
-                entry[utility::conversions::to_string_t("name")] = web::json::value::string(utility::conversions::to_string_t(app.name));
-                entry[utility::conversions::to_string_t("commandLine")] = web::json::value::string(utility::conversions::to_string_t(app.commandLine));
-                entry[utility::conversions::to_string_t("cpu")] = web::json::value::number(app.cpuPercent);
-                entry[utility::conversions::to_string_t("memoryMb")] = web::json::value::number(app.memoryMb);
-                processEntries.push_back(std::move(entry));
-                processCpu += app.cpuPercent;
-                processMemory += app.memoryMb;
-            }
-        }
+    // Revalidation only needs the snapshot version: answer a matching If-None-Match before anything is serialised.
+    const unsigned long long current = snapshot->sequence;
+    const bool openmetrics = query.openmetrics;
+    response.headers.emplace_back("Cache-Control", "no-cache");
+    response.headers.emplace_back("Vary", "Accept");
 
-        if (!processEntries.empty())
-        {
-            web::json::value processObject;
-            processObject[utility::conversions::to_string_t("count")] = web::json::value::number(static_cast<double>(processEntries.size()));
-            processObject[utility::conversions::to_string_t("cpuTotal")] = web::json::value::number(processCpu);
-            processObject[utility::conversions::to_string_t("memoryTotalMb")] = web::json::value::number(processMemory);
-            web::json::value processArray = web::json::value::array(processEntries.size());
-            for (std::size_t i = 0; i < processEntries.size(); ++i)
-            {
-                processArray[i] = std::move(processEntries[i]);
-            }
-            processObject[utility::conversions::to_string_t("entries")] = std::move(processArray);
-            scoped[utility::conversions::to_string_t("processes")] = std::move(processObject);
-        }
+    if (!query.if_none_match.empty() && etag_matches(query.if_none_match, make_etag(instance_tag_, current, openmetrics)))
+    {
+        response.status = 304;
+        response.headers.emplace_back("ETag", make_etag(instance_tag_, current, openmetrics));
+        return;
+    }
 
-        double containerCpu = 0.0;
-        double containerMemory = 0.0;
-        double containerMemoryLimit = 0.0;
-        double containerNetRx = 0.0;
-        double containerNetTx = 0.0;
-        double containerBlockRead = 0.0;
-        double containerBlockWrite = 0.0;
-        std::vector<web::json::value> containerEntries;
-        for (const auto &container : m.dockerContainers)
+    const std::string variant = openmetrics ? std::string("openmetrics") : query.selection.key() + '|' + query.scoped_target;
+    std::shared_ptr<const std::string> body = payloads_.find(current, variant);
+    if (body || openmetrics)
+    {
+        if (!body)
         {
-            if (icontains(container.name, scopedTarget) || icontains(container.id, scopedTarget) || icontains(container.image, scopedTarget))
-            {
-                web::json::value entry;
-                entry[utility::conversions::to_string_t("id")] = web::json::value::string(utility::conversions::to_string_t(container.id));
-                entry[utility::conversions::to_string_t("name")] = web::json::value::string(utility::conversions::to_string_t(container.name));
-                entry[utility::conversions::to_string_t("image")] = web::json::value::string(utility::conversions::to_string_t(container.image));
-                entry[utility::conversions::to_string_t("status")] = web::json::value::string(utility::conversions::to_string_t(container.status));
-                entry[utility::conversions::to_string_t("cpu")] = web::json::value::number(container.cpuPercent);
-                entry[utility::conversions::to_string_t("memoryMb")] = web::json::value::number(container.memoryUsageMb);
-                entry[utility::conversions::to_string_t("memoryLimitMb")] = web::json::value::number(container.memoryLimitMb);
-                entry[utility::conversions::to_string_t("memoryPercent")] = web::json::value::number(container.memoryPercent);
-                entry[utility::conversions::to_string_t("netRxKb")] = web::json::value::number(container.networkRxKb);
-                entry[utility::conversions::to_string_t("netTxKb")] = web::json::value::number(container.networkTxKb);
-                entry[utility::conversions::to_string_t("blockReadKb")] = web::json::value::number(container.blockReadKb);
-                entry[utility::conversions::to_string_t("blockWriteKb")] = web::json::value::number(container.blockWriteKb);
-                entry[utility::conversions::to_string_t("pids")] = web::json::value::number(static_cast<double>(container.pids));
-                containerEntries.push_back(std::move(entry));
-
-                containerCpu += container.cpuPercent;
-                containerMemory += container.memoryUsageMb;
-                containerMemoryLimit += container.memoryLimitMb;
-                containerNetRx += container.networkRxKb;
-                containerNetTx += container.networkTxKb;
-                containerBlockRead += container.blockReadKb;
-                containerBlockWrite += container.blockWriteKb;
-            }
+            body = payloads_.store(current, variant, openmetrics_.render(*snapshot));
         }
+        response.headers.emplace_back("ETag", make_etag(instance_tag_, current, openmetrics));
+        response.set_body(std::move(body), openmetrics ? "application/openmetrics-text; version=1.0.0; charset=utf-8" : "application/json");
+        return;
+    }
 
-        if (!containerEntries.empty())
+    // A scoped render may build the snapshot's target index and run an expression over every name and
+    // command line, so it leaves the I/O thread.
+    const bool scoped = !query.targets.empty() && snapshot->targetIndex;
+    auto render = [this, snapshot, scoped, variant](const SnapshotQuery &query, HttpResponse &out)
+    {
+        TargetIndex::Matches matches;
+        if (scoped)
         {
-            web::json::value containerObject;
-            containerObject[utility::conversions::to_string_t("count")] = web::json::value::number(static_cast<double>(containerEntries.size()));
-            containerObject[utility::conversions::to_string_t("cpuTotal")] = web::json::value::number(containerCpu);
-            containerObject[utility::conversions::to_string_t("memoryTotalMb")] = web::json::value::number(containerMemory);
-            containerObject[utility::conversions::to_string_t("memoryLimitMb")] = web::json::value::number(containerMemoryLimit);
-            containerObject[utility::conversions::to_string_t("netRxTotalKb")] = web::json::value::number(containerNetRx);
-            containerObject[utility::conversions::to_string_t("netTxTotalKb")] = web::json::value::number(containerNetTx);
-            containerObject[utility::conversions::to_string_t("blockReadTotalKb")] = web::json::value::number(containerBlockRead);
-            containerObject[utility::conversions::to_string_t("blockWriteTotalKb")] = web::json::value::number(containerBlockWrite);
-            web::json::value containerArray = web::json::value::array(containerEntries.size());
-            for (std::size_t i = 0; i < containerEntries.size(); ++i)
+            matches = snapshot->targetIndex->match(*snapshot, query.targets);
+            if (matches.budget_exhausted)
             {
-                containerArray[i] = std::move(containerEntries[i]);
+                set_error(out, 400, "Target expression needs more matching steps than one query may use on this snapshot; "
+                                    "narrow it or use substring and prefix: terms");
+                return;
             }
-            containerObject[utility::conversions::to_string_t("entries")] = std::move(containerArray);
-            scoped[utility::conversions::to_string_t("containers")] = std::move(containerObject);
         }
+        out.headers.emplace_back("ETag", make_etag(instance_tag_, snapshot->sequence, false));
+        out.set_body(payloads_.store(snapshot->sequence, variant,
+                                     encode_json(*snapshot, query.selection, scoped ? &matches : nullptr, query.scoped_target)),
+                     "application/json");
+    };
 
-        if (scoped.has_field(utility::conversions::to_string_t("processes")) || scoped.has_field(utility::conversions::to_string_t("containers")))
-        {
-            response[utility::conversions::to_string_t("scopedMetrics")] = std::move(scoped);
-        }
+    if (!scoped || !onIoThread)
+    {
+        render(query, response);
+        return;
     }
+    response.deferred = [render = std::move(render), query](HttpResponse &out)
+    {
+        render(query, out);
+    };
+}
 
-    web::http::http_response httpResponse(web::http::status_codes::OK);
-    httpResponse.headers().add(web::http::header_names::cache_control, utility::conversions::to_string_t("no-store"));
-    httpResponse.headers().add(web::http::header_names::content_type, utility::conversions::to_string_t("application/json"));
-    httpResponse.set_body(response);
-    request.reply(httpResponse);
+void RestServer::add_route(const std::string &path, RouteHandler handler, bool acceptsPost)
+{
+    routes_[path] = Route{std::move(handler), acceptsPost};
 }
 
-bool RestServer::authorize(const web::http::http_request &request) const
+bool RestServer::wants_openmetrics(const HttpRequest &request) const
+{
+    // Scrapers negotiating OpenMetrics on the JSON route get the exposition too. The Prometheus 0.0.4 text
+    // format is not offered: it has no info type, "_total" counter samples or "# EOF".
+    const std::string accept = to_lower_copy(std::string(request.header("accept")));
+    return accept.find("application/openmetrics-text") != std::string::npos;
+}
+
+bool RestServer::authorize(const HttpRequest &request) const
 {
     if (api_token_.empty())
     {
         return true;
     }
 
-    const auto &headers = request.headers();
-    auto authIter = headers.find(web::http::header_names::authorization);
-    if (authIter == headers.end())
-    {
-        return false;
-    }
-
-    const std::string headerValue = utility::conversions::to_utf8string(authIter->second);
-    constexpr char prefix[] = "Bearer ";
-    if (headerValue.compare(0, sizeof(prefix) - 1, prefix) != 0)
+    const std::string_view headerValue = request.header("authorization");
+    constexpr std::string_view prefix = "Bearer ";
+    if (headerValue.compare(0, prefix.size(), prefix) != 0)
     {
         return false;
     }
 
-    const std::string token = headerValue.substr(sizeof(prefix) - 1);
+    const std::string token(headerValue.substr(prefix.size()));
     return security::tokens_equal(token, api_token_);
 }
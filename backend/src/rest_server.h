@@ -1,17 +1,63 @@
 #pragma once
+#include "http_server.h"
+#include "metrics_selection.h"
+#include "openmetrics.h"
+#include "payload_cache.h"
 #include "system_metrics.h"
-#include <cpprest/http_listener.h>
+#include "target_index.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
+// Serves /metrics (JSON), /metrics/openmetrics and any registered routes on the shared HttpServer.
 class RestServer
 {
 public:
-    RestServer(const std::string &url, std::string apiToken = {});
-    void start();
+    using RouteHandler = std::function<void(const HttpRequest &, HttpResponse &)>;
+
+    RestServer(const std::string &url, MetricsCollector &collector, PayloadCache &payloads, std::string apiToken = {});
+
+    void handle(const HttpRequest &request, HttpResponse &response);
+    // Registers an extra GET route (absolute path) behind the same token check. Call before serving.
+    // Routes with state-changing actions also accept POST and check request.method themselves.
+    void add_route(const std::string &path, RouteHandler handler, bool acceptsPost = false);
+
+    // Listening address and port taken from the configured endpoint URL.
+    const std::string &address() const { return address_; }
+    unsigned short port() const { return port_; }
 
 private:
-    web::http::experimental::listener::http_listener listener;
-    MetricsCollector collector;
+    MetricsCollector &collector;
+    PayloadCache &payloads_;
     std::string api_token_;
-    bool authorize(const web::http::http_request &request) const;
-    void handle_get(web::http::http_request request);
+    std::string address_;
+    unsigned short port_;
+    std::string base_path_;
+    std::string instance_tag_;
+    OpenMetricsRenderer openmetrics_;
+    struct Route
+    {
+        RouteHandler handler;
+        bool accepts_post;
+    };
+
+    // What a /metrics request asked for, kept apart from the request so the response can be finished off the I/O thread.
+    struct SnapshotQuery
+    {
+        unsigned int sections = 0;
+        bool openmetrics = false;
+        MetricsSelection selection;
+        std::vector<TargetQuery> targets;
+        std::string scoped_target;
+        std::string if_none_match;
+    };
+
+    std::unordered_map<std::string, Route> routes_;
+    // Answers from `snapshot`; a scoped render is deferred to the blocking pool when still on an I/O thread.
+    void serve_snapshot(const std::shared_ptr<const SystemMetrics> &snapshot, const SnapshotQuery &query, HttpResponse &response,
+                        bool onIoThread);
+    bool authorize(const HttpRequest &request) const;
+    bool wants_openmetrics(const HttpRequest &request) const;
 };
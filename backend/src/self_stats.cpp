@@ -0,0 +1,366 @@
+#include "self_stats.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t STAGE_COUNT = static_cast<std::size_t>(CollectorStage::Count);
+    constexpr std::size_t TIMER_COUNT = static_cast<std::size_t>(self_stats::Timer::Count);
+    constexpr std::size_t HISTOGRAM_COUNT = STAGE_COUNT + TIMER_COUNT;
+    constexpr std::size_t COUNTER_COUNT = static_cast<std::size_t>(self_stats::Counter::Count);
+
+    constexpr unsigned int SUB_BUCKET_BITS = 4;
+    constexpr std::size_t SUB_BUCKETS = std::size_t{1} << SUB_BUCKET_BITS;
+    constexpr unsigned int MAX_EXPONENT = 36; // 2^36 ns is about 68.7 s; longer values share the last bucket
+    constexpr std::size_t BUCKETS = SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+    constexpr std::size_t ALLOCATION_SLOTS = 16;
+
+    constexpr const char *TIMER_NAMES[] = {"collection", "httpRequest", "jsonEncode", "openMetricsEncode", "webSocketWrite"};
+    constexpr const char *COUNTER_NAMES[] = {"httpRequests", "httpBytesSent", "webSocketFrames", "webSocketBytesSent",
+                                             "processDetailProbes"};
+    static_assert(std::size(TIMER_NAMES) == TIMER_COUNT, "one name per timer");
+    static_assert(std::size(COUNTER_NAMES) == COUNTER_COUNT, "one name per counter");
+
+    const auto PROCESS_START = std::chrono::steady_clock::now();
+
+    // Values below 16 ns get a bucket each; above that, 16 buckets per power of two.
+    std::size_t bucket_index(unsigned long long value)
+    {
+        if (value < SUB_BUCKETS)
+        {
+            return static_cast<std::size_t>(value);
+        }
+        const unsigned int exponent = 63U - static_cast<unsigned int>(__builtin_clzll(value));
+        if (exponent >= MAX_EXPONENT)
+        {
+            return BUCKETS - 1;
+        }
+        const unsigned int shift = exponent - SUB_BUCKET_BITS;
+        return SUB_BUCKETS + (exponent - SUB_BUCKET_BITS) * SUB_BUCKETS + static_cast<std::size_t>((value >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    // Midpoint of a bucket, the value reported for every sample that fell into it.
+    double bucket_value(std::size_t index)
+    {
+        if (index < SUB_BUCKETS)
+        {
+            return static_cast<double>(index);
+        }
+        const std::size_t offset = index - SUB_BUCKETS;
+        const unsigned int shift = static_cast<unsigned int>(offset / SUB_BUCKETS);
+        const unsigned long long low = (SUB_BUCKETS + offset % SUB_BUCKETS) << shift;
+        return static_cast<double>(low) + static_cast<double>(1ULL << shift) / 2.0;
+    }
+
+    // Only the owning thread writes a shard, so updates are a relaxed load and store rather than a
+    // locked read-modify-write; readers on other threads may see a slightly stale value.
+    void bump(std::atomic<unsigned long long> &value, unsigned long long amount)
+    {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    struct Histogram
+    {
+        std::array<std::atomic<unsigned long long>, BUCKETS> buckets{};
+        std::atomic<unsigned long long> count{0};
+        std::atomic<unsigned long long> sum{0};
+        std::atomic<unsigned long long> max{0};
+    };
+
+    struct Shard
+    {
+        // Histograms are allocated the first time the owning thread records into them.
+        std::array<std::atomic<Histogram *>, HISTOGRAM_COUNT> histograms{};
+        std::array<std::atomic<unsigned long long>, COUNTER_COUNT> counters{};
+        bool in_use = false; // guarded by Registry::mutex
+    };
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Shard>> shards;
+    };
+
+    // Never destroyed: threads may still record while static destructors run.
+    Registry &registry()
+    {
+        static Registry *instance = new Registry();
+        return *instance;
+    }
+
+    struct ShardLease
+    {
+        Shard *shard = nullptr;
+
+        ~ShardLease()
+        {
+            if (shard != nullptr)
+            {
+                std::lock_guard<std::mutex> lock(registry().mutex);
+                shard->in_use = false;
+            }
+        }
+    };
+
+    thread_local ShardLease lease;
+
+    Shard &local_shard()
+    {
+        if (lease.shard == nullptr)
+        {
+            Registry &shared = registry();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            for (const auto &shard : shared.shards)
+            {
+                if (!shard->in_use)
+                {
+                    lease.shard = shard.get();
+                    break;
+                }
+            }
+            if (lease.shard == nullptr)
+            {
+                shared.shards.push_back(std::make_unique<Shard>());
+                lease.shard = shared.shards.back().get();
+            }
+            lease.shard->in_use = true;
+        }
+        return *lease.shard;
+    }
+
+    void record_histogram(std::size_t index, std::chrono::nanoseconds elapsed)
+    {
+        const unsigned long long value = static_cast<unsigned long long>(std::max<long long>(0, elapsed.count()));
+        Shard &shard = local_shard();
+        Histogram *histogram = shard.histograms[index].load(std::memory_order_acquire);
+        if (histogram == nullptr)
+        {
+            histogram = new Histogram();
+            shard.histograms[index].store(histogram, std::memory_order_release);
+        }
+        bump(histogram->buckets[bucket_index(value)], 1);
+        bump(histogram->count, 1);
+        bump(histogram->sum, value);
+        if (value > histogram->max.load(std::memory_order_relaxed))
+        {
+            histogram->max.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    self_stats::Summary summarize(std::size_t index)
+    {
+        std::array<unsigned long long, BUCKETS> buckets{};
+        unsigned long long count = 0;
+        unsigned long long sum = 0;
+        unsigned long long max = 0;
+        {
+            Registry &shared = registry();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            for (const auto &shard : shared.shards)
+            {
+                const Histogram *histogram = shard->histograms[index].load(std::memory_order_acquire);
+                if (histogram == nullptr)
+                {
+                    continue;
+                }
+                for (std::size_t i = 0; i < BUCKETS; ++i)
+                {
+                    buckets[i] += histogram->buckets[i].load(std::memory_order_relaxed);
+                }
+                count += histogram->count.load(std::memory_order_relaxed);
+                sum += histogram->sum.load(std::memory_order_relaxed);
+                max = std::max(max, histogram->max.load(std::memory_order_relaxed));
+            }
+        }
+
+        self_stats::Summary summary{};
+        // Bucket totals are the ground truth; the separate count may run a sample ahead or behind.
+        unsigned long long total = 0;
+        for (const unsigned long long bucket : buckets)
+        {
+            total += bucket;
+        }
+        summary.count = count;
+        if (total == 0)
+        {
+            return summary;
+        }
+
+        const double maxNs = static_cast<double>(max);
+        const auto quantile = [&buckets, total, maxNs](double q)
+        {
+            const auto rank = static_cast<unsigned long long>(q * static_cast<double>(total - 1)) + 1;
+            unsigned long long seen = 0;
+            for (std::size_t i = 0; i < BUCKETS; ++i)
+            {
+                seen += buckets[i];
+                if (seen >= rank)
+                {
+                    return std::min(bucket_value(i), maxNs) / 1000.0;
+                }
+            }
+            return maxNs / 1000.0;
+        };
+        summary.meanUs = count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count) / 1000.0;
+        summary.p50Us = quantile(0.50);
+        summary.p90Us = quantile(0.90);
+        summary.p99Us = quantile(0.99);
+        summary.p999Us = quantile(0.999);
+        summary.maxUs = maxNs / 1000.0;
+        return summary;
+    }
+
+    nlohmann::json summary_to_json(const self_stats::Summary &summary)
+    {
+        return {
+            {"count", summary.count},
+            {"meanUs", summary.meanUs},
+            {"p50Us", summary.p50Us},
+            {"p90Us", summary.p90Us},
+            {"p99Us", summary.p99Us},
+            {"p999Us", summary.p999Us},
+            {"maxUs", summary.maxUs}};
+    }
+
+    // Allocation counting runs inside operator new, so it must not allocate or touch the shards (whose
+    // first use allocates). Threads spread over padded slots picked once per thread.
+    struct alignas(64) AllocationSlot
+    {
+        std::atomic<unsigned long long> value;
+    };
+
+    AllocationSlot allocation_slots[ALLOCATION_SLOTS];
+    std::atomic<unsigned int> next_allocation_slot(0);
+    std::atomic<bool> allocation_tracking(false);
+    thread_local unsigned int allocation_slot = ALLOCATION_SLOTS;
+
+} // namespace
+
+namespace self_stats
+{
+    void record(Timer timer, std::chrono::nanoseconds elapsed)
+    {
+        record_histogram(STAGE_COUNT + static_cast<std::size_t>(timer), elapsed);
+    }
+
+    void record(CollectorStage stage, std::chrono::nanoseconds elapsed)
+    {
+        record_histogram(static_cast<std::size_t>(stage), elapsed);
+    }
+
+    void add(Counter counter, unsigned long long amount)
+    {
+        bump(local_shard().counters[static_cast<std::size_t>(counter)], amount);
+    }
+
+    Summary summary(Timer timer)
+    {
+        return summarize(STAGE_COUNT + static_cast<std::size_t>(timer));
+    }
+
+    Summary summary(CollectorStage stage)
+    {
+        return summarize(static_cast<std::size_t>(stage));
+    }
+
+    unsigned long long total(Counter counter)
+    {
+        Registry &shared = registry();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        unsigned long long sum = 0;
+        for (const auto &shard : shared.shards)
+        {
+            sum += shard->counters[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    void count_allocation() noexcept
+    {
+        if (allocation_slot == ALLOCATION_SLOTS)
+        {
+            allocation_slot = next_allocation_slot.fetch_add(1, std::memory_order_relaxed) % ALLOCATION_SLOTS;
+        }
+        allocation_slots[allocation_slot].value.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void enable_allocation_tracking() noexcept
+    {
+        allocation_tracking.store(true, std::memory_order_relaxed);
+    }
+
+    bool allocations_tracked()
+    {
+        return allocation_tracking.load(std::memory_order_relaxed);
+    }
+
+    unsigned long long allocations()
+    {
+        unsigned long long sum = 0;
+        for (const auto &slot : allocation_slots)
+        {
+            sum += slot.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    Syscalls syscalls()
+    {
+        Syscalls result{};
+        std::ifstream io("/proc/self/io");
+        std::string key;
+        unsigned long long value = 0;
+        while (io >> key >> value)
+        {
+            if (key == "syscr:")
+            {
+                result.reads = value;
+            }
+            else if (key == "syscw:")
+            {
+                result.writes = value;
+            }
+        }
+        return result;
+    }
+
+    nlohmann::json report()
+    {
+        nlohmann::json collector = nlohmann::json::object();
+        for (std::size_t i = 0; i < STAGE_COUNT; ++i)
+        {
+            const auto stage = static_cast<CollectorStage>(i);
+            collector[collector_stage_name(stage)] = summary_to_json(summary(stage));
+        }
+
+        nlohmann::json timers = nlohmann::json::object();
+        for (std::size_t i = 0; i < TIMER_COUNT; ++i)
+        {
+            timers[TIMER_NAMES[i]] = summary_to_json(summary(static_cast<Timer>(i)));
+        }
+
+        nlohmann::json counters = nlohmann::json::object();
+        for (std::size_t i = 0; i < COUNTER_COUNT; ++i)
+        {
+            counters[COUNTER_NAMES[i]] = total(static_cast<Counter>(i));
+        }
+        const Syscalls calls = syscalls();
+        counters["readSyscalls"] = calls.reads;
+        counters["writeSyscalls"] = calls.writes;
+        counters["allocations"] = allocations_tracked() ? nlohmann::json(allocations()) : nlohmann::json(nullptr);
+
+        return {
+            {"uptimeSeconds", std::chrono::duration<double>(std::chrono::steady_clock::now() - PROCESS_START).count()},
+            {"collectorStages", std::move(collector)},
+            {"timers", std::move(timers)},
+            {"counters", std::move(counters)}};
+    }
+} // namespace self_stats
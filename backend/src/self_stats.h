@@ -0,0 +1,91 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <nlohmann/json.hpp>
+
+#include "system_metrics.h"
+
+// Instrumentation of the agent's own work: latency histograms for every collector stage, request,
+// serialisation and WebSocket write, plus traffic and allocation counters.
+//
+// Histograms are log-linear in the style of HdrHistogram: 16 sub-buckets per power of two from 1 ns
+// to ~68 s, so every quantile is reported within about 6% of the recorded value. Each thread records
+// into its own shard with plain loads and stores (no locked instructions); readers merge the shards.
+// Shards of exited threads are handed to new threads, so counts are never lost and memory is bounded
+// by the peak number of threads.
+namespace self_stats
+{
+    enum class Timer : std::size_t
+    {
+        Collection,        // one full collector refresh, all stages included
+        HttpRequest,       // REST handler, from parsed request to response ready
+        JsonEncode,        // JSON metrics payload, scoped blocks included
+        OpenMetricsEncode, // OpenMetrics exposition
+        WebSocketWrite,    // one WebSocket frame, from async_write to completion
+        Count
+    };
+
+    enum class Counter : std::size_t
+    {
+        HttpRequests,
+        HttpBytesSent,
+        WebSocketFrames,
+        WebSocketBytesSent,
+        ProcessDetailProbes, // smaps_rollup, fd and cgroup reads of the detail scanner
+        Count
+    };
+
+    struct Summary
+    {
+        unsigned long long count;
+        double meanUs;
+        double p50Us;
+        double p90Us;
+        double p99Us;
+        double p999Us;
+        double maxUs;
+    };
+
+    // read(2)/write(2)-family system calls of the whole process, from /proc/self/io (syscr/syscw). Socket
+    // sendmsg/recvmsg calls are not part of these kernel counters.
+    struct Syscalls
+    {
+        unsigned long long reads;
+        unsigned long long writes;
+    };
+
+    void record(Timer timer, std::chrono::nanoseconds elapsed);
+    void record(CollectorStage stage, std::chrono::nanoseconds elapsed);
+    void add(Counter counter, unsigned long long amount = 1);
+
+    Summary summary(Timer timer);
+    Summary summary(CollectorStage stage);
+    unsigned long long total(Counter counter);
+
+    // Heap allocations are counted by the replacement operator new in allocation_counter.cpp, which
+    // only the server binary links; elsewhere allocations() stays 0 and allocations_tracked() false.
+    void count_allocation() noexcept;
+    void enable_allocation_tracking() noexcept;
+    bool allocations_tracked();
+    unsigned long long allocations();
+
+    Syscalls syscalls();
+
+    // Everything above as the /debug/stats document.
+    nlohmann::json report();
+
+    // Records the lifetime of the scope into `timer`.
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(Timer timer) : timer_(timer), start_(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() { record(timer_, std::chrono::steady_clock::now() - start_); }
+
+        ScopedTimer(const ScopedTimer &) = delete;
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    private:
+        Timer timer_;
+        std::chrono::steady_clock::time_point start_;
+    };
+} // namespace self_stats
@@ -1,9 +1,14 @@
 #include "server_config.h"
+#include "trace_recorder.h"
 
+#include <algorithm>
+#include <cctype>
 #include <cstdlib>
 #include <iostream>
 #include <limits>
 #include <stdexcept>
+#include <thread>
+#include <unistd.h>
 
 namespace
 {
@@ -32,8 +37,9 @@ namespace
         }
     }
 
-    std::size_t parse_limit(const char *raw, std::size_t fallback, std::size_t min_value, std::size_t max_value)
+    std::size_t parse_limit(const char *name, std::size_t fallback, std::size_t min_value, std::size_t max_value)
     {
+        const char *raw = std::getenv(name);
         if (raw == nullptr || *raw == '\0')
         {
             return fallback;
@@ -54,12 +60,40 @@ namespace
         }
         catch (const std::exception &ex)
         {
-            std::cerr << "Invalid MONITORING_WS_MAX_CLIENTS value ('" << raw << "'): " << ex.what()
+            std::cerr << "Invalid " << name << " value ('" << raw << "'): " << ex.what()
                       << ". Falling back to " << fallback << std::endl;
             return fallback;
         }
     }
 
+    std::string read_string(const char *name, const std::string &fallback = {})
+    {
+        const char *raw = std::getenv(name);
+        if (raw == nullptr || *raw == '\0')
+        {
+            return fallback;
+        }
+        return raw;
+    }
+
+    bool read_flag(const char *name)
+    {
+        std::string value = read_string(name);
+        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch)
+                       { return static_cast<char>(std::tolower(ch)); });
+        return value == "1" || value == "true" || value == "yes" || value == "on";
+    }
+
+    std::string local_host_name()
+    {
+        char buffer[256] = {};
+        if (gethostname(buffer, sizeof(buffer) - 1) != 0 || buffer[0] == '\0')
+        {
+            return "localhost";
+        }
+        return buffer;
+    }
+
 } // namespace
 
 ServerConfig load_server_config()
@@ -85,7 +119,49 @@ ServerConfig load_server_config()
     }
 
     config.websocket_port = parse_port(std::getenv("MONITORING_WS_PORT"), 9002);
-    config.max_sessions = parse_limit(std::getenv("MONITORING_WS_MAX_CLIENTS"), 32, 1, 4096);
+    config.max_sessions = parse_limit("MONITORING_WS_MAX_CLIENTS", 32, 1, 4096);
+    config.ws_slow_consumer_ms = parse_limit("MONITORING_WS_SLOW_CONSUMER_MS", 10000, 1000, 300000);
+    const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    config.http_threads = parse_limit("MONITORING_HTTP_THREADS", std::min<std::size_t>(4, std::max<std::size_t>(2, cores)), 1, 64);
+    config.host_name = read_string("MONITORING_HOST_NAME", local_host_name());
+    config.proc_root = read_string("MONITORING_PROC_ROOT", "/proc");
+    config.sys_root = read_string("MONITORING_SYS_ROOT", "/sys");
+    config.collector_threads = parse_limit("MONITORING_COLLECTOR_THREADS", std::min<std::size_t>(4, std::max<std::size_t>(2, cores)), 1, 16);
+    config.proc_io_uring = read_flag("MONITORING_PROC_IO_URING");
+    config.process_events = read_flag("MONITORING_PROCESS_EVENTS");
+    config.process_rescan_seconds = parse_limit("MONITORING_PROCESS_RESCAN_SECONDS", 30, 5, 3600);
+    config.detail_budget_us = parse_limit("MONITORING_DETAIL_BUDGET_US", 2000, 0, 1000000);
+    config.detail_syscalls = parse_limit("MONITORING_DETAIL_SYSCALLS", 256, 0, 100000);
+    config.detail_top_k = parse_limit("MONITORING_DETAIL_TOP_K", 10, 0, 1000);
+    config.collector_cpu_percent = parse_limit("MONITORING_COLLECTOR_CPU_PERCENT", 5, 0, 100);
+    config.pressure_trigger_ms = parse_limit("MONITORING_PSI_TRIGGER_MS", 0, 0, 10000);
+    config.pressure_window_ms = parse_limit("MONITORING_PSI_WINDOW_MS", 2000, 500, 10000);
+
+    config.influx_url = read_string("MONITORING_INFLUX_URL");
+    config.influx_org = read_string("MONITORING_INFLUX_ORG");
+    config.influx_bucket = read_string("MONITORING_INFLUX_BUCKET", "server_metrics");
+    config.influx_token = read_string("MONITORING_INFLUX_TOKEN");
+    config.influx_batch_bytes = parse_limit("MONITORING_INFLUX_BATCH_BYTES", 256 * 1024, 4 * 1024, 16 * 1024 * 1024);
+    config.influx_flush_interval_ms = parse_limit("MONITORING_INFLUX_FLUSH_MS", 5000, 100, 300000);
+    config.influx_retry_batches = parse_limit("MONITORING_INFLUX_RETRY_BATCHES", 64, 1, 100000);
+    config.influx_spool_dir = read_string("MONITORING_INFLUX_SPOOL_DIR");
+    config.influx_spool_max_bytes = parse_limit("MONITORING_INFLUX_SPOOL_MAX_BYTES", 64 * 1024 * 1024, 0, std::numeric_limits<std::size_t>::max());
+    config.influx_timeout_ms = parse_limit("MONITORING_INFLUX_TIMEOUT_MS", 10000, 100, 300000);
+
+    config.alert_rules_path = read_string("MONITORING_ALERT_RULES");
+    config.alert_interval_ms = parse_limit("MONITORING_ALERT_INTERVAL_MS", 1000, 0, 3600000);
+
+    config.push_url = read_string("MONITORING_PUSH_URL");
+    config.push_token = read_string("MONITORING_PUSH_TOKEN");
+    config.push_interval_ms = parse_limit("MONITORING_PUSH_INTERVAL_MS", 1000, 100, 60000);
+    config.aggregator = read_flag("MONITORING_AGGREGATOR");
+    config.fleet_history = parse_limit("MONITORING_FLEET_HISTORY", 300, 1, 100000);
+    config.fleet_stale_ms = parse_limit("MONITORING_FLEET_STALE_MS", 10000, 1000, 3600000);
+    config.fleet_retention_ms = parse_limit("MONITORING_FLEET_RETENTION_MS", 3600000, 10000, 604800000);
+    config.fleet_max_agents = parse_limit("MONITORING_FLEET_MAX_AGENTS", 1024, 1, 65536);
+    config.trace_on_start = read_flag("MONITORING_TRACE");
+    config.trace_events = parse_limit("MONITORING_TRACE_EVENTS", trace::DEFAULT_EVENTS_PER_THREAD, trace::MIN_EVENTS_PER_THREAD,
+                                      trace::MAX_EVENTS_PER_THREAD);
 
     return config;
 }
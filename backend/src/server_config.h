@@ -9,6 +9,43 @@ struct ServerConfig
     std::string api_token;
     unsigned short websocket_port;
     std::size_t max_sessions;
+    std::size_t ws_slow_consumer_ms;
+    std::size_t http_threads;
+    std::string host_name;
+    std::string proc_root;
+    std::string sys_root;
+    std::size_t collector_threads;
+    bool proc_io_uring;
+    bool process_events;
+    std::size_t process_rescan_seconds;
+    std::size_t detail_budget_us;
+    std::size_t detail_syscalls;
+    std::size_t detail_top_k;
+    std::size_t collector_cpu_percent;
+    std::size_t pressure_trigger_ms;
+    std::size_t pressure_window_ms;
+    std::string influx_url;
+    std::string influx_org;
+    std::string influx_bucket;
+    std::string influx_token;
+    std::size_t influx_batch_bytes;
+    std::size_t influx_flush_interval_ms;
+    std::size_t influx_retry_batches;
+    std::string influx_spool_dir;
+    std::size_t influx_spool_max_bytes;
+    std::size_t influx_timeout_ms;
+    std::string alert_rules_path;
+    std::size_t alert_interval_ms;
+    std::string push_url;
+    std::string push_token;
+    std::size_t push_interval_ms;
+    bool aggregator;
+    std::size_t fleet_history;
+    std::size_t fleet_stale_ms;
+    std::size_t fleet_retention_ms;
+    std::size_t fleet_max_agents;
+    bool trace_on_start;
+    std::size_t trace_events;
 };
 
 ServerConfig load_server_config();
@@ -0,0 +1,63 @@
+#include "snapshot_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr std::size_t MIN_BLOCK_BYTES = 16 * 1024;
+    // Rough per-entry cost of the intern set (node plus bucket), used to size the next arena.
+    constexpr std::size_t SET_ENTRY_BYTES = 48;
+    constexpr std::size_t AVERAGE_ENTRY_BYTES = 96;
+} // namespace
+
+SnapshotArena::SnapshotArena(std::size_t expectedBytes, std::shared_ptr<const SnapshotArena> parent)
+    : parent_(std::move(parent)),
+      mutex_(),
+      memory_(std::max(expectedBytes, MIN_BLOCK_BYTES)),
+      strings_(&memory_),
+      string_bytes_(0),
+      lookups_(0)
+{
+    // Buckets replaced by a rehash are not reclaimed until the arena goes, so size them up front.
+    strings_.reserve(expectedBytes / AVERAGE_ENTRY_BYTES);
+}
+
+std::string_view SnapshotArena::intern(std::string_view value)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++lookups_;
+    if (value.empty())
+    {
+        return std::string_view();
+    }
+
+    const auto iter = strings_.find(value);
+    if (iter != strings_.end())
+    {
+        return *iter;
+    }
+
+    char *copy = static_cast<char *>(memory_.allocate(value.size(), 1));
+    std::memcpy(copy, value.data(), value.size());
+    string_bytes_ += value.size();
+    return *strings_.emplace(copy, value.size()).first;
+}
+
+std::size_t SnapshotArena::footprint() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return string_bytes_ + strings_.size() * SET_ENTRY_BYTES + strings_.bucket_count() * sizeof(void *);
+}
+
+std::size_t SnapshotArena::distinct_strings() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return strings_.size();
+}
+
+std::size_t SnapshotArena::lookups() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lookups_;
+}
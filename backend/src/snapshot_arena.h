@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+
+// Backing store for the strings of one SystemMetrics snapshot.
+//
+// Process names, command lines, domain names and Docker fields are copied once into a monotonic
+// buffer and interned, so values that repeat across a collection (process names, images, the command
+// line of every worker in a pool) are stored once and the snapshot only holds string_views. Copies of
+// a snapshot share the arena through SystemMetrics::arena; it is released in one go with the last copy.
+// Collector stages running in parallel intern into the same arena, so intern() takes a short lock;
+// the snapshot only reads its views once published.
+class SnapshotArena
+{
+public:
+    // `expectedBytes` sizes the first block: pass the previous snapshot's footprint() so a steady host
+    // fills a single block. A top-up arena names the snapshot it extends as `parent` to keep its strings alive.
+    explicit SnapshotArena(std::size_t expectedBytes = 0, std::shared_ptr<const SnapshotArena> parent = nullptr);
+
+    SnapshotArena(const SnapshotArena &) = delete;
+    SnapshotArena &operator=(const SnapshotArena &) = delete;
+
+    // Returns a view of an arena-owned copy of `value`, shared with every equal string interned before.
+    std::string_view intern(std::string_view value);
+
+    std::size_t footprint() const;       // approximate bytes taken from the upstream allocator
+    std::size_t distinct_strings() const;
+    std::size_t lookups() const;         // intern() calls, including repeats
+
+private:
+    std::shared_ptr<const SnapshotArena> parent_;
+    mutable std::mutex mutex_;
+    std::pmr::monotonic_buffer_resource memory_;
+    std::pmr::unordered_set<std::string_view> strings_;
+    std::size_t string_bytes_;
+    std::size_t lookups_;
+};
@@ -0,0 +1,141 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Publishes immutable snapshots to lock-free readers.
+//
+// The current snapshot hangs off an atomic node pointer. A reader claims a hazard slot, announces
+// the node it is about to dereference, re-checks that the node is still current, copies the
+// shared_ptr out and releases the slot: no mutex, and the snapshot itself is never copied. A writer
+// swaps in a new node and retires the old one; retired nodes are freed only once no hazard slot
+// points at them, so a reader can never touch a freed node. The snapshot an old node referenced
+// lives on for as long as any reader still holds its shared_ptr.
+//
+// publish() must be serialised by the caller (MetricsCollector holds its mutex); load() may be
+// called from any number of threads.
+template <typename T>
+class SnapshotPublisher
+{
+public:
+    using Handle = std::shared_ptr<const T>;
+
+    SnapshotPublisher() : current_(nullptr) {}
+
+    ~SnapshotPublisher()
+    {
+        delete current_.load();
+        for (Node *node : retired_)
+        {
+            delete node;
+        }
+    }
+
+    SnapshotPublisher(const SnapshotPublisher &) = delete;
+    SnapshotPublisher &operator=(const SnapshotPublisher &) = delete;
+
+    void publish(Handle snapshot)
+    {
+        Node *previous = current_.exchange(new Node{std::move(snapshot)});
+        if (previous != nullptr)
+        {
+            retired_.push_back(previous);
+        }
+        if (retired_.size() >= RETIRE_BATCH)
+        {
+            reclaim();
+        }
+    }
+
+    Handle load() const
+    {
+        HazardSlot &slot = claim_slot();
+        const Node *node = current_.load();
+        for (;;)
+        {
+            // seq_cst store then load: the writer either sees this hazard or we see its swap.
+            slot.node.store(node);
+            const Node *latest = current_.load();
+            if (latest == node)
+            {
+                break;
+            }
+            node = latest;
+        }
+
+        Handle handle = node != nullptr ? node->value : Handle();
+        slot.node.store(nullptr, std::memory_order_release);
+        slot.claimed.store(false, std::memory_order_release);
+        return handle;
+    }
+
+private:
+    struct Node
+    {
+        Handle value;
+    };
+
+    // One cache line per slot so readers on different cores do not share lines.
+    struct alignas(64) HazardSlot
+    {
+        std::atomic<const Node *> node{nullptr};
+        std::atomic<bool> claimed{false};
+    };
+
+    static constexpr std::size_t SLOT_COUNT = 128;
+    static constexpr std::size_t RETIRE_BATCH = 8;
+
+    HazardSlot &claim_slot() const
+    {
+        // Slots are held for a few instructions only, so a thread rarely has to probe past its home slot.
+        static thread_local const std::size_t home = std::hash<std::thread::id>()(std::this_thread::get_id());
+        for (std::size_t attempt = 0;; ++attempt)
+        {
+            HazardSlot &slot = slots_[(home + attempt) % SLOT_COUNT];
+            if (!slot.claimed.load(std::memory_order_relaxed) && !slot.claimed.exchange(true, std::memory_order_acquire))
+            {
+                return slot;
+            }
+            if (attempt % SLOT_COUNT == SLOT_COUNT - 1)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void reclaim()
+    {
+        std::vector<const Node *> hazards;
+        hazards.reserve(SLOT_COUNT);
+        for (const HazardSlot &slot : slots_)
+        {
+            if (const Node *node = slot.node.load())
+            {
+                hazards.push_back(node);
+            }
+        }
+
+        std::size_t kept = 0;
+        for (Node *node : retired_)
+        {
+            if (std::find(hazards.begin(), hazards.end(), node) != hazards.end())
+            {
+                retired_[kept++] = node;
+            }
+            else
+            {
+                delete node;
+            }
+        }
+        retired_.resize(kept);
+    }
+
+    std::atomic<Node *> current_;
+    mutable std::array<HazardSlot, SLOT_COUNT> slots_;
+    std::vector<Node *> retired_; // writer-owned
+};
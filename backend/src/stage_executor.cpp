@@ -0,0 +1,262 @@
+#include "stage_executor.h"
+
+#include <algorithm>
+#include <ctime>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    long long thread_cpu_ns()
+    {
+        timespec now{};
+        ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        return static_cast<long long>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+    }
+} // namespace
+
+StageGraph::TaskId StageGraph::add(std::function<void()> work, std::initializer_list<TaskId> after)
+{
+    const TaskId id = tasks_.size();
+    tasks_.push_back(Task{std::move(work), {}, 0});
+    for (const TaskId dependency : after)
+    {
+        if (dependency >= id)
+        {
+            throw std::invalid_argument("stage dependencies must be added first");
+        }
+        tasks_[dependency].dependents.push_back(id);
+        ++tasks_[id].dependencies;
+    }
+    return id;
+}
+
+std::size_t StageGraph::size() const
+{
+    return tasks_.size();
+}
+
+StageExecutor::StageExecutor(std::size_t threads)
+    : queues_(),
+      workers_(),
+      run_mutex_(),
+      graph_(nullptr),
+      waiting_(),
+      remaining_(0),
+      queued_(0),
+      cpu_ns_(0),
+      error_mutex_(),
+      error_(),
+      wake_mutex_(),
+      wake_(),
+      stopping_(false)
+{
+    const std::size_t count = std::max<std::size_t>(1, threads);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (std::size_t i = 1; i < count; ++i)
+    {
+        workers_.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+StageExecutor::~StageExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto &worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+std::size_t StageExecutor::threads() const
+{
+    return queues_.size();
+}
+
+std::chrono::nanoseconds StageExecutor::run(StageGraph &graph)
+{
+    std::lock_guard<std::mutex> runLock(run_mutex_);
+    const std::size_t count = graph.tasks_.size();
+    if (count == 0)
+    {
+        return std::chrono::nanoseconds(0);
+    }
+
+    if (workers_.empty())
+    {
+        // Insertion order already satisfies every dependency.
+        const long long started = thread_cpu_ns();
+        std::exception_ptr error;
+        for (auto &task : graph.tasks_)
+        {
+            try
+            {
+                task.work();
+            }
+            catch (...)
+            {
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        return std::chrono::nanoseconds(thread_cpu_ns() - started);
+    }
+
+    graph_ = &graph;
+    waiting_ = std::make_unique<std::atomic<std::size_t>[]>(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        waiting_[i].store(graph.tasks_[i].dependencies, std::memory_order_relaxed);
+    }
+    error_ = nullptr;
+    cpu_ns_.store(0, std::memory_order_relaxed);
+    remaining_.store(count, std::memory_order_release);
+
+    // Roots go to the caller's deque in reverse so it starts with the first one; workers steal the rest.
+    for (std::size_t i = count; i-- > 0;)
+    {
+        if (graph.tasks_[i].dependencies == 0)
+        {
+            push(0, i);
+        }
+    }
+
+    while (remaining_.load(std::memory_order_acquire) != 0)
+    {
+        StageGraph::TaskId task = 0;
+        if (take(0, task))
+        {
+            execute(0, task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this]
+                   { return queued_.load(std::memory_order_acquire) != 0 || remaining_.load(std::memory_order_acquire) == 0; });
+    }
+
+    graph_ = nullptr;
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        error = std::exchange(error_, nullptr);
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    // Every task added its time before counting itself finished.
+    return std::chrono::nanoseconds(cpu_ns_.load(std::memory_order_relaxed));
+}
+
+void StageExecutor::worker_loop(std::size_t index)
+{
+    while (true)
+    {
+        StageGraph::TaskId task = 0;
+        if (take(index, task))
+        {
+            execute(index, task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this]
+                   { return stopping_ || queued_.load(std::memory_order_acquire) != 0; });
+        if (stopping_)
+        {
+            return;
+        }
+    }
+}
+
+bool StageExecutor::take(std::size_t index, StageGraph::TaskId &task)
+{
+    {
+        Queue &own = *queues_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            queued_.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+    for (std::size_t offset = 1; offset < queues_.size(); ++offset)
+    {
+        Queue &victim = *queues_[(index + offset) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            queued_.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+    return false;
+}
+
+void StageExecutor::push(std::size_t index, StageGraph::TaskId task)
+{
+    {
+        // Raised under the wake lock so a thread checking the wait predicate cannot miss it, and before
+        // the push so a thief's decrement never runs ahead of it.
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        queued_.fetch_add(1, std::memory_order_acq_rel);
+    }
+    {
+        Queue &queue = *queues_[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+    }
+    wake_.notify_one();
+}
+
+void StageExecutor::execute(std::size_t index, StageGraph::TaskId task)
+{
+    StageGraph::Task &current = graph_->tasks_[task];
+    const long long started = thread_cpu_ns();
+    try
+    {
+        current.work();
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        if (!error_)
+        {
+            error_ = std::current_exception();
+        }
+    }
+
+    cpu_ns_.fetch_add(thread_cpu_ns() - started, std::memory_order_relaxed);
+
+    // Dependents are queued before this task counts as finished, so run() cannot return early.
+    for (const StageGraph::TaskId dependent : current.dependents)
+    {
+        if (waiting_[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            push(index, dependent);
+        }
+    }
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+        }
+        wake_.notify_all();
+    }
+}
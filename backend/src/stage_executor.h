@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The collector stages of one refresh as a dependency graph: each task runs once every task it was
+// declared `after` has finished. Tasks may only depend on tasks added before them, so the graph is
+// acyclic by construction and the insertion order is a valid sequential schedule.
+class StageGraph
+{
+public:
+    using TaskId = std::size_t;
+
+    TaskId add(std::function<void()> work, std::initializer_list<TaskId> after = {});
+    std::size_t size() const;
+
+private:
+    friend class StageExecutor;
+
+    struct Task
+    {
+        std::function<void()> work;
+        std::vector<TaskId> dependents;
+        std::size_t dependencies;
+    };
+
+    std::vector<Task> tasks_;
+};
+
+// Small fixed pool that runs a StageGraph. Every thread owns a deque: it pushes the tasks its work made
+// ready to the back and pops from the back, and an idle thread steals from the front of the others, so
+// a long stage (the process walk) never holds back independent short ones. The thread calling run()
+// works as one of the pool instead of waiting, so `threads` counts it; with 1 the graph runs inline in
+// insertion order.
+class StageExecutor
+{
+public:
+    explicit StageExecutor(std::size_t threads);
+    ~StageExecutor();
+
+    StageExecutor(const StageExecutor &) = delete;
+    StageExecutor &operator=(const StageExecutor &) = delete;
+
+    // Runs every task of `graph` and returns once all have finished; completion of a task happens-before
+    // the start of its dependents and the return of run(). A task that throws does not stop the others;
+    // the first exception is rethrown here. One run() at a time. Returns the CPU time the tasks used,
+    // summed over the threads that ran them.
+    std::chrono::nanoseconds run(StageGraph &graph);
+
+    std::size_t threads() const;
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<StageGraph::TaskId> tasks;
+    };
+
+    void worker_loop(std::size_t index);
+    bool take(std::size_t index, StageGraph::TaskId &task);
+    void push(std::size_t index, StageGraph::TaskId task);
+    void execute(std::size_t index, StageGraph::TaskId task);
+
+    std::vector<std::unique_ptr<Queue>> queues_; // index 0 belongs to the thread calling run()
+    std::vector<std::thread> workers_;
+    std::mutex run_mutex_;
+
+    // State of the current run, guarded by wake_mutex_ where noted.
+    StageGraph *graph_;
+    std::unique_ptr<std::atomic<std::size_t>[]> waiting_; // unfinished dependencies per task
+    std::atomic<std::size_t> remaining_;                   // tasks not yet finished
+    std::atomic<std::size_t> queued_;                      // tasks pushed and not yet taken; raised under wake_mutex_
+    std::atomic<long long> cpu_ns_;                        // thread CPU time of the tasks run so far
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool stopping_; // guarded by wake_mutex_
+};
@@ -1,15 +1,23 @@
 #include "system_metrics.h"
+
+#include "self_stats.h"
+#include "target_index.h"
+#include "trace_recorder.h"
+
 #include <algorithm>
 #include <array>
 #include <chrono>
 #include <cmath>
 #include <cctype>
+#include <cerrno>
+#include <charconv>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
 #include <exception>
 #include <fstream>
 #include <iomanip>
+#include <iostream>
 #include <iterator>
 #include <numeric>
 #include <sstream>
@@ -20,9 +28,11 @@
 #include <vector>
 #include <ctime>
 #include <dirent.h>
+#include <fcntl.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/statvfs.h>
 #ifndef _WIN32
 #include <sys/wait.h>
@@ -31,16 +41,36 @@
 
 namespace
 {
-    constexpr const char *PROC_STAT_PATH = "/proc/stat";
-    constexpr const char *PROC_MEMINFO_PATH = "/proc/meminfo";
-    constexpr const char *PROC_TCP4_PATH = "/proc/net/tcp";
-    constexpr const char *PROC_TCP6_PATH = "/proc/net/tcp6";
-    constexpr const char *PROC_UDP4_PATH = "/proc/net/udp";
-    constexpr const char *PROC_UDP6_PATH = "/proc/net/udp6";
-    constexpr const char *PROC_NET_DEV_PATH = "/proc/net/dev";
+    // Paths relative to the configured procfs and sysfs roots.
+    constexpr const char *PROC_STAT_PATH = "/stat";
+    constexpr const char *PROC_MEMINFO_PATH = "/meminfo";
+    constexpr const char *PROC_TCP4_PATH = "/net/tcp";
+    constexpr const char *PROC_TCP6_PATH = "/net/tcp6";
+    constexpr const char *PROC_UDP4_PATH = "/net/udp";
+    constexpr const char *PROC_UDP6_PATH = "/net/udp6";
+    constexpr const char *PROC_NET_DEV_PATH = "/net/dev";
+    constexpr const char *PROC_LOADAVG_PATH = "/loadavg";
+    constexpr const char *PROC_PRESSURE_CPU_PATH = "/pressure/cpu";
+    constexpr const char *PROC_PRESSURE_MEMORY_PATH = "/pressure/memory";
+    constexpr const char *PROC_PRESSURE_IO_PATH = "/pressure/io";
+    constexpr const char *PROC_FILE_NR_PATH = "/sys/fs/file-nr";
+    constexpr const char *SYS_CPU_ONLINE_PATH = "/devices/system/cpu/online";
+    constexpr const char *STAGE_NAMES[] = {"cpu", "memory", "disk", "network", "loadAverage", "pressure",
+                                           "fileDescriptors", "processes", "processCounts", "listeningPorts", "connections",
+                                           "reverseDns", "docker"};
+    static_assert(std::size(STAGE_NAMES) == static_cast<std::size_t>(CollectorStage::Count), "one name per stage");
     constexpr auto CPU_AVERAGE_WINDOW = std::chrono::seconds(60);
     constexpr auto NETWORK_AVERAGE_WINDOW = std::chrono::seconds(30);
     constexpr auto MIN_COLLECTION_INTERVAL = std::chrono::milliseconds(400);
+    constexpr auto SECTION_DEMAND_TTL = std::chrono::seconds(10);
+    // Files read for every process, in request order within its share of a batch.
+    constexpr const char *PROCESS_FILES[] = {"stat", "status", "io", "cmdline"};
+    constexpr std::size_t STAT_FILE = 0;
+    constexpr std::size_t STATUS_FILE = 1;
+    constexpr std::size_t IO_FILE = 2;
+    constexpr std::size_t CMDLINE_FILE = 3;
+    constexpr std::size_t PROC_BATCH_REQUESTS = 128;
+    constexpr std::size_t MAX_SHORT_LIVED = 64; // per walk
     bool is_active_tcp_state(int state)
     {
         switch (state)
@@ -125,14 +155,244 @@ namespace
         return buffer;
     }
 
+    // Reads a whole /proc file into `buffer`, reusing its capacity, without stream or per-line allocations.
+    bool read_proc_file(const char *path, std::string &buffer)
+    {
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        buffer.clear();
+        char chunk[4096];
+        for (;;)
+        {
+            const ssize_t count = ::read(fd, chunk, sizeof(chunk));
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                break;
+            }
+            buffer.append(chunk, static_cast<std::size_t>(count));
+        }
+        ::close(fd);
+        return true;
+    }
+
+    // Value of a "Key:   123 kB" line in /proc/<pid>/status or /proc/<pid>/io; `key` starts with '\n'.
+    unsigned long long status_value(std::string_view text, std::string_view key)
+    {
+        const std::size_t line = text.find(key);
+        if (line == std::string_view::npos)
+        {
+            return 0;
+        }
+        std::string_view value = text.substr(line + key.size());
+        value.remove_prefix(std::min(value.find_first_not_of(" \t"), value.size()));
+        unsigned long long result = 0;
+        std::from_chars(value.data(), value.data() + value.size(), result);
+        return result;
+    }
+
+    // cgroup v2 directories of Docker containers by full id: system.slice/docker-<id>.scope with the
+    // systemd cgroup driver, docker/<id> with cgroupfs.
+    std::vector<std::pair<std::string, std::string>> docker_cgroups(const std::string &sysRoot)
+    {
+        std::vector<std::pair<std::string, std::string>> cgroups;
+        for (const auto &[parent, prefix, suffix] : {std::tuple<std::string_view, std::string_view, std::string_view>{"/fs/cgroup/system.slice", "docker-", ".scope"},
+                                                     {"/fs/cgroup/docker", "", ""}})
+        {
+            const std::string path = sysRoot + std::string(parent);
+            DIR *directory = ::opendir(path.c_str());
+            if (directory == nullptr)
+            {
+                continue;
+            }
+            while (const dirent *entry = ::readdir(directory))
+            {
+                const std::string_view name(entry->d_name);
+                if (name.size() > prefix.size() + suffix.size() && name.substr(0, prefix.size()) == prefix &&
+                    name.substr(name.size() - suffix.size()) == suffix)
+                {
+                    cgroups.emplace_back(name.substr(prefix.size(), name.size() - prefix.size() - suffix.size()), path + "/" + entry->d_name);
+                }
+            }
+            ::closedir(directory);
+        }
+        return cgroups;
+    }
+
+    // Name for `address` via getnameinfo, or the address itself when it does not resolve.
+    std::string reverse_lookup(const std::string &address, bool ipv6)
+    {
+        char host[NI_MAXHOST];
+        int result = -1;
+
+        if (ipv6)
+        {
+            sockaddr_in6 sa{};
+            sa.sin6_family = AF_INET6;
+            if (inet_pton(AF_INET6, address.c_str(), &sa.sin6_addr) == 1)
+            {
+                result = getnameinfo(reinterpret_cast<sockaddr *>(&sa), sizeof(sa), host, sizeof(host), nullptr, 0, NI_NAMEREQD);
+            }
+        }
+        else
+        {
+            sockaddr_in sa{};
+            sa.sin_family = AF_INET;
+            if (inet_pton(AF_INET, address.c_str(), &sa.sin_addr) == 1)
+            {
+                result = getnameinfo(reinterpret_cast<sockaddr *>(&sa), sizeof(sa), host, sizeof(host), nullptr, 0, NI_NAMEREQD);
+            }
+        }
+
+        return result == 0 ? std::string(host) : address;
+    }
+
+    // Counts the CPUs in a sysfs cpulist such as "0-3,8-11"; 0 when the list cannot be parsed.
+    unsigned int count_cpu_list(std::string_view list)
+    {
+        unsigned int count = 0;
+        while (!list.empty() && list.front() != '\n')
+        {
+            unsigned int first = 0;
+            auto parsed = std::from_chars(list.data(), list.data() + list.size(), first);
+            if (parsed.ec != std::errc())
+            {
+                return 0U;
+            }
+            unsigned int last = first;
+            if (parsed.ptr != list.data() + list.size() && *parsed.ptr == '-')
+            {
+                parsed = std::from_chars(parsed.ptr + 1, list.data() + list.size(), last);
+                if (parsed.ec != std::errc() || last < first)
+                {
+                    return 0U;
+                }
+            }
+            count += last - first + 1;
+            list.remove_prefix(static_cast<std::size_t>(parsed.ptr - list.data()));
+            if (!list.empty() && list.front() == ',')
+            {
+                list.remove_prefix(1);
+            }
+        }
+        return count;
+    }
+
+    unsigned int fd_count_by_listing(const char *path)
+    {
+        DIR *dir = opendir(path);
+        if (dir == nullptr)
+        {
+            return 0U;
+        }
+        unsigned int count = 0;
+        while (const struct dirent *entry = readdir(dir))
+        {
+            if (entry->d_name[0] != '.')
+            {
+                ++count;
+            }
+        }
+        closedir(dir);
+        return count;
+    }
+
+    // Since Linux 6.2 the size of /proc/<pid>/fd is the number of open descriptors; older kernels report 0.
+    bool fd_count_from_stat(const std::string &root)
+    {
+        struct stat self_fds{};
+        return ::stat((root + "/self/fd").c_str(), &self_fds) == 0 && self_fds.st_size > 0;
+    }
+
+    // Numeric entries of `root`, i.e. the process ids; false when the directory cannot be opened.
+    bool list_process_ids(const std::string &root, std::vector<int> &pids)
+    {
+        DIR *dir = opendir(root.c_str());
+        if (dir == nullptr)
+        {
+            return false;
+        }
+        pids.clear();
+        while (const struct dirent *entry = readdir(dir))
+        {
+            if (std::isdigit(static_cast<unsigned char>(entry->d_name[0])))
+            {
+                pids.push_back(std::atoi(entry->d_name));
+            }
+        }
+        closedir(dir);
+        return true;
+    }
+
+    // Section fields of `from` that a collection skipping the detail tier hands on unchanged.
+    void carry_sections(const SystemMetrics &from, SystemMetrics &to, unsigned int sections)
+    {
+        if ((sections & SECTION_APPLICATIONS) != 0)
+        {
+            to.topApplications = from.topApplications;
+            to.processChurn = from.processChurn;
+        }
+        if ((sections & SECTION_PROCESS_COUNTS) != 0)
+        {
+            to.processCount = from.processCount;
+            to.threadCount = from.threadCount;
+        }
+        if ((sections & SECTION_LISTENING_PORTS) != 0)
+        {
+            to.listeningTcp = from.listeningTcp;
+            to.listeningUdp = from.listeningUdp;
+        }
+        if ((sections & SECTION_CONNECTIONS) != 0)
+        {
+            to.activeConnections = from.activeConnections;
+            to.domainUsage = from.domainUsage;
+            to.uniqueDomains = from.uniqueDomains;
+        }
+        if ((sections & SECTION_DOCKER) != 0)
+        {
+            to.dockerAvailable = from.dockerAvailable;
+            to.dockerContainers = from.dockerContainers;
+            to.dockerImages = from.dockerImages;
+        }
+    }
+
+    AgentMetrics read_agent_metrics(std::chrono::nanoseconds collection)
+    {
+        AgentMetrics agent{};
+        agent.collectionMs = std::chrono::duration<double, std::milli>(collection).count();
+        agent.collectionP99Ms = self_stats::summary(self_stats::Timer::Collection).p99Us / 1000.0;
+        agent.requestP99Ms = self_stats::summary(self_stats::Timer::HttpRequest).p99Us / 1000.0;
+        agent.allocations = self_stats::allocations();
+        const self_stats::Syscalls calls = self_stats::syscalls();
+        agent.readSyscalls = calls.reads;
+        agent.writeSyscalls = calls.writes;
+        agent.bytesSent = self_stats::total(self_stats::Counter::HttpBytesSent) + self_stats::total(self_stats::Counter::WebSocketBytesSent);
+        return agent;
+    }
+
 } // namespace
 
-MetricsCollector::MetricsCollector()
-    : mutex_(),
+const char *collector_stage_name(CollectorStage stage)
+{
+    const auto index = static_cast<std::size_t>(stage);
+    return index < std::size(STAGE_NAMES) ? STAGE_NAMES[index] : "unknown";
+}
+
+MetricsCollector::MetricsCollector(CollectorConfig config)
+    : proc_root_(std::move(config.proc_root)),
+      sys_root_(std::move(config.sys_root)),
+      mutex_(),
       cpu_initialized_(false),
       previous_total_(0),
       previous_idle_(0),
-      last_cpu_total_diff_(0),
+      application_cpu_total_(0),
       cpu_count_cached_(false),
       cached_cpu_count_(1),
       network_initialized_(false),
@@ -141,74 +401,482 @@ MetricsCollector::MetricsCollector()
       has_cached_sample_(false),
       last_collection_time_(),
       cached_metrics_(),
-      process_cpu_times_(),
+      snapshots_(),
+      collected_at_ns_(0),
+      interval_ns_(std::chrono::nanoseconds(MIN_COLLECTION_INTERVAL).count()),
+      expedited_(false),
+      pressure_triggers_(0),
+      governor_(config.cpu_budget_percent, MIN_COLLECTION_INTERVAL),
+      section_collected_(),
+      sequence_(0),
+      arena_hint_(0),
+      proc_buffer_(),
+      previous_process_walk_(),
+      fd_count_from_stat_(fd_count_from_stat(proc_root_)),
+      process_counters_(),
       cpu_samples_(),
       rx_samples_(),
       tx_samples_(),
-      dns_cache_()
+      dns_cache_(),
+      listeners_(),
+      stage_listeners_(),
+      section_demand_(),
+      pids_(),
+      process_events_(),
+      rescan_interval_(config.rescan_interval),
+      last_rescan_(),
+      short_lived_(),
+      process_details_(proc_root_, ProcessDetailScanner::Budget{config.detail_budget, config.detail_syscalls, config.detail_top_k},
+                       !fd_count_from_stat_),
+      proc_batches_(),
+      wake_mutex_(),
+      wake_(),
+      wanted_sections_(0),
+      running_(false),
+      thread_(),
+      executor_(config.threads)
+{
+    proc_batches_[0] = std::make_unique<ProcFileBatch>(PROC_BATCH_REQUESTS, config.io_uring);
+    if (proc_batches_[0]->uses_io_uring())
+    {
+        proc_batches_[1] = std::make_unique<ProcFileBatch>(PROC_BATCH_REQUESTS, true);
+    }
+    else if (config.io_uring)
+    {
+        std::cerr << "io_uring is not available, reading /proc synchronously" << std::endl;
+    }
+
+    if (config.process_events)
+    {
+        process_events_ = std::make_unique<ProcessEventTracker>(proc_root_, MAX_SHORT_LIVED);
+        std::string error;
+        if (!process_events_->start(error))
+        {
+            std::cerr << "Process events unavailable (" << error << "), listing /proc on every walk" << std::endl;
+            process_events_.reset();
+        }
+    }
+}
+
+void MetricsCollector::add_listener(SnapshotListener listener)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    listeners_.push_back(std::move(listener));
+}
+
+std::chrono::milliseconds MetricsCollector::interval() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::nanoseconds(interval_ns_.load(std::memory_order_relaxed)));
+}
+
+MetricsCollector::~MetricsCollector()
+{
+    stop();
+}
+
+void MetricsCollector::start()
+{
+    refresh(SECTION_ALL);
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    if (!running_)
+    {
+        running_ = true;
+        thread_ = std::thread([this] { run(); });
+    }
+}
+
+void MetricsCollector::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        running_ = false;
+    }
+    wake_.notify_all();
+    published_.notify_all();
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+std::chrono::steady_clock::time_point MetricsCollector::next_collection_due() const
+{
+    const long long interval = expedited_.load(std::memory_order_acquire)
+                                   ? std::chrono::nanoseconds(MIN_COLLECTION_INTERVAL).count()
+                                   : interval_ns_.load(std::memory_order_relaxed);
+    return std::chrono::steady_clock::time_point(std::chrono::nanoseconds(collected_at_ns_.load(std::memory_order_acquire) + interval));
+}
+
+void MetricsCollector::run()
+{
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    while (running_)
+    {
+        // Re-evaluated after every wake-up: a trigger or a reader may have moved the deadline forward.
+        const auto due = next_collection_due();
+        if (wanted_sections_ == 0 && std::chrono::steady_clock::now() < due)
+        {
+            wake_.wait_until(lock, due);
+            continue;
+        }
+        const unsigned int wanted = std::exchange(wanted_sections_, 0U);
+        lock.unlock();
+        refresh(wanted);
+        lock.lock();
+    }
+}
+
+std::shared_ptr<const SystemMetrics> MetricsCollector::latest(unsigned int sections)
+{
+    sections &= SECTION_ALL;
+    const long long nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    std::shared_ptr<const SystemMetrics> current = snapshots_.load();
+    if (!current)
+    {
+        return snapshot(sections);
+    }
+    note_demand(sections, nowNs);
+    if ((current->sections & sections) != sections)
+    {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            wanted_sections_ |= sections;
+        }
+        wake_.notify_one();
+    }
+    return current;
+}
+
+std::shared_ptr<const SystemMetrics> MetricsCollector::latest(unsigned int sections, std::chrono::milliseconds wait)
+{
+    sections &= SECTION_ALL;
+    std::shared_ptr<const SystemMetrics> current = latest(sections);
+    if ((current->sections & sections) == sections || wait <= std::chrono::milliseconds::zero())
+    {
+        return current;
+    }
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    published_.wait_for(lock, wait, [&] {
+        current = snapshots_.load();
+        return !running_ || (current->sections & sections) == sections;
+    });
+    return current;
+}
+
+void MetricsCollector::notify_published()
+{
+    // Taking the wake lock orders the publication before a waiter's check, so no wake-up is lost.
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    published_.notify_all();
+}
+
+void MetricsCollector::on_pressure_trigger(PressureResource)
+{
+    pressure_triggers_.fetch_add(1, std::memory_order_relaxed);
+    {
+        // Under the wake lock, so the collecting thread cannot miss the earlier deadline.
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        expedited_.store(true, std::memory_order_release);
+    }
+    wake_.notify_one();
+}
+
+void MetricsCollector::add_stage_listener(StageListener listener)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stage_listeners_.push_back(std::move(listener));
+}
+
+template <typename Step>
+decltype(auto) MetricsCollector::timed(CollectorStage stage, Step &&step)
 {
+    const auto start = std::chrono::steady_clock::now();
+    decltype(auto) result = step();
+    const auto end = std::chrono::steady_clock::now();
+    self_stats::record(stage, end - start);
+    trace::record(collector_stage_name(stage), "collector", start, end);
+    for (const auto &listener : stage_listeners_)
+    {
+        listener(stage, start, end);
+    }
+    return result;
 }
 
-SystemMetrics MetricsCollector::collect()
+std::shared_ptr<const SystemMetrics> MetricsCollector::snapshot(unsigned int sections)
 {
+    sections &= SECTION_ALL;
+    const long long nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // Fast path: a recent snapshot that already has the requested sections is handed out without the lock.
+    const long long collectedAt = collected_at_ns_.load(std::memory_order_acquire);
+    if (collectedAt != 0 && nowNs - collectedAt < interval_ns_.load(std::memory_order_relaxed) &&
+        !expedited_.load(std::memory_order_acquire))
+    {
+        std::shared_ptr<const SystemMetrics> current = snapshots_.load();
+        if (current && (current->sections & sections) == sections)
+        {
+            note_demand(sections, nowNs);
+            return current;
+        }
+    }
+
     std::lock_guard<std::mutex> lock(mutex_);
+    refresh_locked(sections);
+    return cached_metrics_;
+}
+
+SystemMetrics MetricsCollector::collect(unsigned int sections)
+{
+    return *snapshot(sections);
+}
 
+unsigned long long MetricsCollector::refresh(unsigned int sections)
+{
+    return snapshot(sections)->sequence;
+}
+
+void MetricsCollector::note_demand(unsigned int sections, long long nowNs)
+{
+    // Readers only write a section's timestamp about once a second, so the fast path stays read-mostly.
+    constexpr long long DEMAND_RESOLUTION_NS = 1000000000LL;
+    for (std::size_t i = 0; i < section_demand_.size(); ++i)
+    {
+        if ((sections & (1U << i)) != 0 && nowNs - section_demand_[i].load(std::memory_order_relaxed) > DEMAND_RESOLUTION_NS)
+        {
+            section_demand_[i].store(nowNs, std::memory_order_relaxed);
+        }
+    }
+}
+
+void MetricsCollector::mark_collected(unsigned int sections, std::chrono::steady_clock::time_point when)
+{
+    for (std::size_t i = 0; i < section_collected_.size(); ++i)
+    {
+        if ((sections & (1U << i)) != 0)
+        {
+            section_collected_[i] = when;
+        }
+    }
+}
+
+void MetricsCollector::refresh_locked(unsigned int sections)
+{
     const auto now = std::chrono::steady_clock::now();
+    const long long nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    const long long demandTtlNs = std::chrono::duration_cast<std::chrono::nanoseconds>(SECTION_DEMAND_TTL).count();
+    unsigned int active = sections & SECTION_ALL;
+    for (std::size_t i = 0; i < section_demand_.size(); ++i)
+    {
+        const unsigned int bit = 1U << i;
+        const long long demanded = section_demand_[i].load(std::memory_order_relaxed);
+        if ((sections & bit) != 0)
+        {
+            section_demand_[i].store(nowNs, std::memory_order_relaxed);
+        }
+        else if (demanded != 0 && nowNs - demanded < demandTtlNs)
+        {
+            // Another consumer asked for this section recently; keep it warm for them.
+            active |= bit;
+        }
+    }
+
     if (has_cached_sample_)
     {
         const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_collection_time_);
-        if (elapsed < MIN_COLLECTION_INTERVAL)
+        // A pressure trigger cuts a stretched interval short, but collections never come closer than the minimum.
+        const bool expedited = expedited_.load(std::memory_order_acquire) && elapsed >= MIN_COLLECTION_INTERVAL;
+        if (elapsed < governor_.interval() && !expedited)
         {
-            return cached_metrics_;
+            const unsigned int missing = sections & ~cached_metrics_->sections & SECTION_ALL;
+            if (missing != 0)
+            {
+                // Published snapshots are immutable: top up a copy and publish it as a new version.
+                auto topped = std::make_shared<SystemMetrics>(*cached_metrics_);
+                auto arena = std::make_shared<SnapshotArena>(0, cached_metrics_->arena);
+                topped->arena = arena;
+                StageGraph graph;
+                add_section_stages(graph, *topped, missing, *arena, {}, {});
+                governor_.record_top_up(executor_.run(graph));
+                topped->sections |= missing;
+                topped->collectedSections = missing;
+                mark_collected(missing, now);
+                topped->sequence = ++sequence_;
+                topped->targetIndex = std::make_shared<TargetIndex>();
+                cached_metrics_ = std::move(topped);
+                snapshots_.publish(cached_metrics_);
+                notify_published();
+            }
+            return;
         }
     }
 
+    // A section the previous snapshot has is handed on until it is a detail interval old, each section by
+    // its own age; carried strings stay in the old arena, which the new one keeps alive as its parent.
+    // Triggers that fire while this collection runs ask for the next one.
+    expedited_.store(false, std::memory_order_relaxed);
+    unsigned int carried = 0;
+    if (has_cached_sample_)
+    {
+        for (std::size_t i = 0; i < section_collected_.size(); ++i)
+        {
+            const unsigned int bit = 1U << i;
+            if ((active & cached_metrics_->sections & bit) != 0 && now - section_collected_[i] < governor_.detail_interval())
+            {
+                carried |= bit;
+            }
+        }
+    }
+    const unsigned int collected = active & ~carried;
     SystemMetrics metrics{};
+    auto arena = carried != 0 ? std::make_shared<SnapshotArena>(0, cached_metrics_->arena)
+                              : std::make_shared<SnapshotArena>(arena_hint_ + arena_hint_ / 4);
+    metrics.arena = arena;
+    if (carried != 0)
+    {
+        carry_sections(*cached_metrics_, metrics, carried);
+    }
     metrics.timestamp = std::chrono::system_clock::now();
-    metrics.cpuUsage = read_cpu_usage();
-    metrics.memoryUsage = read_memory_usage();
-    metrics.swapUsage = read_swap_usage();
-    metrics.diskUsage = read_disk_usage();
-    auto [rx_rate, tx_rate] = read_network_throughput();
-    metrics.networkReceiveRate = rx_rate;
-    metrics.networkTransmitRate = tx_rate;
-    auto load_avgs = read_load_averages();
-    metrics.loadAverage1 = load_avgs[0];
-    metrics.loadAverage5 = load_avgs[1];
-    metrics.loadAverage15 = load_avgs[2];
     metrics.cpuCount = detect_cpu_count();
-    auto [processes, threads] = read_process_thread_counts();
-    metrics.processCount = processes;
-    metrics.threadCount = threads;
-    auto [listeningTcp, listeningUdp] = read_listening_ports();
-    metrics.listeningTcp = listeningTcp;
-    metrics.listeningUdp = listeningUdp;
-    metrics.openFileDescriptors = read_open_file_descriptors();
-    auto connectionSummary = read_connection_summary();
-    metrics.activeConnections = connectionSummary.totalConnections;
-    metrics.domainUsage = build_domain_usage(connectionSummary, metrics.networkReceiveRate, metrics.networkTransmitRate);
-    metrics.uniqueDomains = metrics.domainUsage.size();
-    metrics.topApplications = read_application_usage();
+
+    StageGraph graph;
+    const auto cpu = graph.add([this, &metrics]
+                               { metrics.cpuUsage = timed(CollectorStage::Cpu, [this, &metrics]
+                                                          { return read_cpu_usage(metrics.procsRunning, metrics.procsBlocked); }); });
+    graph.add([this, &metrics]
+              {
+        metrics.memoryUsage = timed(CollectorStage::Memory, [this] { return read_memory_usage(); });
+        metrics.swapUsage = timed(CollectorStage::Memory, [this] { return read_swap_usage(); }); });
+    graph.add([this, &metrics]
+              { metrics.diskUsage = timed(CollectorStage::Disk, [this] { return read_disk_usage(); }); });
+    const auto network = graph.add([this, &metrics]
+                                   {
+        auto [rx_rate, tx_rate] = timed(CollectorStage::Network, [this] { return read_network_throughput(); });
+        metrics.networkReceiveRate = rx_rate;
+        metrics.networkTransmitRate = tx_rate; });
+    graph.add([this, &metrics]
+              {
+        auto load_avgs = timed(CollectorStage::LoadAverage, [this] { return read_load_averages(); });
+        metrics.loadAverage1 = load_avgs[0];
+        metrics.loadAverage5 = load_avgs[1];
+        metrics.loadAverage15 = load_avgs[2]; });
+    graph.add([this, &metrics]
+              { metrics.pressure = timed(CollectorStage::Pressure, [this] { return read_pressure(); }); });
+    graph.add([this, &metrics]
+              { metrics.openFileDescriptors = timed(CollectorStage::FileDescriptors, [this] { return read_open_file_descriptors(); }); });
+    add_section_stages(graph, metrics, collected, *arena, {cpu}, {network});
+    process_details_.set_depth_halvings(governor_.depth_halvings());
+    const std::chrono::nanoseconds cpu_time = executor_.run(graph);
+    mark_collected(collected, now);
+    governor_.record(cpu_time, collected != 0);
+    interval_ns_.store(std::chrono::nanoseconds(governor_.interval()).count(), std::memory_order_relaxed);
+
     update_rollup_samples(metrics.cpuUsage, metrics.networkReceiveRate, metrics.networkTransmitRate, now);
     metrics.cpuUsageAverage = compute_average(cpu_samples_, now, CPU_AVERAGE_WINDOW);
     metrics.networkReceiveRateAverage = compute_average(rx_samples_, now, NETWORK_AVERAGE_WINDOW);
     metrics.networkTransmitRateAverage = compute_average(tx_samples_, now, NETWORK_AVERAGE_WINDOW);
-    bool docker_available = false;
-    auto [containers, images] = read_docker_inventory(docker_available);
-    metrics.dockerAvailable = docker_available;
-    metrics.dockerContainers = std::move(containers);
-    metrics.dockerImages = std::move(images);
-
-    cached_metrics_ = metrics;
+    if (carried == 0)
+    {
+        arena_hint_ = arena->footprint();
+    }
+    const auto finished = std::chrono::steady_clock::now();
+    self_stats::record(self_stats::Timer::Collection, finished - now);
+    trace::record("collect", "collector", now, finished, "sections", active);
+    metrics.agent = read_agent_metrics(finished - now);
+    metrics.agent.collectionCpuMs = std::chrono::duration<double, std::milli>(cpu_time).count();
+    metrics.agent.cpuPercent = governor_.projected_percent();
+    metrics.agent.intervalMs = static_cast<double>(governor_.interval().count());
+    metrics.agent.detailIntervalMs = static_cast<double>(governor_.detail_interval().count());
+    metrics.pressure.triggers = pressure_triggers_.load(std::memory_order_relaxed);
+    metrics.sections = active;
+    metrics.collectedSections = collected;
+    metrics.sequence = ++sequence_;
+    metrics.targetIndex = std::make_shared<TargetIndex>();
+
+    cached_metrics_ = std::make_shared<const SystemMetrics>(std::move(metrics));
+    snapshots_.publish(cached_metrics_);
+    notify_published();
+    collected_at_ns_.store(nowNs, std::memory_order_release);
     last_collection_time_ = now;
     has_cached_sample_ = true;
 
-    return metrics;
+    for (const auto &listener : listeners_)
+    {
+        listener(*cached_metrics_);
+    }
+}
+
+// Each stage writes its own fields of `metrics` and collector state no other stage touches, so the
+// snapshot is the same whatever order the executor picks. The edges are the only cross-stage reads:
+// application CPU percent divides by the CPU delta of `afterCpu`, and domain usage splits the
+// throughput measured by `afterNetwork`. A top-up passes no edges; those values are already in place.
+void MetricsCollector::add_section_stages(StageGraph &graph, SystemMetrics &metrics, unsigned int sections, SnapshotArena &arena,
+                                          std::initializer_list<StageGraph::TaskId> afterCpu,
+                                          std::initializer_list<StageGraph::TaskId> afterNetwork)
+{
+    if ((sections & SECTION_APPLICATIONS) != 0)
+    {
+        graph.add([this, &metrics, &arena, sections]
+                  {
+            // The process walk counts processes and threads on the way, so the counts need no walk of their own.
+            unsigned int processes = 0;
+            unsigned int threads = 0;
+            metrics.topApplications = timed(CollectorStage::Processes, [&]
+                                            {
+                metrics.processChurn = read_process_churn(arena);
+                return read_application_usage(arena, processes, threads); });
+            if ((sections & SECTION_PROCESS_COUNTS) != 0)
+            {
+                metrics.processCount = processes;
+                metrics.threadCount = threads;
+            } },
+                  afterCpu);
+    }
+    else if ((sections & SECTION_PROCESS_COUNTS) != 0)
+    {
+        graph.add([this, &metrics]
+                  {
+            auto [processes, threads] = timed(CollectorStage::ProcessCounts, [this] { return read_process_thread_counts(); });
+            metrics.processCount = processes;
+            metrics.threadCount = threads; });
+    }
+    if ((sections & SECTION_LISTENING_PORTS) != 0)
+    {
+        graph.add([this, &metrics]
+                  {
+            auto [listeningTcp, listeningUdp] = timed(CollectorStage::ListeningPorts, [this] { return read_listening_ports(); });
+            metrics.listeningTcp = listeningTcp;
+            metrics.listeningUdp = listeningUdp; });
+    }
+    if ((sections & SECTION_CONNECTIONS) != 0)
+    {
+        graph.add([this, &metrics, &arena]
+                  {
+            metrics.domainUsage = timed(CollectorStage::Connections, [&]
+                                        {
+                auto connectionSummary = read_connection_summary();
+                metrics.activeConnections = connectionSummary.totalConnections;
+                return build_domain_usage(connectionSummary, metrics.networkReceiveRate, metrics.networkTransmitRate, arena); });
+            metrics.uniqueDomains = metrics.domainUsage.size(); },
+                  afterNetwork);
+    }
+    if ((sections & SECTION_DOCKER) != 0)
+    {
+        graph.add([this, &metrics, &arena]
+                  {
+            bool docker_available = false;
+            auto [containers, images] = timed(CollectorStage::Docker, [&]
+                                              { return read_docker_inventory(docker_available, arena); });
+            metrics.dockerAvailable = docker_available;
+            metrics.dockerContainers = std::move(containers);
+            metrics.dockerImages = std::move(images); });
+    }
 }
 
-double MetricsCollector::read_cpu_usage()
+double MetricsCollector::read_cpu_usage(unsigned int &procsRunning, unsigned int &procsBlocked)
 {
-    std::ifstream stat_file(PROC_STAT_PATH);
+    std::ifstream stat_file(proc_root_ + PROC_STAT_PATH);
     if (!stat_file.is_open())
     {
         return 0.0;
@@ -226,6 +894,22 @@ double MetricsCollector::read_cpu_usage()
     unsigned long long iowait = 0, irq = 0, softirq = 0, steal = 0;
     ss >> cpu_label >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal;
 
+    // The run queue comes from the same read: procs_running and procs_blocked follow the per-CPU lines.
+    procsRunning = 0;
+    procsBlocked = 0;
+    while (std::getline(stat_file, line))
+    {
+        if (line.compare(0, 14, "procs_running ") == 0)
+        {
+            procsRunning = static_cast<unsigned int>(status_value(line, "procs_running"));
+        }
+        else if (line.compare(0, 14, "procs_blocked ") == 0)
+        {
+            procsBlocked = static_cast<unsigned int>(status_value(line, "procs_blocked"));
+            break;
+        }
+    }
+
     const unsigned long long idle_all = idle + iowait;
     const unsigned long long non_idle = user + nice + system + irq + softirq + steal;
     const unsigned long long total = idle_all + non_idle;
@@ -235,7 +919,6 @@ double MetricsCollector::read_cpu_usage()
         cpu_initialized_ = true;
         previous_total_ = total;
         previous_idle_ = idle_all;
-        last_cpu_total_diff_ = 0;
         return 0.0;
     }
 
@@ -244,11 +927,9 @@ double MetricsCollector::read_cpu_usage()
 
     previous_total_ = total;
     previous_idle_ = idle_all;
-    last_cpu_total_diff_ = total_diff;
 
     if (total_diff == 0)
     {
-        last_cpu_total_diff_ = 0;
         return 0.0;
     }
 
@@ -258,7 +939,7 @@ double MetricsCollector::read_cpu_usage()
 
 double MetricsCollector::read_memory_usage()
 {
-    std::ifstream meminfo(PROC_MEMINFO_PATH);
+    std::ifstream meminfo(proc_root_ + PROC_MEMINFO_PATH);
     if (!meminfo.is_open())
     {
         return 0.0;
@@ -299,7 +980,7 @@ double MetricsCollector::read_memory_usage()
 
 double MetricsCollector::read_swap_usage()
 {
-    std::ifstream meminfo(PROC_MEMINFO_PATH);
+    std::ifstream meminfo(proc_root_ + PROC_MEMINFO_PATH);
     if (!meminfo.is_open())
     {
         return 0.0;
@@ -360,7 +1041,7 @@ double MetricsCollector::read_disk_usage()
 
 std::tuple<double, double> MetricsCollector::read_network_throughput()
 {
-    std::ifstream net_file(PROC_NET_DEV_PATH);
+    std::ifstream net_file(proc_root_ + PROC_NET_DEV_PATH);
     if (!net_file.is_open())
     {
         return {0.0, 0.0};
@@ -480,152 +1161,300 @@ double MetricsCollector::compute_average(std::deque<std::pair<std::chrono::stead
     return sum / static_cast<double>(samples.size());
 }
 
-std::vector<ApplicationUsage> MetricsCollector::read_application_usage()
+ProcessChurn MetricsCollector::read_process_churn(SnapshotArena &arena)
 {
-    std::vector<ApplicationUsage> result;
-    const unsigned long long total_diff = last_cpu_total_diff_;
-
-    DIR *proc_dir = opendir("/proc");
-    if (proc_dir == nullptr)
+    ProcessChurn churn{};
+    if (!process_events_)
     {
-        process_cpu_times_.clear();
-        return result;
+        return churn;
+    }
+    const ProcessEventTracker::Counts counts = process_events_->counts();
+    churn.eventDriven = true;
+    churn.forks = counts.forks;
+    churn.execs = counts.execs;
+    churn.exits = counts.exits;
+    churn.shortLivedDropped = process_events_->take_short_lived(short_lived_);
+    churn.shortLived.reserve(short_lived_.size());
+    for (const auto &exit : short_lived_)
+    {
+        churn.shortLived.push_back(ShortLivedProcess{exit.pid, arena.intern(exit.name),
+                                                     std::chrono::duration<double, std::milli>(exit.lifetime).count(), exit.exitCode});
     }
+    return churn;
+}
 
-    std::unordered_map<int, unsigned long long> next_cpu_times;
-    struct dirent *entry = nullptr;
+ProcessTable MetricsCollector::read_application_usage(SnapshotArena &arena, unsigned int &processCount, unsigned int &threadCount)
+{
+    ProcessTable result;
+    processCount = 0;
+    threadCount = 0;
+    // Measured against the CPU total at the previous process walk, so skipped ticks do not skew percentages.
+    const unsigned long long total_diff = application_cpu_total_ != 0 && previous_total_ > application_cpu_total_
+                                              ? previous_total_ - application_cpu_total_
+                                              : 0;
+    application_cpu_total_ = previous_total_;
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed = previous_process_walk_ == std::chrono::steady_clock::time_point()
+                               ? 0.0
+                               : std::chrono::duration<double>(now - previous_process_walk_).count();
+    previous_process_walk_ = now;
+    const auto rate = [elapsed](unsigned long long current, unsigned long long previous)
+    {
+        return elapsed > 0.0 && current >= previous ? static_cast<double>(current - previous) / elapsed : 0.0;
+    };
 
-    while ((entry = readdir(proc_dir)) != nullptr)
+    // The process list comes first, so the files of many processes can be requested in one batch. With
+    // process events it is the tracked set, and /proc is only listed to reconcile it now and then.
+    const bool tracked = process_events_ && now - last_rescan_ < rescan_interval_ && process_events_->live_pids(pids_);
+    if (!tracked)
     {
-        if (entry->d_name == nullptr || !std::isdigit(static_cast<unsigned char>(entry->d_name[0])))
+        if (process_events_)
         {
-            continue;
+            process_events_->begin_rescan();
         }
-
-        const int pid = std::atoi(entry->d_name);
-        const std::string base_path = std::string("/proc/") + entry->d_name;
-
-        std::ifstream stat_file(base_path + "/stat");
-        if (!stat_file.is_open())
+        if (!list_process_ids(proc_root_, pids_))
         {
-            continue;
+            process_counters_.clear();
+            return result;
         }
-
-        std::string stat_line;
-        std::getline(stat_file, stat_line);
-        stat_file.close();
-
-        const std::size_t open = stat_line.find('(');
-        const std::size_t close = stat_line.rfind(')');
-        if (open == std::string::npos || close == std::string::npos || close <= open)
+        if (process_events_)
         {
-            continue;
+            process_events_->finish_rescan(pids_);
+            last_rescan_ = now;
         }
+    }
+    processCount = static_cast<unsigned int>(pids_.size());
 
-        std::string name = stat_line.substr(open + 1, close - open - 1);
-        std::string remainder = close + 1 < stat_line.size() ? stat_line.substr(close + 2) : std::string();
-        std::istringstream fields(remainder);
+    // Expensive details of a few processes, within the per-walk budget; the rest keep their cached values.
+    const ProcessDetailScanner::Pass pass = process_details_.run(pids_, now);
+    self_stats::add(self_stats::Counter::ProcessDetailProbes, pass.probes);
+    const auto age_ms = [now](std::chrono::steady_clock::time_point readAt)
+    {
+        return readAt == std::chrono::steady_clock::time_point() ? -1.0 : std::chrono::duration<double, std::milli>(now - readAt).count();
+    };
 
-        std::string token;
-        for (int i = 0; i < 11; ++i)
-        {
-            if (!(fields >> token))
+    std::unordered_map<int, ProcessCounters> next_counters;
+    next_counters.reserve(process_counters_.size());
+    result.reserve(process_counters_.size());
+    // "<root>/<pid>/" is built once per process; each file name is then written after it.
+    std::string path = proc_root_;
+    std::size_t directory = 0;
+    const auto enter = [this, &path, &directory](int pid)
+    {
+        char digits[16];
+        const auto end = std::to_chars(digits, digits + sizeof(digits), pid).ptr;
+        path.resize(proc_root_.size());
+        path += '/';
+        path.append(digits, end);
+        path += '/';
+        directory = path.size();
+    };
+    const auto file = [&path, &directory](const char *name) -> const std::string &
+    {
+        path.resize(directory);
+        path += name;
+        return path;
+    };
+
+    // Since Linux 6.2 the descriptor count is one more stat-like request; older kernels list the directory,
+    // which is left to the detail scanner unless it is disabled.
+    const bool fd_sizes = fd_count_from_stat_;
+    const std::size_t requests_per_process = std::size(PROCESS_FILES) + (fd_sizes ? 1 : 0);
+    const std::size_t depth = proc_batches_[1] ? 2 : 1;
+    std::array<std::size_t, 2> first{};
+    std::array<std::size_t, 2> count{};
+    std::size_t next = 0;
+    const auto queue = [&](std::size_t slot)
+    {
+        ProcFileBatch &batch = *proc_batches_[slot];
+        batch.clear();
+        first[slot] = next;
+        count[slot] = 0;
+        while (next < pids_.size() && batch.size() + requests_per_process <= batch.capacity())
+        {
+            enter(pids_[next]);
+            for (const char *name : PROCESS_FILES)
             {
-                token.clear();
-                break;
+                batch.add_read(file(name));
             }
+            if (fd_sizes)
+            {
+                batch.add_size(file("fd"));
+            }
+            ++next;
+            ++count[slot];
         }
-
-        unsigned long long utime = 0;
-        unsigned long long stime = 0;
-        if (!(fields >> utime >> stime))
+        if (count[slot] != 0)
         {
-            continue;
+            batch.submit();
         }
+    };
 
-        const unsigned long long cpu_time = utime + stime;
-        next_cpu_times[pid] = cpu_time;
-
-        double cpuPercent = 0.0;
-        auto prev_iter = process_cpu_times_.find(pid);
-        if (prev_iter != process_cpu_times_.end() && cpu_time >= prev_iter->second && total_diff > 0)
+    // With io_uring two batches alternate: the kernel reads one while the other is parsed here.
+    for (std::size_t slot = 0; slot < depth; ++slot)
+    {
+        queue(slot);
+    }
+    for (std::size_t slot = 0; count[slot] != 0; slot = (slot + 1) % depth)
+    {
+        ProcFileBatch &batch = *proc_batches_[slot];
+        batch.wait();
+        for (std::size_t k = 0; k < count[slot]; ++k)
         {
-            const unsigned long long delta = cpu_time - prev_iter->second;
-            cpuPercent = static_cast<double>(delta) / static_cast<double>(total_diff) * 100.0;
-        }
+            const int pid = pids_[first[slot] + k];
+            const std::size_t base = k * requests_per_process;
 
-        std::ifstream status_file(base_path + "/status");
-        double memoryMb = 0.0;
-        if (status_file.is_open())
-        {
-            std::string line;
-            while (std::getline(status_file, line))
+            // Names and command lines are interned straight from the batch buffers, so the walk
+            // allocates only when it meets a string for the first time.
+            std::string_view stat_line;
+            if (!batch.contents(base + STAT_FILE, stat_line))
             {
-                if (line.rfind("VmRSS:", 0) == 0)
-                {
-                    std::istringstream rss_stream(line.substr(6));
-                    unsigned long long rss_kb = 0;
-                    rss_stream >> rss_kb;
-                    memoryMb = static_cast<double>(rss_kb) / 1024.0;
-                    break;
-                }
+                continue;
             }
-        }
 
-        std::string commandLine;
-        {
-            std::ifstream cmdline_file(base_path + "/cmdline", std::ios::in | std::ios::binary);
-            if (cmdline_file.is_open())
+            const std::size_t open = stat_line.find('(');
+            const std::size_t close = stat_line.rfind(')');
+            if (open == std::string_view::npos || close == std::string_view::npos || close <= open)
+            {
+                continue;
+            }
+
+            const std::string_view name = arena.intern(stat_line.substr(open + 1, close - open - 1));
+
+            // utime and stime are the 12th and 13th fields after the command name.
+            std::string_view fields = close + 2 < stat_line.size() ? stat_line.substr(close + 2) : std::string_view();
+            for (int i = 0; i < 11 && !fields.empty(); ++i)
             {
-                std::string raw((std::istreambuf_iterator<char>(cmdline_file)), std::istreambuf_iterator<char>());
-                cmdline_file.close();
+                const std::size_t space = fields.find(' ');
+                fields = space == std::string_view::npos ? std::string_view() : fields.substr(space + 1);
+            }
+
+            unsigned long long utime = 0;
+            unsigned long long stime = 0;
+            const auto utime_result = std::from_chars(fields.data(), fields.data() + fields.size(), utime);
+            if (utime_result.ec != std::errc() || utime_result.ptr == fields.data() + fields.size() ||
+                std::from_chars(utime_result.ptr + 1, fields.data() + fields.size(), stime).ec != std::errc())
+            {
+                continue;
+            }
+
+            ProcessCounters counters{};
+            counters.cpuTime = utime + stime;
+
+            ApplicationUsage usage{};
+            usage.pid = pid;
+            usage.name = name;
+
+            std::string_view status;
+            if (batch.contents(base + STATUS_FILE, status))
+            {
+                usage.memoryMb = static_cast<double>(status_value(status, "\nVmRSS:")) / 1024.0;
+                usage.threads = static_cast<unsigned int>(status_value(status, "\nThreads:"));
+                counters.voluntarySwitches = status_value(status, "\nvoluntary_ctxt_switches:");
+                counters.involuntarySwitches = status_value(status, "\nnonvoluntary_ctxt_switches:");
+            }
+            threadCount += usage.threads;
+
+            // Needs PTRACE_MODE_READ on the target; processes of other users simply report no I/O.
+            std::string_view io;
+            if (batch.contents(base + IO_FILE, io))
+            {
+                counters.readBytes = status_value(io, "\nread_bytes:");
+                counters.writeBytes = status_value(io, "\nwrite_bytes:");
+            }
+
+            const ProcessDetailScanner::Details *details = process_details_.find(pid);
+            usage.pssAgeMs = -1.0;
+            usage.cgroupAgeMs = -1.0;
+            if (details != nullptr)
+            {
+                usage.pssMb = static_cast<double>(details->pssKb) / 1024.0;
+                usage.cgroup = arena.intern(details->cgroup);
+                usage.pssAgeMs = age_ms(details->readAt[static_cast<std::size_t>(ProcessDetailScanner::Probe::Pss)]);
+                usage.cgroupAgeMs = age_ms(details->readAt[static_cast<std::size_t>(ProcessDetailScanner::Probe::Cgroup)]);
+            }
+            if (fd_sizes)
+            {
+                unsigned long long fds = 0;
+                usage.openFds = batch.size(base + std::size(PROCESS_FILES), fds) ? static_cast<unsigned int>(fds) : 0U;
+            }
+            else if (process_details_.enabled())
+            {
+                usage.openFds = details != nullptr ? details->openFds : 0U;
+                usage.openFdsAgeMs = details != nullptr ? age_ms(details->readAt[static_cast<std::size_t>(ProcessDetailScanner::Probe::OpenFds)]) : -1.0;
+            }
+            else
+            {
+                enter(pid);
+                usage.openFds = fd_count_by_listing(file("fd").c_str());
+            }
 
-                for (char &ch : raw)
+            auto previous = process_counters_.find(pid);
+            if (previous != process_counters_.end())
+            {
+                const ProcessCounters &before = previous->second;
+                if (counters.cpuTime >= before.cpuTime && total_diff > 0)
                 {
-                    if (ch == '\0')
-                    {
-                        ch = ' ';
-                    }
+                    usage.cpuPercent = static_cast<double>(counters.cpuTime - before.cpuTime) / static_cast<double>(total_diff) * 100.0;
                 }
+                usage.ioReadKbps = rate(counters.readBytes, before.readBytes) / 1024.0;
+                usage.ioWriteKbps = rate(counters.writeBytes, before.writeBytes) / 1024.0;
+                usage.voluntarySwitches = rate(counters.voluntarySwitches, before.voluntarySwitches);
+                usage.involuntarySwitches = rate(counters.involuntarySwitches, before.involuntarySwitches);
+            }
+            next_counters[pid] = counters;
 
-                std::size_t first_non_space = raw.find_first_not_of(' ');
+            std::string_view cmdline;
+            if (batch.contents(base + CMDLINE_FILE, cmdline))
+            {
+                proc_buffer_.assign(cmdline);
+                std::replace(proc_buffer_.begin(), proc_buffer_.end(), '\0', ' ');
+                const std::size_t first_non_space = proc_buffer_.find_first_not_of(' ');
                 if (first_non_space != std::string::npos)
                 {
-                    commandLine = raw.substr(first_non_space);
+                    usage.commandLine = arena.intern(std::string_view(proc_buffer_).substr(first_non_space));
                 }
             }
-        }
 
-        if (commandLine.empty())
-        {
-            commandLine = name;
-        }
+            if (usage.commandLine.empty())
+            {
+                usage.commandLine = name;
+            }
 
-        ApplicationUsage usage{pid, name, cpuPercent, memoryMb, commandLine};
-        result.push_back(std::move(usage));
+            result.push_back(usage);
+        }
+        queue(slot);
     }
 
-    closedir(proc_dir);
-    process_cpu_times_ = std::move(next_cpu_times);
+    process_counters_ = std::move(next_counters);
 
-    std::sort(result.begin(), result.end(), [](const ApplicationUsage &lhs, const ApplicationUsage &rhs)
+    // Sort an index over the numeric columns, then permute every column once.
+    const std::vector<double> &cpu = result.column(ProcessTable::Column::CpuPercent);
+    const std::vector<double> &memory = result.column(ProcessTable::Column::MemoryMb);
+    const std::vector<double> &pids = result.column(ProcessTable::Column::Pid);
+    std::vector<std::size_t> order(result.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs)
               {
-        if (std::abs(lhs.cpuPercent - rhs.cpuPercent) > 0.0001)
+        if (std::abs(cpu[lhs] - cpu[rhs]) > 0.0001)
         {
-            return lhs.cpuPercent > rhs.cpuPercent;
+            return cpu[lhs] > cpu[rhs];
         }
-        if (std::abs(lhs.memoryMb - rhs.memoryMb) > 0.0001)
+        if (std::abs(memory[lhs] - memory[rhs]) > 0.0001)
         {
-            return lhs.memoryMb > rhs.memoryMb;
+            return memory[lhs] > memory[rhs];
         }
-        return lhs.pid < rhs.pid; });
+        return pids[lhs] < pids[rhs]; });
+    result.reorder(order);
+    const std::vector<double> &ranked = result.column(ProcessTable::Column::Pid);
+    process_details_.rank(ranked.begin(), ranked.end());
 
     return result;
 }
 
 std::pair<unsigned int, unsigned int> MetricsCollector::read_process_thread_counts()
 {
-    DIR *proc_dir = opendir("/proc");
+    DIR *proc_dir = opendir(proc_root_.c_str());
     if (proc_dir == nullptr)
     {
         return {0U, 0U};
@@ -644,7 +1473,7 @@ std::pair<unsigned int, unsigned int> MetricsCollector::read_process_thread_coun
 
         ++process_count;
 
-        const std::string status_path = std::string("/proc/") + entry->d_name + "/status";
+        const std::string status_path = proc_root_ + '/' + entry->d_name + "/status";
         std::ifstream status_file(status_path);
         if (!status_file.is_open())
         {
@@ -730,17 +1559,17 @@ std::pair<unsigned int, unsigned int> MetricsCollector::read_listening_ports() c
         return count;
     };
 
-    const unsigned int tcp4 = count_listening(PROC_TCP4_PATH, true);
-    const unsigned int tcp6 = count_listening(PROC_TCP6_PATH, true);
-    const unsigned int udp4 = count_listening(PROC_UDP4_PATH, false);
-    const unsigned int udp6 = count_listening(PROC_UDP6_PATH, false);
+    const unsigned int tcp4 = count_listening(proc_root_ + PROC_TCP4_PATH, true);
+    const unsigned int tcp6 = count_listening(proc_root_ + PROC_TCP6_PATH, true);
+    const unsigned int udp4 = count_listening(proc_root_ + PROC_UDP4_PATH, false);
+    const unsigned int udp6 = count_listening(proc_root_ + PROC_UDP6_PATH, false);
 
     return {tcp4 + tcp6, udp4 + udp6};
 }
 
 unsigned long MetricsCollector::read_open_file_descriptors() const
 {
-    std::ifstream file("/proc/sys/fs/file-nr");
+    std::ifstream file(proc_root_ + PROC_FILE_NR_PATH);
     if (!file.is_open())
     {
         return 0UL;
@@ -758,7 +1587,7 @@ unsigned long MetricsCollector::read_open_file_descriptors() const
     return allocated - unused;
 }
 
-std::pair<std::vector<DockerContainerSummary>, std::vector<DockerImageSummary>> MetricsCollector::read_docker_inventory(bool &available) const
+std::pair<ContainerTable, std::vector<DockerImageSummary>> MetricsCollector::read_docker_inventory(bool &available, SnapshotArena &arena) const
 {
     available = false;
     std::vector<DockerContainerSummary> containers;
@@ -947,10 +1776,10 @@ std::pair<std::vector<DockerContainerSummary>, std::vector<DockerImageSummary>>
             }
 
             DockerContainerSummary summary{};
-            summary.id = parts[0];
-            summary.name = parts[1].empty() ? parts[0] : parts[1];
-            summary.image = parts[2];
-            summary.status = parts[3];
+            summary.id = arena.intern(parts[0]);
+            summary.name = arena.intern(parts[1].empty() ? parts[0] : parts[1]);
+            summary.image = arena.intern(parts[2]);
+            summary.status = arena.intern(parts[3]);
             summary.cpuPercent = 0.0;
             summary.memoryUsageMb = 0.0;
             summary.memoryLimitMb = 0.0;
@@ -960,7 +1789,7 @@ std::pair<std::vector<DockerContainerSummary>, std::vector<DockerImageSummary>>
             summary.blockReadKb = 0.0;
             summary.blockWriteKb = 0.0;
             summary.pids = 0U;
-            container_map[summary.id] = std::move(summary);
+            container_map[parts[0]] = summary;
         }
     }
 
@@ -986,10 +1815,10 @@ std::pair<std::vector<DockerContainerSummary>, std::vector<DockerImageSummary>>
             if (iter == container_map.end())
             {
                 DockerContainerSummary summary{};
-                summary.id = parts[0];
-                summary.name = parts[1];
-                summary.image = std::string();
-                summary.status = std::string();
+                summary.id = arena.intern(parts[0]);
+                summary.name = arena.intern(parts[1]);
+                summary.image = std::string_view();
+                summary.status = std::string_view();
                 summary.cpuPercent = 0.0;
                 summary.memoryUsageMb = 0.0;
                 summary.memoryLimitMb = 0.0;
@@ -999,11 +1828,11 @@ std::pair<std::vector<DockerContainerSummary>, std::vector<DockerImageSummary>>
                 summary.blockReadKb = 0.0;
                 summary.blockWriteKb = 0.0;
                 summary.pids = 0U;
-                iter = container_map.emplace(summary.id, std::move(summary)).first;
+                iter = container_map.emplace(parts[0], summary).first;
             }
 
             DockerContainerSummary &summary = iter->second;
-            summary.name = parts[1].empty() ? summary.id : parts[1];
+            summary.name = parts[1].empty() ? summary.id : arena.intern(parts[1]);
             summary.cpuPercent = parse_percent(parts[2]);
 
             const std::size_t slash = parts[3].find('/');
@@ -1050,6 +1879,39 @@ std::pair<std::vector<DockerContainerSummary>, std::vector<DockerImageSummary>>
         }
         return lhs.id < rhs.id; });
 
+    // docker ps prints short ids; the cgroup directory carries the full one.
+    const auto cgroups = docker_cgroups(sys_root_);
+    std::string pressure_text;
+    for (auto &container : containers)
+    {
+        container.cpuPressure = -1.0;
+        container.memoryPressure = -1.0;
+        container.ioPressure = -1.0;
+        const auto cgroup = std::find_if(cgroups.begin(), cgroups.end(), [&container](const auto &entry)
+                                         { return !container.id.empty() && entry.first.compare(0, container.id.size(), container.id) == 0; });
+        if (cgroup == cgroups.end())
+        {
+            continue;
+        }
+        for (const auto &[file, value] : {std::pair<const char *, double *>{"/cpu.pressure", &container.cpuPressure},
+                                          {"/memory.pressure", &container.memoryPressure},
+                                          {"/io.pressure", &container.ioPressure}})
+        {
+            PressureStall stall{};
+            if (read_proc_file((cgroup->second + file).c_str(), pressure_text) && parse_pressure(pressure_text, stall))
+            {
+                *value = stall.someAvg10;
+            }
+        }
+    }
+
+    ContainerTable table;
+    table.reserve(containers.size());
+    for (const auto &container : containers)
+    {
+        table.push_back(container);
+    }
+
     std::vector<std::string> image_lines;
     if (run_command("docker images --format '{{.Repository}}|{{.Tag}}|{{.ID}}|{{.Size}}'", image_lines))
     {
@@ -1069,15 +1931,15 @@ std::pair<std::vector<DockerContainerSummary>, std::vector<DockerImageSummary>>
             }
 
             DockerImageSummary image{};
-            image.repository = parts[0];
-            image.tag = parts[1];
-            image.id = parts[2];
-            image.size = parts[3];
-            images.push_back(std::move(image));
+            image.repository = arena.intern(parts[0]);
+            image.tag = arena.intern(parts[1]);
+            image.id = arena.intern(parts[2]);
+            image.size = arena.intern(parts[3]);
+            images.push_back(image);
         }
     }
 
-    return {containers, images};
+    return {std::move(table), std::move(images)};
 }
 
 std::string MetricsCollector::resolve_hostname(const std::string &address, bool ipv6)
@@ -1094,37 +1956,7 @@ std::string MetricsCollector::resolve_hostname(const std::string &address, bool
         return it->second;
     }
 
-    char host[NI_MAXHOST];
-    int result = -1;
-
-    if (ipv6)
-    {
-        sockaddr_in6 sa{};
-        sa.sin6_family = AF_INET6;
-        if (inet_pton(AF_INET6, address.c_str(), &sa.sin6_addr) == 1)
-        {
-            result = getnameinfo(reinterpret_cast<sockaddr *>(&sa), sizeof(sa), host, sizeof(host), nullptr, 0, NI_NAMEREQD);
-        }
-    }
-    else
-    {
-        sockaddr_in sa{};
-        sa.sin_family = AF_INET;
-        if (inet_pton(AF_INET, address.c_str(), &sa.sin_addr) == 1)
-        {
-            result = getnameinfo(reinterpret_cast<sockaddr *>(&sa), sizeof(sa), host, sizeof(host), nullptr, 0, NI_NAMEREQD);
-        }
-    }
-
-    std::string resolved;
-    if (result == 0)
-    {
-        resolved = host;
-    }
-    else
-    {
-        resolved = address;
-    }
+    const std::string resolved = timed(CollectorStage::ReverseDns, [&] { return reverse_lookup(address, ipv6); });
 
     dns_cache_[cache_key] = resolved;
     return resolved;
@@ -1194,13 +2026,13 @@ MetricsCollector::ConnectionSummary MetricsCollector::read_connection_summary()
         }
     };
 
-    parse_tcp_file(PROC_TCP4_PATH, false);
-    parse_tcp_file(PROC_TCP6_PATH, true);
+    parse_tcp_file(proc_root_ + PROC_TCP4_PATH, false);
+    parse_tcp_file(proc_root_ + PROC_TCP6_PATH, true);
 
     return summary;
 }
 
-std::vector<DomainUsage> MetricsCollector::build_domain_usage(const ConnectionSummary &summary, double totalRx, double totalTx) const
+std::vector<DomainUsage> MetricsCollector::build_domain_usage(const ConnectionSummary &summary, double totalRx, double totalTx, SnapshotArena &arena) const
 {
     std::vector<DomainUsage> result;
     if (summary.totalConnections <= 0 || summary.domainCounts.empty())
@@ -1211,7 +2043,7 @@ std::vector<DomainUsage> MetricsCollector::build_domain_usage(const ConnectionSu
     for (const auto &entry : summary.domainCounts)
     {
         DomainUsage usage;
-        usage.domain = entry.first;
+        usage.domain = arena.intern(entry.first);
         usage.connections = entry.second;
         const double ratio = static_cast<double>(entry.second) / static_cast<double>(summary.totalConnections);
         usage.receiveRate = totalRx * ratio;
@@ -1236,12 +2068,30 @@ std::vector<DomainUsage> MetricsCollector::build_domain_usage(const ConnectionSu
 
 std::array<double, 3> MetricsCollector::read_load_averages() const
 {
+    // Parsed from <proc>/loadavg rather than getloadavg() so a mounted host procfs is honoured.
     std::array<double, 3> loads{0.0, 0.0, 0.0};
-    if (getloadavg(loads.data(), static_cast<int>(loads.size())) != -1)
+    std::ifstream file(proc_root_ + PROC_LOADAVG_PATH);
+    if (!(file >> loads[0] >> loads[1] >> loads[2]))
+    {
+        return {0.0, 0.0, 0.0};
+    }
+    return loads;
+}
+
+PressureMetrics MetricsCollector::read_pressure() const
+{
+    PressureMetrics pressure{};
+    std::string text;
+    const std::pair<const char *, PressureStall *> files[] = {
+        {PROC_PRESSURE_CPU_PATH, &pressure.cpu}, {PROC_PRESSURE_MEMORY_PATH, &pressure.memory}, {PROC_PRESSURE_IO_PATH, &pressure.io}};
+    for (const auto &[path, stall] : files)
     {
-        return loads;
+        if (read_proc_file((proc_root_ + path).c_str(), text) && parse_pressure(text, *stall))
+        {
+            pressure.available = true;
+        }
     }
-    return {0.0, 0.0, 0.0};
+    return pressure;
 }
 
 unsigned int MetricsCollector::detect_cpu_count()
@@ -1256,6 +2106,15 @@ unsigned int MetricsCollector::detect_cpu_count()
 
 unsigned int MetricsCollector::query_cpu_count() const
 {
+    std::string online;
+    if (read_proc_file((sys_root_ + SYS_CPU_ONLINE_PATH).c_str(), online))
+    {
+        const unsigned int listed = count_cpu_list(online);
+        if (listed > 0)
+        {
+            return listed;
+        }
+    }
     const unsigned int count = std::thread::hardware_concurrency();
     return count == 0 ? 1U : count;
 }
@@ -1,54 +1,104 @@
 #pragma once
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <deque>
+#include <functional>
+#include <memory>
 #include <tuple>
 #include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
-struct ApplicationUsage
-{
-    int pid;
-    std::string name;
-    double cpuPercent;
-    double memoryMb;
-    std::string commandLine;
-};
+#include "collector_governor.h"
+#include "metric_tables.h"
+#include "pressure.h"
+#include "proc_file_batch.h"
+#include "process_details.h"
+#include "process_events.h"
+#include "snapshot_arena.h"
+#include "snapshot_publisher.h"
+#include "stage_executor.h"
+
+class TargetIndex;
 
+// String fields of the summaries below view memory owned by the snapshot's SnapshotArena.
 struct DomainUsage
 {
-    std::string domain;
+    std::string_view domain;
     double receiveRate;
     double transmitRate;
     int connections;
 };
 
-struct DockerContainerSummary
+struct DockerImageSummary
 {
-    std::string id;
-    std::string name;
-    std::string image;
-    std::string status;
-    double cpuPercent;
-    double memoryUsageMb;
-    double memoryLimitMb;
-    double memoryPercent;
-    double networkRxKb;
-    double networkTxKb;
-    double blockReadKb;
-    double blockWriteKb;
-    unsigned int pids;
+    std::string_view repository;
+    std::string_view tag;
+    std::string_view id;
+    std::string_view size;
 };
 
-struct DockerImageSummary
+// Expensive collector stages that can be skipped when no consumer asked for their fields.
+enum CollectorSection : unsigned int
+{
+    SECTION_APPLICATIONS = 1U << 0,    // per-process walk (topApplications)
+    SECTION_PROCESS_COUNTS = 1U << 1,  // processCount / threadCount
+    SECTION_CONNECTIONS = 1U << 2,     // activeConnections, domainUsage (reverse DNS)
+    SECTION_LISTENING_PORTS = 1U << 3, // listeningTcp / listeningUdp
+    SECTION_DOCKER = 1U << 4,          // docker CLI inventory
+    SECTION_ALL = (1U << 5) - 1
+};
+
+// The agent's own cost, captured with each collection (see self_stats.h for the full breakdown).
+struct AgentMetrics
+{
+    double collectionMs;             // Duration of the collection that produced this snapshot
+    double collectionP99Ms;          // p99 collection duration since start
+    double requestP99Ms;             // p99 REST handler time since start
+    unsigned long long allocations;  // Heap allocations since start (0 when not tracked)
+    unsigned long long readSyscalls; // read(2)-family system calls since start
+    unsigned long long writeSyscalls;
+    unsigned long long bytesSent;    // HTTP and WebSocket bytes written since start
+    double collectionCpuMs;          // Thread CPU time of this collection's stages
+    double cpuPercent;               // Collector CPU share the governor projects, % of one core
+    double intervalMs;               // Effective time between collections
+    double detailIntervalMs;         // Effective time between collections of the CollectorSection data
+};
+
+// A process that started and exited between two process walks, known only from kernel events.
+struct ShortLivedProcess
+{
+    int pid;
+    std::string_view name; // comm after exec; inherited from the parent otherwise (empty if the parent predates tracking)
+    double lifetimeMs;
+    int exitCode;          // exit status, or 128 + signal number
+};
+
+// Process lifecycle from the kernel proc connector; all zero unless process events are enabled.
+struct ProcessChurn
 {
-    std::string repository;
-    std::string tag;
-    std::string id;
-    std::string size;
+    bool eventDriven;                          // subscribed: /proc is listed only to reconcile the tracked set
+    unsigned long long forks;                  // since the agent started
+    unsigned long long execs;
+    unsigned long long exits;
+    std::vector<ShortLivedProcess> shortLived; // since the previous walk, oldest first
+    unsigned long long shortLivedDropped;      // short-lived processes beyond the list's cap
+};
+
+// Host pressure stall information from <proc>/pressure; zero when the kernel lacks PSI (before 4.20, or psi=0).
+struct PressureMetrics
+{
+    bool available;
+    PressureStall cpu;
+    PressureStall memory;
+    PressureStall io;
+    unsigned long long triggers; // PSI trigger events since start (MONITORING_PSI_TRIGGER_MS)
 };
 
 struct SystemMetrics
@@ -60,6 +110,9 @@ struct SystemMetrics
     double loadAverage1;                                  // Load average for the last minute
     double loadAverage5;                                  // Load average for the last 5 minutes
     double loadAverage15;                                 // Load average for the last 15 minutes
+    unsigned int procsRunning;                            // Runnable tasks (procs_running in /proc/stat)
+    unsigned int procsBlocked;                            // Tasks blocked on I/O (procs_blocked)
+    PressureMetrics pressure;                             // Stall time per resource
     double networkReceiveRate;                            // Inbound network throughput in KB/s
     double networkTransmitRate;                           // Outbound network throughput in KB/s
     double networkReceiveRateAverage;                     // Rolling average inbound throughput in KB/s
@@ -74,37 +127,126 @@ struct SystemMetrics
     unsigned long openFileDescriptors;                    // Open file descriptors reported by kernel
     std::size_t uniqueDomains;                            // Unique remote domains observed
     std::chrono::system_clock::time_point timestamp;      // Collection time
-    std::vector<ApplicationUsage> topApplications;        // Top processes by utilisation
+    ProcessTable topApplications;                         // Processes by utilisation, busiest first (columnar)
     std::vector<DomainUsage> domainUsage;                 // Aggregated network usage per domain
     bool dockerAvailable;                                 // Whether Docker CLI is accessible
-    std::vector<DockerContainerSummary> dockerContainers; // Running Docker containers
+    ContainerTable dockerContainers;                      // Running Docker containers (columnar)
     std::vector<DockerImageSummary> dockerImages;         // Available Docker images
+    AgentMetrics agent;                                   // Self-instrumentation at collection time
+    ProcessChurn processChurn;                            // Process lifecycle events (applications section)
+    unsigned int sections;                                // CollectorSection bits populated in this snapshot
+    unsigned int collectedSections;                       // Of those, the ones sampled for it rather than carried over
+    unsigned long long sequence;                          // Monotonic snapshot version (changes whenever content does)
+    std::shared_ptr<const TargetIndex> targetIndex;       // Lazily built name index shared by copies of this snapshot
+    std::shared_ptr<const SnapshotArena> arena;           // Owns every string the summaries above view
+};
+
+// Timed steps of a collection, reported to stage listeners.
+enum class CollectorStage : std::size_t
+{
+    Cpu,             // /proc/stat
+    Memory,          // /proc/meminfo (memory and swap)
+    Disk,            // statvfs on /
+    Network,         // /proc/net/dev
+    LoadAverage,     // /proc/loadavg
+    Pressure,        // /proc/pressure/{cpu,memory,io}
+    FileDescriptors, // /proc/sys/fs/file-nr
+    Processes,       // per-process walk (SECTION_APPLICATIONS)
+    ProcessCounts,   // count-only walk (SECTION_PROCESS_COUNTS without applications)
+    ListeningPorts,  // /proc/net/{tcp,udp}{,6}
+    Connections,     // /proc/net/tcp{,6} plus domain attribution
+    ReverseDns,      // one uncached reverse lookup, nested inside Connections
+    Docker,          // docker CLI inventory
+    Count
+};
+
+const char *collector_stage_name(CollectorStage stage);
+
+struct CollectorConfig
+{
+    std::string proc_root = "/proc"; // procfs to read, e.g. /host/proc when monitoring the host from a container
+    std::string sys_root = "/sys";   // sysfs to read (CPU topology)
+    std::size_t threads = 1;         // threads running independent stages, the collecting thread included
+    bool io_uring = false;           // batch the per-process /proc reads through io_uring when the kernel allows
+    bool process_events = false;     // follow fork/exec/exit through the proc connector instead of listing /proc
+    std::chrono::seconds rescan_interval{30}; // full /proc listing that reconciles the event-driven process set
+    std::chrono::microseconds detail_budget{2000}; // per walk for PSS, cgroup and (before Linux 6.2) fd probes; 0 disables them
+    std::size_t detail_syscalls = 256;             // per walk, for the same probes
+    std::size_t detail_top_k = 10;                 // busiest processes probed before the round-robin
+    double cpu_budget_percent = 0.0;               // collector CPU share of one core to stay under; 0 samples at full rate
 };
 
 class MetricsCollector
 {
 public:
-    MetricsCollector();
-    SystemMetrics collect();
+    // Listeners run on the collecting thread for every fresh snapshot and must not call collect().
+    using SnapshotListener = std::function<void(const SystemMetrics &)>;
+    // Called when a stage finishes, while the collector lock is held. With more than one collector
+    // thread, stages finish on pool threads and listeners may run concurrently.
+    using StageListener = std::function<void(CollectorStage stage, std::chrono::steady_clock::time_point start,
+                                             std::chrono::steady_clock::time_point end)>;
+
+    explicit MetricsCollector(CollectorConfig config = CollectorConfig());
+    ~MetricsCollector();
+
+    // Collects every section once on the caller, then starts the collecting thread, which collects at the
+    // governed interval and early when a latest() reader asks for missing sections or a pressure trigger
+    // fires. stop() must run before anything the snapshot listeners use goes away.
+    void start();
+    void stop();
+    // Shared, immutable view of the current snapshot, refreshed first when it is stale or lacks `sections`.
+    // Readers of an up-to-date snapshot take no lock and copy nothing. May collect on the calling thread.
+    std::shared_ptr<const SystemMetrics> snapshot(unsigned int sections = SECTION_ALL);
+    // The published snapshot, never collecting: for I/O threads. Demand for `sections` is noted, and when
+    // the snapshot lacks them the collecting thread is woken to add them, so the returned snapshot may
+    // still lack them. Collects on the caller only before start() has published anything.
+    std::shared_ptr<const SystemMetrics> latest(unsigned int sections = SECTION_ALL);
+    // latest(), then blocks up to `wait` for the collecting thread to publish the missing sections; returns
+    // the newest snapshot either way, so the caller must still check its sections.
+    std::shared_ptr<const SystemMetrics> latest(unsigned int sections, std::chrono::milliseconds wait);
+    // Deep copy of snapshot(sections), for callers that need to modify it.
+    SystemMetrics collect(unsigned int sections = SECTION_ALL);
+    // Brings the snapshot up to date and returns its sequence number.
+    unsigned long long refresh(unsigned int sections = SECTION_ALL);
+    void add_listener(SnapshotListener listener);
+    void add_stage_listener(StageListener listener);
+    // Current time between collections; snapshots requested more often are served from the cache.
+    std::chrono::milliseconds interval() const;
+    // Records a PSI trigger event (see PressureTriggers): it is counted in pressure.triggers, and the next
+    // collection happens even within the governed interval, as long as the last one is at least the
+    // minimum interval old.
+    void on_pressure_trigger(PressureResource resource);
 
     static std::string to_iso8601(const std::chrono::system_clock::time_point &timePoint);
 
 private:
+    // Cumulative per-process counters from the previous walk, for CPU, I/O and context-switch rates.
+    struct ProcessCounters
+    {
+        unsigned long long cpuTime;
+        unsigned long long readBytes;
+        unsigned long long writeBytes;
+        unsigned long long voluntarySwitches;
+        unsigned long long involuntarySwitches;
+    };
+
     struct ConnectionSummary
     {
         int totalConnections;
         std::unordered_map<std::string, int> domainCounts;
     };
 
-    double read_cpu_usage();
+    double read_cpu_usage(unsigned int &procsRunning, unsigned int &procsBlocked);
     double read_memory_usage();
     double read_swap_usage();
-    std::vector<ApplicationUsage> read_application_usage();
+    ProcessChurn read_process_churn(SnapshotArena &arena);
+    ProcessTable read_application_usage(SnapshotArena &arena, unsigned int &processCount, unsigned int &threadCount);
     ConnectionSummary read_connection_summary();
-    std::vector<DomainUsage> build_domain_usage(const ConnectionSummary &summary, double totalRx, double totalTx) const;
+    std::vector<DomainUsage> build_domain_usage(const ConnectionSummary &summary, double totalRx, double totalTx, SnapshotArena &arena) const;
     double read_disk_usage();
     std::tuple<double, double> read_network_throughput();
     std::array<double, 3> read_load_averages() const;
+    PressureMetrics read_pressure() const;
     unsigned int detect_cpu_count();
     unsigned int query_cpu_count() const;
     std::pair<unsigned int, unsigned int> read_process_thread_counts();
@@ -114,14 +256,28 @@ private:
     double compute_average(std::deque<std::pair<std::chrono::steady_clock::time_point, double>> &samples,
                            const std::chrono::steady_clock::time_point &now,
                            const std::chrono::steady_clock::duration &window) const;
-    std::pair<std::vector<DockerContainerSummary>, std::vector<DockerImageSummary>> read_docker_inventory(bool &available) const;
+    std::pair<ContainerTable, std::vector<DockerImageSummary>> read_docker_inventory(bool &available, SnapshotArena &arena) const;
+    void add_section_stages(StageGraph &graph, SystemMetrics &metrics, unsigned int sections, SnapshotArena &arena,
+                            std::initializer_list<StageGraph::TaskId> afterCpu,
+                            std::initializer_list<StageGraph::TaskId> afterNetwork);
+    void refresh_locked(unsigned int sections);
+    void run();
+    void notify_published();
+    std::chrono::steady_clock::time_point next_collection_due() const;
+    void note_demand(unsigned int sections, long long nowNs);
+    void mark_collected(unsigned int sections, std::chrono::steady_clock::time_point when);
     std::string resolve_hostname(const std::string &address, bool ipv6);
+    template <typename Step>
+    decltype(auto) timed(CollectorStage stage, Step &&step);
+
+    const std::string proc_root_;
+    const std::string sys_root_;
 
     std::mutex mutex_;
     bool cpu_initialized_;
     unsigned long long previous_total_;
     unsigned long long previous_idle_;
-    unsigned long long last_cpu_total_diff_;
+    unsigned long long application_cpu_total_;
     bool cpu_count_cached_;
     unsigned int cached_cpu_count_;
     bool network_initialized_;
@@ -130,10 +286,39 @@ private:
     std::chrono::steady_clock::time_point previous_network_sample_;
     bool has_cached_sample_;
     std::chrono::steady_clock::time_point last_collection_time_;
-    SystemMetrics cached_metrics_;
-    std::unordered_map<int, unsigned long long> process_cpu_times_;
+    std::shared_ptr<const SystemMetrics> cached_metrics_; // what snapshots_ currently publishes; never modified after publication
+    SnapshotPublisher<SystemMetrics> snapshots_;
+    std::atomic<long long> collected_at_ns_; // steady-clock time of the last full collection, for the lock-free freshness check
+    std::atomic<long long> interval_ns_;     // governed time between collections, for the same check
+    std::atomic<bool> expedited_;            // a pressure trigger fired: collect on the next request
+    std::atomic<unsigned long long> pressure_triggers_;
+    CollectorGovernor governor_;
+    std::array<std::chrono::steady_clock::time_point, 5> section_collected_; // last collection of each section, top-ups included
+    unsigned long long sequence_;
+    std::size_t arena_hint_; // footprint of the last full snapshot's arena, used to size the next one
+    std::string proc_buffer_; // command line being normalised during the process walk
+    std::chrono::steady_clock::time_point previous_process_walk_;
+    const bool fd_count_from_stat_; // stat() on /proc/<pid>/fd yields the descriptor count (Linux 6.2+)
+    std::unordered_map<int, ProcessCounters> process_counters_;
     std::deque<std::pair<std::chrono::steady_clock::time_point, double>> cpu_samples_;
     std::deque<std::pair<std::chrono::steady_clock::time_point, double>> rx_samples_;
     std::deque<std::pair<std::chrono::steady_clock::time_point, double>> tx_samples_;
     std::unordered_map<std::string, std::string> dns_cache_;
+    std::vector<SnapshotListener> listeners_;
+    std::vector<StageListener> stage_listeners_;
+    std::array<std::atomic<long long>, 5> section_demand_; // steady-clock ns of the last request per section (0 = never)
+    std::vector<int> pids_;                                     // process directories of the current walk
+    std::unique_ptr<ProcessEventTracker> process_events_;       // null unless enabled and subscribed
+    const std::chrono::steady_clock::duration rescan_interval_;
+    std::chrono::steady_clock::time_point last_rescan_;
+    std::vector<ProcessEventTracker::Exit> short_lived_;        // reused between walks
+    ProcessDetailScanner process_details_;
+    std::array<std::unique_ptr<ProcFileBatch>, 2> proc_batches_; // the second only with io_uring, to overlap reads and parsing
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::condition_variable published_; // signalled after every publication, for latest() readers waiting on sections
+    unsigned int wanted_sections_; // sections latest() readers found missing; guarded by wake_mutex_
+    bool running_;                 // guarded by wake_mutex_
+    std::thread thread_;           // the collecting thread
+    StageExecutor executor_; // last member: its threads stop before the state they work on goes
 };
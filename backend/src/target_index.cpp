@@ -0,0 +1,314 @@
+#include "target_index.h"
+
+#include "system_metrics.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+namespace
+{
+    constexpr std::size_t MAX_TARGETS = 16;
+    constexpr std::size_t MAX_REGEX_LENGTH = 128;
+    // NFA states an expression may enter across every document of one query, about 25 ms of one thread.
+    constexpr std::size_t MAX_REGEX_STEPS = 4'000'000;
+    constexpr const char *PREFIX_MARKER = "prefix:";
+    constexpr const char *REGEX_MARKER = "re:";
+
+    char fold(char ch)
+    {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    }
+
+    std::uint32_t trigram_at(std::string_view value, std::size_t pos)
+    {
+        return (static_cast<std::uint32_t>(static_cast<unsigned char>(value[pos])) << 16) |
+               (static_cast<std::uint32_t>(static_cast<unsigned char>(value[pos + 1])) << 8) |
+               static_cast<std::uint32_t>(static_cast<unsigned char>(value[pos + 2]));
+    }
+
+    bool starts_with(const std::string &value, const char *marker)
+    {
+        return value.rfind(marker, 0) == 0;
+    }
+
+} // namespace
+
+bool TargetQuery::parse_list(const std::string &raw, std::vector<TargetQuery> &queries, std::string &error)
+{
+    std::size_t position = 0;
+    while (position < raw.size())
+    {
+        const auto begin = raw.find_first_not_of(" \t", position);
+        if (begin == std::string::npos)
+        {
+            break;
+        }
+        // A regular expression may contain commas itself, so it runs to the end of the list.
+        const auto end = raw.compare(begin, std::char_traits<char>::length(REGEX_MARKER), REGEX_MARKER) == 0
+                             ? raw.size()
+                             : std::min(raw.find(',', begin), raw.size());
+        position = end + 1;
+        std::string term = raw.substr(begin, end - begin);
+        term.erase(term.find_last_not_of(" \t") + 1);
+        if (term.empty())
+        {
+            continue;
+        }
+
+        if (queries.size() == MAX_TARGETS)
+        {
+            error = "Too many targets (at most " + std::to_string(MAX_TARGETS) + ")";
+            return false;
+        }
+
+        TargetQuery query{};
+        if (starts_with(term, REGEX_MARKER))
+        {
+            query.kind = Kind::Regex;
+            if (term.size() - std::char_traits<char>::length(REGEX_MARKER) > MAX_REGEX_LENGTH)
+            {
+                error = "Target expression too long (at most " + std::to_string(MAX_REGEX_LENGTH) + " characters)";
+                return false;
+            }
+            std::string reason;
+            if (!query.pattern.compile(std::string_view(term).substr(std::char_traits<char>::length(REGEX_MARKER)), reason))
+            {
+                error = "Invalid target expression '" + term + "': " + reason;
+                return false;
+            }
+        }
+        else
+        {
+            query.kind = starts_with(term, PREFIX_MARKER) ? Kind::Prefix : Kind::Substring;
+            const std::string text = query.kind == Kind::Prefix ? term.substr(std::char_traits<char>::length(PREFIX_MARKER)) : term;
+            query.folded.resize(text.size());
+            std::transform(text.begin(), text.end(), query.folded.begin(), fold);
+            if (query.folded.empty())
+            {
+                continue;
+            }
+        }
+
+        queries.push_back(std::move(query));
+    }
+    return true;
+}
+
+void TargetIndex::add_document(Owner owner, std::size_t entity, std::string_view value, bool prefixable) const
+{
+    if (value.empty())
+    {
+        return;
+    }
+
+    Document document{};
+    document.offset = static_cast<std::uint32_t>(folded_.size());
+    document.length = static_cast<std::uint32_t>(value.size());
+    document.entity = static_cast<std::uint32_t>(entity);
+    document.owner = owner;
+    std::transform(value.begin(), value.end(), std::back_inserter(folded_), fold);
+
+    const auto id = static_cast<std::uint32_t>(documents_.size());
+    documents_.push_back(document);
+    if (prefixable)
+    {
+        prefix_order_.push_back(id);
+    }
+
+    const std::string_view folded = text(document);
+    for (std::size_t pos = 0; pos + 3 <= folded.size(); ++pos)
+    {
+        auto &postings = trigrams_[trigram_at(folded, pos)];
+        if (postings.empty() || postings.back() != id)
+        {
+            postings.push_back(id);
+        }
+    }
+}
+
+std::string_view TargetIndex::text(const Document &document) const
+{
+    return std::string_view(folded_).substr(document.offset, document.length);
+}
+
+void TargetIndex::build(const SystemMetrics &metrics) const
+{
+    application_count_ = metrics.topApplications.size();
+
+    std::size_t bytes = 0;
+    for (const auto &app : metrics.topApplications)
+    {
+        bytes += app.name.size() + app.commandLine.size();
+    }
+    for (const auto &container : metrics.dockerContainers)
+    {
+        bytes += container.name.size() + container.id.size() + container.image.size();
+    }
+    folded_.reserve(bytes);
+    documents_.reserve(metrics.topApplications.size() * 2 + metrics.dockerContainers.size() * 3);
+
+    for (std::size_t i = 0; i < metrics.topApplications.size(); ++i)
+    {
+        const auto &app = metrics.topApplications[i];
+        add_document(Owner::Application, i, app.name, true);
+        if (app.commandLine != app.name)
+        {
+            add_document(Owner::Application, i, app.commandLine, false);
+        }
+    }
+    for (std::size_t i = 0; i < metrics.dockerContainers.size(); ++i)
+    {
+        const auto &container = metrics.dockerContainers[i];
+        add_document(Owner::Container, i, container.name, true);
+        add_document(Owner::Container, i, container.id, true);
+        add_document(Owner::Container, i, container.image, true);
+    }
+
+    std::sort(prefix_order_.begin(), prefix_order_.end(), [this](std::uint32_t lhs, std::uint32_t rhs)
+              { return text(documents_[lhs]) < text(documents_[rhs]); });
+}
+
+void TargetIndex::match_substring(const std::string &needle, std::vector<bool> &hits) const
+{
+    if (needle.size() < 3)
+    {
+        for (std::size_t id = 0; id < documents_.size(); ++id)
+        {
+            if (text(documents_[id]).find(needle) != std::string_view::npos)
+            {
+                hits[id] = true;
+            }
+        }
+        return;
+    }
+
+    // Intersect the posting lists of every trigram in the needle, shortest first.
+    std::vector<const std::vector<std::uint32_t> *> lists;
+    lists.reserve(needle.size() - 2);
+    for (std::size_t pos = 0; pos + 3 <= needle.size(); ++pos)
+    {
+        const auto iter = trigrams_.find(trigram_at(needle, pos));
+        if (iter == trigrams_.end())
+        {
+            return;
+        }
+        lists.push_back(&iter->second);
+    }
+    std::sort(lists.begin(), lists.end(), [](const auto *lhs, const auto *rhs)
+              { return lhs->size() < rhs->size(); });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+    std::vector<std::uint32_t> candidates = *lists.front();
+    std::vector<std::uint32_t> next;
+    for (std::size_t i = 1; i < lists.size() && !candidates.empty(); ++i)
+    {
+        next.clear();
+        std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(next));
+        candidates.swap(next);
+    }
+
+    for (const std::uint32_t id : candidates)
+    {
+        if (text(documents_[id]).find(needle) != std::string_view::npos)
+        {
+            hits[id] = true;
+        }
+    }
+}
+
+void TargetIndex::match_prefix(const std::string &prefix, std::vector<bool> &hits) const
+{
+    auto iter = std::lower_bound(prefix_order_.begin(), prefix_order_.end(), prefix, [this](std::uint32_t id, const std::string &value)
+                                 { return text(documents_[id]) < std::string_view(value); });
+    for (; iter != prefix_order_.end(); ++iter)
+    {
+        const std::string_view candidate = text(documents_[*iter]);
+        if (candidate.compare(0, prefix.size(), prefix) != 0)
+        {
+            break;
+        }
+        hits[*iter] = true;
+    }
+}
+
+bool TargetIndex::match_regex(const TargetPattern &pattern, std::vector<bool> &hits) const
+{
+    std::size_t budget = MAX_REGEX_STEPS;
+    TargetPattern::Scratch scratch;
+    for (std::size_t id = 0; id < documents_.size(); ++id)
+    {
+        switch (pattern.search(text(documents_[id]), budget, scratch))
+        {
+        case TargetPattern::Result::Hit:
+            hits[id] = true;
+            break;
+        case TargetPattern::Result::Miss:
+            break;
+        case TargetPattern::Result::OutOfBudget:
+            return false;
+        }
+    }
+    return true;
+}
+
+TargetIndex::Matches TargetIndex::match(const SystemMetrics &metrics, const std::vector<TargetQuery> &queries) const
+{
+    std::call_once(built_, [this, &metrics]()
+                   { build(metrics); });
+
+    std::vector<bool> hits(documents_.size(), false);
+    for (const auto &query : queries)
+    {
+        switch (query.kind)
+        {
+        case TargetQuery::Kind::Substring:
+            match_substring(query.folded, hits);
+            break;
+        case TargetQuery::Kind::Prefix:
+            match_prefix(query.folded, hits);
+            break;
+        case TargetQuery::Kind::Regex:
+            if (!match_regex(query.pattern, hits))
+            {
+                Matches exhausted;
+                exhausted.budget_exhausted = true;
+                return exhausted;
+            }
+            break;
+        }
+    }
+
+    std::vector<bool> applications(application_count_, false);
+    std::vector<bool> containers(metrics.dockerContainers.size(), false);
+    for (std::size_t id = 0; id < documents_.size(); ++id)
+    {
+        if (!hits[id])
+        {
+            continue;
+        }
+        const Document &document = documents_[id];
+        auto &owner = document.owner == Owner::Application ? applications : containers;
+        if (document.entity < owner.size())
+        {
+            owner[document.entity] = true;
+        }
+    }
+
+    Matches matches;
+    for (std::size_t i = 0; i < applications.size(); ++i)
+    {
+        if (applications[i])
+        {
+            matches.applications.push_back(i);
+        }
+    }
+    for (std::size_t i = 0; i < containers.size(); ++i)
+    {
+        if (containers[i])
+        {
+            matches.containers.push_back(i);
+        }
+    }
+    return matches;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "target_pattern.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct SystemMetrics;
+
+// One ?target= term: a case-insensitive substring (default), a "prefix:" match on names and ids,
+// or a "re:" regular expression (see TargetPattern). An expression is tried against every name and
+// command line in full, under a step budget per query; a query that runs out is rejected, never answered
+// with a subset.
+struct TargetQuery
+{
+    enum class Kind
+    {
+        Substring,
+        Prefix,
+        Regex
+    };
+
+    Kind kind;
+    std::string folded;
+    TargetPattern pattern;
+
+    // Parses a comma-separated list of terms; a "re:" term takes the rest of the list, commas included.
+    // Returns false and describes the problem on invalid input.
+    static bool parse_list(const std::string &raw, std::vector<TargetQuery> &queries, std::string &error);
+};
+
+// Case-folded search index over the process and container names of one snapshot.
+//
+// The collector attaches a fresh, empty index to each snapshot; it is built on the first scoped query
+// and then shared by every copy of that snapshot, so concurrent dashboards filtering the same
+// snapshot pay for folding and trigram extraction once.
+class TargetIndex
+{
+public:
+    struct Matches
+    {
+        std::vector<std::size_t> applications;
+        std::vector<std::size_t> containers;
+        // The regular expression ran out of steps; the lists above are incomplete and must not be served.
+        bool budget_exhausted = false;
+    };
+
+    Matches match(const SystemMetrics &metrics, const std::vector<TargetQuery> &queries) const;
+
+private:
+    enum class Owner : std::uint8_t
+    {
+        Application,
+        Container
+    };
+
+    struct Document
+    {
+        std::uint32_t offset;
+        std::uint32_t length;
+        std::uint32_t entity;
+        Owner owner;
+    };
+
+    void build(const SystemMetrics &metrics) const;
+    void add_document(Owner owner, std::size_t entity, std::string_view value, bool prefixable) const;
+    std::string_view text(const Document &document) const;
+    void match_substring(const std::string &needle, std::vector<bool> &hits) const;
+    void match_prefix(const std::string &prefix, std::vector<bool> &hits) const;
+    bool match_regex(const TargetPattern &pattern, std::vector<bool> &hits) const;
+
+    // Written once by build() under built_, read-only afterwards.
+    mutable std::once_flag built_;
+    mutable std::string folded_;
+    mutable std::vector<Document> documents_;
+    mutable std::vector<std::uint32_t> prefix_order_;
+    mutable std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> trigrams_;
+    mutable std::size_t application_count_ = 0;
+};
@@ -0,0 +1,790 @@
+#include "target_pattern.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+    constexpr std::size_t MAX_PROGRAM = 2048; // NFA states; also bounds the live states per subject byte
+    constexpr unsigned int MAX_REPEAT = 100;  // largest count in a {n,m} quantifier
+    constexpr unsigned int UNBOUNDED = ~0u;
+    constexpr unsigned int MAX_DEPTH = 32; // nested groups
+
+    unsigned char fold(unsigned char ch)
+    {
+        return static_cast<unsigned char>(std::tolower(ch));
+    }
+
+    int hex_value(char ch)
+    {
+        if (ch >= '0' && ch <= '9')
+        {
+            return ch - '0';
+        }
+        if (ch >= 'a' && ch <= 'f')
+        {
+            return ch - 'a' + 10;
+        }
+        if (ch >= 'A' && ch <= 'F')
+        {
+            return ch - 'A' + 10;
+        }
+        return -1;
+    }
+
+    void set_range(std::bitset<256> &set, unsigned int low, unsigned int high)
+    {
+        for (unsigned int ch = low; ch <= high; ++ch)
+        {
+            set.set(ch);
+        }
+    }
+
+} // namespace
+
+struct TargetPattern::Node
+{
+    enum class Kind
+    {
+        Set,
+        Begin,
+        End,
+        Concat,
+        Alternate,
+        Repeat
+    };
+
+    Kind kind = Kind::Concat;
+    std::uint16_t set = 0;
+    unsigned int min = 0;
+    unsigned int max = 0;
+    std::vector<Node> children;
+};
+
+// Recursive descent over the expression; recursion depth is bounded by MAX_DEPTH.
+class TargetPattern::Parser
+{
+public:
+    Parser(std::string_view source, std::vector<std::bitset<256>> &sets) : source_(source), sets_(sets) {}
+
+    bool parse(Node &root, std::string &error)
+    {
+        if (alternation(root, 0) && pos_ < source_.size())
+        {
+            fail("unmatched ')'");
+        }
+        if (!error_.empty())
+        {
+            error = error_ + " at offset " + std::to_string(pos_);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool fail(const char *message)
+    {
+        if (error_.empty())
+        {
+            error_ = message;
+        }
+        return false;
+    }
+
+    bool peek(char ch) const
+    {
+        return pos_ < source_.size() && source_[pos_] == ch;
+    }
+
+    bool alternation(Node &out, unsigned int depth)
+    {
+        if (depth > MAX_DEPTH)
+        {
+            return fail("groups nested too deeply");
+        }
+        Node branch;
+        if (!concat(branch, depth))
+        {
+            return false;
+        }
+        if (!peek('|'))
+        {
+            out = std::move(branch);
+            return true;
+        }
+
+        out.kind = Node::Kind::Alternate;
+        out.children.push_back(std::move(branch));
+        while (peek('|'))
+        {
+            ++pos_;
+            Node next;
+            if (!concat(next, depth))
+            {
+                return false;
+            }
+            out.children.push_back(std::move(next));
+        }
+        return true;
+    }
+
+    bool concat(Node &out, unsigned int depth)
+    {
+        out.kind = Node::Kind::Concat;
+        while (pos_ < source_.size() && !peek('|') && !peek(')'))
+        {
+            Node item;
+            if (!repeat(item, depth))
+            {
+                return false;
+            }
+            out.children.push_back(std::move(item));
+        }
+        return true;
+    }
+
+    bool repeat(Node &out, unsigned int depth)
+    {
+        if (!atom(out, depth))
+        {
+            return false;
+        }
+
+        unsigned int min = 0;
+        unsigned int max = 0;
+        if (!quantifier(min, max))
+        {
+            return error_.empty();
+        }
+        if (peek('?'))
+        {
+            ++pos_; // lazy and greedy forms accept the same subjects
+        }
+        if (peek('*') || peek('+') || peek('?'))
+        {
+            return fail("nothing to repeat");
+        }
+
+        Node repeated;
+        repeated.kind = Node::Kind::Repeat;
+        repeated.min = min;
+        repeated.max = max;
+        repeated.children.push_back(std::move(out));
+        out = std::move(repeated);
+        return true;
+    }
+
+    // Consumes a quantifier if one follows. A '{' that does not open a well-formed {n}, {n,} or {n,m} is
+    // left alone and read as a literal, as in ECMAScript's web-compatible grammar.
+    bool quantifier(unsigned int &min, unsigned int &max)
+    {
+        if (pos_ >= source_.size())
+        {
+            return false;
+        }
+        switch (source_[pos_])
+        {
+        case '*':
+            ++pos_;
+            min = 0;
+            max = UNBOUNDED;
+            return true;
+        case '+':
+            ++pos_;
+            min = 1;
+            max = UNBOUNDED;
+            return true;
+        case '?':
+            ++pos_;
+            min = 0;
+            max = 1;
+            return true;
+        case '{':
+            break;
+        default:
+            return false;
+        }
+
+        std::size_t cursor = pos_ + 1;
+        const auto number = [this, &cursor](unsigned int &value)
+        {
+            const std::size_t begin = cursor;
+            value = 0;
+            while (cursor < source_.size() && std::isdigit(static_cast<unsigned char>(source_[cursor])))
+            {
+                value = std::min(value * 10 + static_cast<unsigned int>(source_[cursor] - '0'), MAX_REPEAT + 1);
+                ++cursor;
+            }
+            return cursor > begin;
+        };
+
+        if (!number(min))
+        {
+            return false;
+        }
+        max = min;
+        if (cursor < source_.size() && source_[cursor] == ',')
+        {
+            ++cursor;
+            if (!number(max))
+            {
+                max = UNBOUNDED;
+            }
+        }
+        if (cursor >= source_.size() || source_[cursor] != '}')
+        {
+            return false;
+        }
+        pos_ = cursor + 1;
+        if (min > MAX_REPEAT || (max != UNBOUNDED && max > MAX_REPEAT))
+        {
+            return fail("repeat count too large");
+        }
+        if (max < min)
+        {
+            return fail("numbers out of order in {} quantifier");
+        }
+        return true;
+    }
+
+    bool atom(Node &out, unsigned int depth)
+    {
+        const char ch = source_[pos_++];
+        switch (ch)
+        {
+        case '(':
+            if (source_.compare(pos_, 2, "?:") == 0)
+            {
+                pos_ += 2;
+            }
+            else if (peek('?'))
+            {
+                return fail("lookaround and named groups are not supported");
+            }
+            if (!alternation(out, depth + 1))
+            {
+                return false;
+            }
+            if (!peek(')'))
+            {
+                return fail("missing ')'");
+            }
+            ++pos_;
+            return true;
+        case '*':
+        case '+':
+        case '?':
+            return fail("nothing to repeat");
+        case '^':
+            out.kind = Node::Kind::Begin;
+            return true;
+        case '$':
+            out.kind = Node::Kind::End;
+            return true;
+        case '.':
+        {
+            std::bitset<256> any;
+            any.set();
+            any.reset('\n');
+            any.reset('\r');
+            return add_set(out, any, false);
+        }
+        case '[':
+            return bracket(out);
+        case '\\':
+        {
+            std::bitset<256> set;
+            int value = 0;
+            if (!escape(set, value, false))
+            {
+                return false;
+            }
+            if (value >= 0)
+            {
+                set.set(static_cast<std::size_t>(value));
+            }
+            return add_set(out, set, false);
+        }
+        default:
+        {
+            std::bitset<256> set;
+            set.set(static_cast<unsigned char>(ch));
+            return add_set(out, set, false);
+        }
+        }
+    }
+
+    // Reads the escape after a backslash. A single character comes back in `value`; a class escape
+    // (\d, \W, ...) sets `value` to -1 and its members in `set`.
+    bool escape(std::bitset<256> &set, int &value, bool inBracket)
+    {
+        if (pos_ >= source_.size())
+        {
+            return fail("trailing backslash");
+        }
+        const char ch = source_[pos_++];
+        value = -1;
+        std::bitset<256> members;
+        switch (ch)
+        {
+        case 'd':
+        case 'D':
+            set_range(members, '0', '9');
+            break;
+        case 'w':
+        case 'W':
+            set_range(members, '0', '9');
+            set_range(members, 'a', 'z');
+            set_range(members, 'A', 'Z');
+            members.set('_');
+            break;
+        case 's':
+        case 'S':
+            members.set(' ');
+            set_range(members, '\t', '\r');
+            break;
+        case 'b':
+            if (!inBracket)
+            {
+                return fail("word boundaries are not supported");
+            }
+            value = '\b';
+            return true;
+        case 'B':
+            return fail("word boundaries are not supported");
+        case '0':
+            value = 0;
+            return true;
+        case 't':
+            value = '\t';
+            return true;
+        case 'n':
+            value = '\n';
+            return true;
+        case 'r':
+            value = '\r';
+            return true;
+        case 'f':
+            value = '\f';
+            return true;
+        case 'v':
+            value = '\v';
+            return true;
+        case 'c':
+            if (pos_ >= source_.size() || !std::isalpha(static_cast<unsigned char>(source_[pos_])))
+            {
+                return fail("invalid \\c escape");
+            }
+            value = source_[pos_++] % 32;
+            return true;
+        case 'x':
+        case 'u':
+        {
+            const std::size_t digits = ch == 'x' ? 2 : 4;
+            if (pos_ + digits > source_.size())
+            {
+                return fail("invalid hexadecimal escape");
+            }
+            value = 0;
+            for (std::size_t i = 0; i < digits; ++i)
+            {
+                const int digit = hex_value(source_[pos_ + i]);
+                if (digit < 0)
+                {
+                    return fail("invalid hexadecimal escape");
+                }
+                value = value * 16 + digit;
+            }
+            pos_ += digits;
+            if (value > 0xff)
+            {
+                return fail("characters above \\xff are not supported");
+            }
+            return true;
+        }
+        default:
+            if (ch >= '1' && ch <= '9')
+            {
+                return fail("back-references are not supported");
+            }
+            value = static_cast<unsigned char>(ch);
+            return true;
+        }
+
+        if (std::isupper(static_cast<unsigned char>(ch)))
+        {
+            members.flip();
+        }
+        set |= members;
+        return true;
+    }
+
+    bool bracket(Node &out)
+    {
+        const bool negated = peek('^');
+        if (negated)
+        {
+            ++pos_;
+        }
+
+        std::bitset<256> set;
+        while (true)
+        {
+            if (pos_ >= source_.size())
+            {
+                return fail("missing ']'");
+            }
+            if (peek(']'))
+            {
+                ++pos_;
+                break;
+            }
+
+            int low = 0;
+            if (!member(set, low))
+            {
+                return false;
+            }
+            if (low < 0)
+            {
+                continue;
+            }
+            if (peek('-') && pos_ + 1 < source_.size() && source_[pos_ + 1] != ']')
+            {
+                ++pos_;
+                int high = 0;
+                if (!member(set, high))
+                {
+                    return false;
+                }
+                if (high < 0)
+                {
+                    return fail("invalid class range");
+                }
+                if (high < low)
+                {
+                    return fail("range out of order in character class");
+                }
+                set_range(set, static_cast<unsigned int>(low), static_cast<unsigned int>(high));
+            }
+            else
+            {
+                set.set(static_cast<std::size_t>(low));
+            }
+        }
+        return add_set(out, set, negated);
+    }
+
+    // One bracket member: a character in `value`, or -1 after a class escape has been added to `set`.
+    bool member(std::bitset<256> &set, int &value)
+    {
+        const char ch = source_[pos_++];
+        if (ch == '\\')
+        {
+            return escape(set, value, true);
+        }
+        value = static_cast<unsigned char>(ch);
+        return true;
+    }
+
+    // Subjects are folded, so a set matches a byte when the byte is the folded form of a member.
+    bool add_set(Node &out, const std::bitset<256> &members, bool negated)
+    {
+        if (sets_.size() > UINT16_MAX)
+        {
+            return fail("expression too complex");
+        }
+        std::bitset<256> folded;
+        for (unsigned int ch = 0; ch < 256; ++ch)
+        {
+            if (members[ch])
+            {
+                folded.set(fold(static_cast<unsigned char>(ch)));
+            }
+        }
+        if (negated)
+        {
+            folded.flip();
+        }
+        out.kind = Node::Kind::Set;
+        out.set = static_cast<std::uint16_t>(sets_.size());
+        sets_.push_back(folded);
+        return true;
+    }
+
+    std::string_view source_;
+    std::vector<std::bitset<256>> &sets_;
+    std::size_t pos_ = 0;
+    std::string error_;
+};
+
+bool TargetPattern::compile(std::string_view source, std::string &error)
+{
+    program_.clear();
+    sets_.clear();
+
+    Node root;
+    if (!Parser(source, sets_).parse(root, error) || !emit(root, error))
+    {
+        return false;
+    }
+    append(Instruction::Op::Match);
+
+    // Bytes on which a thread started away from the subject's ends can make progress; search() skips the rest.
+    std::bitset<256> first;
+    std::vector<bool> seen(program_.size(), false);
+    std::vector<std::uint32_t> stack{0};
+    while (!stack.empty())
+    {
+        const std::uint32_t pc = stack.back();
+        stack.pop_back();
+        if (seen[pc])
+        {
+            continue;
+        }
+        seen[pc] = true;
+        const Instruction &instruction = program_[pc];
+        switch (instruction.op)
+        {
+        case Instruction::Op::Byte:
+            first |= sets_[instruction.set];
+            break;
+        case Instruction::Op::Split:
+            stack.push_back(instruction.y);
+            stack.push_back(instruction.x);
+            break;
+        case Instruction::Op::Jump:
+            stack.push_back(instruction.x);
+            break;
+        case Instruction::Op::Begin:
+        case Instruction::Op::End:
+            break;
+        case Instruction::Op::Match:
+            first.set();
+            break;
+        }
+    }
+    only_first_ = -1;
+    for (unsigned int ch = 0; ch < 256; ++ch)
+    {
+        first_[ch] = first[ch];
+        if (first[ch])
+        {
+            only_first_ = first.count() == 1 ? static_cast<int>(ch) : -1;
+        }
+    }
+    return true;
+}
+
+std::uint32_t TargetPattern::append(Instruction::Op op, std::uint32_t x, std::uint32_t y, std::uint16_t set)
+{
+    program_.push_back(Instruction{op, set, x, y});
+    return static_cast<std::uint32_t>(program_.size() - 1);
+}
+
+bool TargetPattern::emit(const Node &node, std::string &error)
+{
+    if (program_.size() >= MAX_PROGRAM)
+    {
+        error = "expression too complex (more than " + std::to_string(MAX_PROGRAM) + " states)";
+        return false;
+    }
+
+    const auto next = [this]()
+    { return static_cast<std::uint32_t>(program_.size()); };
+
+    switch (node.kind)
+    {
+    case Node::Kind::Set:
+        append(Instruction::Op::Byte, next() + 1, 0, node.set);
+        return true;
+    case Node::Kind::Begin:
+        append(Instruction::Op::Begin, next() + 1);
+        return true;
+    case Node::Kind::End:
+        append(Instruction::Op::End, next() + 1);
+        return true;
+    case Node::Kind::Concat:
+        for (const Node &child : node.children)
+        {
+            if (!emit(child, error))
+            {
+                return false;
+            }
+        }
+        return true;
+    case Node::Kind::Alternate:
+    {
+        std::vector<std::uint32_t> exits;
+        for (std::size_t i = 0; i + 1 < node.children.size(); ++i)
+        {
+            const std::uint32_t split = append(Instruction::Op::Split, next() + 1);
+            if (!emit(node.children[i], error))
+            {
+                return false;
+            }
+            exits.push_back(append(Instruction::Op::Jump));
+            program_[split].y = next();
+        }
+        if (!emit(node.children.back(), error))
+        {
+            return false;
+        }
+        for (const std::uint32_t exit : exits)
+        {
+            program_[exit].x = next();
+        }
+        return true;
+    }
+    case Node::Kind::Repeat:
+    {
+        const Node &child = node.children.front();
+        for (unsigned int i = 0; i < node.min; ++i)
+        {
+            if (!emit(child, error))
+            {
+                return false;
+            }
+        }
+        if (node.max == UNBOUNDED)
+        {
+            const std::uint32_t loop = append(Instruction::Op::Split, next() + 1);
+            if (!emit(child, error))
+            {
+                return false;
+            }
+            append(Instruction::Op::Jump, loop);
+            program_[loop].y = next();
+            return true;
+        }
+        for (unsigned int i = node.min; i < node.max; ++i)
+        {
+            const std::uint32_t optional = append(Instruction::Op::Split, next() + 1);
+            if (!emit(child, error))
+            {
+                return false;
+            }
+            program_[optional].y = next();
+        }
+        return true;
+    }
+    }
+    return true;
+}
+
+TargetPattern::Result TargetPattern::search(std::string_view folded, std::size_t &budget, Scratch &scratch) const
+{
+    if (scratch.marks.size() < program_.size())
+    {
+        scratch.marks.resize(program_.size(), 0);
+    }
+    // Marks are compared against the generation, so starting a new step list never clears them.
+    const auto advance = [&scratch]()
+    {
+        if (++scratch.generation == 0)
+        {
+            std::fill(scratch.marks.begin(), scratch.marks.end(), 0);
+            scratch.generation = 1;
+        }
+    };
+    // Adds the states reachable from `start` without consuming input at `pos` to `list`.
+    const auto add = [this, folded, &budget, &scratch](std::vector<std::uint32_t> &list, std::uint32_t start, std::size_t pos)
+    {
+        scratch.stack.clear();
+        scratch.stack.push_back(start);
+        while (!scratch.stack.empty())
+        {
+            const std::uint32_t pc = scratch.stack.back();
+            scratch.stack.pop_back();
+            if (scratch.marks[pc] == scratch.generation)
+            {
+                continue;
+            }
+            scratch.marks[pc] = scratch.generation;
+            if (budget == 0)
+            {
+                return Result::OutOfBudget;
+            }
+            --budget;
+
+            const Instruction &instruction = program_[pc];
+            switch (instruction.op)
+            {
+            case Instruction::Op::Byte:
+                list.push_back(pc);
+                break;
+            case Instruction::Op::Split:
+                scratch.stack.push_back(instruction.y);
+                scratch.stack.push_back(instruction.x);
+                break;
+            case Instruction::Op::Jump:
+                scratch.stack.push_back(instruction.x);
+                break;
+            case Instruction::Op::Begin:
+                if (pos == 0)
+                {
+                    scratch.stack.push_back(instruction.x);
+                }
+                break;
+            case Instruction::Op::End:
+                if (pos == folded.size())
+                {
+                    scratch.stack.push_back(instruction.x);
+                }
+                break;
+            case Instruction::Op::Match:
+                return Result::Hit;
+            }
+        }
+        return Result::Miss;
+    };
+
+    advance();
+    scratch.current.clear();
+    for (std::size_t pos = 0;; ++pos)
+    {
+        if (scratch.current.empty() && pos > 0)
+        {
+            // No thread is alive, so only a byte that can begin a match (or the end) is worth stopping at.
+            if (only_first_ >= 0)
+            {
+                const void *found = std::memchr(folded.data() + pos, only_first_, folded.size() - pos);
+                pos = found != nullptr ? static_cast<std::size_t>(static_cast<const char *>(found) - folded.data()) : folded.size();
+            }
+            else
+            {
+                while (pos < folded.size() && !first_[static_cast<unsigned char>(folded[pos])])
+                {
+                    ++pos;
+                }
+            }
+            advance();
+        }
+
+        // The search is unanchored: a match may also begin here.
+        Result result = add(scratch.current, 0, pos);
+        if (result != Result::Miss || pos == folded.size())
+        {
+            return result;
+        }
+
+        advance();
+        scratch.next.clear();
+        const auto byte = static_cast<unsigned char>(folded[pos]);
+        for (const std::uint32_t pc : scratch.current)
+        {
+            const Instruction &instruction = program_[pc];
+            if (sets_[instruction.set][byte])
+            {
+                result = add(scratch.next, instruction.x, pos + 1);
+                if (result != Result::Miss)
+                {
+                    return result;
+                }
+            }
+        }
+        scratch.current.swap(scratch.next);
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A case-insensitive regular expression for ?target=re: terms, compiled to a Thompson NFA and matched by
+// advancing every live state at once. Time is linear in the subject length times the program size and
+// nothing recurses or backtracks, so the cost of a search is known before it runs and can be budgeted.
+//
+// Covers the ECMAScript subset a name filter needs: literals and escapes, '.', bracket classes, \d \w \s
+// and their negations, '^' and '$' on the whole subject, capturing and (?:) groups, alternation and the
+// * + ? {n} {n,} {n,m} quantifiers (lazy forms match the same subjects). Back-references, lookaround and
+// word boundaries are rejected at compile time.
+class TargetPattern
+{
+public:
+    enum class Result
+    {
+        Miss,
+        Hit,
+        OutOfBudget
+    };
+
+    // Per-thread working set of search(); reused across subjects so a scan does not allocate per document.
+    struct Scratch
+    {
+        std::vector<std::uint32_t> current;
+        std::vector<std::uint32_t> next;
+        std::vector<std::uint32_t> stack;
+        std::vector<std::uint32_t> marks;
+        std::uint32_t generation = 0;
+    };
+
+    // Returns false and describes the problem when `source` is malformed, unsupported or too large.
+    bool compile(std::string_view source, std::string &error);
+
+    // Searches a subject that is already lower-case. Entering an NFA state costs one step of `budget`;
+    // OutOfBudget means the budget ran out before the outcome was known.
+    Result search(std::string_view folded, std::size_t &budget, Scratch &scratch) const;
+
+private:
+    struct Instruction
+    {
+        enum class Op : std::uint8_t
+        {
+            Byte,  // consume one byte in sets_[set], continue at x
+            Split, // continue at both x and y
+            Jump,  // continue at x
+            Begin, // continue at x at the start of the subject only
+            End,   // continue at x at the end of the subject only
+            Match
+        };
+
+        Op op;
+        std::uint16_t set;
+        std::uint32_t x;
+        std::uint32_t y;
+    };
+
+    struct Node;
+    class Parser;
+
+    bool emit(const Node &node, std::string &error);
+    std::uint32_t append(Instruction::Op op, std::uint32_t x = 0, std::uint32_t y = 0, std::uint16_t set = 0);
+
+    std::vector<Instruction> program_;
+    std::vector<std::bitset<256>> sets_;
+    // Bytes that can begin a match away from either end of the subject, and the only such byte when there is one.
+    std::array<bool, 256> first_{};
+    int only_first_ = -1;
+};
@@ -0,0 +1,249 @@
+#include "trace_recorder.h"
+
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    constexpr std::size_t MAX_INTERNED_NAMES = 512;
+
+    const auto TRACE_EPOCH = std::chrono::steady_clock::now();
+
+    long long to_ns(std::chrono::steady_clock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time - TRACE_EPOCH).count();
+    }
+
+    // One span. Fields are atomics so a reader copying a slot while its owner overwrites it is a
+    // detectable torn read (the sequence changes) rather than a data race.
+    struct Slot
+    {
+        std::atomic<unsigned long long> sequence{0}; // 2 * index + 2 once event `index` is complete, odd while writing
+        std::atomic<const char *> name{nullptr};
+        std::atomic<const char *> category{nullptr};
+        std::atomic<const char *> arg_name{nullptr};
+        std::atomic<long long> start_ns{0};
+        std::atomic<long long> end_ns{0};
+        std::atomic<unsigned long long> arg_value{0};
+    };
+
+    // Single-producer ring owned by one thread at a time. `head` counts every event ever written; the
+    // capture of `generation` starts at event `first`.
+    struct Ring
+    {
+        Ring(std::size_t capacity, unsigned int tid, std::string name)
+            : slots(capacity), tid(tid), thread_name(std::move(name))
+        {
+        }
+
+        std::vector<Slot> slots;
+        const unsigned int tid;
+        const std::string thread_name;
+        std::atomic<unsigned long long> head{0};
+        std::atomic<unsigned long long> first{0};
+        std::atomic<unsigned long long> generation{0};
+        bool in_use = false; // guarded by Registry::mutex
+    };
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Ring>> rings;
+        std::unordered_set<std::string> names;
+        std::atomic<unsigned long long> generation{0};
+        std::atomic<std::size_t> events_per_thread{trace::DEFAULT_EVENTS_PER_THREAD};
+    };
+
+    // Never destroyed: threads may still record while static destructors run.
+    Registry &registry()
+    {
+        static Registry *instance = new Registry();
+        return *instance;
+    }
+
+    struct RingLease
+    {
+        Ring *ring = nullptr;
+
+        ~RingLease()
+        {
+            if (ring != nullptr)
+            {
+                std::lock_guard<std::mutex> lock(registry().mutex);
+                ring->in_use = false;
+            }
+        }
+    };
+
+    thread_local RingLease lease;
+
+    Ring &local_ring()
+    {
+        if (lease.ring == nullptr)
+        {
+            Registry &shared = registry();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            for (const auto &ring : shared.rings)
+            {
+                if (!ring->in_use)
+                {
+                    lease.ring = ring.get();
+                    break;
+                }
+            }
+            if (lease.ring == nullptr)
+            {
+                char name[16] = {};
+                pthread_getname_np(pthread_self(), name, sizeof(name));
+                const auto tid = static_cast<unsigned int>(shared.rings.size() + 1);
+                shared.rings.push_back(std::make_unique<Ring>(shared.events_per_thread.load(std::memory_order_relaxed), tid,
+                                                              std::string(name) + " #" + std::to_string(tid)));
+                lease.ring = shared.rings.back().get();
+            }
+            lease.ring->in_use = true;
+        }
+        return *lease.ring;
+    }
+
+} // namespace
+
+namespace trace
+{
+    namespace detail
+    {
+        std::atomic<bool> active(false);
+    }
+
+    void start(std::size_t eventsPerThread)
+    {
+        Registry &shared = registry();
+        shared.events_per_thread.store(std::clamp(eventsPerThread, MIN_EVENTS_PER_THREAD, MAX_EVENTS_PER_THREAD), std::memory_order_relaxed);
+        shared.generation.fetch_add(1, std::memory_order_acq_rel);
+        detail::active.store(true, std::memory_order_release);
+    }
+
+    void stop()
+    {
+        detail::active.store(false, std::memory_order_release);
+    }
+
+    void record(const char *name, const char *category, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end, const char *argName, unsigned long long argValue)
+    {
+        if (!enabled())
+        {
+            return;
+        }
+
+        Ring &ring = local_ring();
+        const unsigned long long index = ring.head.load(std::memory_order_relaxed);
+        const unsigned long long generation = registry().generation.load(std::memory_order_acquire);
+        if (ring.generation.load(std::memory_order_relaxed) != generation)
+        {
+            // First span of a new capture on this thread: earlier events belong to the previous one.
+            ring.first.store(index, std::memory_order_relaxed);
+            ring.generation.store(generation, std::memory_order_release);
+        }
+
+        Slot &slot = ring.slots[index % ring.slots.size()];
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.category.store(category, std::memory_order_relaxed);
+        slot.arg_name.store(argName, std::memory_order_relaxed);
+        slot.start_ns.store(to_ns(start), std::memory_order_relaxed);
+        slot.end_ns.store(to_ns(end), std::memory_order_relaxed);
+        slot.arg_value.store(argValue, std::memory_order_relaxed);
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+        ring.head.store(index + 1, std::memory_order_release);
+    }
+
+    const char *intern(std::string_view name, const char *fallback)
+    {
+        Registry &shared = registry();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        const auto iter = shared.names.find(std::string(name));
+        if (iter != shared.names.end())
+        {
+            return iter->c_str();
+        }
+        if (shared.names.size() >= MAX_INTERNED_NAMES)
+        {
+            return fallback;
+        }
+        // Set nodes never move, so the c_str() stays valid for the life of the process.
+        return shared.names.emplace(name).first->c_str();
+    }
+
+    std::string dump_chrome_json()
+    {
+        nlohmann::json events = nlohmann::json::array();
+        const long long pid = ::getpid();
+
+        std::vector<Ring *> rings;
+        Registry &shared = registry();
+        const unsigned long long generation = shared.generation.load(std::memory_order_acquire);
+        {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            for (const auto &ring : shared.rings)
+            {
+                rings.push_back(ring.get());
+            }
+        }
+
+        for (Ring *ring : rings)
+        {
+            if (ring->generation.load(std::memory_order_acquire) != generation)
+            {
+                continue;
+            }
+            const unsigned long long head = ring->head.load(std::memory_order_acquire);
+            const unsigned long long capacity = ring->slots.size();
+            const unsigned long long begin = std::max(ring->first.load(std::memory_order_relaxed), head > capacity ? head - capacity : 0);
+
+            events.push_back({{"ph", "M"}, {"name", "thread_name"}, {"pid", pid}, {"tid", ring->tid}, {"args", {{"name", ring->thread_name}}}});
+            for (unsigned long long index = begin; index < head; ++index)
+            {
+                const Slot &slot = ring->slots[index % capacity];
+                const unsigned long long before = slot.sequence.load(std::memory_order_acquire);
+                if (before != 2 * index + 2)
+                {
+                    continue;
+                }
+                const char *name = slot.name.load(std::memory_order_relaxed);
+                const char *category = slot.category.load(std::memory_order_relaxed);
+                const char *argName = slot.arg_name.load(std::memory_order_relaxed);
+                const long long start = slot.start_ns.load(std::memory_order_relaxed);
+                const long long end = slot.end_ns.load(std::memory_order_relaxed);
+                const unsigned long long argValue = slot.arg_value.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) != before)
+                {
+                    continue; // overwritten while we were copying it
+                }
+
+                nlohmann::json event = {
+                    {"ph", "X"},
+                    {"name", name != nullptr ? name : "?"},
+                    {"cat", category != nullptr ? category : ""},
+                    {"pid", pid},
+                    {"tid", ring->tid},
+                    {"ts", static_cast<double>(start) / 1000.0},
+                    {"dur", static_cast<double>(std::max(0LL, end - start)) / 1000.0}};
+                if (argName != nullptr)
+                {
+                    event["args"] = {{argName, argValue}};
+                }
+                events.push_back(std::move(event));
+            }
+        }
+
+        return nlohmann::json{{"traceEvents", std::move(events)}, {"displayTimeUnit", "ms"}}.dump();
+    }
+} // namespace trace
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// On-demand span tracing, exported in the Chrome trace event format (chrome://tracing, Perfetto).
+//
+// Each thread writes completed spans into its own fixed-size ring; writers never lock or wait and
+// readers copy the rings with a per-slot sequence check, skipping slots overwritten mid-copy. When a
+// ring wraps, the oldest spans are lost. While tracing is off a span costs one relaxed atomic load.
+// Span names and categories must be string literals (or otherwise outlive the trace).
+namespace trace
+{
+    constexpr std::size_t DEFAULT_EVENTS_PER_THREAD = 8192;
+    constexpr std::size_t MIN_EVENTS_PER_THREAD = 256;
+    constexpr std::size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+    // Starts a new capture, discarding the previous one. `eventsPerThread`, clamped to the limits above,
+    // sizes rings created from now on; rings already handed to a thread keep their size, because their
+    // writers never lock.
+    void start(std::size_t eventsPerThread = DEFAULT_EVENTS_PER_THREAD);
+    void stop();
+
+    namespace detail
+    {
+        extern std::atomic<bool> active;
+    }
+
+    inline bool enabled()
+    {
+        return detail::active.load(std::memory_order_relaxed);
+    }
+
+    // Records a completed span; `argName`/`argValue` become the span's single argument when argName is set.
+    void record(const char *name, const char *category, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end, const char *argName = nullptr, unsigned long long argValue = 0);
+
+    // Returns a stable copy of `name` for use as a span name; repeated names share one copy. The table is
+    // capped, after which `fallback` is returned.
+    const char *intern(std::string_view name, const char *fallback);
+
+    // The current capture as a Chrome trace JSON document ({"traceEvents":[...]}).
+    std::string dump_chrome_json();
+
+    // Records the lifetime of the scope as a span when tracing is on at construction.
+    class Span
+    {
+    public:
+        Span(const char *name, const char *category)
+            : name_(name), category_(category), start_(enabled() ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point())
+        {
+        }
+        ~Span()
+        {
+            if (start_ != std::chrono::steady_clock::time_point())
+            {
+                record(name_, category_, start_, std::chrono::steady_clock::now());
+            }
+        }
+
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+    private:
+        const char *name_;
+        const char *category_;
+        std::chrono::steady_clock::time_point start_;
+    };
+} // namespace trace
@@ -1,23 +1,24 @@
 #include "websocket_server.h"
 
+#include "http_transport.h"
+#include "metrics_json.h"
+#include "self_stats.h"
 #include "token_utils.h"
+#include "trace_recorder.h"
 
 // Include Boost beast/asio only in .cpp (limits macro/template exposure)
 #include <boost/asio.hpp>
 #include <boost/asio/error.hpp>
 #include <boost/beast.hpp>
-#include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
 #include <boost/beast/websocket.hpp>
 #include <nlohmann/json.hpp>
+#include <algorithm>
 #include <chrono>
-#include <cstdlib>
-#include <functional>
+#include <deque>
 #include <iostream>
 #include <memory>
-#include <sstream>
-#include <thread>
-#include <unordered_map>
+#include <vector>
 
 namespace beast = boost::beast;
 namespace websocket = beast::websocket;
@@ -26,74 +27,767 @@ using tcp = net::ip::tcp;
 
 namespace
 {
-    std::unordered_map<std::string, std::string> parse_query_string(beast::string_view target)
+    constexpr auto DEFAULT_INTERVAL = std::chrono::milliseconds(500);
+    constexpr auto MIN_INTERVAL = std::chrono::milliseconds(100);
+    constexpr auto MAX_INTERVAL = std::chrono::milliseconds(60000);
+    constexpr std::size_t MAX_CONTROL_FRAMES = 32; // replies and events queued behind a slow write before we drop them (counted)
+
+    bool is_disconnect(beast::error_code ec)
     {
-        std::unordered_map<std::string, std::string> params;
-        const auto pos = target.find('?');
-        if (pos == beast::string_view::npos)
+        return ec == websocket::error::closed || ec == net::error::operation_aborted ||
+               ec == net::error::broken_pipe || ec == net::error::connection_reset || ec == net::error::eof;
+    }
+
+    bool parse_interval(const std::string &raw, std::chrono::milliseconds &interval, std::string &error)
+    {
+        if (raw.empty())
         {
-            return params;
+            return true;
         }
+        if (raw.find_first_not_of("0123456789") != std::string::npos || raw.size() > 9)
+        {
+            error = "Invalid interval '" + raw + "' (milliseconds expected)";
+            return false;
+        }
+        interval = std::clamp(std::chrono::milliseconds(std::stoll(raw)), MIN_INTERVAL, MAX_INTERVAL);
+        return true;
+    }
 
-        const auto query = target.substr(pos + 1);
-        std::string query_str(query);
-        std::stringstream ss(query_str);
-        std::string pair;
-
-        auto url_decode = [](const std::string &value)
+    // Control messages accept field lists either as "a,b" or ["a","b"].
+    bool read_field_list(const nlohmann::json &message, const char *name, std::string &out, std::string &error)
+    {
+        const auto iter = message.find(name);
+        if (iter == message.end() || iter->is_null())
+        {
+            out.clear();
+            return true;
+        }
+        if (iter->is_string())
+        {
+            out = iter->get<std::string>();
+            return true;
+        }
+        if (iter->is_array())
         {
-            std::string result;
-            result.reserve(value.size());
-            for (std::size_t i = 0; i < value.size(); ++i)
+            out.clear();
+            for (const auto &entry : *iter)
             {
-                if (value[i] == '%' && i + 2 < value.size())
+                if (!entry.is_string())
                 {
-                    std::string hex = value.substr(i + 1, 2);
-                    char decoded = static_cast<char>(std::strtol(hex.c_str(), nullptr, 16));
-                    result.push_back(decoded);
-                    i += 2;
+                    error = std::string("'") + name + "' entries must be strings";
+                    return false;
                 }
-                else if (value[i] == '+')
+                if (!out.empty())
                 {
-                    result.push_back(' ');
+                    out.push_back(',');
                 }
-                else
+                out += entry.get<std::string>();
+            }
+            return true;
+        }
+        error = std::string("'") + name + "' must be a string or an array of strings";
+        return false;
+    }
+
+    bool parse_bursts(const std::string &raw, bool &bursts, std::string &error)
+    {
+        if (raw.empty() || raw == "0" || raw == "1")
+        {
+            bursts = raw == "1";
+            return true;
+        }
+        error = "Invalid bursts '" + raw + "' (0 or 1 expected)";
+        return false;
+    }
+
+    std::shared_ptr<const std::string> control_frame(nlohmann::json body)
+    {
+        return std::make_shared<const std::string>(body.dump());
+    }
+
+} // namespace
+
+// One upgraded connection. Reads, writes and frame hand-off all run on the connection's strand.
+// Snapshot frames are conflated: a tick that arrives while a write is in flight replaces the frame
+// waiting behind it. Control replies and events are queued separately, never conflated; beyond
+// MAX_CONTROL_FRAMES they are dropped and counted in controlDropped (and framesDropped).
+class WebSocketServer::Session : public std::enable_shared_from_this<WebSocketServer::Session>
+{
+public:
+    Session(WebSocketServer &server, HttpUpgrade &&upgrade)
+        : server_(server), ws_(std::move(upgrade.stream)), request_(std::move(upgrade.request)),
+          selection_(MetricsSelection::all()), interval_(DEFAULT_INTERVAL), admitted_(false), closed_(false), writing_(false), bursts_(false),
+          connected_(std::chrono::steady_clock::now()), behind_since_(), write_started_(), interval_ms_(DEFAULT_INTERVAL.count()), queued_(0),
+          frames_sent_(0), frames_dropped_(0), control_dropped_(0), bytes_sent_(0), behind_since_ms_(0)
+    {
+        beast::error_code ec;
+        const auto endpoint = beast::get_lowest_layer(ws_).socket().remote_endpoint(ec);
+        if (!ec)
+        {
+            remote_ = endpoint.address().to_string() + ':' + std::to_string(endpoint.port());
+        }
+    }
+
+    ~Session()
+    {
+        if (!group_key_.empty())
+        {
+            server_.leave(this, group_key_);
+        }
+        if (admitted_)
+        {
+            server_.active_sessions_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    net::any_io_executor executor()
+    {
+        return ws_.get_executor();
+    }
+
+    void run()
+    {
+        ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+        ws_.read_message_max(64 * 1024);
+        ws_.set_option(websocket::stream_base::decorator([](websocket::response_type &res)
+                                                         { res.set(beast::http::field::server, BOOST_BEAST_VERSION_STRING " monitoring-service"); }));
+        ws_.async_accept(request_, [self = shared_from_this()](beast::error_code ec)
+                         { self->on_accept(ec); });
+    }
+
+    // Called by the tick group from its own strand.
+    void deliver(std::shared_ptr<const std::string> frame)
+    {
+        net::post(ws_.get_executor(), [self = shared_from_this(), frame = std::move(frame)]() mutable
+                  {
+            self->accept_frame(std::move(frame)); });
+    }
+
+    bool wants_bursts() const
+    {
+        return bursts_.load(std::memory_order_relaxed);
+    }
+
+    // Event frames (alerts, burst batches) are never conflated, so they go through the control queue.
+    void deliver_event(std::shared_ptr<const std::string> frame)
+    {
+        net::post(ws_.get_executor(), [self = shared_from_this(), frame = std::move(frame)]() mutable
+                  {
+            if (self->closed_)
+            {
+                return;
+            }
+            self->enqueue_control(std::move(frame)); });
+    }
+
+    nlohmann::json report(std::chrono::steady_clock::time_point now) const
+    {
+        const long long behindSince = behind_since_ms_.load(std::memory_order_relaxed);
+        const long long nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+        return {
+            {"remote", remote_},
+            {"interval", interval_ms_.load(std::memory_order_relaxed)},
+            {"bursts", bursts_.load(std::memory_order_relaxed)},
+            {"queued", queued_.load(std::memory_order_relaxed)},
+            {"framesSent", frames_sent_.load(std::memory_order_relaxed)},
+            {"framesDropped", frames_dropped_.load(std::memory_order_relaxed)},
+            {"controlDropped", control_dropped_.load(std::memory_order_relaxed)},
+            {"bytesSent", bytes_sent_.load(std::memory_order_relaxed)},
+            {"behindMs", behindSince == 0 ? 0 : nowMs - behindSince},
+            {"connectedSeconds", std::chrono::duration_cast<std::chrono::seconds>(now - connected_).count()}};
+    }
+
+private:
+    void on_accept(beast::error_code ec)
+    {
+        if (ec)
+        {
+            std::cerr << "WebSocket handshake error: " << ec.message() << std::endl;
+            return;
+        }
+
+        const auto params = parse_query(std::string_view(request_.target().data(), request_.target().size()));
+        auto param = [&params](const char *name)
+        {
+            const auto iter = params.find(name);
+            return iter != params.end() ? iter->second : std::string();
+        };
+
+        if (!server_.is_token_valid(param("token")))
+        {
+            std::cerr << "Rejected WebSocket client due to invalid token" << std::endl;
+            close(websocket::close_code::policy_error, "Missing or invalid token");
+            return;
+        }
+
+        const auto current_sessions = server_.active_sessions_.fetch_add(1, std::memory_order_relaxed) + 1;
+        admitted_ = true;
+        if (current_sessions > server_.max_sessions_)
+        {
+            std::cerr << "Rejecting WebSocket client: too many active sessions" << std::endl;
+            close(websocket::close_code::try_again_later, "Server busy");
+            return;
+        }
+
+        MetricsSelection selection = MetricsSelection::all();
+        std::chrono::milliseconds interval = DEFAULT_INTERVAL;
+        std::string subscription_error;
+        if (!MetricsSelection::parse(param("fields"), param("exclude"), selection, subscription_error) ||
+            !selection.parse_order(param("sort"), param("limit"), subscription_error) ||
+            !parse_interval(param("interval"), interval, subscription_error))
+        {
+            close(websocket::close_code::policy_error, subscription_error.substr(0, 120));
+            return;
+        }
+        bool bursts = false;
+        if (!parse_bursts(param("bursts"), bursts, subscription_error))
+        {
+            close(websocket::close_code::policy_error, subscription_error.substr(0, 120));
+            return;
+        }
+        bursts_.store(bursts, std::memory_order_relaxed);
+
+        fields_ = param("fields");
+        exclude_ = param("exclude");
+        ws_.text(true);
+        do_read();
+        subscribe(interval, selection);
+    }
+
+    void subscribe(std::chrono::milliseconds interval, const MetricsSelection &selection)
+    {
+        if (!group_key_.empty())
+        {
+            server_.leave(this, group_key_);
+        }
+        interval_ = interval;
+        interval_ms_.store(interval.count(), std::memory_order_relaxed);
+        selection_ = selection;
+        group_key_ = server_.join(shared_from_this(), interval_, selection_);
+
+        // New subscribers get a frame straight away instead of waiting for the group's next tick, unless
+        // the published snapshot still lacks their sections.
+        if (auto frame = server_.payload(selection_))
+        {
+            latest_ = std::move(frame);
+            flush();
+        }
+    }
+
+    void handle_control(const std::string &text)
+    {
+        const nlohmann::json message = nlohmann::json::parse(text, nullptr, false);
+        if (message.is_discarded() || !message.is_object())
+        {
+            reply_error("Control messages must be JSON objects");
+            return;
+        }
+
+        const std::string type = message.value("type", std::string());
+        if (type != "subscribe")
+        {
+            reply_error("Unknown control message type '" + type + "'");
+            return;
+        }
+
+        std::chrono::milliseconds interval = interval_;
+        MetricsSelection selection = selection_;
+        std::string fields = fields_;
+        std::string exclude = exclude_;
+        std::string error;
+
+        const auto intervalIter = message.find("interval");
+        if (intervalIter != message.end())
+        {
+            const std::string raw = intervalIter->is_number_unsigned() ? std::to_string(intervalIter->get<unsigned long long>())
+                                    : intervalIter->is_string()        ? intervalIter->get<std::string>()
+                                                                       : std::string("?");
+            if (!parse_interval(raw, interval, error))
+            {
+                reply_error(error);
+                return;
+            }
+        }
+
+        if (message.contains("fields") || message.contains("exclude"))
+        {
+            if (!read_field_list(message, "fields", fields, error) || !read_field_list(message, "exclude", exclude, error) ||
+                !MetricsSelection::parse(fields, exclude, selection, error))
+            {
+                reply_error(error);
+                return;
+            }
+        }
+
+        if (message.contains("sort") || message.contains("limit"))
+        {
+            // Omitted keys keep their current value; "limit": null drops the limit.
+            std::string sort = selection.sort_key();
+            std::string limit = selection.limit() == 0 ? std::string() : std::to_string(selection.limit());
+            const auto sortIter = message.find("sort");
+            if (sortIter != message.end())
+            {
+                sort = sortIter->is_string() ? sortIter->get<std::string>() : std::string("?");
+            }
+            const auto limitIter = message.find("limit");
+            if (limitIter != message.end())
+            {
+                limit = limitIter->is_number_unsigned() ? std::to_string(limitIter->get<unsigned long long>())
+                        : limitIter->is_null()          ? std::string()
+                                                        : std::string("?");
+            }
+            if (!selection.parse_order(sort, limit, error))
+            {
+                reply_error(error);
+                return;
+            }
+        }
+
+        bool bursts = bursts_.load(std::memory_order_relaxed);
+        const auto burstsIter = message.find("bursts");
+        if (burstsIter != message.end())
+        {
+            if (!burstsIter->is_boolean())
+            {
+                reply_error("'bursts' must be true or false");
+                return;
+            }
+            bursts = burstsIter->get<bool>();
+        }
+
+        fields_ = fields;
+        exclude_ = exclude;
+        bursts_.store(bursts, std::memory_order_relaxed);
+        // Ticks faster than the collector's governed interval repeat the same snapshot.
+        enqueue_control(control_frame({{"type", "subscribed"},
+                                       {"interval", interval.count()},
+                                       {"collectorIntervalMs", server_.collector.interval().count()},
+                                       {"fields", fields_},
+                                       {"exclude", exclude_},
+                                       {"sort", selection.sort_key()},
+                                       {"limit", selection.limit()},
+                                       {"bursts", bursts}}));
+        subscribe(interval, selection);
+    }
+
+    void reply_error(const std::string &message)
+    {
+        enqueue_control(control_frame({{"type", "error"}, {"message", message}}));
+    }
+
+    void enqueue_control(std::shared_ptr<const std::string> frame)
+    {
+        if (control_.size() >= MAX_CONTROL_FRAMES)
+        {
+            frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+            control_dropped_.fetch_add(1, std::memory_order_relaxed);
+            server_.frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+            server_.control_dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        control_.push_back(std::move(frame));
+        flush();
+    }
+
+    void do_read()
+    {
+        ws_.async_read(read_buffer_, [self = shared_from_this()](beast::error_code ec, std::size_t bytes)
+                       {
+            if (ec)
+            {
+                self->closed_ = true;
+                if (!self->group_key_.empty())
                 {
-                    result.push_back(value[i]);
+                    self->server_.leave(self.get(), self->group_key_);
+                    self->group_key_.clear();
                 }
+                return;
             }
-            return result;
-        };
+            const std::string text = beast::buffers_to_string(self->read_buffer_.data());
+            self->read_buffer_.consume(bytes);
+            self->handle_control(text);
+            self->do_read(); });
+    }
+
+    void accept_frame(std::shared_ptr<const std::string> frame)
+    {
+        if (closed_)
+        {
+            return;
+        }
+
+        if (writing_)
+        {
+            // The previous frame is still on the wire: conflate, and track how long we have been behind.
+            const auto now = std::chrono::steady_clock::now();
+            if (latest_)
+            {
+                frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+                server_.frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (behind_since_ == std::chrono::steady_clock::time_point())
+            {
+                behind_since_ = now;
+                behind_since_ms_.store(std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count(),
+                                       std::memory_order_relaxed);
+            }
+            else if (now - behind_since_ > server_.slow_consumer_timeout_)
+            {
+                disconnect_slow(now);
+                return;
+            }
+        }
+
+        latest_ = std::move(frame);
+        flush();
+    }
+
+    void disconnect_slow(std::chrono::steady_clock::time_point now)
+    {
+        std::cerr << "Disconnecting slow WebSocket consumer " << remote_ << " (behind for "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(now - behind_since_).count() << " ms)" << std::endl;
+        server_.slow_disconnects_.fetch_add(1, std::memory_order_relaxed);
+        closed_ = true;
+        latest_.reset();
+        control_.clear();
+        queued_.store(0, std::memory_order_relaxed);
+        if (!group_key_.empty())
+        {
+            server_.leave(this, group_key_);
+            group_key_.clear();
+        }
+        // A close handshake would queue behind the stalled write; drop the connection instead.
+        beast::get_lowest_layer(ws_).close();
+    }
+
+    void flush()
+    {
+        queued_.store(control_.size() + (latest_ ? 1 : 0), std::memory_order_relaxed);
+        if (writing_ || closed_)
+        {
+            return;
+        }
+        if (!control_.empty())
+        {
+            current_ = std::move(control_.front());
+            control_.pop_front();
+        }
+        else if (latest_)
+        {
+            current_ = std::move(latest_);
+            latest_.reset();
+        }
+        else
+        {
+            return;
+        }
 
-        while (std::getline(ss, pair, '&'))
+        writing_ = true;
+        write_started_ = std::chrono::steady_clock::now();
+        queued_.store(control_.size() + (latest_ ? 1 : 0), std::memory_order_relaxed);
+        ws_.async_write(net::buffer(*current_), [self = shared_from_this()](beast::error_code ec, std::size_t bytes)
+                        { self->on_write(ec, bytes); });
+    }
+
+    void on_write(beast::error_code ec, std::size_t bytes)
+    {
+        writing_ = false;
+        current_.reset();
+        if (ec)
         {
-            if (pair.empty())
+            if (!is_disconnect(ec) && !closed_)
             {
-                continue;
+                std::cerr << "WebSocket session error: " << ec.message() << std::endl;
             }
-            const auto equal_pos = pair.find('=');
-            if (equal_pos == std::string::npos)
+            closed_ = true;
+            return;
+        }
+
+        frames_sent_.fetch_add(1, std::memory_order_relaxed);
+        bytes_sent_.fetch_add(bytes, std::memory_order_relaxed);
+        server_.frames_sent_.fetch_add(1, std::memory_order_relaxed);
+        const auto written = std::chrono::steady_clock::now();
+        self_stats::record(self_stats::Timer::WebSocketWrite, written - write_started_);
+        trace::record("ws.write", "websocket", write_started_, written, "bytes", bytes);
+        self_stats::add(self_stats::Counter::WebSocketFrames);
+        self_stats::add(self_stats::Counter::WebSocketBytesSent, bytes);
+
+        flush();
+        if (!writing_)
+        {
+            // Queue drained: the client has caught up.
+            behind_since_ = std::chrono::steady_clock::time_point();
+            behind_since_ms_.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void close(websocket::close_code code, const std::string &text)
+    {
+        websocket::close_reason reason(code);
+        reason.reason = text;
+        ws_.async_close(reason, [self = shared_from_this()](beast::error_code) {});
+    }
+
+    WebSocketServer &server_;
+    websocket::stream<beast::tcp_stream> ws_;
+    beast::http::request<beast::http::string_body> request_;
+    beast::flat_buffer read_buffer_;
+    MetricsSelection selection_;
+    std::chrono::milliseconds interval_;
+    std::string fields_;
+    std::string exclude_;
+    std::string group_key_;
+    std::shared_ptr<const std::string> current_;
+    std::shared_ptr<const std::string> latest_;
+    std::deque<std::shared_ptr<const std::string>> control_;
+    bool admitted_;
+    bool closed_;
+    bool writing_;
+    std::atomic<bool> bursts_; // read by broadcast_burst() from the burst sampler
+    std::string remote_;
+    const std::chrono::steady_clock::time_point connected_;
+    std::chrono::steady_clock::time_point behind_since_;
+    std::chrono::steady_clock::time_point write_started_;
+
+    // Mirrors of the strand-owned state, read by handle_sessions() from other threads.
+    std::atomic<long long> interval_ms_;
+    std::atomic<std::size_t> queued_;
+    std::atomic<unsigned long long> frames_sent_;
+    std::atomic<unsigned long long> frames_dropped_;
+    std::atomic<unsigned long long> control_dropped_; // replies and events, also in frames_dropped_
+    std::atomic<unsigned long long> bytes_sent_;
+    std::atomic<long long> behind_since_ms_;
+};
+
+// Sessions sharing one (interval, selection) subscription. The group's timer runs on its own strand;
+// each tick encodes once (through the shared PayloadCache) and hands the buffer to every member.
+class WebSocketServer::TickGroup : public std::enable_shared_from_this<WebSocketServer::TickGroup>
+{
+public:
+    TickGroup(WebSocketServer &server, const net::any_io_executor &executor, std::chrono::milliseconds interval, const MetricsSelection &selection)
+        : server_(server), strand_(net::make_strand(executor)), timer_(strand_), interval_(interval), selection_(selection), stopped_(false)
+    {
+    }
+
+    void start()
+    {
+        net::dispatch(strand_, [self = shared_from_this()]()
+                      {
+            self->next_tick_ = std::chrono::steady_clock::now() + self->interval_;
+            self->schedule(); });
+    }
+
+    void stop()
+    {
+        net::post(strand_, [self = shared_from_this()]()
+                  {
+            self->stopped_ = true;
+            self->timer_.cancel(); });
+    }
+
+    // Guarded by the server's groups_mutex_.
+    std::unordered_map<Session *, std::weak_ptr<Session>> members;
+
+private:
+    void schedule()
+    {
+        timer_.expires_at(next_tick_);
+        timer_.async_wait([self = shared_from_this()](beast::error_code ec)
+                          { self->on_tick(ec); });
+    }
+
+    void on_tick(beast::error_code ec)
+    {
+        if (ec || stopped_)
+        {
+            return;
+        }
+
+        trace::Span span("ws.tick", "websocket");
+        const auto frame = server_.payload(selection_);
+        std::vector<std::shared_ptr<Session>> targets;
+        if (frame)
+        {
+            std::lock_guard<std::mutex> lock(server_.groups_mutex_);
+            targets.reserve(members.size());
+            for (const auto &member : members)
             {
-                continue;
+                if (auto session = member.second.lock())
+                {
+                    targets.push_back(std::move(session));
+                }
             }
+        }
+        for (const auto &session : targets)
+        {
+            session->deliver(frame);
+        }
 
-            std::string key = pair.substr(0, equal_pos);
-            std::string value = pair.substr(equal_pos + 1);
-            params[url_decode(key)] = url_decode(value);
+        // Skip ticks missed while the strand was busy rather than bursting to catch up.
+        next_tick_ += interval_;
+        const auto now = std::chrono::steady_clock::now();
+        if (next_tick_ < now)
+        {
+            next_tick_ = now + interval_;
         }
+        schedule();
+    }
+
+    WebSocketServer &server_;
+    net::strand<net::any_io_executor> strand_;
+    net::steady_timer timer_;
+    std::chrono::milliseconds interval_;
+    MetricsSelection selection_;
+    std::chrono::steady_clock::time_point next_tick_;
+    bool stopped_;
+};
+
+WebSocketServer::WebSocketServer(MetricsCollector &collector, PayloadCache &payloads, std::string apiToken, std::size_t maxSessions,
+                                 std::chrono::milliseconds slowConsumerTimeout)
+    : collector(collector), payloads_(payloads), api_token_(std::move(apiToken)),
+      max_sessions_(maxSessions == 0 ? 1 : maxSessions), slow_consumer_timeout_(slowConsumerTimeout), active_sessions_(0),
+      frames_sent_(0), frames_dropped_(0), control_dropped_(0), slow_disconnects_(0) {}
+
+HttpServer::UpgradeHandler WebSocketServer::upgrade_handler()
+{
+    return [this](HttpUpgrade &&upgrade)
+    {
+        std::make_shared<Session>(*this, std::move(upgrade))->run();
+    };
+}
+
+void WebSocketServer::handle_sessions(const HttpRequest &, HttpResponse &response)
+{
+    response.set_body(sessions_report().dump(), "application/json");
+}
+
+nlohmann::json WebSocketServer::sessions_report()
+{
+    std::vector<std::shared_ptr<Session>> sessions;
+    std::size_t groupCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(groups_mutex_);
+        groupCount = groups_.size();
+        for (const auto &group : groups_)
+        {
+            for (const auto &member : group.second->members)
+            {
+                if (auto session = member.second.lock())
+                {
+                    sessions.push_back(std::move(session));
+                }
+            }
+        }
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    nlohmann::json clients = nlohmann::json::array();
+    for (const auto &session : sessions)
+    {
+        clients.push_back(session->report(now));
+    }
+
+    return {
+        {"sessions", active_sessions_.load(std::memory_order_relaxed)},
+        {"groups", groupCount},
+        {"framesSent", frames_sent_.load(std::memory_order_relaxed)},
+        {"framesDropped", frames_dropped_.load(std::memory_order_relaxed)},
+        {"controlDropped", control_dropped_.load(std::memory_order_relaxed)},
+        {"slowDisconnects", slow_disconnects_.load(std::memory_order_relaxed)},
+        {"slowConsumerTimeoutMs", slow_consumer_timeout_.count()},
+        {"clients", std::move(clients)}};
+}
+
+void WebSocketServer::broadcast(std::string frame)
+{
+    fan_out(std::move(frame), false);
+}
+
+void WebSocketServer::broadcast_burst(std::string frame)
+{
+    fan_out(std::move(frame), true);
+}
 
-        return params;
+void WebSocketServer::fan_out(std::string frame, bool burstsOnly)
+{
+    const auto shared = std::make_shared<const std::string>(std::move(frame));
+    // Every live session is kept until the lock is released: dropping what may be the last reference under
+    // groups_mutex_ would run ~Session, whose leave() takes the same mutex and erases from the members map.
+    std::vector<std::shared_ptr<Session>> targets;
+    {
+        std::lock_guard<std::mutex> lock(groups_mutex_);
+        for (const auto &group : groups_)
+        {
+            for (const auto &member : group.second->members)
+            {
+                if (auto session = member.second.lock())
+                {
+                    targets.push_back(std::move(session));
+                }
+            }
+        }
     }
+    for (const auto &session : targets)
+    {
+        if (!burstsOnly || session->wants_bursts())
+        {
+            session->deliver_event(shared);
+        }
+    }
+}
 
+std::string WebSocketServer::join(const std::shared_ptr<Session> &session, std::chrono::milliseconds interval, const MetricsSelection &selection)
+{
+    std::string key = std::to_string(interval.count()) + '|' + selection.key();
+
+    std::lock_guard<std::mutex> lock(groups_mutex_);
+    auto &group = groups_[key];
+    if (!group)
+    {
+        group = std::make_shared<TickGroup>(*this, session->executor(), interval, selection);
+        group->start();
+    }
+    group->members.emplace(session.get(), session);
+    return key;
 }
 
-WebSocketServer::WebSocketServer(unsigned short port, std::string apiToken, std::size_t maxSessions)
-    : collector(), port_(port), api_token_(std::move(apiToken)),
-      max_sessions_(maxSessions == 0 ? 1 : maxSessions), active_sessions_(0) {}
+void WebSocketServer::leave(Session *session, const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(groups_mutex_);
+    const auto iter = groups_.find(key);
+    if (iter == groups_.end())
+    {
+        return;
+    }
+    iter->second->members.erase(session);
+    if (iter->second->members.empty())
+    {
+        iter->second->stop();
+        groups_.erase(iter);
+    }
+}
 
-SystemMetrics WebSocketServer::collect_once()
+std::shared_ptr<const std::string> WebSocketServer::payload(const MetricsSelection &selection)
 {
-    return collector.collect();
+    // Same representation key as the REST handler, so pollers and streams share one encoding. Runs on the
+    // I/O threads, so it only reads the published snapshot; the collecting thread fills in missing sections.
+    const std::shared_ptr<const SystemMetrics> snapshot = collector.latest(selection.sections());
+    if ((snapshot->sections & selection.sections()) != selection.sections())
+    {
+        return nullptr;
+    }
+    const std::string variant = selection.key() + '|';
+    if (auto cached = payloads_.find(snapshot->sequence, variant))
+    {
+        return cached;
+    }
+    std::string encoded;
+    {
+        self_stats::ScopedTimer timer(self_stats::Timer::JsonEncode);
+        trace::Span span("encode.json", "serialize");
+        encoded = metrics_to_json(*snapshot, selection).dump();
+    }
+    return payloads_.store(snapshot->sequence, variant, std::move(encoded));
 }
 
 bool WebSocketServer::is_token_valid(const std::string &provided) const
@@ -110,184 +804,3 @@ bool WebSocketServer::is_token_valid(const std::string &provided) const
 
     return security::tokens_equal(provided, api_token_);
 }
-
-void WebSocketServer::run()
-{
-    try
-    {
-        net::io_context ioc{1};
-        tcp::acceptor acceptor{ioc, tcp::endpoint(tcp::v4(), port_)};
-
-        std::cout << "WebSocket server listening on port: " << port_ << std::endl;
-
-        for (;;)
-        {
-            tcp::socket socket{ioc};
-            acceptor.accept(socket);
-
-            // Launch a detached thread to handle the session
-            std::thread([s = std::move(socket), this]() mutable
-                        {
-                try {
-                    s.set_option(tcp::no_delay(true));
-                    s.set_option(net::socket_base::keep_alive(true));
-
-                    websocket::stream<tcp::socket> ws{std::move(s)};
-                    ws.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
-                    ws.read_message_max(64 * 1024);
-                    ws.set_option(websocket::stream_base::decorator([](websocket::response_type &res) {
-                        res.set(beast::http::field::server, BOOST_BEAST_VERSION_STRING " monitoring-service");
-                    }));
-
-                    beast::flat_buffer buffer;
-                    beast::http::request<beast::http::string_body> req;
-                    beast::http::read(ws.next_layer(), buffer, req);
-
-                    if (req.method() != beast::http::verb::get)
-                    {
-                        beast::http::response<beast::http::string_body> res{beast::http::status::method_not_allowed, req.version()};
-                        res.set(beast::http::field::server, BOOST_BEAST_VERSION_STRING " monitoring-service");
-                        res.set(beast::http::field::content_type, "text/plain");
-                        res.keep_alive(false);
-                        res.body() = "WebSocket handshake must use GET.";
-                        res.prepare_payload();
-                        beast::http::write(ws.next_layer(), res);
-                        return;
-                    }
-
-                    if (!websocket::is_upgrade(req))
-                    {
-                        beast::http::response<beast::http::string_body> res{beast::http::status::bad_request, req.version()};
-                        res.set(beast::http::field::server, BOOST_BEAST_VERSION_STRING " monitoring-service");
-                        res.set(beast::http::field::content_type, "text/plain");
-                        res.keep_alive(false);
-                        res.body() = "Expected WebSocket upgrade request.";
-                        res.prepare_payload();
-                        beast::http::write(ws.next_layer(), res);
-                        return;
-                    }
-
-                    ws.accept(req);
-
-                    const auto params = parse_query_string(req.target());
-                    const auto it = params.find("token");
-                    const std::string provided_token = it != params.end() ? it->second : std::string();
-                    if (!is_token_valid(provided_token)) {
-                        std::cerr << "Rejected WebSocket client due to invalid token" << std::endl;
-                        websocket::close_reason reason(websocket::close_code::policy_error);
-                        reason.reason = "Missing or invalid token";
-                        ws.close(reason);
-                        return;
-                    }
-
-                    const auto current_sessions = active_sessions_.fetch_add(1, std::memory_order_relaxed) + 1;
-
-                    if (current_sessions > max_sessions_) {
-                        std::cerr << "Rejecting WebSocket client: too many active sessions" << std::endl;
-                        active_sessions_.fetch_sub(1, std::memory_order_relaxed);
-                        websocket::close_reason reason(websocket::close_code::try_again_later);
-                        reason.reason = "Server busy";
-                        ws.close(reason);
-                        return;
-                    }
-
-                    auto guard = std::unique_ptr<void, std::function<void(void*)>>(nullptr, [this](void*) {
-                        active_sessions_.fetch_sub(1, std::memory_order_relaxed);
-                    });
-
-                    ws.text(true);
-                    while (ws.is_open()) {
-                        SystemMetrics m = this->collect_once();
-                        nlohmann::json j;
-                        j["cpu"] = m.cpuUsage;
-                        j["cpuAvg"] = m.cpuUsageAverage;
-                        j["memory"] = m.memoryUsage;
-                        j["swap"] = m.swapUsage;
-                        j["connections"] = m.activeConnections;
-                        j["disk"] = m.diskUsage;
-                        j["load1"] = m.loadAverage1;
-                        j["load5"] = m.loadAverage5;
-                        j["load15"] = m.loadAverage15;
-                        j["netRx"] = m.networkReceiveRate;
-                        j["netTx"] = m.networkTransmitRate;
-                        j["netRxAvg"] = m.networkReceiveRateAverage;
-                        j["netTxAvg"] = m.networkTransmitRateAverage;
-                        j["cpuCores"] = m.cpuCount;
-                        j["processes"] = m.processCount;
-                        j["threads"] = m.threadCount;
-                        j["listeningTcp"] = m.listeningTcp;
-                        j["listeningUdp"] = m.listeningUdp;
-                        j["openFds"] = m.openFileDescriptors;
-                        j["uniqueDomains"] = m.uniqueDomains;
-                        j["dockerAvailable"] = m.dockerAvailable;
-                        j["timestamp"] = MetricsCollector::to_iso8601(m.timestamp);
-                        j["applications"] = nlohmann::json::array();
-                        for (const auto &app : m.topApplications)
-                        {
-                            j["applications"].push_back({
-                                {"pid", app.pid},
-                                {"name", app.name},
-                                {"cpu", app.cpuPercent},
-                                {"memoryMb", app.memoryMb},
-                                {"commandLine", app.commandLine}
-                            });
-                        }
-                        j["domains"] = nlohmann::json::array();
-                        for (const auto &domain : m.domainUsage)
-                        {
-                            j["domains"].push_back({
-                                {"domain", domain.domain},
-                                {"receiveRate", domain.receiveRate},
-                                {"transmitRate", domain.transmitRate},
-                                {"connections", domain.connections}
-                            });
-                        }
-
-                        j["dockerContainers"] = nlohmann::json::array();
-                        for (const auto &container : m.dockerContainers)
-                        {
-                            j["dockerContainers"].push_back({
-                                {"id", container.id},
-                                {"name", container.name},
-                                {"image", container.image},
-                                {"status", container.status}
-                            });
-                        }
-
-                        j["dockerImages"] = nlohmann::json::array();
-                        for (const auto &image : m.dockerImages)
-                        {
-                            j["dockerImages"].push_back({
-                                {"repository", image.repository},
-                                {"tag", image.tag},
-                                {"id", image.id},
-                                {"size", image.size}
-                            });
-                        }
-
-                        beast::error_code ec;
-                        ws.write(net::buffer(j.dump()), ec);
-                        if (ec)
-                        {
-                            if (ec == websocket::error::closed || ec == net::error::operation_aborted || ec == boost::asio::error::broken_pipe)
-                            {
-                                break;
-                            }
-                            std::cerr << "WebSocket session error: " << ec.message() << std::endl;
-                            break;
-                        }
-
-                        std::this_thread::sleep_for(std::chrono::milliseconds(500));
-                    }
-                } catch (const std::exception& e) {
-                    // Session error — log and exit thread
-                    std::cerr << "WebSocket session error: " << e.what() << std::endl;
-                } })
-                .detach();
-        }
-    }
-    catch (const std::exception &e)
-    {
-        std::cerr << "WebSocket server fatal error: " << e.what() << std::endl;
-    }
-}
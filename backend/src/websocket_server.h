@@ -1,23 +1,71 @@
 #pragma once
 #include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <thread>
+#include <unordered_map>
 
+#include <nlohmann/json.hpp>
+
+#include "http_server.h"
+#include "metrics_selection.h"
+#include "payload_cache.h"
 #include "system_metrics.h"
 
+// Streams snapshots to WebSocket clients upgraded from the shared HttpServer.
+//
+// A client subscribes to a push interval and field set, either with handshake parameters
+// (?interval=1000&fields=cpu,memory) or later with a control message:
+//   {"type":"subscribe","interval":1000,"fields":"cpu,memory","exclude":""}
+// Burst capture batches are opt-in, with ?bursts=1 or "bursts":true in a subscribe message.
+// Sessions with identical subscriptions share a tick group: one timer and one encoded payload per
+// tick, fanned out to every member.
+//
+// Each session keeps at most one pending snapshot frame (newer ticks replace it) plus a short
+// queue of control replies. A session that stays behind for longer than the slow-consumer timeout
+// is disconnected, so one laggy client cannot hold memory or delay the others.
 class WebSocketServer
 {
 public:
-    explicit WebSocketServer(unsigned short port, std::string apiToken = {}, std::size_t maxSessions = 32);
-    void run();
+    WebSocketServer(MetricsCollector &collector, PayloadCache &payloads, std::string apiToken = {}, std::size_t maxSessions = 32,
+                    std::chrono::milliseconds slowConsumerTimeout = std::chrono::seconds(10));
+
+    // Handler that takes over the connections HttpServer upgrades to WebSocket.
+    HttpServer::UpgradeHandler upgrade_handler();
+    // JSON report of every subscribed session: queue depth, frames sent and dropped (control replies separately), how far behind it is.
+    void handle_sessions(const HttpRequest &request, HttpResponse &response);
+    // The same report as a document, for embedding in /debug/stats.
+    nlohmann::json sessions_report();
+    // Queues a text frame (e.g. an alert event) for every subscribed session, behind any pending replies.
+    void broadcast(std::string frame);
+    // Queues a burst capture batch for the sessions that asked for bursts only.
+    void broadcast_burst(std::string frame);
 
 private:
-    SystemMetrics collect_once();
-    MetricsCollector collector;
-    unsigned short port_;
+    class Session;
+    class TickGroup;
+
+    // Queues an event frame for every subscribed session, or only those that asked for bursts.
+    void fan_out(std::string frame, bool burstsOnly);
+    // Encoded frame of the published snapshot; null while it lacks the selection's sections.
+    std::shared_ptr<const std::string> payload(const MetricsSelection &selection);
+    // Adds the session to the group for (interval, selection), creating it on first use; returns the group key.
+    std::string join(const std::shared_ptr<Session> &session, std::chrono::milliseconds interval, const MetricsSelection &selection);
+    void leave(Session *session, const std::string &key);
+    bool is_token_valid(const std::string &provided) const;
+
+    MetricsCollector &collector;
+    PayloadCache &payloads_;
     std::string api_token_;
     std::size_t max_sessions_;
+    std::chrono::milliseconds slow_consumer_timeout_;
     std::atomic<std::size_t> active_sessions_;
-    bool is_token_valid(const std::string &provided) const;
+    std::atomic<unsigned long long> frames_sent_;
+    std::atomic<unsigned long long> frames_dropped_;
+    std::atomic<unsigned long long> control_dropped_;
+    std::atomic<unsigned long long> slow_disconnects_;
+    std::mutex groups_mutex_;
+    std::unordered_map<std::string, std::shared_ptr<TickGroup>> groups_;
 };
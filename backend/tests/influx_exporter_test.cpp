@@ -0,0 +1,343 @@
+// InfluxExporter against a local HTTP stub that answers 204, then 500, then nothing at all.
+//
+// Drives the live collector and checks, in order: that a flush interval's snapshots go out as one gzip
+// batch with the configured target, token and host tag; that batches rejected with 500 are retried,
+// overflow the retry queue into the spool and are all delivered once the stub recovers; that a write the
+// stub never answers is abandoned after the request timeout; and that stop() does not wait for it.
+#include "influx_exporter.h"
+#include "system_metrics.h"
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        std::cout << (condition ? "ok   " : "FAIL ") << what << '\n';
+        if (!condition)
+        {
+            ++failures;
+        }
+    }
+
+    bool wait_until(const std::function<bool()> &done, std::chrono::milliseconds timeout)
+    {
+        const auto deadline = Clock::now() + timeout;
+        while (!done())
+        {
+            if (Clock::now() >= deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        return true;
+    }
+
+    bool gunzip(const std::string &compressed, std::string &out)
+    {
+        z_stream stream{};
+        if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+        {
+            return false;
+        }
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data()));
+        stream.avail_in = static_cast<uInt>(compressed.size());
+        char buffer[16384];
+        int status = Z_OK;
+        while (status == Z_OK)
+        {
+            stream.next_out = reinterpret_cast<Bytef *>(buffer);
+            stream.avail_out = sizeof(buffer);
+            status = inflate(&stream, Z_NO_FLUSH);
+            out.append(buffer, sizeof(buffer) - stream.avail_out);
+        }
+        inflateEnd(&stream);
+        return status == Z_STREAM_END;
+    }
+
+    // One connection at a time, as the exporter keeps a single keep-alive connection.
+    class StubServer
+    {
+    public:
+        enum class Mode
+        {
+            Accept, // 204 No Content
+            Fail,   // 500 Internal Server Error
+            Hang    // read the request and never answer
+        };
+
+        struct Request
+        {
+            Mode mode;
+            std::string target;
+            std::string authorization;
+            std::string encoding;
+            std::string body; // as received, gzip-compressed
+        };
+
+        StubServer() : acceptor_(ioc_, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0)), mode_(Mode::Accept), stopping_(false)
+        {
+            thread_ = std::thread([this]()
+                                  { serve(); });
+        }
+
+        ~StubServer()
+        {
+            stopping_ = true;
+            beast::error_code ignored;
+            tcp::socket wake(ioc_);
+            wake.connect(acceptor_.local_endpoint(), ignored);
+            thread_.join();
+        }
+
+        unsigned short port() const { return acceptor_.local_endpoint().port(); }
+        void set_mode(Mode mode) { mode_ = mode; }
+
+        std::vector<Request> requests()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return requests_;
+        }
+
+        std::size_t count(Mode mode)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return static_cast<std::size_t>(std::count_if(requests_.begin(), requests_.end(), [mode](const Request &request)
+                                                          { return request.mode == mode; }));
+        }
+
+        // How long each unanswered request stayed open before the client closed the connection.
+        std::vector<Clock::duration> abandoned()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return abandoned_;
+        }
+
+    private:
+        void serve()
+        {
+            while (!stopping_)
+            {
+                tcp::socket socket(ioc_);
+                beast::error_code ec;
+                acceptor_.accept(socket, ec);
+                if (ec || stopping_)
+                {
+                    continue;
+                }
+
+                beast::flat_buffer buffer;
+                for (;;)
+                {
+                    http::request<http::string_body> req;
+                    http::read(socket, buffer, req, ec);
+                    if (ec)
+                    {
+                        break;
+                    }
+
+                    const Mode mode = mode_;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        requests_.push_back({mode, std::string(req.target()), std::string(req[http::field::authorization]),
+                                             std::string(req[http::field::content_encoding]), std::move(req.body())});
+                    }
+
+                    if (mode == Mode::Hang)
+                    {
+                        const auto started = Clock::now();
+                        char byte;
+                        socket.read_some(net::buffer(&byte, 1), ec);
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        abandoned_.push_back(Clock::now() - started);
+                        break;
+                    }
+
+                    http::response<http::string_body> res{mode == Mode::Accept ? http::status::no_content : http::status::internal_server_error, 11};
+                    res.keep_alive(true);
+                    if (mode == Mode::Fail)
+                    {
+                        res.body() = "{\"code\":\"internal error\"}";
+                    }
+                    res.prepare_payload();
+                    http::write(socket, res, ec);
+                    if (ec)
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+
+        net::io_context ioc_;
+        tcp::acceptor acceptor_;
+        std::atomic<Mode> mode_;
+        std::atomic<bool> stopping_;
+        std::mutex mutex_;
+        std::vector<Request> requests_;
+        std::vector<Clock::duration> abandoned_;
+        std::thread thread_;
+    };
+
+    std::size_t spooled(const std::filesystem::path &directory)
+    {
+        std::error_code ec;
+        return static_cast<std::size_t>(std::distance(std::filesystem::directory_iterator(directory, ec), std::filesystem::directory_iterator()));
+    }
+
+    long long milliseconds(Clock::duration elapsed)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    }
+
+} // namespace
+
+int main()
+{
+    const std::filesystem::path spool = std::filesystem::temp_directory_path() / ("influx_exporter_test-" + std::to_string(::getpid()));
+    std::filesystem::remove_all(spool);
+
+    StubServer stub;
+    MetricsCollector collector;
+
+    InfluxExporterConfig config{};
+    config.url = "http://127.0.0.1:" + std::to_string(stub.port());
+    config.org = "o";
+    config.bucket = "b";
+    config.token = "t";
+    config.host_tag = "stub-host";
+    config.batch_max_bytes = 16 * 1024 * 1024;
+    config.flush_interval = std::chrono::milliseconds(1500);
+    config.retry_queue_max_batches = 1;
+    config.spool_directory = spool.string();
+    config.spool_max_bytes = 64 * 1024 * 1024;
+    config.request_timeout = std::chrono::milliseconds(500);
+    auto exporter = std::make_unique<InfluxExporter>(collector, config);
+    exporter->start();
+    collector.start();
+
+    // 204: one batch per flush interval.
+    check(wait_until([&]
+                     { return stub.count(StubServer::Mode::Accept) >= 1; },
+                     std::chrono::seconds(10)),
+          "a batch reaches the stub");
+    {
+        const auto first = stub.requests().front();
+        std::string lines;
+        check(first.target == "/api/v2/write?org=o&bucket=b&precision=ms", "write target carries org, bucket and precision");
+        check(first.authorization == "Token t", "token sent as Authorization: Token");
+        check(first.encoding == "gzip" && gunzip(first.body, lines), "body is gzip-compressed");
+
+        std::size_t points = 0;
+        std::set<std::string> timestamps;
+        bool tagged = true;
+        std::istringstream in(lines);
+        for (std::string line; std::getline(in, line);)
+        {
+            ++points;
+            tagged = tagged && line.find(",host=stub-host") != std::string::npos;
+            if (line.compare(0, 15, "system_metrics,") == 0)
+            {
+                timestamps.insert(line.substr(line.rfind(' ') + 1));
+            }
+        }
+        check(points > 0 && !lines.empty() && lines.back() == '\n', "batch holds whole lines");
+        check(tagged, "every point carries the host tag");
+        check(timestamps.size() >= 2, "one batch holds several snapshots (" + std::to_string(timestamps.size()) + ")");
+    }
+
+    // 500: retried with backoff, the retry queue spills into the spool, everything arrives afterwards.
+    stub.set_mode(StubServer::Mode::Fail);
+    const std::size_t acceptedBefore = stub.count(StubServer::Mode::Accept);
+    check(wait_until([&]
+                     { return stub.count(StubServer::Mode::Fail) >= 3 && spooled(spool) >= 1; },
+                     std::chrono::seconds(15)),
+          "rejected batches are retried and spill into the spool");
+    std::set<std::string> rejected;
+    std::size_t attempts = 0;
+    for (const auto &request : stub.requests())
+    {
+        if (request.mode == StubServer::Mode::Fail)
+        {
+            ++attempts;
+            rejected.insert(request.body);
+        }
+    }
+    check(rejected.size() < attempts, "a rejected batch is sent again");
+
+    stub.set_mode(StubServer::Mode::Accept);
+    const auto delivered = [&]
+    {
+        std::set<std::string> accepted;
+        for (const auto &request : stub.requests())
+        {
+            if (request.mode == StubServer::Mode::Accept)
+            {
+                accepted.insert(request.body);
+            }
+        }
+        return std::all_of(rejected.begin(), rejected.end(), [&accepted](const std::string &body)
+                           { return accepted.count(body) != 0; });
+    };
+    check(wait_until([&]
+                     { return delivered() && spooled(spool) == 0; },
+                     std::chrono::seconds(20)),
+          "every rejected batch is delivered once the stub recovers and the spool drains");
+    check(stub.count(StubServer::Mode::Accept) > acceptedBefore, "delivery resumes");
+
+    // No answer: the write is abandoned after the request timeout and retried.
+    stub.set_mode(StubServer::Mode::Hang);
+    check(wait_until([&]
+                     { return !stub.abandoned().empty(); },
+                     std::chrono::seconds(10)),
+          "an unanswered write is abandoned");
+    if (!stub.abandoned().empty())
+    {
+        const long long waited = milliseconds(stub.abandoned().front());
+        check(waited >= 400 && waited < 2000, "abandoned after the 500 ms request timeout (" + std::to_string(waited) + " ms)");
+    }
+
+    // stop() with a write in flight returns without waiting for the timeout and spools what was queued.
+    const std::size_t hung = stub.count(StubServer::Mode::Hang);
+    check(wait_until([&]
+                     { return stub.count(StubServer::Mode::Hang) > hung; },
+                     std::chrono::seconds(10)),
+          "the batch is retried against the unresponsive stub");
+    const auto stopping = Clock::now();
+    exporter->stop();
+    const long long stopMs = milliseconds(Clock::now() - stopping);
+    check(stopMs < 400, "stop() cancels the write in flight (" + std::to_string(stopMs) + " ms)");
+    check(spooled(spool) >= 1, "undelivered batches are spooled on stop");
+    collector.stop();
+    exporter.reset();
+
+    std::filesystem::remove_all(spool);
+    std::cout << (failures == 0 ? "all checks passed" : std::to_string(failures) + " checks failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,306 @@
+// TargetPattern and the ?target= term parser: grammar, agreement with std::regex, rejections and the step budget.
+#include "system_metrics.h"
+#include "target_index.h"
+#include "target_pattern.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cout << "FAIL " << what << '\n';
+            ++failures;
+        }
+    }
+
+    std::string fold(std::string value)
+    {
+        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch)
+                       { return static_cast<char>(std::tolower(ch)); });
+        return value;
+    }
+
+    TargetPattern::Result run(const TargetPattern &pattern, const std::string &subject, std::size_t &budget)
+    {
+        TargetPattern::Scratch scratch;
+        return pattern.search(fold(subject), budget, scratch);
+    }
+
+    // Compiles `source` and reports whether it matches somewhere in `subject`; a compile error fails the check.
+    bool matches(const std::string &source, const std::string &subject)
+    {
+        TargetPattern pattern;
+        std::string error;
+        if (!pattern.compile(source, error))
+        {
+            check(false, "'" + source + "' compiles: " + error);
+            return false;
+        }
+        std::size_t budget = std::numeric_limits<std::size_t>::max();
+        return run(pattern, subject, budget) == TargetPattern::Result::Hit;
+    }
+
+    void expect_match(const std::string &source, const std::string &subject, bool expected)
+    {
+        check(matches(source, subject) == expected,
+              "'" + source + "' " + (expected ? "matches" : "does not match") + " '" + subject + "'");
+    }
+
+    void expect_rejected(const std::string &source, const std::string &reason)
+    {
+        TargetPattern pattern;
+        std::string error;
+        const bool compiled = pattern.compile(source, error);
+        check(!compiled && error.find(reason) != std::string::npos,
+              "'" + source + "' is rejected with \"" + reason + "\" (got \"" + (compiled ? std::string("compiled") : error) + "\")");
+    }
+
+    void grammar()
+    {
+        expect_match("worker", "/usr/bin/worker --config", true);
+        expect_match("worker", "/usr/bin/work", false);
+        expect_match("WORKER", "Worker-1", true);
+        expect_match("w.rker", "wOrker", true);
+        expect_match("a.c", "a\nc", false);
+        expect_match("", "anything", true);
+        expect_match("", "", true);
+
+        expect_match("^nginx", "nginx: master", true);
+        expect_match("^nginx", "/usr/sbin/nginx", false);
+        expect_match("master$", "nginx: master", true);
+        expect_match("master$", "master process", false);
+        expect_match("^$", "", true);
+        expect_match("^$", "x", false);
+
+        expect_match("worker-[0-9]+", "worker-17", true);
+        expect_match("worker-[0-9]+", "worker-x", false);
+        expect_match("[^a-z]", "abc", false);
+        expect_match("[^a-z]", "ab1", true);
+        expect_match("[A-Z]", "q", true);
+        expect_match("[-a]", "-", true);
+        expect_match("[a-]", "-", true);
+        expect_match("[]a]", "a", false);
+        expect_match("[\\]]", "]", true);
+        expect_match("[\\d.]", ".", true);
+        expect_match("\\d\\d", "a12", true);
+        expect_match("\\d\\d", "a1b2", false);
+        expect_match("\\D", "123", false);
+        expect_match("\\w+_\\w+", "snake_case", true);
+        expect_match("\\W", "abc_123", false);
+        expect_match("a\\sb", "a\tb", true);
+        expect_match("\\S", " \t", false);
+        expect_match("\\x41\\u0042", "ab", true);
+        expect_match("\\.yaml", "configxyaml", false);
+        expect_match("\\.yaml", "config.yaml", true);
+        expect_match("a\\+", "a+", true);
+        expect_match("\\cJ", "\n", true);
+
+        expect_match("cat|dog", "hotdog", true);
+        expect_match("cat|dog", "cow", false);
+        expect_match("a|", "zzz", true);
+        expect_match("(?:ab)+c", "ababc", true);
+        expect_match("(ab)+c", "aabbc", false);
+        expect_match("^(a|b)*$", "abba", true);
+        expect_match("^(a|b)*$", "abca", false);
+
+        expect_match("^ab?c$", "ac", true);
+        expect_match("^ab?c$", "abbc", false);
+        expect_match("^a{3}$", "aaa", true);
+        expect_match("^a{3}$", "aaaa", false);
+        expect_match("^a{2,}$", "a", false);
+        expect_match("^a{2,}$", "aaaaa", true);
+        expect_match("^a{1,2}$", "aaa", false);
+        expect_match("^a{0}b$", "b", true);
+        expect_match("^a+?$", "aaa", true);
+        expect_match("^a*?b$", "aab", true);
+        expect_match("^a{2}?$", "aa", true);
+
+        // A '{' that does not open a well-formed quantifier is a literal.
+        expect_match("a{", "a{", true);
+        expect_match("a{1", "a{1", true);
+        expect_match("a{,2}", "a{,2}", true);
+        expect_match("{}", "{}", true);
+    }
+
+    // Results must agree with std::regex (ECMAScript, case-insensitive) wherever both accept the expression.
+    void differential()
+    {
+        const std::vector<std::string> patterns = {
+            "worker", "^worker-[0-9]+$", "w(or|ro)ker", "(a|b)*c", "[^abc]+", "\\d{2,3}", "x?y+z*", "^$", "(?:ab|a)b",
+            "--config /etc/\\w+/", "[a-c][x-z]?", "(a*)*b", "b{2}a", "^(ab|ba|b)*$", "\\s\\S", "[.]", "a|b|c|",
+        };
+        const std::vector<std::string> subjects = {
+            "", "worker", "worker-12", "worker-", "wroker", "aaac", "abab", "xyz", "y", "12", "1234", "ab", "abb", "bba",
+            "--config /etc/worker/worker-1.yaml", "cz", "b", "a", "bab", "a b", ".", "dd",
+        };
+        for (const auto &source : patterns)
+        {
+            const std::regex reference(source, std::regex::ECMAScript | std::regex::icase);
+            for (const auto &subject : subjects)
+            {
+                const bool expected = std::regex_search(subject, reference);
+                check(matches(source, subject) == expected, "'" + source + "' agrees with std::regex on '" + subject + "'");
+            }
+        }
+    }
+
+    void rejections()
+    {
+        expect_rejected("(a)\\1", "back-references are not supported");
+        expect_rejected("(?=a)", "lookaround and named groups are not supported");
+        expect_rejected("(?!a)", "lookaround and named groups are not supported");
+        expect_rejected("(?<name>a)", "lookaround and named groups are not supported");
+        expect_rejected("\\bword", "word boundaries are not supported");
+        expect_rejected("\\B", "word boundaries are not supported");
+
+        expect_rejected("[abc", "missing ']'");
+        expect_rejected("[a-", "missing ']'");
+        expect_rejected("[z-a]", "range out of order");
+        expect_rejected("[a-\\d]", "invalid class range");
+        expect_rejected("(abc", "missing ')'");
+        expect_rejected("abc)", "unmatched ')'");
+        expect_rejected("abc\\", "trailing backslash");
+        expect_rejected("\\x4", "invalid hexadecimal escape");
+        expect_rejected("\\u0100", "characters above \\xff are not supported");
+        expect_rejected("\\c1", "invalid \\c escape");
+
+        expect_rejected("*a", "nothing to repeat");
+        expect_rejected("a**", "nothing to repeat");
+        expect_rejected("a+*", "nothing to repeat");
+        expect_rejected("a|?", "nothing to repeat");
+        expect_rejected("a{3,1}", "numbers out of order");
+        expect_rejected("a{101}", "repeat count too large");
+        expect_rejected("a{1,1000}", "repeat count too large");
+
+        // Nested counted repeats multiply the program; past MAX_PROGRAM states they are refused up front.
+        expect_rejected("(a{100}){100}", "expression too complex");
+        expect_rejected("((a{20}){20}){20}", "expression too complex");
+        expect_rejected(std::string(40, '(') + "a" + std::string(40, ')'), "groups nested too deeply");
+
+        // Errors name where the parser stopped.
+        TargetPattern pattern;
+        std::string error;
+        pattern.compile("ab[cd", error);
+        check(error.find("at offset 5") != std::string::npos, "error names the offset (" + error + ")");
+    }
+
+    void budget()
+    {
+        // Nested and overlapping quantifiers that send a backtracking matcher exponential stay linear here.
+        for (const std::string source : {"(a+)+b", "(a|a)*b", "(a*)*b", "(ab|ba|b)*x"})
+        {
+            TargetPattern pattern;
+            std::string error;
+            check(pattern.compile(source, error), "'" + source + "' compiles");
+            const std::string subject(10000, source == "(ab|ba|b)*x" ? 'b' : 'a');
+
+            std::size_t budget = std::numeric_limits<std::size_t>::max();
+            check(run(pattern, subject, budget) == TargetPattern::Result::Miss, "'" + source + "' misses a long run");
+            const std::size_t steps = std::numeric_limits<std::size_t>::max() - budget;
+
+            budget = std::numeric_limits<std::size_t>::max();
+            run(pattern, subject + subject, budget);
+            const std::size_t doubled = std::numeric_limits<std::size_t>::max() - budget;
+            check(steps > 0 && doubled <= 2 * steps + 64, "'" + source + "' costs linear steps (" + std::to_string(steps) + " -> " +
+                                                              std::to_string(doubled) + ")");
+
+            // Any smaller budget runs out rather than answering.
+            budget = steps - 1;
+            check(run(pattern, subject, budget) == TargetPattern::Result::OutOfBudget && budget == 0,
+                  "'" + source + "' reports an exhausted budget");
+            budget = steps;
+            check(run(pattern, subject, budget) == TargetPattern::Result::Miss && budget == 0, "'" + source + "' fits its exact budget");
+        }
+
+        // A hit found early does not spend the budget on the rest of the subject.
+        TargetPattern pattern;
+        std::string error;
+        pattern.compile("needle", error);
+        std::size_t budget = 100;
+        check(run(pattern, "needle" + std::string(100000, 'x'), budget) == TargetPattern::Result::Hit, "early hit within a small budget");
+
+        // Scratch sized for a larger program is reused for a smaller one and back.
+        TargetPattern large;
+        TargetPattern small;
+        large.compile("^(worker|agent)-[0-9]{1,6}$", error);
+        small.compile("b+", error);
+        TargetPattern::Scratch scratch;
+        for (int round = 0; round < 3; ++round)
+        {
+            budget = std::numeric_limits<std::size_t>::max();
+            check(large.search("worker-123", budget, scratch) == TargetPattern::Result::Hit, "reused scratch, large program");
+            check(small.search("aaa", budget, scratch) == TargetPattern::Result::Miss, "reused scratch, small program");
+            check(small.search("abb", budget, scratch) == TargetPattern::Result::Hit, "reused scratch, small program hit");
+        }
+    }
+
+    void queries()
+    {
+        std::vector<TargetQuery> parsed;
+        std::string error;
+        check(TargetQuery::parse_list("nginx,prefix:web-,re:^a{1,3},b$", parsed, error) && parsed.size() == 3 &&
+                  parsed[0].kind == TargetQuery::Kind::Substring && parsed[1].kind == TargetQuery::Kind::Prefix &&
+                  parsed[2].kind == TargetQuery::Kind::Regex,
+              "a re: term takes the rest of the list, commas included");
+
+        parsed.clear();
+        check(!TargetQuery::parse_list("re:" + std::string(129, 'a'), parsed, error) && error.find("too long") != std::string::npos,
+              "over-long expressions are rejected (" + error + ")");
+        parsed.clear();
+        check(TargetQuery::parse_list("re:" + std::string(128, 'a'), parsed, error), "an expression of the maximum length is accepted");
+        parsed.clear();
+        check(!TargetQuery::parse_list("re:[abc", parsed, error) && error.find("missing ']'") != std::string::npos,
+              "a malformed expression is rejected with the reason (" + error + ")");
+
+        // Over a snapshot whose command lines need more steps than one query may use, the result is flagged.
+        auto arena = std::make_shared<SnapshotArena>();
+        SystemMetrics snapshot{};
+        snapshot.arena = arena;
+        snapshot.sections = SECTION_ALL;
+        snapshot.collectedSections = SECTION_ALL;
+        for (int i = 0; i < 500; ++i)
+        {
+            ApplicationUsage app{};
+            app.pid = 1000 + i;
+            app.name = arena->intern("worker-" + std::to_string(i));
+            app.commandLine = arena->intern(std::string(4000, 'b'));
+            app.pssAgeMs = -1.0;
+            app.cgroupAgeMs = -1.0;
+            snapshot.topApplications.push_back(app);
+        }
+
+        parsed.clear();
+        TargetQuery::parse_list("re:^worker-1[0-9]$", parsed, error);
+        TargetIndex::Matches found = TargetIndex().match(snapshot, parsed);
+        check(!found.budget_exhausted && found.applications.size() == 10, "an anchored expression matches its ten workers");
+
+        parsed.clear();
+        TargetQuery::parse_list("re:(ab|ba|b)*x", parsed, error);
+        found = TargetIndex().match(snapshot, parsed);
+        check(found.budget_exhausted, "an expression that exceeds the step budget is flagged, not truncated");
+    }
+
+} // namespace
+
+int main()
+{
+    grammar();
+    differential();
+    rejections();
+    budget();
+    queries();
+    std::cout << (failures == 0 ? "all checks passed" : std::to_string(failures) + " checks failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -50,7 +50,8 @@ function App() {
     previousMetric,
     connectionState,
     health,
-    statusEvents
+    statusEvents,
+    anomalies
   } = useLiveMetrics({ retentionSeconds });
 
   const stats = useMemo(() => buildStatistics(metrics), [metrics]);
@@ -207,7 +208,7 @@ function App() {
             <>
               <section className="panel-grid panel-grid--balanced" aria-label="Workload focus">
                 <ApplicationUsagePanel applications={latestMetric?.applications ?? []} />
-                <OptimizationInsightsPanel latestMetric={latestMetric} stats={stats} />
+                <OptimizationInsightsPanel latestMetric={latestMetric} stats={stats} anomalies={anomalies} />
               </section>
 
               <section className="panel-grid panel-grid--balanced" aria-label="Security and containers">
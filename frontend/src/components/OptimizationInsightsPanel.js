@@ -9,10 +9,10 @@ const severityIcon = {
   success: "✅",
 };
 
-function OptimizationInsightsPanel({ latestMetric, stats }) {
+function OptimizationInsightsPanel({ latestMetric, stats, anomalies }) {
   const insights = useMemo(
-    () => generateOptimizationInsights({ latestMetric, stats }),
-    [latestMetric, stats]
+    () => generateOptimizationInsights({ latestMetric, stats, anomalies }),
+    [latestMetric, stats, anomalies]
   );
 
   const hasInsights = insights.length > 0;
@@ -28,6 +28,7 @@ export const useLiveMetrics = ({ retentionSeconds } = {}) => {
   const [metrics, setMetrics] = useState([]);
   const [connectionState, setConnectionState] = useState("connecting");
   const [statusEvents, setStatusEvents] = useState([]);
+  const [anomalies, setAnomalies] = useState([]);
   const previousHealth = useRef("unknown");
   const retentionRef = useRef(
     Number.isFinite(retentionSeconds) && retentionSeconds > 0
@@ -84,6 +85,13 @@ export const useLiveMetrics = ({ retentionSeconds } = {}) => {
       ws.onmessage = (event) => {
         try {
           const payload = JSON.parse(event.data);
+          if (payload && typeof payload.type === "string") {
+            // Control replies and alert/anomaly events share the socket with snapshots.
+            if (payload.type === "anomaly") {
+              setAnomalies((prev) => [payload, ...prev].slice(0, 20));
+            }
+            return;
+          }
           const metric = normaliseMetricPayload(payload);
 
           appendMetric(metric);
@@ -151,5 +159,6 @@ export const useLiveMetrics = ({ retentionSeconds } = {}) => {
     connectionState: sanitiseConnectionState(connectionState),
     health,
     statusEvents,
+    anomalies,
   };
 };
@@ -70,8 +70,47 @@ const sortInsights = (insights) =>
     })
     .map(({ _index, ...rest }) => rest);
 
-export const generateOptimizationInsights = ({ latestMetric, stats }) => {
+const anomalySeriesLabel = {
+  cpu: 'CPU usage',
+  memory: 'Memory usage',
+  netRx: 'Inbound traffic',
+  netTx: 'Outbound traffic',
+  'container.cpu': 'Container CPU',
+  'container.memory': 'Container memory'
+};
+
+const formatAnomalyValue = (series, value) =>
+  series === 'netRx' || series === 'netTx' ? formatThroughput(value) : formatPercentLabel(value);
+
+// Latest backend anomaly event per series; only series still outside their band are returned.
+const activeAnomalies = (anomalies) => {
+  if (!Array.isArray(anomalies)) {
+    return [];
+  }
+  const latest = new Map();
+  anomalies.forEach((event) => {
+    const key = `${event.series}|${event.instance || ''}`;
+    if (!latest.has(key)) {
+      latest.set(key, event);
+    }
+  });
+  return [...latest.values()].filter((event) => event.state === 'anomalous');
+};
+
+export const generateOptimizationInsights = ({ latestMetric, stats, anomalies }) => {
   const insights = [];
+
+  activeAnomalies(anomalies).forEach((event) => {
+    const label = anomalySeriesLabel[event.series] || event.series;
+    const subject = event.instance ? `${label} (${event.instance})` : label;
+    pushInsight(insights, {
+      id: `anomaly-${event.series}-${event.instance || 'host'}`,
+      severity: 'warning',
+      title: `${subject} is behaving unusually`,
+      description: `The backend detectors flagged ${formatAnomalyValue(event.series, event.value)} against an expected ${formatAnomalyValue(event.series, event.expected)} (band ${formatAnomalyValue(event.series, event.lower)} – ${formatAnomalyValue(event.series, event.upper)}).`,
+      actions: ['Check recent deployments, cron jobs or traffic changes around this time.']
+    });
+  });
   const cpu = toNumber(latestMetric?.cpu);
   const cpuAvg = getStatValue(stats, 'cpu', 'avg');
   const cpuPeak = getStatValue(stats, 'cpu', 'peak');